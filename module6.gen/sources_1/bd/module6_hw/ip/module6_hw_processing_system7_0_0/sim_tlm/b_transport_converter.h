@@ -50,12 +50,24 @@
 #include <systemc>
 #include "tlm_utils/simple_target_socket.h"
 #include "tlm_utils/simple_initiator_socket.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <utility>
 #include <vector>
 
 template<int IN_WIDTH, int OUT_WIDTH>
 class b_transport_converter: public sc_core::sc_module 
 {
+    static_assert(OUT_WIDTH >= 8 && (OUT_WIDTH & (OUT_WIDTH - 1)) == 0,
+            "OUT_WIDTH must be a power of two number of bytes");
+
+    //bytes a beat on the initiator socket side, a constant so the beat
+    //count of a burst is shifts and masks for every width pair
+    static const unsigned int OUT_BEAT_BYTES = OUT_WIDTH / 8;
+
+    public:
     enum TLM_IF_TYPE
     {
         B_TRANSPORT = 0,
@@ -64,17 +76,24 @@ class b_transport_converter: public sc_core::sc_module
         DMI_IF,
         INVALID_IF
     };
-    typedef std::vector<std::pair<sc_dt::uint64, sc_dt::uint64>> addr_range_list;
+
+    private:
+    typedef std::pair<sc_dt::uint64, sc_dt::uint64> addr_range;
+    typedef std::vector<addr_range> addr_range_list;
 
     public:
         SC_HAS_PROCESS(b_transport_converter);
         b_transport_converter<IN_WIDTH, OUT_WIDTH>(sc_core::sc_module_name name): 
-            sc_module(name)
+            sc_module(name), m_dmi_valid(false)
     {
         target_socket.register_b_transport(
                 this, &b_transport_converter<IN_WIDTH, OUT_WIDTH>::b_transport);
+        target_socket.register_get_direct_mem_ptr(
+                this, &b_transport_converter<IN_WIDTH, OUT_WIDTH>::get_direct_mem_ptr);
         initiator_socket.register_nb_transport_bw(
                 this, &b_transport_converter<IN_WIDTH, OUT_WIDTH>::nb_transport_bw);
+        initiator_socket.register_invalidate_direct_mem_ptr(
+                this, &b_transport_converter<IN_WIDTH, OUT_WIDTH>::invalidate_direct_mem_ptr);
 
     }
 
@@ -82,27 +101,117 @@ class b_transport_converter: public sc_core::sc_module
         tlm_utils::simple_target_socket<b_transport_converter<IN_WIDTH, OUT_WIDTH>, IN_WIDTH>    target_socket;
         tlm_utils::simple_initiator_socket<b_transport_converter<IN_WIDTH, OUT_WIDTH>, OUT_WIDTH> initiator_socket;
 
+        //Routes [start, end) through the given interface. Addresses in no
+        //range go through nb_transport. Ranges are shared by all converters
+        //of the same widths and are added before the simulation starts.
+        static void add_addr_range(TLM_IF_TYPE type, sc_dt::uint64 start, sc_dt::uint64 end)
+        {
+            switch(type)
+            {
+                case B_TRANSPORT:   m_b_transport_addr_list.push_back(std::make_pair(start, end)); break;
+                case NB_TRANSPORT:  m_nb_transport_addr_list.push_back(std::make_pair(start, end)); break;
+                case TRANSPORT_DBG: m_dbg_transport_addr_list.push_back(std::make_pair(start, end)); break;
+                case DMI_IF:        m_dmi_addr_list.push_back(std::make_pair(start, end)); break;
+                default:            break;
+            }
+        }
+
+        //Adds the ranges in list: comma separated type:start:size entries,
+        //type one of b, nb, dbg or dmi and the numbers as strtoull reads
+        //them, e.g. "dmi:0x0:0x10000,b:0x1200000:0x1000". Returns false at
+        //the first malformed entry; the ones before it are added.
+        static bool add_addr_ranges(const char* list)
+        {
+            std::string s(list);
+            size_t pos = 0;
+
+            while(pos < s.size()) {
+                size_t end = s.find(',', pos);
+                if(end == std::string::npos) {
+                    end = s.size();
+                }
+                std::string item = s.substr(pos, end - pos);
+                pos = end + 1;
+                if(item.empty()) {
+                    continue;
+                }
+
+                size_t colon = item.find(':');
+                std::string kind = item.substr(0, colon);
+                TLM_IF_TYPE type = kind == "b" ? B_TRANSPORT :
+                                   kind == "nb" ? NB_TRANSPORT :
+                                   kind == "dbg" ? TRANSPORT_DBG :
+                                   kind == "dmi" ? DMI_IF : INVALID_IF;
+                if(colon == std::string::npos || type == INVALID_IF) {
+                    return false;
+                }
+
+                const char* p = item.c_str() + colon + 1;
+                char* q;
+                sc_dt::uint64 start = strtoull(p, &q, 0);
+                if(q == p || *q != ':') {
+                    return false;
+                }
+                p = q + 1;
+                sc_dt::uint64 size = strtoull(p, &q, 0);
+                if(q == p || *q != '\0' || size == 0) {
+                    return false;
+                }
+                add_addr_range(type, start, start + size);
+            }
+            return true;
+        }
+
 
     public:
         void b_transport(tlm::tlm_generic_payload& payload, sc_core::sc_time& time)
         {
             tlm::tlm_phase phase = tlm::BEGIN_REQ; //for nb_transport_fw
+
+            //the region held is all in one DMI_IF range, so this comes
+            //before the range lists are searched
+            if(dmi_transport(payload, time)) {
+                return;
+            }
             switch(get_tlm_if_type(payload.get_address()))
             {
                 case B_TRANSPORT:
                     initiator_socket->b_transport(payload, time);
                     break;
 
+                case DMI_IF:
+                    //DMI ranges take b_transport too, from initiators that
+                    //have no pointer yet or were refused one or never ask,
+                    //as remote-port. The converter keeps a pointer of its
+                    //own for them.
+                    initiator_socket->b_transport(payload, time);
+                    if(!m_dmi_valid && payload.is_response_ok() && payload.is_dmi_allowed()) {
+                        m_dmi.init();
+                        m_dmi_valid = get_direct_mem_ptr(payload, m_dmi);
+                    }
+                    break;
+
                 case NB_TRANSPORT:
-                    initiator_socket->nb_transport_fw(payload, phase, time);
-                    wait(resp_complete_event); //! Wait for the response to complete
+                    //The request goes out at the initiator's local time,
+                    //time ahead of the kernel under temporal decoupling.
+                    //A response that comes back later through
+                    //nb_transport_bw is waited for in kernel time, which
+                    //then holds the local offset, so it is used up.
+                    if(initiator_socket->nb_transport_fw(payload, phase, time) == tlm::TLM_COMPLETED) {
+                        //response and its latency already in time
+                    } else if(phase == tlm::BEGIN_RESP) {
+                        phase = tlm::END_RESP;
+                        initiator_socket->nb_transport_fw(payload, phase, time);
+                    } else {
+                        wait(resp_complete_event); //! Wait for the response to complete
+                        time = sc_core::SC_ZERO_TIME;
+                    }
+                    payload.set_dmi_allowed(false);
                     break;
 
                 case TRANSPORT_DBG:
                     initiator_socket->transport_dbg(payload);
-                    break;
-
-                case DMI_IF:
+                    payload.set_dmi_allowed(false);
                     break;
 
                 default:
@@ -110,12 +219,56 @@ class b_transport_converter: public sc_core::sc_module
             }
         }
 
+        //DMI is passed through for addresses in B_TRANSPORT and DMI_IF
+        //ranges. The region the target grants is cut down to the range the
+        //address is in, so an initiator holding the pointer never reaches
+        //past it into addresses that must go through nb_transport. Elsewhere
+        //DMI is refused, for as wide a region as holds no DMI range.
+        bool get_direct_mem_ptr(tlm::tlm_generic_payload& payload, tlm::tlm_dmi& dmi_data)
+        {
+            sc_dt::uint64 address = payload.get_address();
+            addr_range range;
+            bool granted;
+
+            if(!get_dmi_range(address, range)) {
+                dmi_data.set_start_address(range.first);
+                dmi_data.set_end_address(range.second - 1);
+                return false;
+            }
+            granted = initiator_socket->get_direct_mem_ptr(payload, dmi_data);
+
+            //clip to range, moving the pointer along with the start address
+            if(dmi_data.get_start_address() < range.first) {
+                if(granted) {
+                    dmi_data.set_dmi_ptr(dmi_data.get_dmi_ptr() +
+                            (range.first - dmi_data.get_start_address()));
+                }
+                dmi_data.set_start_address(range.first);
+            }
+            if(dmi_data.get_end_address() > range.second - 1) {
+                dmi_data.set_end_address(range.second - 1);
+            }
+            return granted;
+        }
+
+        //Invalidations from the target reach the initiator for the parts of
+        //[start, end] in DMI ranges, the only ones it can hold pointers to.
+        void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+        {
+            if(m_dmi_valid && start <= m_dmi.get_end_address() &&
+                    end >= m_dmi.get_start_address()) {
+                m_dmi_valid = false;
+            }
+            invalidate_in(m_b_transport_addr_list, start, end);
+            invalidate_in(m_dmi_addr_list, start, end);
+        }
+
         tlm::tlm_sync_enum
             nb_transport_bw(tlm::tlm_generic_payload& payload, 
                     tlm::tlm_phase& phase, sc_core::sc_time& time)
             {
                 if(phase == tlm::BEGIN_RESP) {
-                    resp_complete_event.notify();
+                    resp_complete_event.notify(time);
                     phase = tlm::END_RESP;
                     return tlm::TLM_UPDATED;
                 }
@@ -123,39 +276,135 @@ class b_transport_converter: public sc_core::sc_module
             }
 
     private:
+        //A transaction in the region the converter holds a pointer to is a
+        //memcpy, whatever its length, when it has no byte enables and no
+        //streaming: one pass however many beats it is. It takes the DMI
+        //latency for each beat on the initiator side's bus. Anything else
+        //goes to the target.
+        bool dmi_transport(tlm::tlm_generic_payload& payload, sc_core::sc_time& time)
+        {
+            sc_dt::uint64 address = payload.get_address();
+            unsigned int length = payload.get_data_length();
+            unsigned char* ptr;
+            unsigned int beats;
+
+            if(!m_dmi_valid || length == 0 || payload.get_byte_enable_ptr() != NULL ||
+                    payload.get_streaming_width() < length ||
+                    address < m_dmi.get_start_address() ||
+                    address - m_dmi.get_start_address() + (length - 1) >
+                    m_dmi.get_end_address() - m_dmi.get_start_address()) {
+                return false;
+            }
+            ptr = m_dmi.get_dmi_ptr() + (address - m_dmi.get_start_address());
+            beats = (unsigned int)((address % OUT_BEAT_BYTES + length + OUT_BEAT_BYTES - 1) /
+                    OUT_BEAT_BYTES);
+            if(payload.is_read() && m_dmi.is_read_allowed()) {
+                std::memcpy(payload.get_data_ptr(), ptr, length);
+                time += beats * m_dmi.get_read_latency();
+            } else if(payload.is_write() && m_dmi.is_write_allowed()) {
+                std::memcpy(ptr, payload.get_data_ptr(), length);
+                time += beats * m_dmi.get_write_latency();
+            } else {
+                return false;
+            }
+            payload.set_dmi_allowed(true);
+            payload.set_response_status(tlm::TLM_OK_RESPONSE);
+            return true;
+        }
+
+        static bool in_range(const addr_range& range, sc_dt::uint64 address)
+        {
+            return address >= range.first && address < range.second;
+        }
+
         TLM_IF_TYPE get_tlm_if_type(unsigned long long address)
         {
             //check for b_transport addresses
             for(auto& addr_range: m_b_transport_addr_list) {
-                if(address >= addr_range.first && address < addr_range.second) {
+                if(in_range(addr_range, address)) {
                     return B_TRANSPORT;
                 }
             }
 
             //check for nb_transport addresses
             for(auto& addr_range: m_nb_transport_addr_list) {
-                if(address >= addr_range.first && address < addr_range.second) {
+                if(in_range(addr_range, address)) {
                     return NB_TRANSPORT;
                 }
             }
             //check for dbg_transport addresses
             for(auto& addr_range: m_dbg_transport_addr_list) {
-                if(address >= addr_range.first && address < addr_range.second) {
+                if(in_range(addr_range, address)) {
                     return TRANSPORT_DBG;
                 }
             }
+            //check for dmi addresses
+            for(auto& addr_range: m_dmi_addr_list) {
+                if(in_range(addr_range, address)) {
+                    return DMI_IF;
+                }
+            }
 
             //By default return NB_TRANSPORT
             return NB_TRANSPORT;
         }
 
+        //The range address is routed through, and whether DMI may be granted
+        //there. Outside all ranges the range returned is the gap between the
+        //nearest ranges either side.
+        bool get_dmi_range(sc_dt::uint64 address, addr_range& range)
+        {
+            const addr_range_list* lists[] = {
+                &m_b_transport_addr_list, &m_nb_transport_addr_list,
+                &m_dbg_transport_addr_list, &m_dmi_addr_list
+            };
+            TLM_IF_TYPE type = get_tlm_if_type(address);
+            sc_dt::uint64 low = 0, high = ~(sc_dt::uint64)0;
+
+            for(auto list: lists) {
+                for(auto& r: *list) {
+                    if(r.first == r.second) {
+                        continue;
+                    }
+                    if(in_range(r, address)) {
+                        range = r;
+                        return type == B_TRANSPORT || type == DMI_IF;
+                    }
+                    if(r.second <= address && r.second > low) {
+                        low = r.second;
+                    }
+                    if(r.first > address && r.first < high) {
+                        high = r.first;
+                    }
+                }
+            }
+            range = std::make_pair(low, high);
+            return false;
+        }
+
+        void invalidate_in(const addr_range_list& list, sc_dt::uint64 start, sc_dt::uint64 end)
+        {
+            for(auto& r: list) {
+                if(r.first == r.second || end < r.first || start >= r.second) {
+                    continue;
+                }
+                target_socket->invalidate_direct_mem_ptr(std::max(start, r.first),
+                        std::min(end, r.second - 1));
+            }
+        }
+
         //Start and End Address List for each of interfaces...
         static addr_range_list  m_b_transport_addr_list;
         static addr_range_list  m_nb_transport_addr_list;
         static addr_range_list  m_dbg_transport_addr_list;
+        static addr_range_list  m_dmi_addr_list;
 
         //event to notify completion of transaction
         sc_core::sc_event  resp_complete_event;
+
+        //DMI region held for the b_transport of DMI_IF ranges
+        tlm::tlm_dmi  m_dmi;
+        bool          m_dmi_valid;
 };
 
 template<int IN_WIDTH, int OUT_WIDTH>
@@ -164,6 +413,8 @@ template<int IN_WIDTH, int OUT_WIDTH>
 typename b_transport_converter<IN_WIDTH,OUT_WIDTH>::addr_range_list b_transport_converter<IN_WIDTH,OUT_WIDTH>::m_nb_transport_addr_list = {std::make_pair(0, 0)};
 template<int IN_WIDTH, int OUT_WIDTH>
 typename b_transport_converter<IN_WIDTH,OUT_WIDTH>::addr_range_list b_transport_converter<IN_WIDTH,OUT_WIDTH>::m_dbg_transport_addr_list = {std::make_pair(0, 0)};
+template<int IN_WIDTH, int OUT_WIDTH>
+typename b_transport_converter<IN_WIDTH,OUT_WIDTH>::addr_range_list b_transport_converter<IN_WIDTH,OUT_WIDTH>::m_dmi_addr_list = {std::make_pair(0, 0)};
 
 
 #endif /* _B_TRANSPORT_CONVERTER_H_ */
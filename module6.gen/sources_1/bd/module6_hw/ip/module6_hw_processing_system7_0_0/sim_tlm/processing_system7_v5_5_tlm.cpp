@@ -58,6 +58,20 @@ rptlm2xtlm_converter<IN_WIDTH, OUT_WIDTH>::rptlm2xtlm_converter(sc_module_name n
     ,m_btrans_conv("b_transport_converter")
     ,xtlm_bridge("tlm2xtlmbridge")
 {
+    //Which GP0 addresses take b_transport, DMI or transport_dbg instead of
+    //nb_transport, from COSIM_GP0_RANGES (see add_addr_ranges()), in the
+    //addresses the GP0 transactions carry. Unset, all of them take
+    //nb_transport. The ranges are shared by converters of the same widths,
+    //so they are read once.
+    static bool ranges_read = false;
+    char* ranges = getenv("COSIM_GP0_RANGES");
+    if (ranges != nullptr && !ranges_read) {
+        ranges_read = true;
+        if (!b_transport_converter<IN_WIDTH, OUT_WIDTH>::add_addr_ranges(ranges)) {
+            SC_REPORT_ERROR(this->name(),
+                    "COSIM_GP0_RANGES: expected type:start:size entries, type b, nb, dbg or dmi");
+        }
+    }
     target_socket.bind(m_btrans_conv.target_socket);
     m_btrans_conv.initiator_socket.bind(xtlm_bridge.target_socket);
     xtlm_bridge.rd_socket->bind(rd_socket);
@@ -209,6 +223,15 @@ processing_system7_v5_5_tlm :: processing_system7_v5_5_tlm (sc_core::sc_module_n
 	    }
 
 	    const char* skt = skt_name.c_str();
+
+	    //Temporal decoupling: remote-port's quantum keeper lets SystemC run
+	    //this far ahead of the kernel between syncs with QEMU. In ns, as
+	    //QEMU's -sync-quantum, which it should match; unset keeps the
+	    //simulator's global quantum.
+	    char* sync_quantum = getenv("COSIM_SYNC_QUANTUM");
+	    if (sync_quantum != nullptr) {
+	    	tlm::tlm_global_quantum::instance().set(sc_time(strtod(sync_quantum, NULL), SC_NS));
+	    }
         m_zynq_tlm_model = new xilinx_zynq("xilinx_zynq",skt);
 
         //instantiating TLM2XTLM bridge and stiching it between 
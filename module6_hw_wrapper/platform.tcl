@@ -20,3 +20,14 @@ domain active {zynq_fsbl}
 domain active {standalone_ps7_cortexa9_0}
 platform generate -quick
 platform generate
+repo -set {/thayerfs/home/f005cpz/workspace/module6/sw_repo}
+domain active {standalone_ps7_cortexa9_0}
+bsp setlib -name xilffs -ver 4.6
+bsp config cache_sectors "32"
+bsp write
+bsp reload
+domain active {zynq_fsbl}
+bsp config cache_sectors "0"
+bsp write
+bsp reload
+platform generate
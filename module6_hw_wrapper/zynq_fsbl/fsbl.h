@@ -270,6 +270,10 @@
 * RSA_SUPPORT
 * This flag is used to enable authentication feature
 * Default this macro disabled, reason to avoid increase in code size
+* Authentication uses the in-tree verifier (rsa2048.c, sha256.c): the PPK
+* Montgomery constants are computed once in SetPpk(), a verified SPK is
+* not checked again for later partitions and signed partitions are hashed
+* while they are copied from the boot device.
 *
 * MMC_SUPPORT
 * This flag is used to enable MMC support feature
@@ -286,6 +290,36 @@
 * Note : Changing the default behaviour is not recommended from
 * Security perspective.
 *
+* FSBL_TIMELINE_EXCLUDE
+* Defining this flag removes the boot timeline markers (fsbl_timeline.h).
+* By default every boot stage is time stamped into the reserved OCM window
+* at 0xFFFFFC00 so the application can report the boot time after handoff.
+*
+* PCAP_ASYNC_EXCLUDE
+* Defining this flag loads bitstreams synchronously again. By default the
+* bitstream DMA is started from a staging area at the top of DDR and the
+* following partitions are fetched and verified while it runs, completion
+* is signalled by the DevC interrupt. FsblHookAfterBitstreamDload() is
+* called once the PCAP is done, before the next bitstream or the handoff.
+*
+* COMPRESSION_EXCLUDE
+* Defining this flag removes the LZ4 decompressor (lz4.c). By default a PS
+* partition with ATTRIBUTE_COMPRESSED_MASK set (see tools/lz4pack) is read
+* from the boot device into a staging area at the top of DDR, verified
+* there and inflated to its load address.
+*
+* SD_FAST_PATH_EXCLUDE
+* Defining this flag makes SDAccess() use f_lseek/f_read for every request.
+* By default the FAT chain of the boot file is mapped once at InitSD (the
+* BSP builds xilffs without FF_USE_FASTSEEK) and partitions are read with
+* multi-block commands straight into cache line aligned destinations.
+*
+* IMAGE_DIR_EXCLUDE
+* Defining this flag makes fallback search the flash 32 KB at a time again.
+* By default the image directory written by tools/imgdir into the last
+* 32 KB of the boot device is read once and the multiboot register is set
+* to the next image it lists (see image_dir.h).
+*
 *******************************************************************************/
 #ifndef XIL_FSBL_H
 #define XIL_FSBL_H
@@ -360,6 +394,7 @@ extern "C" {
 #define RSA_SUPPORT_NOT_ENABLED_FAIL	0xA011 /**< RSA not enabled fail */
 #define PS7_INIT_FAIL			0xA012 /**< ps7 Init Fail */
 #define PARTITION_LOAD_FAIL            0xA013 /**< Partition load fail*/
+#define DECOMPRESSION_FAIL		0xA014 /**< Decompression fail */
 /*
  * FSBL Exception error codes
  */
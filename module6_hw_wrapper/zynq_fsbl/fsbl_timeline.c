@@ -0,0 +1,142 @@
+/*****************************************************************************/
+/**
+*
+* @file fsbl_timeline.c
+*
+* Contains the code for the boot timeline markers. Refer to fsbl_timeline.h
+* for the record layout.
+*
+* @note
+*	The record is written through plain stores. main() flushes and disables
+*	the data cache right after ps7_init, so every marker taken afterwards
+*	lands directly in OCM and is visible to the application after handoff.
+*
+******************************************************************************/
+
+/***************************** Include Files *********************************/
+#include "fsbl.h"
+#include "fsbl_timeline.h"
+#include "xtime_l.h"
+
+#ifndef FSBL_TIMELINE_EXCLUDE
+
+/************************** Constant Definitions *****************************/
+
+/**************************** Type Definitions *******************************/
+
+/***************** Macros (Inline Functions) Definitions *********************/
+#define TimelinePtr	((volatile FsblTimeline *)FSBL_TL_BASEADDR)
+
+/************************** Function Prototypes ******************************/
+
+/************************** Variable Definitions *****************************/
+/*
+ * Set once ps7_init has locked the PLLs and the global timer runs at
+ * COUNTS_PER_SECOND
+ */
+static u8 TimelinePllLocked;
+
+/*****************************************************************************/
+/**
+*
+* This function clears the boot timeline record and takes the entry marker.
+* It must be the first call in main(), before ps7_init.
+*
+* @param	None
+*
+* @return	None
+*
+* @note		None
+*
+****************************************************************************/
+void FsblTimelineInit(void)
+{
+	volatile u32 *Word = (volatile u32 *)FSBL_TL_BASEADDR;
+	u32 Index;
+
+	/*
+	 * Invalidate first so a reader never sees a half written record
+	 */
+	TimelinePtr->Magic = 0;
+
+	for (Index = 1; Index < (FSBL_TL_SIZE >> WORD_LENGTH_SHIFT); Index++) {
+		Word[Index] = 0;
+	}
+
+	TimelinePllLocked = 0;
+	TimelinePtr->Version = FSBL_TL_VERSION;
+	TimelinePtr->CountsPerSecond = COUNTS_PER_SECOND;
+	TimelinePtr->Magic = FSBL_TL_MAGIC;
+
+	FsblTimelineMark(FSBL_TL_STAGE_ENTRY, 0);
+}
+
+/*****************************************************************************/
+/**
+*
+* This function records a stage marker with the current global timer value
+*
+* @param	Stage is one of the FSBL_TL_STAGE_* markers
+* @param	Arg is a stage specific argument (partition number, boot mode,
+*			handoff address)
+*
+* @return	None
+*
+* @note		Markers beyond FSBL_TL_MAX_ENTRIES are dropped and the
+*			overflow flag is set in the header.
+*
+****************************************************************************/
+void FsblTimelineMark(u32 Stage, u32 Arg)
+{
+	volatile FsblTimelineEntry *Entry;
+	XTime tCur = 0;
+	u32 Count;
+
+	XTime_GetTime(&tCur);
+
+	Count = TimelinePtr->Count;
+	if (Count >= FSBL_TL_MAX_ENTRIES) {
+		TimelinePtr->Flags |= FSBL_TL_HDR_OVERFLOW;
+		return;
+	}
+
+	Entry = &TimelinePtr->Entry[Count];
+	Entry->Stage = (u16)Stage;
+	Entry->Flags = TimelinePllLocked ? 0 : FSBL_TL_FLAG_PRE_PLL;
+	Entry->Arg = Arg;
+	Entry->TimeLo = (u32)tCur;
+	Entry->TimeHi = (u32)(tCur >> 32);
+
+	if (Stage == FSBL_TL_STAGE_PS7_INIT) {
+		TimelinePllLocked = 1;
+	}
+
+	if (Stage == FSBL_TL_STAGE_HANDOFF) {
+		TimelinePtr->Flags |= FSBL_TL_HDR_HANDOFF;
+	}
+
+	/*
+	 * Publish the entry only after it is complete
+	 */
+	dsb();
+	TimelinePtr->Count = (u16)(Count + 1);
+}
+
+/*****************************************************************************/
+/**
+*
+* This function stores the boot mode register value in the record header
+*
+* @param	BootMode is the masked boot mode register value
+*
+* @return	None
+*
+* @note		None
+*
+****************************************************************************/
+void FsblTimelineSetBootMode(u32 BootMode)
+{
+	TimelinePtr->BootMode = BootMode;
+}
+
+#endif
@@ -0,0 +1,123 @@
+/*****************************************************************************/
+/**
+*
+* @file fsbl_timeline.h
+*
+* Contains the layout of the boot timeline record and the stage markers the
+* FSBL writes into it.
+*
+* The record lives in a reserved 512 byte window at the top of the high OCM
+* (see lscript.ld). The FSBL stack never reaches it and the application
+* linker script keeps it out of its own placement, so the record survives
+* the handoff and can be read back by the application.
+*
+* Every marker stores the global timer value at the moment the stage
+* completed. The global timer is reset by the FSBL crt0 and runs at
+* COUNTS_PER_SECOND only once ps7_init has programmed the PLLs; the
+* FSBL_TL_STAGE_PS7_INIT marker is therefore taken in PLL bypass ticks and
+* is flagged with FSBL_TL_FLAG_PRE_PLL.
+*
+* @note
+*
+* FSBL_TIMELINE_EXCLUDE
+* Defining this flag compiles the markers out.
+*
+******************************************************************************/
+#ifndef ___FSBL_TIMELINE_H___
+#define ___FSBL_TIMELINE_H___
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************** Include Files *********************************/
+#include "xil_types.h"
+
+/************************** Constant Definitions *****************************/
+
+/*
+ * Reserved OCM window, keep in sync with lscript.ld of the FSBL and the
+ * application
+ */
+#define FSBL_TL_BASEADDR		0xFFFFFC00
+#define FSBL_TL_SIZE			0x200
+
+#define FSBL_TL_MAGIC			0x314C5442	/* "BTL1" */
+#define FSBL_TL_VERSION			1
+#define FSBL_TL_MAX_ENTRIES		((FSBL_TL_SIZE - 32) / 16)
+
+/*
+ * Entry flags
+ */
+#define FSBL_TL_FLAG_PRE_PLL		0x1	/* Ticks taken before ps7_init */
+
+/*
+ * Header flags
+ */
+#define FSBL_TL_HDR_OVERFLOW		0x1	/* Markers were dropped */
+#define FSBL_TL_HDR_HANDOFF		0x2	/* Handoff marker written */
+
+/*
+ * Stage markers, each is taken when the stage completes
+ */
+#define FSBL_TL_STAGE_ENTRY			0x00 /**< main() entered */
+#define FSBL_TL_STAGE_PS7_INIT		0x01 /**< ps7_init done */
+#define FSBL_TL_STAGE_DDR_CHECK		0x02 /**< DDRInitCheck done */
+#define FSBL_TL_STAGE_PCAP_INIT		0x03 /**< InitPcap done */
+#define FSBL_TL_STAGE_BOOTDEV_INIT	0x04 /**< InitQspi/InitSD.. done, Arg=mode */
+#define FSBL_TL_STAGE_HEADERS		0x05 /**< Partition headers read */
+#define FSBL_TL_STAGE_PART_START	0x06 /**< Partition load start, Arg=num */
+#define FSBL_TL_STAGE_PART_MOVED	0x07 /**< PartitionMove done, Arg=num */
+#define FSBL_TL_STAGE_PART_CHECKED	0x08 /**< Checksum/auth done, Arg=num */
+#define FSBL_TL_STAGE_FABRIC_INIT	0x09 /**< FabricInit done */
+#define FSBL_TL_STAGE_PCAP_DMA		0x0A /**< PCAP DMA done, Arg=irq lag */
+#define FSBL_TL_STAGE_PCAP_FPGA		0x0B /**< PCAP FPGA done, Arg=irq lag */
+#define FSBL_TL_STAGE_PART_DONE		0x0C /**< Partition loaded, Arg=num */
+#define FSBL_TL_STAGE_IMAGE_LOADED	0x0D /**< LoadBootImage done */
+#define FSBL_TL_STAGE_HANDOFF		0x0E /**< FsblHandoff, Arg=address */
+#define FSBL_TL_STAGE_FALLBACK		0x0F /**< FsblFallback entered */
+#define FSBL_TL_STAGE_PART_INFLATED	0x10 /**< Decompression done, Arg=num */
+
+/*
+ * A bitstream loaded in the background is only marked when PcapWaitAsync()
+ * collects it, the irq lag Arg is the number of ticks the DMA/FPGA done
+ * interrupt came before that, i.e. how much of the load was overlapped.
+ */
+
+/**************************** Type Definitions *******************************/
+
+typedef struct {
+	u16 Stage;		/* 0x0 */
+	u16 Flags;		/* 0x2 */
+	u32 Arg;		/* 0x4 */
+	u32 TimeLo;		/* 0x8 */
+	u32 TimeHi;		/* 0xC */
+} FsblTimelineEntry;
+
+typedef struct {
+	u32 Magic;		/* 0x0 */
+	u16 Version;		/* 0x4 */
+	u16 Count;		/* 0x6 */
+	u32 CountsPerSecond;	/* 0x8 */
+	u32 Flags;		/* 0xC */
+	u32 BootMode;		/* 0x10 */
+	u32 Pads[3];		/* 0x14 */
+	FsblTimelineEntry Entry[FSBL_TL_MAX_ENTRIES];	/* 0x20 */
+} FsblTimeline;
+
+/************************** Function Prototypes ******************************/
+#ifndef FSBL_TIMELINE_EXCLUDE
+void FsblTimelineInit(void);
+void FsblTimelineMark(u32 Stage, u32 Arg);
+void FsblTimelineSetBootMode(u32 BootMode);
+#else
+#define FsblTimelineInit()
+#define FsblTimelineMark(Stage, Arg)
+#define FsblTimelineSetBootMode(BootMode)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ___FSBL_TIMELINE_H___ */
@@ -0,0 +1,220 @@
+/*****************************************************************************/
+/**
+*
+* @file image_dir.c
+*
+* Contains the multiboot image directory lookup used by FsblFallback() and
+* NextValidImageCheck(). Refer to image_dir.h for the layout.
+*
+* @note
+*	The directory is read with one MoveImage() call the first time it is
+*	needed and kept in OCM, later lookups cost no flash access. MoveImage
+*	has to be set up, so the callers only use it once the boot device is
+*	initialized (SystemInitFlag).
+*
+******************************************************************************/
+
+/***************************** Include Files *********************************/
+#include "fsbl.h"
+#include "image_mover.h"
+#include "image_dir.h"
+
+#ifndef IMAGE_DIR_EXCLUDE
+
+/************************** Constant Definitions *****************************/
+#define IMAGE_DIR_UNREAD		0
+#define IMAGE_DIR_VALID			1
+#define IMAGE_DIR_INVALID		2
+
+/**************************** Type Definitions *******************************/
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+/************************** Function Prototypes ******************************/
+
+/************************** Variable Definitions *****************************/
+extern ImageMoverType MoveImage;
+
+static ImageDir Directory;
+static u8 DirectoryState = IMAGE_DIR_UNREAD;
+
+/*****************************************************************************/
+/**
+*
+* This function reads the directory from the boot device and checks it
+*
+* @param	DevSize is the size of the boot device in bytes
+*
+* @return
+*		- XST_SUCCESS if a valid directory is present
+*		- XST_FAILURE otherwise
+*
+* @note		The result is cached, the device is only read once.
+*
+****************************************************************************/
+static u32 ImageDirLoad(u32 DevSize)
+{
+	u32 *Word = (u32 *)&Directory;
+	u32 Checksum = 0;
+	u32 Index;
+
+	if (DirectoryState != IMAGE_DIR_UNREAD) {
+		return (DirectoryState == IMAGE_DIR_VALID) ?
+				XST_SUCCESS : XST_FAILURE;
+	}
+	DirectoryState = IMAGE_DIR_INVALID;
+
+	if (DevSize < (2 * GOLDEN_IMAGE_OFFSET)) {
+		return XST_FAILURE;
+	}
+
+	if (MoveImage(ImageDirOffset(DevSize), (u32)&Directory,
+			sizeof(Directory)) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	if ((Directory.Magic != IMAGE_DIR_MAGIC) ||
+			(Directory.Count == 0) ||
+			(Directory.Count > IMAGE_DIR_MAX_ENTRIES)) {
+		fsbl_printf(DEBUG_INFO, "No image directory\r\n");
+		return XST_FAILURE;
+	}
+
+	for (Index = 0; Index < (sizeof(Directory) / 4); Index++) {
+		if (Index != 3) {
+			Checksum += Word[Index];
+		}
+	}
+	if ((Checksum ^ 0xFFFFFFFF) != Directory.Checksum) {
+		fsbl_printf(DEBUG_GENERAL, "Image directory checksum failed\r\n");
+		return XST_FAILURE;
+	}
+
+	/*
+	 * Every entry must be a multiboot slot below the directory
+	 */
+	for (Index = 0; Index < Directory.Count; Index++) {
+		if (((Directory.Entry[Index].Offset % GOLDEN_IMAGE_OFFSET) != 0) ||
+				(Directory.Entry[Index].Offset >= ImageDirOffset(DevSize))) {
+			fsbl_printf(DEBUG_GENERAL, "Image directory entry %lu invalid\r\n",
+					Index);
+			return XST_FAILURE;
+		}
+	}
+
+	fsbl_printf(DEBUG_INFO, "Image directory: %lu images\r\n",
+			Directory.Count);
+	DirectoryState = IMAGE_DIR_VALID;
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function finds the directory entry of an image
+*
+* @param	Offset is the flash offset of the image
+*
+* @return	Index of the entry, Directory.Count if the image is not listed
+*
+****************************************************************************/
+static u32 ImageDirFind(u32 Offset)
+{
+	u32 Index;
+
+	for (Index = 0; Index < Directory.Count; Index++) {
+		if (Directory.Entry[Index].Offset == Offset) {
+			break;
+		}
+	}
+
+	return Index;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function returns the image to fall back to after an image failed
+*
+* @param	DevSize is the size of the boot device in bytes
+* @param	FailedOffset is the flash offset of the image that failed
+* @param	NextOffset returns the flash offset of the next image
+*
+* @return
+*		- XST_SUCCESS if the directory names a next image
+*		- XST_FAILURE if there is no directory or the failed image was
+*		the last entry
+*
+* @note		An image that is not listed falls back to the first entry.
+*
+****************************************************************************/
+u32 ImageDirNext(u32 DevSize, u32 FailedOffset, u32 *NextOffset)
+{
+	u32 Index;
+
+	if (ImageDirLoad(DevSize) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	Index = ImageDirFind(FailedOffset);
+	Index = (Index == Directory.Count) ? 0 : (Index + 1);
+	if (Index >= Directory.Count) {
+		fsbl_printf(DEBUG_INFO, "Image directory exhausted\r\n");
+		return XST_FAILURE;
+	}
+
+	*NextOffset = Directory.Entry[Index].Offset;
+	fsbl_printf(DEBUG_GENERAL, "Fallback to %s image v%lu at 0x%08lx\r\n",
+			(Directory.Entry[Index].Flags & IMAGE_DIR_FLAG_GOLDEN) ?
+					"golden" : "update",
+			Directory.Entry[Index].Version, *NextOffset);
+
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function checks an image against its directory entry. Only the boot
+* header checksum word is read; LoadBootImage() validates the partition
+* headers and the Boot ROM the boot header as usual.
+*
+* @param	DevSize is the size of the boot device in bytes
+* @param	Offset is the flash offset of the image
+*
+* @return
+*		- XST_SUCCESS if the image is listed and its header checksum
+*		matches the directory
+*		- XST_FAILURE otherwise
+*
+* @note		None
+*
+****************************************************************************/
+u32 ImageDirVerify(u32 DevSize, u32 Offset)
+{
+	u32 HeaderChecksum;
+	u32 Index;
+
+	if (ImageDirLoad(DevSize) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	Index = ImageDirFind(Offset);
+	if (Index == Directory.Count) {
+		return XST_FAILURE;
+	}
+
+	if (MoveImage(Offset + IMAGE_CHECKSUM_OFFSET, (u32)&HeaderChecksum,
+			4) != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	if (HeaderChecksum != Directory.Entry[Index].HeaderChecksum) {
+		fsbl_printf(DEBUG_GENERAL, "Image at 0x%08lx does not match "
+				"the directory\r\n", Offset);
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+#endif
@@ -0,0 +1,84 @@
+/*****************************************************************************/
+/**
+*
+* @file image_dir.h
+*
+* Contains the layout of the multiboot image directory and the interface
+* the fallback path uses to read it.
+*
+* The directory is written by tools/imgdir into the last GOLDEN_IMAGE_OFFSET
+* (32 KB) slot of the boot device. It lists every boot image in the flash
+* in fallback order, usually the update images newest first followed by the
+* golden image, with the image offset, version and the boot header checksum
+* word (IMAGE_CHECKSUM_OFFSET) the image was written with.
+*
+* On fallback the FSBL reads the directory once, takes the entry after the
+* image that failed and points the multiboot register straight at it, so
+* neither the Boot ROM nor NextValidImageCheck() has to probe the flash 32 KB
+* at a time. When the directory is missing, corrupt or exhausted the linear
+* search is used as before.
+*
+* @note
+*
+* IMAGE_DIR_EXCLUDE
+* Defining this flag removes the directory lookup.
+*
+******************************************************************************/
+#ifndef ___IMAGE_DIR_H___
+#define ___IMAGE_DIR_H___
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************** Include Files *********************************/
+#include "xil_types.h"
+#include "xstatus.h"
+
+/************************** Constant Definitions *****************************/
+#define IMAGE_DIR_MAGIC			0x52494449	/* "IDIR" */
+#define IMAGE_DIR_MAX_ENTRIES	15
+#define IMAGE_DIR_SIZE			256
+
+/*
+ * Entry flags
+ */
+#define IMAGE_DIR_FLAG_GOLDEN	0x1	/* Golden image */
+
+/**************************** Type Definitions *******************************/
+typedef struct {
+	u32 Offset;		/* 0x0 Flash offset, multiple of 32 KB */
+	u32 Version;		/* 0x4 Image version, set by the packaging tool */
+	u32 HeaderChecksum;	/* 0x8 Boot header checksum word of the image */
+	u32 Flags;		/* 0xC IMAGE_DIR_FLAG_* */
+} ImageDirEntry;
+
+typedef struct {
+	u32 Magic;		/* 0x0 IMAGE_DIR_MAGIC */
+	u32 Count;		/* 0x4 Valid entries */
+	u32 Reserved;		/* 0x8 Zero */
+	u32 Checksum;		/* 0xC ~sum of the other 63 words */
+	ImageDirEntry Entry[IMAGE_DIR_MAX_ENTRIES];
+} ImageDir;
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+/*
+ * Flash offset of the directory on a boot device of the given size
+ */
+#define ImageDirOffset(DevSize)	((DevSize) - GOLDEN_IMAGE_OFFSET)
+
+/************************** Function Prototypes ******************************/
+#ifndef IMAGE_DIR_EXCLUDE
+u32 ImageDirNext(u32 DevSize, u32 FailedOffset, u32 *NextOffset);
+u32 ImageDirVerify(u32 DevSize, u32 Offset);
+#else
+#define ImageDirNext(DevSize, FailedOffset, NextOffset)	XST_FAILURE
+#define ImageDirVerify(DevSize, Offset)	XST_FAILURE
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ___IMAGE_DIR_H___ */
@@ -65,14 +65,17 @@
 #include "pcap.h"
 #include "fsbl_hooks.h"
 #include "md5.h"
+#include "fsbl_timeline.h"
 
 #ifdef XPAR_XWDTPS_0_BASEADDR
 #include "xwdtps.h"
 #endif
 
+#include "lz4.h"
+#include "xil_cache.h"
+
 #ifdef RSA_SUPPORT
 #include "rsa.h"
-#include "xil_cache.h"
 #endif
 /************************** Constant Definitions *****************************/
 
@@ -80,6 +83,12 @@
 #define MAXIMUM_IMAGE_WORD_LEN 0x40000000
 #define MD5_CHECKSUM_SIZE   16
 
+/*
+ * Bitstreams loading in the background and compressed partitions are
+ * staged at the top of DDR, aligned down to this
+ */
+#define STAGING_ALIGN	0x100000
+
 /**************************** Type Definitions *******************************/
 
 /***************** Macros (Inline Functions) Definitions *********************/
@@ -88,6 +97,8 @@
 u32 ValidateParition(u32 StartAddr, u32 Length, u32 ChecksumOffset);
 u32 GetPartitionChecksum(u32 ChecksumOffset, u8 *Checksum);
 u32 CalcPartitionChecksum(u32 SourceAddr, u32 DataLength, u8 *Checksum);
+static void BitstreamComplete(void);
+static u32 GetStagingAddr(u32 Top, u32 Length);
 
 /************************** Variable Definitions *****************************/
 /*
@@ -100,10 +111,24 @@ u8 SignedPartitionFlag;
 u8 PartitionChecksumFlag;
 u8 BitstreamFlag;
 u8 ApplicationFlag;
+u8 CompressedPartitionFlag;
 
 u32 ExecutionAddress;
 ImageMoverType MoveImage;
 
+/*
+ * DDR location PL partitions are copied to before they go to the PCAP,
+ * and whether the after bitstream hook still has to run
+ */
+static u32 PlStagingAddr = DDR_TEMP_START_ADDR;
+static u8 BitstreamPending;
+
+/*
+ * DDR location compressed partitions are copied to before they are
+ * inflated to their load address
+ */
+static u32 CompStagingAddr;
+
 /*
  * Header array
  */
@@ -212,6 +237,7 @@ u32 LoadBootImage(void)
 		OutputStatus(GET_HEADER_INFO_FAIL);
 		FsblFallback();
 	}
+	FsblTimelineMark(FSBL_TL_STAGE_HEADERS, 0);
 
 	/*
 	 * RSA is not implemented in 1.0 and 2.0
@@ -279,6 +305,7 @@ u32 LoadBootImage(void)
 	while (PartitionNum < PartitionCount) {
 
 		fsbl_printf(DEBUG_INFO, "Partition Number: %lu\r\n", PartitionNum);
+		FsblTimelineMark(FSBL_TL_STAGE_PART_START, PartitionNum);
 
 		HeaderPtr = &PartitionHeader[PartitionNum];
 
@@ -340,6 +367,21 @@ u32 LoadBootImage(void)
 #endif
 				break;
 			}
+
+			/*
+			 * Only one bitstream goes through the PCAP at a time
+			 */
+			BitstreamComplete();
+
+			PlStagingAddr = DDR_TEMP_START_ADDR;
+#ifndef PCAP_ASYNC_EXCLUDE
+			/*
+			 * Stage the bitstream at the top of DDR, clear of the
+			 * application that is fetched while it loads
+			 */
+			PlStagingAddr = GetStagingAddr(DDR_END_ADDR + 1,
+					PartitionTotalSize << WORD_LENGTH_SHIFT);
+#endif
 		}
 
 		if (PartitionAttr & ATTRIBUTE_PS_IMAGE_MASK) {
@@ -391,6 +433,46 @@ u32 LoadBootImage(void)
 			SignedPartitionFlag = 0;
 		}
 
+		/*
+		 * Compressed partition check, only plain PS partitions can be
+		 * inflated
+		 */
+		if (PartitionAttr & ATTRIBUTE_COMPRESSED_MASK) {
+			fsbl_printf(DEBUG_INFO, "Compressed\r\n");
+			CompressedPartitionFlag = 1;
+		} else {
+			CompressedPartitionFlag = 0;
+		}
+
+		if (CompressedPartitionFlag) {
+#ifndef COMPRESSION_EXCLUDE
+			if ((!PSPartitionFlag) || EncryptedPartitionFlag) {
+				fsbl_printf(DEBUG_GENERAL,
+						"DECOMPRESSION_FAIL: unsupported partition\r\n");
+				OutputStatus(DECOMPRESSION_FAIL);
+				FsblFallback();
+			}
+
+			/*
+			 * Stage below a bitstream that may still be loading
+			 */
+			CompStagingAddr = GetStagingAddr(
+					(PlStagingAddr > DDR_TEMP_START_ADDR) ?
+					PlStagingAddr : (DDR_END_ADDR + 1),
+					PartitionTotalSize << WORD_LENGTH_SHIFT);
+			if (CompStagingAddr <= PartitionLoadAddr) {
+				fsbl_printf(DEBUG_GENERAL,
+						"DECOMPRESSION_FAIL: no staging space\r\n");
+				OutputStatus(DECOMPRESSION_FAIL);
+				FsblFallback();
+			}
+#else
+			fsbl_printf(DEBUG_GENERAL,"DECOMPRESSION_FAIL: not supported\r\n");
+			OutputStatus(DECOMPRESSION_FAIL);
+			FsblFallback();
+#endif
+		}
+
 		/*
 		 * Load address check
 		 * Loop will break when PS load address zero and partition is
@@ -436,6 +518,23 @@ u32 LoadBootImage(void)
 			}
 		}
 
+		/*
+		 * A bitstream still loading in the background may be read from
+		 * where this partition goes
+		 */
+		if (CompressedPartitionFlag &&
+				PcapAsyncOverlaps(PartitionLoadAddr,
+					(CompStagingAddr - PartitionLoadAddr) +
+					(PartitionTotalSize << WORD_LENGTH_SHIFT))) {
+			fsbl_printf(DEBUG_INFO, "Waiting for PCAP\r\n");
+			BitstreamComplete();
+		}
+		if (PSPartitionFlag && PcapAsyncOverlaps(PartitionLoadAddr,
+				PartitionTotalSize << WORD_LENGTH_SHIFT)) {
+			fsbl_printf(DEBUG_INFO, "Waiting for PCAP\r\n");
+			BitstreamComplete();
+		}
+
 		/*
 		 * Move partitions from boot device
 		 */
@@ -445,6 +544,7 @@ u32 LoadBootImage(void)
 			OutputStatus(PARTITION_MOVE_FAIL);
 			FsblFallback();
 		}
+		FsblTimelineMark(FSBL_TL_STAGE_PART_MOVED, PartitionNum);
 
 		if ((SignedPartitionFlag) || (PartitionChecksumFlag)) {
 			if(PLPartitionFlag) {
@@ -452,7 +552,9 @@ u32 LoadBootImage(void)
 				 * PL partition loaded in to DDR temporary address
 				 * for authentication and checksum verification
 				 */
-				PartitionStartAddr = DDR_TEMP_START_ADDR;
+				PartitionStartAddr = PlStagingAddr;
+			} else if (CompressedPartitionFlag) {
+				PartitionStartAddr = CompStagingAddr;
 			} else {
 				PartitionStartAddr = PartitionLoadAddr;
 			}
@@ -501,6 +603,7 @@ u32 LoadBootImage(void)
 				FsblFallback();
 #endif
 			}
+			FsblTimelineMark(FSBL_TL_STAGE_PART_CHECKED, PartitionNum);
 
 			/*
 			 * Decrypt PS partition
@@ -520,7 +623,7 @@ u32 LoadBootImage(void)
 			 * Load Signed PL partition in Fabric
 			 */
 			if (PLPartitionFlag) {
-				Status = PcapLoadPartition((u32*)PartitionStartAddr,
+				Status = PcapLoadPartitionAsync((u32*)PartitionStartAddr,
 						(u32*)PartitionLoadAddr,
 						PartitionImageLength,
 						PartitionDataLength,
@@ -535,25 +638,109 @@ u32 LoadBootImage(void)
 
 
 		/*
-		 * FSBL user hook call after bitstream download
+		 * Inflate a compressed partition from its verified staging copy
 		 */
-		if (PLPartitionFlag) {
-			Status = FsblHookAfterBitstreamDload();
+		if (CompressedPartitionFlag) {
+			Status = DecompressPartition(CompStagingAddr,
+					PartitionTotalSize << WORD_LENGTH_SHIFT,
+					PartitionLoadAddr,
+					CompStagingAddr - PartitionLoadAddr);
 			if (Status != XST_SUCCESS) {
-				fsbl_printf(DEBUG_GENERAL,"FSBL_AFTER_BSTREAM_HOOK_FAIL\r\n");
-				OutputStatus(FSBL_AFTER_BSTREAM_HOOK_FAIL);
+				fsbl_printf(DEBUG_GENERAL,"DECOMPRESSION_FAIL\r\n");
+				OutputStatus(DECOMPRESSION_FAIL);
 				FsblFallback();
 			}
+			FsblTimelineMark(FSBL_TL_STAGE_PART_INFLATED, PartitionNum);
+		}
+
+		/*
+		 * FSBL user hook call after bitstream download, made from
+		 * BitstreamComplete() once the PCAP is done
+		 */
+		if (PLPartitionFlag) {
+			BitstreamPending = 1;
+#ifdef PCAP_ASYNC_EXCLUDE
+			BitstreamComplete();
+#endif
 		}
+		FsblTimelineMark(FSBL_TL_STAGE_PART_DONE, PartitionNum);
+
 		/*
 		 * Increment partition number
 		 */
 		PartitionNum++;
 	}
 
+	/*
+	 * The fabric has to be configured before handoff
+	 */
+	BitstreamComplete();
+
 	return ExecAddress;
 }
 
+/*****************************************************************************/
+/**
+*
+* This function waits for a bitstream loading in the background and then
+* calls the FSBL user hook after bitstream download
+*
+* @param	None
+*
+* @return	None, falls back on a PCAP or hook failure
+*
+* @note		Does nothing if no bitstream is outstanding
+*
+****************************************************************************/
+static void BitstreamComplete(void)
+{
+	u32 Status;
+
+	if (!BitstreamPending) {
+		return;
+	}
+	BitstreamPending = 0;
+
+	Status = PcapWaitAsync();
+	if (Status != XST_SUCCESS) {
+		fsbl_printf(DEBUG_GENERAL,"BITSTREAM_DOWNLOAD_FAIL\r\n");
+		OutputStatus(BITSTREAM_DOWNLOAD_FAIL);
+		FsblFallback();
+	}
+
+	Status = FsblHookAfterBitstreamDload();
+	if (Status != XST_SUCCESS) {
+		fsbl_printf(DEBUG_GENERAL,"FSBL_AFTER_BSTREAM_HOOK_FAIL\r\n");
+		OutputStatus(FSBL_AFTER_BSTREAM_HOOK_FAIL);
+		FsblFallback();
+	}
+}
+
+/*****************************************************************************/
+/**
+*
+* This function returns where a partition is staged below a given top of
+* DDR
+*
+* @param	Top is the first address above the staging area
+* @param	Length is the partition length in bytes
+*
+* @return	The staging address, or DDR_TEMP_START_ADDR if the partition
+*		would take more than half of the space below Top
+*
+* @note		None
+*
+****************************************************************************/
+static u32 GetStagingAddr(u32 Top, u32 Length)
+{
+	if ((Top <= DDR_TEMP_START_ADDR) ||
+			(Length >= ((Top - DDR_TEMP_START_ADDR) >> 1))) {
+		return DDR_TEMP_START_ADDR;
+	}
+
+	return (Top - Length) & ~(STAGING_ALIGN - 1);
+}
+
 /*****************************************************************************/
 /**
 *
@@ -1047,6 +1234,13 @@ u32 PartitionMove(u32 ImageBaseAddress, PartHeader *Header)
 	ImageWordLen = Header->ImageWordLen;
 	DataWordLen = Header->DataWordLen;
 
+	/*
+	 * Compressed partitions are staged and inflated in to place later
+	 */
+	if (CompressedPartitionFlag) {
+		LoadAddr = CompStagingAddr;
+	}
+
 	/*
 	 * Add flash base address for linear boot devices
 	 */
@@ -1089,9 +1283,19 @@ u32 PartitionMove(u32 ImageBaseAddress, PartHeader *Header)
 		 * PL partition copied to DDR temporary location
 		 */
 		if (PLPartitionFlag) {
-			LoadAddr = DDR_TEMP_START_ADDR;
+			LoadAddr = PlStagingAddr;
 		}
 
+#ifdef RSA_SUPPORT
+		/*
+		 * Signed partitions are hashed while they are copied
+		 */
+		if (SignedPartitionFlag) {
+			Status = MoveImageAndHash(SourceAddr,
+						LoadAddr,
+						(ImageWordLen << WORD_LENGTH_SHIFT));
+		} else
+#endif
 		Status = MoveImage(SourceAddr,
 						LoadAddr,
 						(ImageWordLen << WORD_LENGTH_SHIFT));
@@ -1116,7 +1320,7 @@ u32 PartitionMove(u32 ImageBaseAddress, PartHeader *Header)
 		 */
 		if(PLPartitionFlag){
 			SecureTransferFlag = 0;
-			LoadAddr = DDR_TEMP_START_ADDR;
+			LoadAddr = PlStagingAddr;
 		}
 
 		/*
@@ -1143,7 +1347,7 @@ u32 PartitionMove(u32 ImageBaseAddress, PartHeader *Header)
 	 * if checksum and authentication bits are not set
 	 */
 	if (PLPartitionFlag && (!(SignedPartitionFlag || PartitionChecksumFlag))) {
-		Status = PcapLoadPartition((u32*)SourceAddr,
+		Status = PcapLoadPartitionAsync((u32*)SourceAddr,
 					(u32*)Header->LoadAddr,
 					Header->ImageWordLen,
 					Header->DataWordLen,
@@ -1158,6 +1362,49 @@ u32 PartitionMove(u32 ImageBaseAddress, PartHeader *Header)
 }
 
 
+/******************************************************************************/
+/**
+*
+* This function inflates a compressed partition to its load address
+*
+* @param	StartAddr is the staging address of the LZ4 frame
+* @param	Length is the partition length in bytes
+* @param	LoadAddr is where the partition is inflated to
+* @param	LoadLimit is the space available at LoadAddr in bytes
+*
+* @return
+*		- XST_SUCCESS if decompression successful
+*		- XST_FAILURE if the frame is corrupt or does not fit
+*
+* @note		The D-cache is enabled while inflating and flushed after,
+*		so the code is in DDR before handoff.
+*
+*******************************************************************************/
+u32 DecompressPartition(u32 StartAddr, u32 Length, u32 LoadAddr,
+		u32 LoadLimit)
+{
+#ifndef COMPRESSION_EXCLUDE
+	u32 Status;
+	u32 OutLen = 0;
+
+	Xil_DCacheEnable();
+	Status = Lz4DecompressFrame((const u8 *)StartAddr, Length,
+			(u8 *)LoadAddr, LoadLimit, &OutLen);
+	Xil_DCacheFlush();
+	Xil_DCacheDisable();
+	if (Status != XST_SUCCESS) {
+		fsbl_printf(DEBUG_GENERAL,"LZ4 frame at 0x%lx is corrupt\r\n",
+				StartAddr);
+		return XST_FAILURE;
+	}
+
+	fsbl_printf(DEBUG_INFO,"Inflated %lu to %lu bytes\r\n", Length, OutLen);
+	return XST_SUCCESS;
+#else
+	return XST_FAILURE;
+#endif
+}
+
 /******************************************************************************/
 /**
 *
@@ -71,6 +71,7 @@ extern "C" {
 #define ATTRIBUTE_CHECKSUM_TYPE_MASK	0x7000	/* Checksum Type */
 #define ATTRIBUTE_RSA_PRESENT_MASK		0x8000	/* RSA Signature Present */
 #define ATTRIBUTE_PARTITION_OWNER_MASK	0x30000	/* Partition Owner */
+#define ATTRIBUTE_COMPRESSED_MASK		0x40000	/* LZ4 frame (lz4.h) */
 
 #define ATTRIBUTE_PARTITION_OWNER_FSBL	0x00000	/* FSBL Partition Owner */
 
@@ -120,6 +121,8 @@ void HeaderDump(PartHeader *Header);
 u32 GetPartitionCount(PartHeader *Header);
 u32 ValidateHeader(PartHeader *Header);
 u32 DecryptPartition(u32 StartAddr, u32 DataLength, u32 ImageLength);
+u32 DecompressPartition(u32 StartAddr, u32 Length, u32 LoadAddr,
+		u32 LoadLimit);
 
 /************************** Variable Definitions *****************************/
 
@@ -0,0 +1,211 @@
+/*****************************************************************************/
+/**
+*
+* @file lz4.c
+*
+* Contains the LZ4 block decompressor for compressed partitions
+*
+* @note
+*	Every length and offset is checked against both buffers, a corrupt
+*	frame fails instead of writing outside the destination. Copies go
+*	through memcpy()/memset(), so the FSBL should run it with the D-cache
+*	enabled (see DecompressPartition()).
+*
+******************************************************************************/
+
+/***************************** Include Files *********************************/
+#ifndef COMPRESSION_EXCLUDE
+#include <string.h>
+#include "xstatus.h"
+#include "lz4.h"
+
+/************************** Constant Definitions *****************************/
+
+/**************************** Type Definitions *******************************/
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+/************************** Function Prototypes ******************************/
+
+/************************** Variable Definitions *****************************/
+
+/*****************************************************************************/
+/**
+*
+* This function reads the extension bytes of a literal or match length
+*
+* @param	Ip points to the input pointer, advanced past the bytes
+* @param	IpEnd is the end of the input
+* @param	Len is the length so far, 15 from the token
+*
+* @return	The full length, or 0xFFFFFFFF if the input is truncated or
+*		the length overflows
+*
+* @note		None
+*
+****************************************************************************/
+static u32 Lz4ReadLength(const u8 **Ip, const u8 *IpEnd, u32 Len)
+{
+	const u8 *Ptr = *Ip;
+	u32 Byte;
+
+	do {
+		if (Ptr >= IpEnd) {
+			return 0xFFFFFFFF;
+		}
+		Byte = *Ptr++;
+		Len += Byte;
+		if (Len < Byte) {
+			return 0xFFFFFFFF;
+		}
+	} while (Byte == 255);
+
+	*Ip = Ptr;
+	return Len;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function decompresses one LZ4 block
+*
+* @param	Src points to the block
+* @param	SrcLen is the block length in bytes
+* @param	Dst points to the output
+* @param	DstLen is the output space in bytes
+* @param	OutLen returns the decompressed length
+*
+* @return
+*		- XST_SUCCESS if the block decoded within both buffers
+*		- XST_FAILURE if the block is malformed or does not fit
+*
+* @note		None
+*
+****************************************************************************/
+u32 Lz4Decompress(const u8 *Src, u32 SrcLen, u8 *Dst, u32 DstLen,
+		u32 *OutLen)
+{
+	const u8 *Ip = Src;
+	const u8 *IpEnd = Src + SrcLen;
+	u8 *Op = Dst;
+	u8 *OpEnd = Dst + DstLen;
+	const u8 *Match;
+	u32 Token;
+	u32 Len;
+	u32 Offset;
+	u32 Chunk;
+
+	while (Ip < IpEnd) {
+		Token = *Ip++;
+
+		/*
+		 * Literal run
+		 */
+		Len = Token >> 4;
+		if (Len == 15) {
+			Len = Lz4ReadLength(&Ip, IpEnd, Len);
+		}
+		if ((Len > (u32)(IpEnd - Ip)) || (Len > (u32)(OpEnd - Op))) {
+			return XST_FAILURE;
+		}
+		memcpy(Op, Ip, Len);
+		Op += Len;
+		Ip += Len;
+
+		/*
+		 * The last sequence has no match
+		 */
+		if (Ip == IpEnd) {
+			break;
+		}
+
+		if ((IpEnd - Ip) < 2) {
+			return XST_FAILURE;
+		}
+		Offset = (u32)Ip[0] | ((u32)Ip[1] << 8);
+		Ip += 2;
+		if ((Offset == 0) || (Offset > (u32)(Op - Dst))) {
+			return XST_FAILURE;
+		}
+
+		Len = Token & 0xF;
+		if (Len == 15) {
+			Len = Lz4ReadLength(&Ip, IpEnd, Len);
+			if (Len == 0xFFFFFFFF) {
+				return XST_FAILURE;
+			}
+		}
+		Len += LZ4_MIN_MATCH;
+		if (Len > (u32)(OpEnd - Op)) {
+			return XST_FAILURE;
+		}
+
+		/*
+		 * Match copy, an overlapping match repeats the last Offset
+		 * bytes, which is done a period at a time
+		 */
+		Match = Op - Offset;
+		if (Offset >= Len) {
+			memcpy(Op, Match, Len);
+			Op += Len;
+		} else if (Offset == 1) {
+			memset(Op, *Match, Len);
+			Op += Len;
+		} else {
+			while (Len != 0) {
+				Chunk = (Len < Offset) ? Len : Offset;
+				memcpy(Op, Op - Offset, Chunk);
+				Op += Chunk;
+				Len -= Chunk;
+			}
+		}
+	}
+
+	*OutLen = (u32)(Op - Dst);
+	return XST_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function checks a compressed partition frame and decompresses it
+*
+* @param	Src points to the frame header
+* @param	SrcLen is the partition length in bytes, including padding
+* @param	Dst points to the output
+* @param	DstLen is the output space in bytes
+* @param	OutLen returns the decompressed length
+*
+* @return
+*		- XST_SUCCESS if the frame decoded to its recorded length
+*		- XST_FAILURE otherwise
+*
+* @note		None
+*
+****************************************************************************/
+u32 Lz4DecompressFrame(const u8 *Src, u32 SrcLen, u8 *Dst, u32 DstLen,
+		u32 *OutLen)
+{
+	Lz4FrameHeader Header;
+	u32 Status;
+
+	if (SrcLen < LZ4_FRAME_HEADER_SIZE) {
+		return XST_FAILURE;
+	}
+	memcpy(&Header, Src, sizeof(Header));
+
+	if ((Header.Magic != LZ4_FRAME_MAGIC) ||
+			(Header.BlockLen > (SrcLen - LZ4_FRAME_HEADER_SIZE)) ||
+			(Header.DataLen > DstLen)) {
+		return XST_FAILURE;
+	}
+
+	Status = Lz4Decompress(Src + LZ4_FRAME_HEADER_SIZE, Header.BlockLen,
+			Dst, Header.DataLen, OutLen);
+	if ((Status != XST_SUCCESS) || (*OutLen != Header.DataLen)) {
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+#endif
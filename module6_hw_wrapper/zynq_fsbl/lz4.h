@@ -0,0 +1,54 @@
+/*****************************************************************************/
+/**
+*
+* @file lz4.h
+*
+* Contains the interface of the LZ4 block decompressor used for compressed
+* partitions (ATTRIBUTE_COMPRESSED_MASK).
+*
+* A compressed partition holds one frame: a 16 byte header followed by a
+* single LZ4 block (the format of LZ4_compress_default()). The frame is
+* written by tools/lz4pack, which also fixes up the partition header and
+* the MD5 checksum. Checksums and signatures cover the frame as stored in
+* flash, the FSBL inflates it after they are verified.
+*
+* @note
+*
+******************************************************************************/
+#ifndef ___LZ4_H___
+#define ___LZ4_H___
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************** Include Files *********************************/
+#include "xil_types.h"
+
+/************************** Constant Definitions *****************************/
+#define LZ4_FRAME_MAGIC			0x345A4C46	/* "FLZ4" */
+#define LZ4_FRAME_HEADER_SIZE	16
+
+#define LZ4_MIN_MATCH			4
+#define LZ4_LAST_LITERALS		5	/* Block ends with literals */
+#define LZ4_MAX_OFFSET			65535
+
+/**************************** Type Definitions *******************************/
+typedef struct {
+	u32 Magic;		/* 0x0 LZ4_FRAME_MAGIC */
+	u32 DataLen;		/* 0x4 Decompressed length in bytes */
+	u32 BlockLen;		/* 0x8 LZ4 block length in bytes */
+	u32 Reserved;		/* 0xC Zero */
+} Lz4FrameHeader;
+
+/************************** Function Prototypes ******************************/
+u32 Lz4Decompress(const u8 *Src, u32 SrcLen, u8 *Dst, u32 DstLen,
+		u32 *OutLen);
+u32 Lz4DecompressFrame(const u8 *Src, u32 SrcLen, u8 *Dst, u32 DstLen,
+		u32 *OutLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ___LZ4_H___ */
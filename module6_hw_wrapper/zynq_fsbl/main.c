@@ -113,6 +113,8 @@
 #include "xstatus.h"
 #include "fsbl_hooks.h"
 #include "xtime_l.h"
+#include "fsbl_timeline.h"
+#include "image_dir.h"
 
 #ifdef XPAR_XWDTPS_0_BASEADDR
 #include "xwdtps.h"
@@ -151,6 +153,7 @@ extern int ps7_post_config();
 #endif
 
 static void Update_MultiBootRegister(void);
+static u32 GetBootDevMaxSize(void);
 /* Exception handlers */
 static void RegisterHandlers(void);
 static void Undef_Handler (void);
@@ -217,6 +220,12 @@ int main(void)
 	u32 HandoffAddress = 0;
 	u32 Status = XST_SUCCESS;
 	u32 RegVal;
+
+	/*
+	 * Start the boot timeline, must precede ps7_init
+	 */
+	FsblTimelineInit();
+
 	/*
 	 * PCW initialization for MIO,PLL,CLK and DDR
 	 */
@@ -231,6 +240,7 @@ int main(void)
 		 */
 		FsblHookFallback();
 	}
+	FsblTimelineMark(FSBL_TL_STAGE_PS7_INIT, 0);
 
 	/*
 	 * Unlock SLCR for SLCR register write
@@ -287,6 +297,7 @@ int main(void)
 		 */
 		FsblHookFallback();
 	}
+	FsblTimelineMark(FSBL_TL_STAGE_DDR_CHECK, 0);
 
 
 	/*
@@ -303,6 +314,8 @@ int main(void)
 		FsblHookFallback();
 	}
 
+	FsblTimelineMark(FSBL_TL_STAGE_PCAP_INIT, 0);
+
 	fsbl_printf(DEBUG_INFO,"Devcfg driver initialized \r\n");
 
 	/*
@@ -359,6 +372,7 @@ int main(void)
 	 */
 	BootModeRegister = Xil_In32(BOOT_MODE_REG);
 	BootModeRegister &= BOOT_MODES_MASK;
+	FsblTimelineSetBootMode(BootModeRegister);
 
 	/*
 	 * QSPI BOOT MODE
@@ -506,6 +520,7 @@ int main(void)
 		 */
 		FsblFallback();
 	}
+	FsblTimelineMark(FSBL_TL_STAGE_BOOTDEV_INIT, BootModeRegister);
 
 	fsbl_printf(DEBUG_INFO,"Flash Base Address: 0x%08lx\r\n", FlashReadBaseAddress);
 
@@ -546,6 +561,7 @@ int main(void)
 	 * Load boot image
 	 */
 	HandoffAddress = LoadBootImage();
+	FsblTimelineMark(FSBL_TL_STAGE_IMAGE_LOADED, 0);
 
 	fsbl_printf(DEBUG_INFO,"Handoff Address: 0x%08lx\r\n",HandoffAddress);
 
@@ -591,6 +607,8 @@ void FsblFallback(void)
 	u32 HandoffAddr;
 	u32 BootModeRegister;
 
+	FsblTimelineMark(FSBL_TL_STAGE_FALLBACK, 0);
+
 	/*
 	 * Read bootmode register
 	 */
@@ -766,6 +784,8 @@ void FsblHandoff(u32 FsblStartAddr)
 	 */
 	ClearFSBLIn();
 
+	FsblTimelineMark(FSBL_TL_STAGE_HANDOFF, FsblStartAddr);
+
 	if(FsblStartAddr == 0) {
 		/*
 		 * SLCR lock
@@ -1023,6 +1043,7 @@ static void FIQ_Handler (void)
 static void Update_MultiBootRegister(void)
 {
 	u32 MultiBootReg = 0;
+	u32 NextOffset;
 
 	if (Silicon_Version != SILICON_VERSION_1) {
 		/*
@@ -1032,9 +1053,23 @@ static void Update_MultiBootRegister(void)
 					XDCFG_MULTIBOOT_ADDR_OFFSET);
 
 		/*
-		 * Incrementing multiboot register by one
+		 * Point the multiboot register straight at the next image of
+		 * the directory, the boot device is only set up once system
+		 * initialization is done
 		 */
-		MultiBootReg++;
+		if ((SystemInitFlag == 1) &&
+				(ImageDirNext(GetBootDevMaxSize(),
+					(MultiBootReg & PCAP_MBOOT_REG_REBOOT_OFFSET_MASK)
+						* GOLDEN_IMAGE_OFFSET,
+					&NextOffset) == XST_SUCCESS)) {
+			MultiBootReg = (MultiBootReg & ~PCAP_MBOOT_REG_REBOOT_OFFSET_MASK) |
+					(NextOffset / GOLDEN_IMAGE_OFFSET);
+		} else {
+			/*
+			 * Incrementing multiboot register by one
+			 */
+			MultiBootReg++;
+		}
 
 		XDcfg_WriteReg(DcfgInstPtr->Config.BaseAddr,
 				XDCFG_MULTIBOOT_ADDR_OFFSET,
@@ -1391,28 +1426,20 @@ u32 ImageCheckID(u32 FlashOffsetAddress){
 
 /******************************************************************************
 *
-* This function NextValidImageCheck search for valid boot image
+* This function returns the size of the boot device, the limit of the
+* multiboot image search
 *
 * @param	None
 *
-* @return
-*		- XST_SUCCESS if valid image found
-*		- XST_FAILURE if no image found
+* @return	Size in bytes, 0 for boot modes without fallback
 *
 * @note		None
 *
 *******************************************************************************/
-u32 NextValidImageCheck(void)
+static u32 GetBootDevMaxSize(void)
 {
-	u32 ImageBaseAddr;
-	u32 MultiBootReg;
-	u32 BootDevMaxSize=0;
+	u32 BootDevMaxSize = 0;
 
-	fsbl_printf(DEBUG_GENERAL, "Searching For Next Valid Image");
-	
-	/*
-	 * Setting variable with maximum flash size based on boot mode
-	 */
 #ifdef XPAR_PS7_QSPI_LINEAR_0_S_AXI_BASEADDR
 	if (FlashReadBaseAddress == XPS_QSPI_LINEAR_BASEADDR) {
 		BootDevMaxSize = QspiFlashSize;
@@ -1427,6 +1454,36 @@ u32 NextValidImageCheck(void)
 		BootDevMaxSize  = NOR_FLASH_SIZE;
 	}
 
+	return BootDevMaxSize;
+}
+
+
+/******************************************************************************
+*
+* This function NextValidImageCheck search for valid boot image
+*
+* @param	None
+*
+* @return
+*		- XST_SUCCESS if valid image found
+*		- XST_FAILURE if no image found
+*
+* @note		None
+*
+*******************************************************************************/
+u32 NextValidImageCheck(void)
+{
+	u32 ImageBaseAddr;
+	u32 MultiBootReg;
+	u32 BootDevMaxSize;
+
+	fsbl_printf(DEBUG_GENERAL, "Searching For Next Valid Image");
+	
+	/*
+	 * Setting variable with maximum flash size based on boot mode
+	 */
+	BootDevMaxSize = GetBootDevMaxSize();
+
 	/*
 	 * Read the multiboot register
 	 */
@@ -1438,6 +1495,16 @@ u32 NextValidImageCheck(void)
 	 */
 	ImageBaseAddr = (MultiBootReg & PCAP_MBOOT_REG_REBOOT_OFFSET_MASK)
 								* GOLDEN_IMAGE_OFFSET;
+
+	/*
+	 * Update_MultiBootRegister() already moved to the next image of the
+	 * directory, a match of its header checksum word is enough
+	 */
+	if (ImageDirVerify(BootDevMaxSize, ImageBaseAddr) == XST_SUCCESS) {
+		fsbl_printf(DEBUG_GENERAL, "\r\nImage found, offset: 0x%.8lx\r\n",
+				ImageBaseAddr);
+		return XST_SUCCESS;
+	}
 	
 	/*
 	 * Valid image search continue till end of the flash
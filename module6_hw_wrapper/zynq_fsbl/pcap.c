@@ -76,10 +76,14 @@
 #include "xdevcfg.h"
 #include "sleep.h"
 #include "xtime_l.h"
+#include "fsbl_timeline.h"
 
 #ifdef XPAR_XWDTPS_0_BASEADDR
 #include "xwdtps.h"
 #endif
+#ifndef PCAP_ASYNC_EXCLUDE
+#include "xscugic.h"
+#endif
 /************************** Constant Definitions *****************************/
 /*
  * The following constants map to the XPAR parameters created in the
@@ -88,6 +92,14 @@
  */
 
 #define DCFG_DEVICE_ID		XPAR_XDCFG_0_DEVICE_ID
+#define INTC_DEVICE_ID		XPAR_SCUGIC_SINGLE_DEVICE_ID
+#define DCFG_INTR_ID		XPAR_XDCFG_0_INTR
+
+/*
+ * DevC interrupts that end a background bitstream load
+ */
+#define PCAP_ASYNC_DONE_MASK	(XDCFG_IXR_DMA_DONE_MASK | \
+					XDCFG_IXR_PCFG_DONE_MASK)
 
 /**************************** Type Definitions *******************************/
 
@@ -95,6 +107,11 @@
 
 /************************** Function Prototypes ******************************/
 extern int XDcfgPollDone(u32 MaskValue, u32 MaxCount);
+#ifndef PCAP_ASYNC_EXCLUDE
+static void PcapIntrHandler(void *CallBackRef);
+static u32 PcapAsyncIntrSetup(void);
+static void PcapAsyncIntrRelease(void);
+#endif
 
 /************************** Variable Definitions *****************************/
 /* Devcfg driver instance */
@@ -104,6 +121,17 @@ extern u32 Silicon_Version;
 #ifdef XPAR_XWDTPS_0_BASEADDR
 extern XWdtPs Watchdog;	/* Instance of WatchDog Timer	*/
 #endif
+#ifndef PCAP_ASYNC_EXCLUDE
+/* Interrupt controller, only live while a bitstream loads in background */
+static XScuGic IntcInstance;
+static u32 PcapAsyncActive;		/* Load started, not yet collected */
+static volatile u32 PcapAsyncPending;	/* Cleared by the interrupt */
+static volatile u32 PcapAsyncIntrSts;	/* Accumulated DevC status */
+static volatile XTime PcapAsyncDmaTime;
+static volatile XTime PcapAsyncFpgaTime;
+static u32 PcapAsyncSrcAddr;
+static u32 PcapAsyncSrcLen;
+#endif
 
 /******************************************************************************/
 /**
@@ -138,6 +166,14 @@ u32 PcapDataTransfer(u32 *SourceDataPtr, u32 *DestinationDataPtr,
 		PcapTransferType = XDCFG_CONCURRENT_SECURE_READ_WRITE;
 	}
 
+	/*
+	 * The PCAP may still be busy with a bitstream
+	 */
+	Status = PcapWaitAsync();
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
 #ifdef FSBL_PERF
 	XTime tXferCur = 0;
 	FsblGetGlobalTime(&tXferCur);
@@ -248,6 +284,14 @@ u32 PcapLoadPartition(u32 *SourceDataPtr, u32 *DestinationDataPtr,
 		PcapTransferType = XDCFG_SECURE_PCAP_WRITE;
 	}
 
+	/*
+	 * The PCAP may still be busy with a bitstream
+	 */
+	Status = PcapWaitAsync();
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
 #ifdef FSBL_PERF
 	XTime tXferCur = 0;
 	FsblGetGlobalTime(&tXferCur);
@@ -274,6 +318,7 @@ u32 PcapLoadPartition(u32 *SourceDataPtr, u32 *DestinationDataPtr,
 	if (Status != XST_SUCCESS) {
 		return XST_FAILURE;
 	}
+	FsblTimelineMark(FSBL_TL_STAGE_FABRIC_INIT, 0);
 
 
 #ifdef	XPAR_XWDTPS_0_BASEADDR
@@ -318,6 +363,7 @@ u32 PcapLoadPartition(u32 *SourceDataPtr, u32 *DestinationDataPtr,
 	}
 
 	fsbl_printf(DEBUG_INFO,"DMA Done ! \n\r");
+	FsblTimelineMark(FSBL_TL_STAGE_PCAP_DMA, 0);
 
 	/*
 	 * Poll for FPGA Done
@@ -329,6 +375,7 @@ u32 PcapLoadPartition(u32 *SourceDataPtr, u32 *DestinationDataPtr,
 	}
 
 	fsbl_printf(DEBUG_INFO,"FPGA Done ! \n\r");
+	FsblTimelineMark(FSBL_TL_STAGE_PCAP_FPGA, 0);
 	
 	/*
 	 * Check for errors
@@ -351,6 +398,334 @@ u32 PcapLoadPartition(u32 *SourceDataPtr, u32 *DestinationDataPtr,
 	return XST_SUCCESS;
 }
 
+#ifndef PCAP_ASYNC_EXCLUDE
+/******************************************************************************/
+/**
+*
+* This function starts loading a bitstream through the PCAP and returns as
+* soon as the DMA is queued. Completion is signalled by the DevC interrupt
+* and collected with PcapWaitAsync().
+*
+* @param 	SourceDataPtr is a pointer to where the data is read from
+* @param 	DestinationDataPtr is a pointer to where the data is written to
+* @param 	SourceLength is the length of the data to be moved in words
+* @param 	DestinationLength is the length of the data to be moved in words
+* @param 	SecureTransfer indicated the encryption key location, 0 for
+* 			non-encrypted
+*
+* @return
+*		- XST_SUCCESS if the transfer is started (or done, see note)
+*		- XST_FAILURE if the transfer fails
+*
+* @note		The source must stay untouched until PcapAsyncOverlaps()
+*		no longer reports it. If the interrupt cannot be hooked the
+*		bitstream is loaded synchronously with PcapLoadPartition().
+*
+****************************************************************************/
+u32 PcapLoadPartitionAsync(u32 *SourceDataPtr, u32 *DestinationDataPtr,
+		u32 SourceLength, u32 DestinationLength, u32 SecureTransfer)
+{
+	u32 Status;
+	u32 PcapTransferType = XDCFG_NON_SECURE_PCAP_WRITE;
+
+	/*
+	 * Check for secure transfer
+	 */
+	if (SecureTransfer) {
+		PcapTransferType = XDCFG_SECURE_PCAP_WRITE;
+	}
+
+	/*
+	 * Only one bitstream can be in flight
+	 */
+	Status = PcapWaitAsync();
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	Status = PcapAsyncIntrSetup();
+	if (Status != XST_SUCCESS) {
+		fsbl_printf(DEBUG_INFO,"PCAP interrupt setup failed, "
+				"loading synchronously\r\n");
+		return PcapLoadPartition(SourceDataPtr, DestinationDataPtr,
+				SourceLength, DestinationLength, SecureTransfer);
+	}
+
+	/*
+	 * Clear the PCAP status registers
+	 */
+	Status = ClearPcapStatus();
+	if (Status != XST_SUCCESS) {
+		fsbl_printf(DEBUG_INFO,"PCAP_CLEAR_STATUS_FAIL \r\n");
+		PcapAsyncIntrRelease();
+		return XST_FAILURE;
+	}
+
+	/*
+	 * For Bitstream case destination address will be 0xFFFFFFFF
+	 */
+	DestinationDataPtr = (u32*)XDCFG_DMA_INVALID_ADDRESS;
+
+	/*
+	 * New Bitstream download initialization sequence
+	 */
+	Status = FabricInit();
+	if (Status != XST_SUCCESS) {
+		PcapAsyncIntrRelease();
+		return XST_FAILURE;
+	}
+	FsblTimelineMark(FSBL_TL_STAGE_FABRIC_INIT, 0);
+
+#ifdef	XPAR_XWDTPS_0_BASEADDR
+	/*
+	 * Prevent WDT reset
+	 */
+	XWdtPs_RestartWdt(&Watchdog);
+#endif
+
+	PcapAsyncSrcAddr = (u32)SourceDataPtr;
+	PcapAsyncSrcLen = SourceLength << WORD_LENGTH_SHIFT;
+	PcapAsyncIntrSts = 0;
+	PcapAsyncDmaTime = 0;
+	PcapAsyncFpgaTime = 0;
+	PcapAsyncPending = 1;
+	PcapAsyncActive = 1;
+
+	/*
+	 * Done bits left over from FabricInit must not end the load early
+	 */
+	XDcfg_IntrClear(DcfgInstPtr, XDCFG_IXR_ALL_MASK);
+	XDcfg_IntrEnable(DcfgInstPtr, PCAP_ASYNC_DONE_MASK |
+			FSBL_XDCFG_IXR_ERROR_FLAGS_MASK);
+
+	/*
+	 * PCAP single DMA transfer setup
+	 */
+	SourceDataPtr = (u32*)((u32)SourceDataPtr | PCAP_LAST_TRANSFER);
+	DestinationDataPtr = (u32*)((u32)DestinationDataPtr | PCAP_LAST_TRANSFER);
+
+	/*
+	 * Transfer using Device Configuration
+	 */
+	Status = XDcfg_Transfer(DcfgInstPtr, (u8 *)SourceDataPtr,
+					SourceLength,
+					(u8 *)DestinationDataPtr,
+					DestinationLength, PcapTransferType);
+	if (Status != XST_SUCCESS) {
+		fsbl_printf(DEBUG_INFO,"Status of XDcfg_Transfer = %lu \r \n",Status);
+		XDcfg_IntrDisable(DcfgInstPtr, XDCFG_IXR_ALL_MASK);
+		PcapAsyncPending = 0;
+		PcapAsyncActive = 0;
+		PcapAsyncIntrRelease();
+		return XST_FAILURE;
+	}
+
+	fsbl_printf(DEBUG_INFO,"PCAP bitstream DMA started \r\n");
+
+	return XST_SUCCESS;
+}
+
+/******************************************************************************/
+/**
+*
+* This function waits for a bitstream started by PcapLoadPartitionAsync()
+*
+* @param	None
+*
+* @return
+*		- XST_SUCCESS if nothing was in flight or the FPGA is done
+*		- XST_FAILURE if the PCAP reported an error or timed out
+*
+* @note		The result is returned once, the next call returns
+*		XST_SUCCESS.
+*
+****************************************************************************/
+u32 PcapWaitAsync(void)
+{
+	u32 Count = MAX_COUNT;
+	u32 IntrStsReg;
+	XTime tCur = 0;
+
+	if (!PcapAsyncActive) {
+		return XST_SUCCESS;
+	}
+
+	while (PcapAsyncPending) {
+		Count -= 1;
+		if (!Count) {
+			fsbl_printf(DEBUG_GENERAL,"PCAP transfer timed out \r\n");
+			XDcfg_IntrDisable(DcfgInstPtr, XDCFG_IXR_ALL_MASK);
+			PcapAsyncPending = 0;
+			break;
+		}
+	}
+
+	PcapAsyncActive = 0;
+	PcapAsyncIntrRelease();
+	IntrStsReg = PcapAsyncIntrSts;
+
+	XTime_GetTime(&tCur);
+	if (IntrStsReg & XDCFG_IXR_DMA_DONE_MASK) {
+		fsbl_printf(DEBUG_INFO,"DMA Done ! \n\r");
+		FsblTimelineMark(FSBL_TL_STAGE_PCAP_DMA,
+				(u32)(tCur - PcapAsyncDmaTime));
+	}
+	if (IntrStsReg & XDCFG_IXR_PCFG_DONE_MASK) {
+		fsbl_printf(DEBUG_INFO,"FPGA Done ! \n\r");
+		FsblTimelineMark(FSBL_TL_STAGE_PCAP_FPGA,
+				(u32)(tCur - PcapAsyncFpgaTime));
+	}
+
+	/*
+	 * Check for errors
+	 */
+	if ((IntrStsReg & FSBL_XDCFG_IXR_ERROR_FLAGS_MASK) ||
+			((IntrStsReg & PCAP_ASYNC_DONE_MASK) !=
+					PCAP_ASYNC_DONE_MASK)) {
+		fsbl_printf(DEBUG_INFO,"Errors in PCAP %lx\r\n", IntrStsReg);
+		PcapDumpRegisters();
+		return XST_FAILURE;
+	}
+
+	return XST_SUCCESS;
+}
+
+/******************************************************************************/
+/**
+*
+* This function tells whether a range overlaps the source of a bitstream
+* that the PCAP DMA is still reading
+*
+* @param	Addr is the start of the range
+* @param	Length is the range length in bytes
+*
+* @return	1 if the range must not be written yet, else 0
+*
+* @note		None
+*
+****************************************************************************/
+u32 PcapAsyncOverlaps(u32 Addr, u32 Length)
+{
+	if (!PcapAsyncActive || (PcapAsyncDmaTime != 0) ||
+			(PcapAsyncIntrSts & FSBL_XDCFG_IXR_ERROR_FLAGS_MASK)) {
+		return 0;
+	}
+
+	return ((Addr < (PcapAsyncSrcAddr + PcapAsyncSrcLen)) &&
+			(PcapAsyncSrcAddr < (Addr + Length))) ? 1 : 0;
+}
+
+/******************************************************************************/
+/**
+*
+* This function is the DevC interrupt handler for background bitstream
+* loads. It records the DMA and FPGA done times and ends the load on
+* FPGA done or on any error.
+*
+* @param	CallBackRef is the XDcfg instance
+*
+* @return	None
+*
+* @note		None
+*
+****************************************************************************/
+static void PcapIntrHandler(void *CallBackRef)
+{
+	XDcfg *InstancePtr = (XDcfg *)CallBackRef;
+	u32 IntrStsReg;
+	XTime tCur = 0;
+
+	XTime_GetTime(&tCur);
+	IntrStsReg = XDcfg_IntrGetStatus(InstancePtr);
+	XDcfg_IntrClear(InstancePtr, IntrStsReg);
+
+	if ((IntrStsReg & XDCFG_IXR_DMA_DONE_MASK) && (PcapAsyncDmaTime == 0)) {
+		PcapAsyncDmaTime = tCur;
+	}
+	if ((IntrStsReg & XDCFG_IXR_PCFG_DONE_MASK) && (PcapAsyncFpgaTime == 0)) {
+		PcapAsyncFpgaTime = tCur;
+	}
+	PcapAsyncIntrSts |= IntrStsReg;
+
+	if ((PcapAsyncIntrSts & FSBL_XDCFG_IXR_ERROR_FLAGS_MASK) ||
+			((PcapAsyncIntrSts & PCAP_ASYNC_DONE_MASK) ==
+					PCAP_ASYNC_DONE_MASK)) {
+		XDcfg_IntrDisable(InstancePtr, XDCFG_IXR_ALL_MASK);
+		PcapAsyncPending = 0;
+	}
+}
+
+/******************************************************************************/
+/**
+*
+* This function hooks the DevC interrupt and unmasks IRQs. The GIC is
+* initialized on first use only.
+*
+* @param	None
+*
+* @return
+*		- XST_SUCCESS if the interrupt is connected
+*		- XST_FAILURE otherwise
+*
+* @note		None
+*
+****************************************************************************/
+static u32 PcapAsyncIntrSetup(void)
+{
+	XScuGic_Config *IntcConfig;
+	u32 Status;
+
+	if (IntcInstance.IsReady != XIL_COMPONENT_IS_READY) {
+		IntcConfig = XScuGic_LookupConfig(INTC_DEVICE_ID);
+		if (IntcConfig == NULL) {
+			return XST_FAILURE;
+		}
+
+		Status = XScuGic_CfgInitialize(&IntcInstance, IntcConfig,
+						IntcConfig->CpuBaseAddress);
+		if (Status != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+
+		Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_IRQ_INT,
+				(Xil_ExceptionHandler)XScuGic_InterruptHandler,
+				&IntcInstance);
+	}
+
+	Status = XScuGic_Connect(&IntcInstance, DCFG_INTR_ID,
+				(Xil_InterruptHandler)PcapIntrHandler,
+				(void *)DcfgInstPtr);
+	if (Status != XST_SUCCESS) {
+		return XST_FAILURE;
+	}
+
+	XScuGic_Enable(&IntcInstance, DCFG_INTR_ID);
+	Xil_ExceptionEnableMask(XIL_EXCEPTION_IRQ);
+
+	return XST_SUCCESS;
+}
+
+/******************************************************************************/
+/**
+*
+* This function masks IRQs again and unhooks the DevC interrupt, so the
+* application starts with the interrupt state it expects
+*
+* @param	None
+*
+* @return	None
+*
+* @note		None
+*
+****************************************************************************/
+static void PcapAsyncIntrRelease(void)
+{
+	Xil_ExceptionDisableMask(XIL_EXCEPTION_IRQ);
+	XScuGic_Disable(&IntcInstance, DCFG_INTR_ID);
+	XScuGic_Disconnect(&IntcInstance, DCFG_INTR_ID);
+}
+#endif
+
 /******************************************************************************/
 /**
 *
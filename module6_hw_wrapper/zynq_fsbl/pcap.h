@@ -72,6 +72,16 @@ u32 PcapLoadPartition(u32 *SourceData, u32 *DestinationData, u32 SourceLength,
 		 	u32 DestinationLength, u32 Flags);
 u32 PcapDataTransfer(u32 *SourceData, u32 *DestinationData, u32 SourceLength,
  			u32 DestinationLength, u32 Flags);
+#ifndef PCAP_ASYNC_EXCLUDE
+u32 PcapLoadPartitionAsync(u32 *SourceData, u32 *DestinationData,
+			u32 SourceLength, u32 DestinationLength, u32 Flags);
+u32 PcapWaitAsync(void);
+u32 PcapAsyncOverlaps(u32 Addr, u32 Length);
+#else
+#define PcapLoadPartitionAsync		PcapLoadPartition
+#define PcapWaitAsync()			XST_SUCCESS
+#define PcapAsyncOverlaps(Addr, Length)	0
+#endif
 /************************** Variable Definitions *****************************/
 #ifdef __cplusplus
 }
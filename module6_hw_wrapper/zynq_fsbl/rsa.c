@@ -36,15 +36,29 @@
 
 /***************************** Include Files *********************************/
 #ifdef RSA_SUPPORT
+#include <string.h>
 #include "fsbl.h"
 #include "rsa.h"
-#include "xilrsa.h"
+#include "rsa2048.h"
+#include "sha256.h"
+#include "image_mover.h"
+#include "xil_cache.h"
 
 #ifdef	XPAR_XWDTPS_0_BASEADDR
 #include "xwdtps.h"
 #endif
 
 /************************** Constant Definitions *****************************/
+/*
+ * Size of the SPK block covered by the SPK signature
+ */
+#define RSA_SPK_SIZE		(RSA_SPK_MODULAR_SIZE + \
+					RSA_SPK_MODULAR_EXT_SIZE + RSA_SPK_EXPO_SIZE)
+
+/*
+ * Signed partitions are copied and hashed in chunks of this size
+ */
+#define RSA_HASH_CHUNK_SIZE	0x10000
 
 /**************************** Type Definitions *******************************/
 
@@ -65,7 +79,31 @@ static u8 *PpkModularEx;
 static u32	PpkExp;
 static u32 PpkAlreadySet=0;
 
+/*
+ * Montgomery constants of the PPK, prepared once in SetPpk()
+ */
+static Rsa2048Key PpkKey;
+
+/*
+ * Last SPK that passed verification against the PPK. Partitions signed
+ * with the same SPK skip the SPK hash and the PPK exponentiation.
+ */
+static Rsa2048Key SpkKey;
+static u8 SpkVerified[RSA_SPK_SIZE + RSA_SPK_SIGNATURE_SIZE];
+static u32 SpkVerifiedValid = 0;
+
+/*
+ * Partition hash computed while the partition was copied,
+ * see MoveImageAndHash()
+ */
+static Sha256Context StreamHashCtx;
+static u32 StreamHashAddr;
+static u32 StreamHashLen;
+static u32 StreamHashDone;
+static u32 StreamHashValid = 0;
+
 extern u32 FsblLength;
+extern ImageMoverType MoveImage;
 
 void FsblPrintArray (u8 *Buf, u32 Len, char *Str)
 {
@@ -144,6 +182,11 @@ void SetPpk(void )
 		PpkModularEx = (u8 *)PpkPtr;
 		PpkPtr += RSA_PPK_MODULAR_EXT_SIZE;
 		PpkExp = *((u32 *)PpkPtr);
+
+		/*
+		 * Precompute the Montgomery constants of the PPK
+		 */
+		Rsa2048KeyInit(&PpkKey, PpkModular, PpkModularEx);
 	
 		/*
 		 * Setting variable to avoid resetting PPK pointers
@@ -176,7 +219,9 @@ u32 AuthenticatePartition(u8 *Buffer, u32 Size)
 	u8 *SpkModular;
 	u8 *SpkModularEx;
 	u32 SpkExp;
+	u8 *SpkPtr;
 	u8 *SignaturePtr;
+	u32 HashLen;
 	u32 Status;
 
 #ifdef	XPAR_XWDTPS_0_BASEADDR
@@ -209,16 +254,9 @@ u32 AuthenticatePartition(u8 *Buffer, u32 Size)
 	SignaturePtr += RSA_PPK_EXPO_SIZE;
 
 	/*
-	 * Calculate Hash Signature
+	 * Extract SPK
 	 */
-	sha_256((u8 *)SignaturePtr, (RSA_SPK_MODULAR_EXT_SIZE +
-				RSA_SPK_EXPO_SIZE + RSA_SPK_MODULAR_SIZE),
-				HashSignature);
-	FsblPrintArray(HashSignature, 32, "SPK Hash Calculated");
-
-   	/*
-   	 * Extract SPK signature
-   	 */
+	SpkPtr = SignaturePtr;
 	SpkModular = (u8 *)SignaturePtr;
 	SignaturePtr += RSA_SPK_MODULAR_SIZE;
 	SpkModularEx = (u8 *)SignaturePtr;
@@ -227,43 +265,61 @@ u32 AuthenticatePartition(u8 *Buffer, u32 Size)
 	SignaturePtr += RSA_SPK_EXPO_SIZE;
 
 	/*
-	 * Decrypt SPK Signature
+	 * The SPK and its signature are usually identical for every
+	 * partition, verify them against the PPK only when they change
 	 */
-	rsa2048_pubexp((RSA_NUMBER)DecryptSignature,
-			(RSA_NUMBER)SignaturePtr,
-			(u32)PpkExp,
-			(RSA_NUMBER)PpkModular,
-			(RSA_NUMBER)PpkModularEx);
-	FsblPrintArray(DecryptSignature, RSA_SPK_SIGNATURE_SIZE,
-					"SPK Decrypted Hash");
+	if ((SpkVerifiedValid == 0) ||
+			(memcmp(SpkVerified, SpkPtr, sizeof(SpkVerified)) != 0)) {
+		SpkVerifiedValid = 0;
 
+		/*
+		 * Calculate Hash Signature
+		 */
+		Sha256(SpkPtr, RSA_SPK_SIZE, HashSignature);
+		FsblPrintArray(HashSignature, 32, "SPK Hash Calculated");
 
-	Status = RecreatePaddingAndCheck(DecryptSignature, HashSignature);
-	if (Status != XST_SUCCESS) {
-		fsbl_printf(DEBUG_INFO, "Partition SPK Signature "
-				"Authentication failed\r\n");
-		return XST_FAILURE;
+		/*
+		 * Decrypt SPK Signature
+		 */
+		Rsa2048PubExp(&PpkKey, SignaturePtr, PpkExp, DecryptSignature);
+		FsblPrintArray(DecryptSignature, RSA_SPK_SIGNATURE_SIZE,
+						"SPK Decrypted Hash");
+
+		Status = RecreatePaddingAndCheck(DecryptSignature, HashSignature);
+		if (Status != XST_SUCCESS) {
+			fsbl_printf(DEBUG_INFO, "Partition SPK Signature "
+					"Authentication failed\r\n");
+			return XST_FAILURE;
+		}
+
+		Rsa2048KeyInit(&SpkKey, SpkModular, SpkModularEx);
+		memcpy(SpkVerified, SpkPtr, sizeof(SpkVerified));
+		SpkVerifiedValid = 1;
+	} else {
+		fsbl_printf(DEBUG_INFO, "SPK already verified\r\n");
 	}
 	SignaturePtr += RSA_SPK_SIGNATURE_SIZE;
 
 	/*
 	 * Decrypt Partition Signature
 	 */
-	rsa2048_pubexp((RSA_NUMBER)DecryptSignature,
-			(RSA_NUMBER)SignaturePtr,
-			(u32)SpkExp,
-			(RSA_NUMBER)SpkModular,
-			(RSA_NUMBER)SpkModularEx);
+	Rsa2048PubExp(&SpkKey, SignaturePtr, SpkExp, DecryptSignature);
 	FsblPrintArray(DecryptSignature, RSA_PARTITION_SIGNATURE_SIZE,
 					"Partition Decrypted Hash");
 
 	/*
 	 * Partition Authentication
-	 * Calculate Hash Signature
+	 * Use the hash computed during the copy when it covers exactly
+	 * this buffer, calculate it otherwise
 	 */
-	sha_256((u8 *)Buffer,
-			(Size - RSA_PARTITION_SIGNATURE_SIZE),
-			HashSignature);
+	HashLen = Size - RSA_PARTITION_SIGNATURE_SIZE;
+	if (StreamHashValid && (StreamHashAddr == (u32)Buffer) &&
+			(StreamHashLen == HashLen) && (StreamHashDone == HashLen)) {
+		Sha256Finish(&StreamHashCtx, HashSignature);
+	} else {
+		Sha256((u8 *)Buffer, HashLen, HashSignature);
+	}
+	StreamHashValid = 0;
 	FsblPrintArray(HashSignature, 32,
 						"Partition Hash Calculated");
 
@@ -278,6 +334,86 @@ u32 AuthenticatePartition(u8 *Buffer, u32 Size)
 }
 
 
+/*****************************************************************************/
+/**
+*
+* This function copies a signed partition from the boot device and feeds
+* it to the partition hash on the way, so AuthenticatePartition() does not
+* need a second pass over the partition
+*
+* @param	SourceAddress is the partition offset on the boot device
+* @param	DestinationAddress is the DDR address of the copy
+* @param	LengthBytes is the partition length including the
+*		authentication certificate
+*
+* @return
+*		- XST_SUCCESS if the copy succeeded
+*		- XST_FAILURE if MoveImage failed
+*
+* @note		The data cache is enabled for the copy so the hash reads the
+*		freshly written data from the cache; it is flushed and
+*		disabled again before returning.
+*
+******************************************************************************/
+u32 MoveImageAndHash(u32 SourceAddress, u32 DestinationAddress,
+		u32 LengthBytes)
+{
+	u32 Offset = 0;
+	u32 Chunk;
+	u32 HashChunk;
+	u32 Status = XST_SUCCESS;
+
+	StreamHashValid = 0;
+	if (LengthBytes < RSA_PARTITION_SIGNATURE_SIZE) {
+		return MoveImage(SourceAddress, DestinationAddress, LengthBytes);
+	}
+
+	StreamHashAddr = DestinationAddress;
+	StreamHashLen = LengthBytes - RSA_PARTITION_SIGNATURE_SIZE;
+	StreamHashDone = 0;
+	Sha256Start(&StreamHashCtx);
+
+	Xil_DCacheEnable();
+
+	while (Offset < LengthBytes) {
+		Chunk = LengthBytes - Offset;
+		if (Chunk > RSA_HASH_CHUNK_SIZE) {
+			Chunk = RSA_HASH_CHUNK_SIZE;
+		}
+
+		Status = MoveImage(SourceAddress + Offset,
+				DestinationAddress + Offset, Chunk);
+		if (Status != XST_SUCCESS) {
+			break;
+		}
+
+		/*
+		 * The partition signature at the end is not hashed
+		 */
+		if (StreamHashDone < StreamHashLen) {
+			HashChunk = StreamHashLen - StreamHashDone;
+			if (HashChunk > Chunk) {
+				HashChunk = Chunk;
+			}
+			Sha256Update(&StreamHashCtx,
+					(u8 *)(DestinationAddress + Offset), HashChunk);
+			StreamHashDone += HashChunk;
+		}
+
+		Offset += Chunk;
+	}
+
+	Xil_DCacheFlush();
+	Xil_DCacheDisable();
+
+	if (Status == XST_SUCCESS) {
+		StreamHashValid = 1;
+	}
+
+	return Status;
+}
+
+
 /*****************************************************************************/
 /**
 *
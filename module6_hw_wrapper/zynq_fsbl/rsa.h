@@ -46,6 +46,8 @@ extern "C" {
 void SetPpk(void );
 u32 AuthenticatePartition(u8 *Buffer, u32 Size);
 u32 RecreatePaddingAndCheck(u8 *signature, u8 *hash);
+u32 MoveImageAndHash(u32 SourceAddress, u32 DestinationAddress,
+		u32 LengthBytes);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,285 @@
+/*****************************************************************************/
+/**
+*
+* @file rsa2048.c
+*
+* Contains the RSA-2048 public key operation for partition authentication,
+* built on word-serial (CIOS) Montgomery multiplication.
+*
+* @note
+*	Only public key operations are done here, so nothing is constant
+*	time. The input is expected to be below the modulus, a malformed
+*	signature only produces a result that fails the padding check.
+*
+******************************************************************************/
+
+/***************************** Include Files *********************************/
+#ifdef RSA_SUPPORT
+#include <string.h>
+#include "rsa2048.h"
+
+/************************** Constant Definitions *****************************/
+
+/**************************** Type Definitions *******************************/
+
+/***************** Macros (Inline Functions) Definitions *********************/
+
+/************************** Function Prototypes ******************************/
+
+/************************** Variable Definitions *****************************/
+
+/*****************************************************************************/
+/**
+*
+* This function loads a little endian byte string into words
+*
+* @param	Out is the word array
+* @param	In points to RSA2048_BYTES bytes
+*
+* @return	None
+*
+****************************************************************************/
+static void Rsa2048Load(u32 *Out, const u8 *In)
+{
+	u32 Index;
+
+	for (Index = 0; Index < RSA2048_WORDS; Index++) {
+		Out[Index] = (u32)In[0] | ((u32)In[1] << 8) |
+				((u32)In[2] << 16) | ((u32)In[3] << 24);
+		In += 4;
+	}
+}
+
+/*****************************************************************************/
+/**
+*
+* This function stores words as a little endian byte string
+*
+* @param	Out points to RSA2048_BYTES bytes
+* @param	In is the word array
+*
+* @return	None
+*
+****************************************************************************/
+static void Rsa2048Store(u8 *Out, const u32 *In)
+{
+	u32 Index;
+
+	for (Index = 0; Index < RSA2048_WORDS; Index++) {
+		Out[0] = (u8)In[Index];
+		Out[1] = (u8)(In[Index] >> 8);
+		Out[2] = (u8)(In[Index] >> 16);
+		Out[3] = (u8)(In[Index] >> 24);
+		Out += 4;
+	}
+}
+
+/*****************************************************************************/
+/**
+*
+* This function computes Out = A * B * R^-1 mod N
+*
+* @param	Key is the prepared key
+* @param	Out is the result, may alias A or B
+* @param	A is the first operand, below N
+* @param	B is the second operand, below N
+*
+* @return	None
+*
+****************************************************************************/
+static void Rsa2048MontMul(const Rsa2048Key *Key, u32 *Out, const u32 *A,
+		const u32 *B)
+{
+	u32 T[RSA2048_WORDS + 2];
+	const u32 *N = Key->Modulus;
+	u64 Carry;
+	u64 Borrow;
+	u32 M;
+	u32 I, J;
+
+	memset(T, 0, sizeof(T));
+
+	for (I = 0; I < RSA2048_WORDS; I++) {
+		/*
+		 * T += A * B[I]
+		 */
+		Carry = 0;
+		for (J = 0; J < RSA2048_WORDS; J++) {
+			Carry = (u64)A[J] * B[I] + T[J] + (Carry >> 32);
+			T[J] = (u32)Carry;
+		}
+		Carry = (u64)T[RSA2048_WORDS] + (Carry >> 32);
+		T[RSA2048_WORDS] = (u32)Carry;
+		T[RSA2048_WORDS + 1] = (u32)(Carry >> 32);
+
+		/*
+		 * T = (T + M * N) / 2^32, M chosen to clear the low word
+		 */
+		M = T[0] * Key->NPrime;
+		Carry = (u64)M * N[0] + T[0];
+		for (J = 1; J < RSA2048_WORDS; J++) {
+			Carry = (u64)M * N[J] + T[J] + (Carry >> 32);
+			T[J - 1] = (u32)Carry;
+		}
+		Carry = (u64)T[RSA2048_WORDS] + (Carry >> 32);
+		T[RSA2048_WORDS - 1] = (u32)Carry;
+		T[RSA2048_WORDS] = T[RSA2048_WORDS + 1] + (u32)(Carry >> 32);
+	}
+
+	/*
+	 * T < 2N, one conditional subtraction brings it below N
+	 */
+	if (T[RSA2048_WORDS] == 0) {
+		for (J = RSA2048_WORDS; J-- > 0; ) {
+			if (T[J] != N[J]) {
+				break;
+			}
+		}
+		if ((J != (u32)-1) && (T[J] < N[J])) {
+			memcpy(Out, T, RSA2048_BYTES);
+			return;
+		}
+	}
+
+	Borrow = 0;
+	for (J = 0; J < RSA2048_WORDS; J++) {
+		Borrow = (u64)T[J] - N[J] - Borrow;
+		Out[J] = (u32)Borrow;
+		Borrow = (Borrow >> 32) & 1;
+	}
+}
+
+/*****************************************************************************/
+/**
+*
+* This function prepares a key for repeated public key operations
+*
+* @param	Key is the key to prepare
+* @param	Modulus points to the little endian modulus
+* @param	ModulusExt points to the little endian R^2 mod N
+*
+* @return	None
+*
+* @note		This is what SetPpk() does once for the PPK and what rsa.c
+*		does once per distinct SPK.
+*
+****************************************************************************/
+void Rsa2048KeyInit(Rsa2048Key *Key, const u8 *Modulus, const u8 *ModulusExt)
+{
+	u32 Inv;
+	u32 Index;
+
+	Rsa2048Load(Key->Modulus, Modulus);
+	Rsa2048Load(Key->ModulusExt, ModulusExt);
+
+	/*
+	 * Newton iteration for N[0]^-1 mod 2^32, every step doubles the
+	 * number of correct low bits starting from 3
+	 */
+	Inv = Key->Modulus[0];
+	for (Index = 0; Index < 4; Index++) {
+		Inv *= 2 - Key->Modulus[0] * Inv;
+	}
+	Key->NPrime = (u32)0 - Inv;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function computes Result = Base ^ Exponent mod N by left to right
+* binary exponentiation in the Montgomery domain
+*
+* @param	Key is the prepared key
+* @param	Base points to the little endian base
+* @param	Exponent is the public exponent
+* @param	Result points to the little endian result
+*
+* @return	None
+*
+****************************************************************************/
+void Rsa2048ModExp(const Rsa2048Key *Key, const u8 *Base, u32 Exponent,
+		u8 *Result)
+{
+	u32 X[RSA2048_WORDS];
+	u32 XMont[RSA2048_WORDS];
+	u32 Acc[RSA2048_WORDS];
+	s32 Bit;
+
+	Rsa2048Load(X, Base);
+
+	if (Exponent == 0) {
+		memset(Acc, 0, sizeof(Acc));
+		Acc[0] = 1;
+		Rsa2048Store(Result, Acc);
+		return;
+	}
+
+	Rsa2048MontMul(Key, XMont, X, Key->ModulusExt);
+	memcpy(Acc, XMont, sizeof(Acc));
+
+	for (Bit = 30; (Bit >= 0) && !(Exponent >> (Bit + 1)); Bit--) {
+		/*
+		 * Skip to the bit below the most significant one
+		 */
+	}
+
+	for (; Bit >= 0; Bit--) {
+		Rsa2048MontMul(Key, Acc, Acc, Acc);
+		if (Exponent & (1U << Bit)) {
+			Rsa2048MontMul(Key, Acc, Acc, XMont);
+		}
+	}
+
+	/*
+	 * Leave the Montgomery domain
+	 */
+	memset(X, 0, sizeof(X));
+	X[0] = 1;
+	Rsa2048MontMul(Key, Acc, Acc, X);
+	Rsa2048Store(Result, Acc);
+}
+
+/*****************************************************************************/
+/**
+*
+* This function computes Result = Base ^ Exponent mod N for a public
+* exponent.
+*
+* Exponents of the form 2^k + 1 (3, 17, 65537) take a fast path: k
+* squarings of Base * R followed by one multiplication with the plain Base,
+* which leaves the Montgomery domain for free. 65537 costs 18 Montgomery
+* multiplications against 19 plus the bit scan in Rsa2048ModExp().
+*
+* @param	Key is the prepared key
+* @param	Base points to the little endian base
+* @param	Exponent is the public exponent
+* @param	Result points to the little endian result
+*
+* @return	None
+*
+****************************************************************************/
+void Rsa2048PubExp(const Rsa2048Key *Key, const u8 *Base, u32 Exponent,
+		u8 *Result)
+{
+	u32 X[RSA2048_WORDS];
+	u32 Acc[RSA2048_WORDS];
+	u32 Squarings = Exponent - 1;
+
+	if (((Exponent & 1) == 0) || (Squarings == 0) ||
+			((Squarings & (Squarings - 1)) != 0)) {
+		Rsa2048ModExp(Key, Base, Exponent, Result);
+		return;
+	}
+
+	Rsa2048Load(X, Base);
+	Rsa2048MontMul(Key, Acc, X, Key->ModulusExt);
+
+	while (Squarings > 1) {
+		Rsa2048MontMul(Key, Acc, Acc, Acc);
+		Squarings >>= 1;
+	}
+
+	Rsa2048MontMul(Key, Acc, Acc, X);
+	Rsa2048Store(Result, Acc);
+}
+#endif
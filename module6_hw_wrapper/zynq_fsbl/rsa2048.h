@@ -0,0 +1,50 @@
+/*****************************************************************************/
+/**
+*
+* @file rsa2048.h
+*
+* Contains the interface of the RSA-2048 public key operation used for
+* partition authentication.
+*
+* Numbers are little endian, as they are stored in the authentication
+* certificate. A key is prepared once with Rsa2048KeyInit(), which keeps
+* the modulus, R^2 mod N (the modulus extension bootgen writes next to
+* every key) and the Montgomery constant -N^-1 mod 2^32, so each
+* verification only runs the exponentiation itself.
+*
+* @note
+*
+******************************************************************************/
+#ifndef ___RSA2048_H___
+#define ___RSA2048_H___
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************** Include Files *********************************/
+#include "xil_types.h"
+
+/************************** Constant Definitions *****************************/
+#define RSA2048_BYTES			256
+#define RSA2048_WORDS			(RSA2048_BYTES / 4)
+
+/**************************** Type Definitions *******************************/
+typedef struct {
+	u32 Modulus[RSA2048_WORDS];	/* N */
+	u32 ModulusExt[RSA2048_WORDS];	/* R^2 mod N, R = 2^2048 */
+	u32 NPrime;			/* -N^-1 mod 2^32 */
+} Rsa2048Key;
+
+/************************** Function Prototypes ******************************/
+void Rsa2048KeyInit(Rsa2048Key *Key, const u8 *Modulus, const u8 *ModulusExt);
+void Rsa2048ModExp(const Rsa2048Key *Key, const u8 *Base, u32 Exponent,
+		u8 *Result);
+void Rsa2048PubExp(const Rsa2048Key *Key, const u8 *Base, u32 Exponent,
+		u8 *Result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ___RSA2048_H___ */
@@ -39,14 +39,40 @@
 
 #include "ff.h"
 #include "sd.h"
+#ifndef SD_FAST_PATH_EXCLUDE
+#include <string.h>
+#include "diskio.h"
+#endif
 
 /************************** Constant Definitions *****************************/
+#ifndef SD_FAST_PATH_EXCLUDE
+#define SD_SECTOR_SIZE		512
+#define SD_MAX_EXTENTS		64	/* Fragments of BOOT.BIN on the card */
+#define SD_MAX_READ_BLOCKS	4096	/* 32 ADMA2 descriptors of 64 KB */
+#define SD_BOUNCE_SECTORS	16
+#define SD_DMA_ALIGN		32	/* Cache line, see XSdPs_SetupReadDma */
+#endif
 
 /**************************** Type Definitions *******************************/
+#ifndef SD_FAST_PATH_EXCLUDE
+/*
+ * Run of file sectors that are consecutive on the card
+ */
+typedef struct {
+	u32 FileSector;		/* First sector of the run in the file */
+	u32 Lba;		/* Card sector it is stored at */
+	u32 Count;		/* Sectors in the run */
+} SdExtent;
+#endif
 
 /***************** Macros (Inline Functions) Definitions *********************/
 
 /************************** Function Prototypes ******************************/
+#ifndef SD_FAST_PATH_EXCLUDE
+static u32 SdBuildExtentMap(void);
+static u32 SdFastRead(u32 SourceAddress, u32 DestinationAddress,
+		u32 LengthBytes);
+#endif
 
 /************************** Variable Definitions *****************************/
 
@@ -58,6 +84,27 @@ static FATFS fatfs;
 static char buffer[32];
 static char *boot_file = buffer;
 
+#ifndef SD_FAST_PATH_EXCLUDE
+/*
+ * Cluster map of the boot file, built once at InitSD. SdExtentCount is 0
+ * when the file system or the fragmentation is not handled, SDAccess then
+ * goes through f_lseek/f_read.
+ */
+static SdExtent SdExtentMap[SD_MAX_EXTENTS];
+static u32 SdExtentCount;
+static u32 SdExtentHint;
+static u32 SdFileSize;
+
+/*
+ * Sector buffer for partial sectors and unaligned destinations, it also
+ * keeps the last sectors read for the many small header reads
+ */
+static u8 SdBounce[SD_BOUNCE_SECTORS * SD_SECTOR_SIZE]
+		__attribute__ ((aligned(SD_DMA_ALIGN)));
+static u32 SdBounceLba;
+static u32 SdBounceCount;
+#endif
+
 /******************************************************************************/
 /******************************************************************************/
 /**
@@ -97,6 +144,12 @@ u32 InitSD(const char *filename)
 		return XST_FAILURE;
 	}
 
+#ifndef SD_FAST_PATH_EXCLUDE
+	if (SdBuildExtentMap() != XST_SUCCESS) {
+		fsbl_printf(DEBUG_INFO,"SD: no cluster map, using f_read\r\n");
+	}
+#endif
+
 	return XST_SUCCESS;
 
 }
@@ -124,6 +177,12 @@ u32 SDAccess( u32 SourceAddress, u32 DestinationAddress, u32 LengthBytes)
 	FRESULT rc;	 /* Result code */
 	UINT br;
 
+#ifndef SD_FAST_PATH_EXCLUDE
+	if (SdExtentCount != 0) {
+		return SdFastRead(SourceAddress, DestinationAddress, LengthBytes);
+	}
+#endif
+
 	rc = f_lseek(&fil, SourceAddress);
 	if (rc) {
 		fsbl_printf(DEBUG_INFO,"SD: Unable to seek to %lx\n", SourceAddress);
@@ -156,10 +215,234 @@ u32 SDAccess( u32 SourceAddress, u32 DestinationAddress, u32 LengthBytes)
 void ReleaseSD(void) {
 
 	f_close(&fil);
+#ifndef SD_FAST_PATH_EXCLUDE
+	SdExtentCount = 0;
+#endif
 	return;
 
 
 }
+
+#ifndef SD_FAST_PATH_EXCLUDE
+/******************************************************************************/
+/**
+*
+* This function walks the FAT chain of the boot file once and records it as
+* runs of consecutive card sectors
+*
+* @param	None
+*
+* @return
+*		- XST_SUCCESS if the map covers the whole file
+*		- XST_FAILURE if the file system is not FAT16/FAT32, the chain
+*		  is broken or the file has more than SD_MAX_EXTENTS fragments
+*
+* @note		The FAT sectors are read through SdBounce.
+*
+****************************************************************************/
+static u32 SdBuildExtentMap(void)
+{
+	FATFS *Fs = fil.obj.fs;
+	u32 Cluster = fil.obj.sclust;
+	u32 ClusterBytes = (u32)Fs->csize * SD_SECTOR_SIZE;
+	u32 Remaining = (u32)fil.obj.objsize;
+	u32 EntriesPerSector;
+	u32 FatSector;
+	u32 Index;
+	u32 Lba;
+	SdExtent *Extent = NULL;
+
+	SdExtentCount = 0;
+	SdExtentHint = 0;
+	SdBounceCount = 0;
+	SdFileSize = Remaining;
+
+	if ((Fs->fs_type != FS_FAT16) && (Fs->fs_type != FS_FAT32)) {
+		return XST_FAILURE;
+	}
+	EntriesPerSector = SD_SECTOR_SIZE / ((Fs->fs_type == FS_FAT16) ? 2 : 4);
+
+	Index = 0;
+	while (Remaining != 0) {
+		if ((Cluster < 2) || (Cluster >= Fs->n_fatent)) {
+			return XST_FAILURE;
+		}
+
+		/*
+		 * Extend the current run or start a new one
+		 */
+		Lba = Fs->database + (Cluster - 2) * Fs->csize;
+		if ((Extent != NULL) && (Lba == (Extent->Lba + Extent->Count))) {
+			Extent->Count += Fs->csize;
+		} else {
+			if (Index == SD_MAX_EXTENTS) {
+				return XST_FAILURE;
+			}
+			Extent = &SdExtentMap[Index++];
+			Extent->FileSector = (Extent == SdExtentMap) ? 0 :
+					((Extent - 1)->FileSector + (Extent - 1)->Count);
+			Extent->Lba = Lba;
+			Extent->Count = Fs->csize;
+		}
+		Remaining -= (Remaining < ClusterBytes) ? Remaining : ClusterBytes;
+		if (Remaining == 0) {
+			break;
+		}
+
+		/*
+		 * Next cluster from the FAT
+		 */
+		FatSector = Fs->fatbase + (Cluster / EntriesPerSector);
+		if ((SdBounceCount == 0) || (SdBounceLba != FatSector)) {
+			if (disk_read(Fs->pdrv, SdBounce, FatSector, 1) != RES_OK) {
+				SdBounceCount = 0;
+				return XST_FAILURE;
+			}
+			SdBounceLba = FatSector;
+			SdBounceCount = 1;
+		}
+		if (Fs->fs_type == FS_FAT16) {
+			Cluster = (u32)SdBounce[(Cluster % EntriesPerSector) * 2] |
+				((u32)SdBounce[(Cluster % EntriesPerSector) * 2 + 1] << 8);
+		} else {
+			Cluster = ((u32)SdBounce[(Cluster % EntriesPerSector) * 4] |
+				((u32)SdBounce[(Cluster % EntriesPerSector) * 4 + 1] << 8) |
+				((u32)SdBounce[(Cluster % EntriesPerSector) * 4 + 2] << 16) |
+				((u32)SdBounce[(Cluster % EntriesPerSector) * 4 + 3] << 24)) &
+				0x0FFFFFFF;
+		}
+	}
+
+	/*
+	 * FAT sectors are not file data
+	 */
+	SdBounceCount = 0;
+	SdExtentCount = Index;
+	fsbl_printf(DEBUG_INFO,"SD: %lu bytes in %lu extents\r\n",
+			SdFileSize, SdExtentCount);
+
+	return XST_SUCCESS;
+}
+
+/******************************************************************************/
+/**
+*
+* This function reads from the boot file through the cluster map.
+*
+* Whole sectors that land on a cache line aligned destination are read
+* straight into it, as many as are consecutive on the card in one
+* multi-block command. Partial sectors and unaligned destinations go
+* through SdBounce.
+*
+* @param	SourceAddress is the offset in the boot file
+* @param	DestinationAddress is address in OCM or DDR
+* @param	LengthBytes is the number of bytes to move
+*
+* @return
+*		- XST_SUCCESS if the read completes correctly
+*		- XST_FAILURE if the range is outside the file or the card
+*		  read fails
+*
+* @note		None.
+*
+****************************************************************************/
+static u32 SdFastRead(u32 SourceAddress, u32 DestinationAddress,
+		u32 LengthBytes)
+{
+	FATFS *Fs = fil.obj.fs;
+	SdExtent *Extent;
+	u32 Sector;
+	u32 Offset;
+	u32 Lba;
+	u32 Avail;
+	u32 Count;
+	u32 Bytes;
+
+	if ((SourceAddress > SdFileSize) ||
+			(LengthBytes > (SdFileSize - SourceAddress))) {
+		fsbl_printf(DEBUG_GENERAL,"SD: read past end of file %lx\r\n",
+				SourceAddress);
+		return XST_FAILURE;
+	}
+
+	while (LengthBytes != 0) {
+		Sector = SourceAddress / SD_SECTOR_SIZE;
+		Offset = SourceAddress % SD_SECTOR_SIZE;
+
+		/*
+		 * Find the run holding the sector, reads are mostly sequential
+		 */
+		if (Sector < SdExtentMap[SdExtentHint].FileSector) {
+			SdExtentHint = 0;
+		}
+		while ((SdExtentHint < (SdExtentCount - 1)) &&
+				(Sector >= (SdExtentMap[SdExtentHint].FileSector +
+					SdExtentMap[SdExtentHint].Count))) {
+			SdExtentHint++;
+		}
+		Extent = &SdExtentMap[SdExtentHint];
+		Lba = Extent->Lba + (Sector - Extent->FileSector);
+		Avail = Extent->FileSector + Extent->Count - Sector;
+
+		if ((Offset == 0) && (LengthBytes >= SD_SECTOR_SIZE) &&
+				((DestinationAddress % SD_DMA_ALIGN) == 0)) {
+			/*
+			 * Direct multi-block read
+			 */
+			Count = LengthBytes / SD_SECTOR_SIZE;
+			if (Count > Avail) {
+				Count = Avail;
+			}
+			if (Count > SD_MAX_READ_BLOCKS) {
+				Count = SD_MAX_READ_BLOCKS;
+			}
+			if (disk_read(Fs->pdrv, (BYTE *)DestinationAddress, Lba,
+					Count) != RES_OK) {
+				fsbl_printf(DEBUG_GENERAL,"SD: read of %lu sectors at %lx "
+						"failed\r\n", Count, Lba);
+				return XST_FAILURE;
+			}
+			Bytes = Count * SD_SECTOR_SIZE;
+		} else {
+			/*
+			 * Through the bounce buffer, which may already hold it
+			 */
+			Count = (Offset + LengthBytes + SD_SECTOR_SIZE - 1) /
+					SD_SECTOR_SIZE;
+			if (Count > Avail) {
+				Count = Avail;
+			}
+			if (Count > SD_BOUNCE_SECTORS) {
+				Count = SD_BOUNCE_SECTORS;
+			}
+			if ((SdBounceCount == 0) || (Lba < SdBounceLba) ||
+					((Lba + Count) > (SdBounceLba + SdBounceCount))) {
+				if (disk_read(Fs->pdrv, SdBounce, Lba, Count) != RES_OK) {
+					SdBounceCount = 0;
+					fsbl_printf(DEBUG_GENERAL,"SD: read of %lu sectors at "
+							"%lx failed\r\n", Count, Lba);
+					return XST_FAILURE;
+				}
+				SdBounceLba = Lba;
+				SdBounceCount = Count;
+			}
+			Bytes = Count * SD_SECTOR_SIZE - Offset;
+			if (Bytes > LengthBytes) {
+				Bytes = LengthBytes;
+			}
+			memcpy((void *)DestinationAddress,
+				&SdBounce[(Lba - SdBounceLba) * SD_SECTOR_SIZE + Offset],
+				Bytes);
+		}
+
+		SourceAddress += Bytes;
+		DestinationAddress += Bytes;
+		LengthBytes -= Bytes;
+	}
+
+	return XST_SUCCESS;
+}
+#endif
 #endif
 
 
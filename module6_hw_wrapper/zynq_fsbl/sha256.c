@@ -0,0 +1,229 @@
+/*****************************************************************************/
+/**
+*
+* @file sha256.c
+*
+* Contains the streaming SHA-256 (FIPS 180-4) used by rsa.c
+*
+* @note
+*	Full blocks are processed straight from the caller's buffer, the
+*	context buffer only holds a partial block between updates.
+*
+******************************************************************************/
+
+/***************************** Include Files *********************************/
+#ifdef RSA_SUPPORT
+#include <string.h>
+#include "sha256.h"
+
+/************************** Constant Definitions *****************************/
+
+static const u32 Sha256K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/***************** Macros (Inline Functions) Definitions *********************/
+#define ROR(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z)	(((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z)	(((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define EP0(x)		(ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define EP1(x)		(ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define SIG0(x)		(ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define SIG1(x)		(ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+
+#define LOAD_BE32(p)	(((u32)(p)[0] << 24) | ((u32)(p)[1] << 16) | \
+			 ((u32)(p)[2] << 8) | (u32)(p)[3])
+
+/*****************************************************************************/
+/**
+*
+* This function compresses one 64 byte block into the hash state
+*
+* @param	State is the hash state
+* @param	Block points to the block
+*
+* @return	None
+*
+* @note		None
+*
+****************************************************************************/
+static void Sha256Block(u32 *State, const u8 *Block)
+{
+	u32 W[64];
+	u32 A, B, C, D, E, F, G, H;
+	u32 T1, T2;
+	u32 Index;
+
+	for (Index = 0; Index < 16; Index++) {
+		W[Index] = LOAD_BE32(Block + (Index << 2));
+	}
+	for (Index = 16; Index < 64; Index++) {
+		W[Index] = SIG1(W[Index - 2]) + W[Index - 7] +
+				SIG0(W[Index - 15]) + W[Index - 16];
+	}
+
+	A = State[0]; B = State[1]; C = State[2]; D = State[3];
+	E = State[4]; F = State[5]; G = State[6]; H = State[7];
+
+	for (Index = 0; Index < 64; Index++) {
+		T1 = H + EP1(E) + CH(E, F, G) + Sha256K[Index] + W[Index];
+		T2 = EP0(A) + MAJ(A, B, C);
+		H = G; G = F; F = E;
+		E = D + T1;
+		D = C; C = B; B = A;
+		A = T1 + T2;
+	}
+
+	State[0] += A; State[1] += B; State[2] += C; State[3] += D;
+	State[4] += E; State[5] += F; State[6] += G; State[7] += H;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function initializes a SHA-256 context
+*
+* @param	Ctx is the context to initialize
+*
+* @return	None
+*
+* @note		None
+*
+****************************************************************************/
+void Sha256Start(Sha256Context *Ctx)
+{
+	Ctx->State[0] = 0x6a09e667;
+	Ctx->State[1] = 0xbb67ae85;
+	Ctx->State[2] = 0x3c6ef372;
+	Ctx->State[3] = 0xa54ff53a;
+	Ctx->State[4] = 0x510e527f;
+	Ctx->State[5] = 0x9b05688c;
+	Ctx->State[6] = 0x1f83d9ab;
+	Ctx->State[7] = 0x5be0cd19;
+	Ctx->BufferLen = 0;
+	Ctx->TotalLen = 0;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function feeds data into a SHA-256 context
+*
+* @param	Ctx is the context
+* @param	Data points to the data
+* @param	Len is the data length in bytes
+*
+* @return	None
+*
+* @note		None
+*
+****************************************************************************/
+void Sha256Update(Sha256Context *Ctx, const u8 *Data, u32 Len)
+{
+	u32 Fill;
+
+	Ctx->TotalLen += Len;
+
+	/*
+	 * Complete a pending partial block first
+	 */
+	if (Ctx->BufferLen != 0) {
+		Fill = SHA256_BLOCK_SIZE - Ctx->BufferLen;
+		if (Len < Fill) {
+			memcpy(Ctx->Buffer + Ctx->BufferLen, Data, Len);
+			Ctx->BufferLen += Len;
+			return;
+		}
+		memcpy(Ctx->Buffer + Ctx->BufferLen, Data, Fill);
+		Sha256Block(Ctx->State, Ctx->Buffer);
+		Ctx->BufferLen = 0;
+		Data += Fill;
+		Len -= Fill;
+	}
+
+	while (Len >= SHA256_BLOCK_SIZE) {
+		Sha256Block(Ctx->State, Data);
+		Data += SHA256_BLOCK_SIZE;
+		Len -= SHA256_BLOCK_SIZE;
+	}
+
+	if (Len != 0) {
+		memcpy(Ctx->Buffer, Data, Len);
+		Ctx->BufferLen = Len;
+	}
+}
+
+/*****************************************************************************/
+/**
+*
+* This function pads the message and writes the digest
+*
+* @param	Ctx is the context
+* @param	Digest points to a SHA256_DIGEST_SIZE byte output buffer
+*
+* @return	None
+*
+* @note		The context must be restarted before it is used again.
+*
+****************************************************************************/
+void Sha256Finish(Sha256Context *Ctx, u8 *Digest)
+{
+	u64 BitLen = Ctx->TotalLen << 3;
+	u32 Index;
+
+	Ctx->Buffer[Ctx->BufferLen++] = 0x80;
+	if (Ctx->BufferLen > SHA256_BLOCK_SIZE - 8) {
+		memset(Ctx->Buffer + Ctx->BufferLen, 0,
+				SHA256_BLOCK_SIZE - Ctx->BufferLen);
+		Sha256Block(Ctx->State, Ctx->Buffer);
+		Ctx->BufferLen = 0;
+	}
+	memset(Ctx->Buffer + Ctx->BufferLen, 0,
+			SHA256_BLOCK_SIZE - 8 - Ctx->BufferLen);
+
+	for (Index = 0; Index < 8; Index++) {
+		Ctx->Buffer[SHA256_BLOCK_SIZE - 1 - Index] = (u8)(BitLen >> (Index << 3));
+	}
+	Sha256Block(Ctx->State, Ctx->Buffer);
+
+	for (Index = 0; Index < 8; Index++) {
+		Digest[(Index << 2)] = (u8)(Ctx->State[Index] >> 24);
+		Digest[(Index << 2) + 1] = (u8)(Ctx->State[Index] >> 16);
+		Digest[(Index << 2) + 2] = (u8)(Ctx->State[Index] >> 8);
+		Digest[(Index << 2) + 3] = (u8)(Ctx->State[Index]);
+	}
+}
+
+/*****************************************************************************/
+/**
+*
+* This function hashes a buffer in one call
+*
+* @param	Data points to the data
+* @param	Len is the data length in bytes
+* @param	Digest points to a SHA256_DIGEST_SIZE byte output buffer
+*
+* @return	None
+*
+* @note		None
+*
+****************************************************************************/
+void Sha256(const u8 *Data, u32 Len, u8 *Digest)
+{
+	Sha256Context Ctx;
+
+	Sha256Start(&Ctx);
+	Sha256Update(&Ctx, Data, Len);
+	Sha256Finish(&Ctx, Digest);
+}
+#endif
@@ -0,0 +1,46 @@
+/*****************************************************************************/
+/**
+*
+* @file sha256.h
+*
+* Contains the interface of the streaming SHA-256 used for partition
+* authentication. The context can be fed piecewise while a partition is
+* being copied from the boot device, so the digest is ready when the copy
+* completes.
+*
+* @note
+*
+******************************************************************************/
+#ifndef ___SHA256_H___
+#define ___SHA256_H___
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************** Include Files *********************************/
+#include "xil_types.h"
+
+/************************** Constant Definitions *****************************/
+#define SHA256_BLOCK_SIZE		64
+#define SHA256_DIGEST_SIZE		32
+
+/**************************** Type Definitions *******************************/
+typedef struct {
+	u32 State[8];
+	u8 Buffer[SHA256_BLOCK_SIZE];
+	u32 BufferLen;
+	u64 TotalLen;
+} Sha256Context;
+
+/************************** Function Prototypes ******************************/
+void Sha256Start(Sha256Context *Ctx);
+void Sha256Update(Sha256Context *Ctx, const u8 *Data, u32 Len);
+void Sha256Finish(Sha256Context *Ctx, u8 *Digest);
+void Sha256(const u8 *Data, u32 Len, u8 *Digest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ___SHA256_H___ */
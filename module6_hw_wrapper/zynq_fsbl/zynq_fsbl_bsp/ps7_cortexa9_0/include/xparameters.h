@@ -642,4 +642,5 @@
 #define FILE_SYSTEM_USE_STRFUNC 0
 #define FILE_SYSTEM_SET_FS_RPATH 0
 #define FILE_SYSTEM_WORD_ACCESS
+#define FILE_SYSTEM_CACHE_SECTORS 0
 #endif  /* end of protection macro */
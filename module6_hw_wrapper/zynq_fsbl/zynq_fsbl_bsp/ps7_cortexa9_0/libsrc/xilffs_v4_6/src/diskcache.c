@@ -0,0 +1,453 @@
+/*****************************************************************************/
+/**
+*
+* @file diskcache.c
+*
+* Contains the write-back LRU sector cache beneath diskio.c
+*
+* @note
+*	The cache is small enough that every lookup is a scan of all lines;
+*	one scan costs far less than the command it saves. Lines and the
+*	staging buffers are cache line aligned, so DMA into and out of them
+*	never shares a line with other data.
+*
+******************************************************************************/
+
+/***************************** Include Files *********************************/
+#include <string.h>
+#include "diskcache.h"
+
+/************************** Constant Definitions *****************************/
+#define SECTOR_SIZE		DISK_CACHE_SECTOR_SIZE
+#define NO_LINE			(-1)
+
+/**************************** Type Definitions *******************************/
+typedef struct {
+	DWORD Sector;
+	u32 Age;		/* UseCount at the last access */
+	BYTE Drive;
+	u8 Valid;
+	u8 Dirty;
+} CacheLine;
+
+/************************** Variable Definitions *****************************/
+static DiskCacheStats Stats;
+
+#if DISK_CACHE_SECTORS > 0
+static CacheLine Lines[DISK_CACHE_SECTORS];
+static BYTE LineData[DISK_CACHE_SECTORS][SECTOR_SIZE]
+		__attribute__ ((aligned(32)));
+static BYTE ReadStage[DISK_CACHE_STAGE][SECTOR_SIZE]
+		__attribute__ ((aligned(32)));
+/* Separate, a read can evict while its sectors are in ReadStage */
+static BYTE WriteStage[DISK_CACHE_STAGE][SECTOR_SIZE]
+		__attribute__ ((aligned(32)));
+static u32 UseCount;
+static DWORD NextSector[DISK_CACHE_DRIVES];	/* End of the last read */
+
+/*****************************************************************************/
+/**
+*
+* This function finds the line holding a sector
+*
+* @param	Drive is the drive number
+* @param	Sector is the sector number
+*
+* @return	The line index, or NO_LINE if the sector is not cached
+*
+****************************************************************************/
+static s32 Lookup(BYTE Drive, DWORD Sector)
+{
+	s32 Index;
+
+	for (Index = 0; Index < (s32)DISK_CACHE_SECTORS; Index++) {
+		if ((Lines[Index].Valid != 0U) && (Lines[Index].Sector == Sector) &&
+				(Lines[Index].Drive == Drive)) {
+			return Index;
+		}
+	}
+	return NO_LINE;
+}
+
+static void Touch(s32 Index)
+{
+	UseCount++;
+	Lines[Index].Age = UseCount;
+}
+
+static u32 IsDirty(BYTE Drive, DWORD Sector)
+{
+	s32 Index = Lookup(Drive, Sector);
+
+	return (Index != NO_LINE) && (Lines[Index].Dirty != 0U);
+}
+
+/*****************************************************************************/
+/**
+*
+* This function writes a run of dirty sectors to the card in one command
+* and marks them clean
+*
+* @param	Drive is the drive number
+* @param	First is the first sector of the run
+* @param	Count is the number of sectors, 1 to DISK_CACHE_STAGE, all of
+*		them cached and dirty
+*
+* @return	RES_OK, or the error of the transfer
+*
+****************************************************************************/
+static DRESULT WriteRun(BYTE Drive, DWORD First, UINT Count)
+{
+	const BYTE *Src;
+	DRESULT Res;
+	UINT Index;
+
+	if (Count == 1U) {
+		Src = LineData[Lookup(Drive, First)];
+	} else {
+		for (Index = 0U; Index < Count; Index++) {
+			(void)memcpy(WriteStage[Index],
+					LineData[Lookup(Drive, First + Index)], SECTOR_SIZE);
+		}
+		Src = WriteStage[0];
+	}
+	Stats.Commands++;
+	Res = disk_cache_dev_write(Drive, Src, First, Count);
+	if (Res != RES_OK) {
+		return Res;
+	}
+	for (Index = 0U; Index < Count; Index++) {
+		Lines[Lookup(Drive, First + Index)].Dirty = 0U;
+	}
+	Stats.WriteBacks += Count;
+	return RES_OK;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function frees a line for a new sector, the least recently used
+* one if none is free. A dirty victim is written back with the dirty
+* sectors around it.
+*
+* @param	Drive is the drive number of the new sector
+* @param	Sector is the new sector
+*
+* @return	The line index, or NO_LINE if the write back failed
+*
+****************************************************************************/
+static s32 Allocate(BYTE Drive, DWORD Sector)
+{
+	s32 Index, Victim = 0;
+	DWORD First;
+	UINT Count;
+
+	for (Index = 0; Index < (s32)DISK_CACHE_SECTORS; Index++) {
+		if (Lines[Index].Valid == 0U) {
+			Victim = Index;
+			break;
+		}
+		if (Lines[Index].Age < Lines[Victim].Age) {
+			Victim = Index;
+		}
+	}
+	if ((Lines[Victim].Valid != 0U) && (Lines[Victim].Dirty != 0U)) {
+		First = Lines[Victim].Sector;
+		while ((First > 0U) && ((Lines[Victim].Sector - First) <
+				(DISK_CACHE_STAGE / 2U)) &&
+				(IsDirty(Lines[Victim].Drive, First - 1U) != 0U)) {
+			First--;
+		}
+		for (Count = 1U; (Count < DISK_CACHE_STAGE) &&
+				(IsDirty(Lines[Victim].Drive, First + Count) != 0U); Count++) {
+			;
+		}
+		if (WriteRun(Lines[Victim].Drive, First, Count) != RES_OK) {
+			return NO_LINE;
+		}
+		Stats.Evictions += Count;
+	}
+	Lines[Victim].Drive = Drive;
+	Lines[Victim].Sector = Sector;
+	Lines[Victim].Valid = 1U;
+	Lines[Victim].Dirty = 0U;
+	return Victim;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function reads sectors through the cache
+*
+* @param	pdrv - Drive number
+* @param	*buff - Pointer to the data buffer to store read data
+* @param	sector - Start sector number
+* @param	count - Sector count
+*
+* @return	RES_OK, or the error of a transfer
+*
+* @note		Missing sectors are read in one command per run. When the
+*		request continues the previous one and misses up to its end,
+*		the command reads DISK_CACHE_READ_AHEAD sectors more; if that
+*		fails, past the end of the card, it is retried without them.
+*
+****************************************************************************/
+DRESULT disk_cache_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	DRESULT Res;
+	s32 Index;
+	UINT Run, Fetch, Offset;
+	u32 Sequential;
+
+	if (pdrv >= DISK_CACHE_DRIVES) {
+		return RES_PARERR;
+	}
+	Sequential = (sector == NextSector[pdrv]);
+	NextSector[pdrv] = sector + count;
+
+	if (count >= DISK_CACHE_STAGE) {
+		Stats.Bypassed++;
+		Stats.Commands++;
+		Res = disk_cache_dev_read(pdrv, buff, sector, count);
+		if (Res != RES_OK) {
+			return Res;
+		}
+		/* A cached sector may be newer than the card */
+		for (Index = 0; Index < (s32)DISK_CACHE_SECTORS; Index++) {
+			if ((Lines[Index].Valid != 0U) && (Lines[Index].Drive == pdrv) &&
+					(Lines[Index].Sector >= sector) &&
+					(Lines[Index].Sector < (sector + count))) {
+				(void)memcpy(buff + ((Lines[Index].Sector - sector) * SECTOR_SIZE),
+						LineData[Index], SECTOR_SIZE);
+			}
+		}
+		return RES_OK;
+	}
+
+	while (count > 0U) {
+		Index = Lookup(pdrv, sector);
+		if (Index != NO_LINE) {
+			(void)memcpy(buff, LineData[Index], SECTOR_SIZE);
+			Touch(Index);
+			Stats.ReadHits++;
+			buff += SECTOR_SIZE;
+			sector++;
+			count--;
+			continue;
+		}
+
+		for (Run = 1U; (Run < count) && (Lookup(pdrv, sector + Run) == NO_LINE);
+				Run++) {
+			;
+		}
+		Fetch = Run;
+		if ((Sequential != 0U) && (Run == count)) {
+			Fetch = Run + DISK_CACHE_READ_AHEAD;
+			if (Fetch > DISK_CACHE_STAGE) {
+				Fetch = DISK_CACHE_STAGE;
+			}
+		}
+		Stats.Commands++;
+		Res = disk_cache_dev_read(pdrv, ReadStage[0], sector, Fetch);
+		if ((Res != RES_OK) && (Fetch > Run)) {
+			Fetch = Run;
+			Stats.Commands++;
+			Res = disk_cache_dev_read(pdrv, ReadStage[0], sector, Fetch);
+		}
+		if (Res != RES_OK) {
+			return Res;
+		}
+		Stats.ReadMisses += Run;
+		Stats.ReadAhead += Fetch - Run;
+
+		(void)memcpy(buff, ReadStage[0], Run * SECTOR_SIZE);
+		for (Offset = 0U; Offset < Fetch; Offset++) {
+			/* A read-ahead sector may be cached, and dirty, already */
+			if ((Offset >= Run) && (Lookup(pdrv, sector + Offset) != NO_LINE)) {
+				continue;
+			}
+			Index = Allocate(pdrv, sector + Offset);
+			if (Index == NO_LINE) {
+				return RES_ERROR;
+			}
+			(void)memcpy(LineData[Index], ReadStage[Offset], SECTOR_SIZE);
+			Touch(Index);
+		}
+		buff += Run * SECTOR_SIZE;
+		sector += Run;
+		count -= Run;
+	}
+	return RES_OK;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function writes sectors into the cache
+*
+* @param	pdrv - Drive number
+* @param	*buff - Pointer to the data to be written
+* @param	sector - Sector address
+* @param	count - Sector count
+*
+* @return	RES_OK, or the error of a write back or of the transfer
+*
+****************************************************************************/
+DRESULT disk_cache_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	DRESULT Res;
+	s32 Index;
+
+	if (pdrv >= DISK_CACHE_DRIVES) {
+		return RES_PARERR;
+	}
+
+	if (count >= DISK_CACHE_STAGE) {
+		Stats.Bypassed++;
+		Stats.Commands++;
+		Res = disk_cache_dev_write(pdrv, buff, sector, count);
+		if (Res != RES_OK) {
+			return Res;
+		}
+		for (Index = 0; Index < (s32)DISK_CACHE_SECTORS; Index++) {
+			if ((Lines[Index].Valid != 0U) && (Lines[Index].Drive == pdrv) &&
+					(Lines[Index].Sector >= sector) &&
+					(Lines[Index].Sector < (sector + count))) {
+				(void)memcpy(LineData[Index],
+						buff + ((Lines[Index].Sector - sector) * SECTOR_SIZE),
+						SECTOR_SIZE);
+				Lines[Index].Dirty = 0U;
+			}
+		}
+		return RES_OK;
+	}
+
+	for (; count > 0U; count--) {
+		Index = Lookup(pdrv, sector);
+		if (Index == NO_LINE) {
+			Index = Allocate(pdrv, sector);
+			if (Index == NO_LINE) {
+				return RES_ERROR;
+			}
+		}
+		(void)memcpy(LineData[Index], buff, SECTOR_SIZE);
+		Lines[Index].Dirty = 1U;
+		Touch(Index);
+		Stats.Writes++;
+		buff += SECTOR_SIZE;
+		sector++;
+	}
+	return RES_OK;
+}
+
+/*****************************************************************************/
+/**
+*
+* This function writes the dirty sectors of a drive to the card, in sector
+* order and merged into runs of up to DISK_CACHE_STAGE sectors
+*
+* @param	pdrv - Drive number
+*
+* @return	RES_OK, or the error of the first failed write; the sectors
+*		not written stay dirty
+*
+****************************************************************************/
+DRESULT disk_cache_sync(BYTE pdrv)
+{
+	DRESULT Res;
+	s32 Index, Lowest;
+	UINT Count;
+
+	for (;;) {
+		Lowest = NO_LINE;
+		for (Index = 0; Index < (s32)DISK_CACHE_SECTORS; Index++) {
+			if ((Lines[Index].Valid != 0U) && (Lines[Index].Dirty != 0U) &&
+					(Lines[Index].Drive == pdrv) && ((Lowest == NO_LINE) ||
+					(Lines[Index].Sector < Lines[Lowest].Sector))) {
+				Lowest = Index;
+			}
+		}
+		if (Lowest == NO_LINE) {
+			return RES_OK;
+		}
+		for (Count = 1U; (Count < DISK_CACHE_STAGE) &&
+				(IsDirty(pdrv, Lines[Lowest].Sector + Count) != 0U); Count++) {
+			;
+		}
+		Res = WriteRun(pdrv, Lines[Lowest].Sector, Count);
+		if (Res != RES_OK) {
+			return Res;
+		}
+	}
+}
+
+/*****************************************************************************/
+/**
+*
+* This function drops every sector of a drive, dirty or not, for a card
+* that was (re)initialized
+*
+* @param	pdrv - Drive number
+*
+* @return	None
+*
+****************************************************************************/
+void disk_cache_invalidate(BYTE pdrv)
+{
+	u32 Index;
+
+	for (Index = 0U; Index < DISK_CACHE_SECTORS; Index++) {
+		if (Lines[Index].Drive == pdrv) {
+			Lines[Index].Valid = 0U;
+			Lines[Index].Dirty = 0U;
+		}
+	}
+	if (pdrv < DISK_CACHE_DRIVES) {
+		NextSector[pdrv] = 0U;
+	}
+}
+
+#else
+
+/*
+ * Cache compiled out, every request goes to the card
+ */
+DRESULT disk_cache_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	Stats.Commands++;
+	return disk_cache_dev_read(pdrv, buff, sector, count);
+}
+
+DRESULT disk_cache_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	Stats.Commands++;
+	return disk_cache_dev_write(pdrv, buff, sector, count);
+}
+
+DRESULT disk_cache_sync(BYTE pdrv)
+{
+	(void)pdrv;
+	return RES_OK;
+}
+
+void disk_cache_invalidate(BYTE pdrv)
+{
+	(void)pdrv;
+}
+
+#endif
+
+/*****************************************************************************/
+/**
+*
+* This function reads the counters
+*
+* @param	Out is filled with the counters since boot
+*
+* @return	None
+*
+****************************************************************************/
+void disk_cache_stats(DiskCacheStats *Out)
+{
+	*Out = Stats;
+}
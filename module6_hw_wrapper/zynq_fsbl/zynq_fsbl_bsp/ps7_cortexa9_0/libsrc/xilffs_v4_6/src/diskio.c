@@ -26,7 +26,9 @@
 *		high speed mode will be enabled.
 *		The default block size is 512 bytes.
 *		disk_read and disk_write functions are used to read and
-*		write files using ADMA2 in polled mode.
+*		write files using ADMA2 in polled mode, through the sector
+*		cache in diskcache.c; dirty sectors are written to the card
+*		at CTRL_SYNC (see diskcache.h).
 *		The file system can be used to read from and write to an
 *		SD card that is already formatted as FATFS.
 *
@@ -72,6 +74,7 @@
 *
 ******************************************************************************/
 #include "diskio.h"
+#include "diskcache.h"
 #include "ff.h"
 #include "xil_types.h"
 
@@ -292,9 +295,10 @@ DSTATUS disk_initialize (
 
 
 	/*
-	 * Disk is initialized.
+	 * Disk is initialized, the card may not be the one cached.
 	 * Store the same in Stat.
 	 */
+	disk_cache_invalidate(pdrv);
 	s &= (~STA_NOINIT);
 
 	Stat[pdrv] = s;
@@ -343,10 +347,6 @@ DRESULT disk_read (
 )
 {
 	DSTATUS s;
-#ifdef FILE_SYSTEM_INTERFACE_SD
-	s32 Status = XST_FAILURE;
-	DWORD LocSector = sector;
-#endif
 
 	s = disk_status(pdrv);
 
@@ -357,7 +357,38 @@ DRESULT disk_read (
 		return RES_PARERR;
 	}
 
+	return disk_cache_read(pdrv, buff, sector, count);
+}
+
+/*****************************************************************************/
+/**
+*
+* Reads sectors from the card for the sector cache
+* In case of SD, it reads the SD card using ADMA2 in polled mode.
+*
+* @param	pdrv - Drive number
+* @param	*buff - Pointer to the data buffer to store read data
+* @param	sector - Start sector number
+* @param	count - Sector count
+*
+* @return
+*		RES_OK		Read successful
+*		RES_ERROR	Read not successful
+*
+* @note
+*
+******************************************************************************/
+DRESULT disk_cache_dev_read (
+		BYTE pdrv,	/* Physical drive number (0) */
+		BYTE *buff,	/* Pointer to the data buffer to store read data */
+		DWORD sector,	/* Start sector number (LBA) */
+		UINT count	/* Sector count (1..128) */
+)
+{
 #ifdef FILE_SYSTEM_INTERFACE_SD
+	s32 Status = XST_FAILURE;
+	DWORD LocSector = sector;
+
 	/* Convert LBA to byte address if needed */
 	if ((SdInstance[pdrv].HCS) == 0U) {
 		LocSector *= (DWORD)XSDPS_BLK_SIZE_512_MASK;
@@ -374,8 +405,10 @@ DRESULT disk_read (
 #endif
 
 #if !defined(FILE_SYSTEM_INTERFACE_SD) && !defined(FILE_SYSTEM_INTERFACE_RAM)
+	(void)pdrv;
 	(void)buff;
 	(void)sector;
+	(void)count;
 #endif
 
     return RES_OK;
@@ -401,7 +434,7 @@ DRESULT disk_ioctl (
 
 	switch (cmd) {
 		case (BYTE)CTRL_SYNC :	/* Make sure that no pending write process */
-			res = RES_OK;
+			res = disk_cache_sync(pdrv);
 			break;
 
 		case (BYTE)GET_SECTOR_COUNT : /* Get number of sectors on the disk (DWORD) */
@@ -423,7 +456,7 @@ DRESULT disk_ioctl (
 #ifdef FILE_SYSTEM_INTERFACE_RAM
 	switch (cmd) {
 	case (BYTE)CTRL_SYNC:
-		res = RES_OK;
+		res = disk_cache_sync(pdrv);
 		break;
 	case (BYTE)GET_BLOCK_SIZE:
 		*(WORD *)buff = BLOCKSIZE;
@@ -502,10 +535,6 @@ DRESULT disk_write (
 )
 {
 	DSTATUS s;
-#ifdef FILE_SYSTEM_INTERFACE_SD
-	s32 Status = XST_FAILURE;
-	DWORD LocSector = sector;
-#endif
 
 	s = disk_status(pdrv);
 	if ((s & STA_NOINIT) != 0U) {
@@ -515,7 +544,38 @@ DRESULT disk_write (
 		return RES_PARERR;
 	}
 
+	return disk_cache_write(pdrv, buff, sector, count);
+}
+
+/*****************************************************************************/
+/**
+*
+* Writes sectors to the card for the sector cache
+* In case of SD, it writes the SD card using ADMA2 in polled mode.
+*
+* @param	pdrv - Drive number
+* @param	*buff - Pointer to the data to be written
+* @param	sector - Sector address
+* @param	count - Sector count
+*
+* @return
+*		RES_OK		Write successful
+*		RES_ERROR	Write not successful
+*
+* @note
+*
+******************************************************************************/
+DRESULT disk_cache_dev_write (
+	BYTE pdrv,			/* Physical drive nmuber (0..) */
+	const BYTE *buff,	/* Data to be written */
+	DWORD sector,		/* Sector address (LBA) */
+	UINT count			/* Number of sectors to write (1..128) */
+)
+{
 #ifdef FILE_SYSTEM_INTERFACE_SD
+	s32 Status = XST_FAILURE;
+	DWORD LocSector = sector;
+
 	/* Convert LBA to byte address if needed */
 	if ((SdInstance[pdrv].HCS) == 0U) {
 		LocSector *= (DWORD)XSDPS_BLK_SIZE_512_MASK;
@@ -533,8 +593,10 @@ DRESULT disk_write (
 #endif
 
 #if !defined(FILE_SYSTEM_INTERFACE_SD) && !defined(FILE_SYSTEM_INTERFACE_RAM)
+	(void)pdrv;
 	(void)buff;
 	(void)sector;
+	(void)count;
 #endif
 
 	return RES_OK;
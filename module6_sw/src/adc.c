@@ -1,17 +1,105 @@
 #include "adc.h"		/* types used by xilinx */
+#include "gic.h"
+
+#define ALARMS (ADC_ALARM_TEMP | ADC_ALARM_VCCINT)
 
 /*
  * initialize the adc module
  */
 XAdcPs XAdcInst; // XADC instance
 
+volatile u32 adc_alarm_active;
+static u32 reported;                    /* active alarms already logged */
+static u32 temp_alarms, vccint_alarms;
+
+/*
+ * alarm interrupt: mask what fired until the main loop sees it end; the
+ * command FIFO is left to the main loop
+ */
+static void adc_alarm_handler(void *ref) {
+	u32 status = XAdcPs_IntrGetStatus(&XAdcInst) & ALARMS;
+
+	XAdcPs_IntrDisable(&XAdcInst, status);
+	XAdcPs_IntrClear(&XAdcInst, status);
+	if (status & ADC_ALARM_TEMP)
+		temp_alarms++;
+	if (status & ADC_ALARM_VCCINT)
+		vccint_alarms++;
+	__atomic_fetch_or(&adc_alarm_active, status, __ATOMIC_RELEASE);
+}
+
 void adc_init(void){
 	 XAdcPs_Config *ConfigPtr;
+	 u32 on;
 	      ConfigPtr = XAdcPs_LookupConfig(XPAR_XADCPS_0_DEVICE_ID);
 	      XAdcPs_CfgInitialize(&XAdcInst, ConfigPtr, ConfigPtr->BaseAddress);
-	      XAdcPs_SetSequencerMode(&XAdcInst, XADCPS_SEQ_MODE_CONTINPASS);
+	      // the channel setup only takes in safe mode
+	      XAdcPs_SetSequencerMode(&XAdcInst, XADCPS_SEQ_MODE_SAFE);
 	      XAdcPs_SetSeqChEnables(&XAdcInst, XADCPS_SEQ_CH_AUX14 | XADCPS_SEQ_CH_TEMP | XADCPS_SEQ_CH_VCCINT);
-	      XAdcPs_SetAlarmEnables(&XAdcInst, 0);
+	      // average the monitored channels, not the potentiometer
+	      XAdcPs_SetAvg(&XAdcInst, XADCPS_AVG_256_SAMPLES);
+	      XAdcPs_SetSeqAvgEnables(&XAdcInst, XADCPS_SEQ_CH_TEMP | XADCPS_SEQ_CH_VCCINT);
+	      XAdcPs_SetAlarmThreshold(&XAdcInst, XADCPS_ATR_TEMP_UPPER, XAdcPs_TemperatureToRaw(ADC_TEMP_HOT));
+	      XAdcPs_SetAlarmThreshold(&XAdcInst, XADCPS_ATR_TEMP_LOWER, XAdcPs_TemperatureToRaw(ADC_TEMP_COOL));
+	      XAdcPs_SetAlarmThreshold(&XAdcInst, XADCPS_ATR_VCCINT_UPPER, XAdcPs_VoltageToRaw(ADC_VCCINT_HIGH));
+	      XAdcPs_SetAlarmThreshold(&XAdcInst, XADCPS_ATR_VCCINT_LOWER, XAdcPs_VoltageToRaw(ADC_VCCINT_LOW));
+	      XAdcPs_SetAlarmEnables(&XAdcInst, XADCPS_CFR1_ALM_TEMP_MASK | XADCPS_CFR1_ALM_VCCINT_MASK);
+	      XAdcPs_SetSequencerMode(&XAdcInst, XADCPS_SEQ_MODE_CONTINPASS);
+
+	      XAdcPs_IntrDisable(&XAdcInst, XADCPS_INTX_ALL_MASK);
+	      XAdcPs_IntrClear(&XAdcInst, XADCPS_INTX_ALL_MASK);
+	      if (gic_connect(XPAR_XADCPS_INT_ID, adc_alarm_handler, &XAdcInst) != XST_SUCCESS) {
+	    	  printf("\n[ERROR: unable to connect the xadc alarm interrupt]\n");
+	    	  return;
+	      }
+	      // an alarm already on raised its interrupt before this; take it
+	      // as raised now, the main loop sees it end
+	      on = XAdcPs_GetMiscStatus(&XAdcInst) & ALARMS;
+	      adc_alarm_active = on;
+	      XAdcPs_IntrEnable(&XAdcInst, ALARMS & ~on);
+}
+
+bool adc_health_service(void) {
+	bool was = (reported & ADC_ALARM_TEMP) != 0;
+	u32 active = __atomic_load_n(&adc_alarm_active, __ATOMIC_ACQUIRE);
+	u32 on = XAdcPs_GetMiscStatus(&XAdcInst) & ALARMS;
+	u32 fresh = active & ~reported, over = active & ~on & ~fresh;
+	adc_health_t h;
+
+	if (fresh != 0) {
+		// one line as an alarm starts and one as it ends, however long
+		adc_health(&h);
+		if (fresh & ADC_ALARM_TEMP)
+			printf("\n[ALARM] temperature %d C, max %d C: throttling\n", (int)h.temp, (int)h.temp_max);
+		if (fresh & ADC_ALARM_VCCINT)
+			printf("\n[ALARM] VCCINT %d mV, range %d..%d mV\n", (int)(h.vccint * 1000),
+			       (int)(h.vccint_min * 1000), (int)(h.vccint_max * 1000));
+		reported |= fresh;
+	}
+	if (over != 0) {
+		adc_health(&h);
+		if (over & ADC_ALARM_TEMP)
+			printf("\n[ALARM] temperature back to %d C\n", (int)h.temp);
+		if (over & ADC_ALARM_VCCINT)
+			printf("\n[ALARM] VCCINT back to %d mV\n", (int)(h.vccint * 1000));
+		reported &= ~over;
+		__atomic_fetch_and(&adc_alarm_active, ~over, __ATOMIC_RELEASE);
+		XAdcPs_IntrClear(&XAdcInst, over);
+		XAdcPs_IntrEnable(&XAdcInst, over);
+	}
+	return ((reported & ADC_ALARM_TEMP) != 0) != was;
+}
+
+void adc_health(adc_health_t *h) {
+	h->temp = adc_get_temp();
+	h->temp_min = XAdcPs_RawToTemperature(XAdcPs_GetMinMaxMeasurement(&XAdcInst, XADCPS_MIN_TEMP));
+	h->temp_max = XAdcPs_RawToTemperature(XAdcPs_GetMinMaxMeasurement(&XAdcInst, XADCPS_MAX_TEMP));
+	h->vccint = adc_get_vccint();
+	h->vccint_min = XAdcPs_RawToVoltage(XAdcPs_GetMinMaxMeasurement(&XAdcInst, XADCPS_MIN_VCCINT));
+	h->vccint_max = XAdcPs_RawToVoltage(XAdcPs_GetMinMaxMeasurement(&XAdcInst, XADCPS_MAX_VCCINT));
+	h->active = adc_alarm_active;
+	h->temp_alarms = temp_alarms;
+	h->vccint_alarms = vccint_alarms;
 }
 
 /*
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "xadcps.h"
 #include "xparameters.h"  	/* constants used by the hardware */
 #include "xil_types.h"		/* types used by xilinx */
@@ -28,3 +29,73 @@ float adc_get_vccint(void);
  */
 float adc_get_pot(void);
 
+/*
+ * Health monitor
+ *
+ * The XADC compares every temperature and VCCINT conversion against
+ * the limits below in hardware and raises an alarm, so nothing polls
+ * them: the alarm interrupt marks the alarm active and masks it, and
+ * the main loop is told through adc_alarm_active, a word it only tests.
+ * While an alarm is active adc_health_poll() checks the alarm outputs
+ * for its end, then unmasks it again. The temperature alarm clears at
+ * ADC_TEMP_COOL, not ADC_TEMP_HOT, so it does not chatter at the limit.
+ *
+ * While the temperature alarm is active adc_throttled() is true, and
+ * the application cuts its console output and stops non-critical work;
+ * the FSM itself carries on.
+ *
+ * Temperature and VCCINT are averaged over 256 conversions in the XADC,
+ * and it keeps their minimum and maximum since power on; adc_health()
+ * reads them when asked. All XADC reads go through the command FIFO of
+ * the PS interface, which the interrupt handler never touches, so they
+ * are made from the main loop only.
+ *
+ *   adc_init();
+ *   ...
+ *   if (adc_health_poll())
+ *       adc_throttled() ? stop_extras() : start_extras();
+ */
+#define ADC_TEMP_HOT     85.0f  /* degrees C, the temperature alarm sets */
+#define ADC_TEMP_COOL    75.0f  /* and clears */
+#define ADC_VCCINT_LOW   0.95f  /* volts, the VCCINT alarm is on outside */
+#define ADC_VCCINT_HIGH  1.05f
+
+#define ADC_ALARM_TEMP   XADCPS_INTX_ALM0_MASK
+#define ADC_ALARM_VCCINT XADCPS_INTX_ALM1_MASK
+
+typedef struct {
+	float temp, temp_min, temp_max;        /* degrees C */
+	float vccint, vccint_min, vccint_max;  /* volts */
+	u32 active;                            /* ADC_ALARM_* */
+	u32 temp_alarms, vccint_alarms;        /* since adc_init() */
+} adc_health_t;
+
+/* ADC_ALARM_* set by the alarm interrupt, cleared when the alarm ends */
+extern volatile u32 adc_alarm_active;
+
+/*
+ * log new alarms and check the active ones for their end
+ *
+ * returns true when adc_throttled() changed
+ */
+bool adc_health_service(void);
+
+/*
+ * call adc_health_service() when an alarm is active; otherwise a
+ * single load
+ */
+static inline bool adc_health_poll(void) {
+	return adc_alarm_active != 0 && adc_health_service();
+}
+
+/*
+ * true while the temperature alarm is active
+ */
+static inline bool adc_throttled(void) {
+	return (adc_alarm_active & ADC_ALARM_TEMP) != 0;
+}
+
+/*
+ * read the averaged values, the extremes and the alarm counts
+ */
+void adc_health(adc_health_t *h);
@@ -0,0 +1,60 @@
+/*
+ * boottime.c -- reads back the FSBL boot timeline
+ */
+#include <stdio.h>
+#include "boottime.h"
+#include "xtime_l.h"
+
+static volatile boottime_t *const timeline = (volatile boottime_t *)BOOTTIME_BASEADDR;
+
+/* indexed by the FSBL_TL_STAGE_* values */
+static const char *stage_names[] = {
+	"ENTRY", "PS7_INIT", "DDR_CHECK", "PCAP_INIT", "BOOTDEV_INIT",
+	"HEADERS", "PART_START", "PART_MOVED", "PART_CHECKED", "FABRIC_INIT",
+	"PCAP_DMA", "PCAP_FPGA", "PART_DONE", "IMAGE_LOADED", "HANDOFF",
+	"FALLBACK", "PART_INFLATED"
+};
+
+bool boottime_valid(void) {
+	return timeline->magic == BOOTTIME_MAGIC &&
+		timeline->version == BOOTTIME_VERSION &&
+		timeline->count <= BOOTTIME_ENTRIES;
+}
+
+void boottime_print(void) {
+	XTime now;
+	int i;
+
+	if (!boottime_valid()) {
+		printf("[BOOTTIME] no record\n\r");
+		return;
+	}
+
+	/* the application crt0 restarts the global timer, this is time since then */
+	XTime_GetTime(&now);
+
+	printf("[BOOTTIME] cps=%lu entries=%u mode=%lu flags=%lu app=%llu\n\r",
+	       (unsigned long)timeline->counts_per_second,
+	       (unsigned)timeline->count,
+	       (unsigned long)timeline->boot_mode,
+	       (unsigned long)timeline->flags,
+	       (unsigned long long)now);
+
+	for (i = 0; i < timeline->count; i++) {
+		volatile boottime_entry_t *e = &timeline->entry[i];
+		unsigned long long ticks = ((unsigned long long)e->time_hi << 32) | e->time_lo;
+		const char *name = (e->stage < sizeof(stage_names) / sizeof(stage_names[0])) ?
+			stage_names[e->stage] : "UNKNOWN";
+
+		printf("[BOOTTIME] %d %s 0x%08lx %llu%s\n\r",
+		       i, name, (unsigned long)e->arg, ticks,
+		       (e->flags & BOOTTIME_PRE_PLL) ? " pre-pll" : "");
+	}
+
+	if (timeline->flags & BOOTTIME_OVERFLOW)
+		printf("[BOOTTIME] overflow\n\r");
+}
+
+void boottime_clear(void) {
+	timeline->magic = 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * boottime.h -- reads back the FSBL boot timeline
+ *
+ * The FSBL time stamps every boot stage into a reserved OCM window
+ * (0xFFFFFC00, kept out of lscript.ld). The layout has to match
+ * module6_hw_wrapper/zynq_fsbl/fsbl_timeline.h.
+ *
+ * boottime_print() writes one line per marker, prefixed with [BOOTTIME],
+ * so a console capture can be fed straight into tools/boottime.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+
+#define BOOTTIME_BASEADDR 0xFFFFFC00
+#define BOOTTIME_MAGIC    0x314C5442 /* "BTL1" */
+#define BOOTTIME_VERSION  1
+#define BOOTTIME_ENTRIES  30
+
+#define BOOTTIME_PRE_PLL  0x1 /* entry flag: ticks taken before ps7_init */
+#define BOOTTIME_OVERFLOW 0x1 /* header flag: markers were dropped */
+#define BOOTTIME_HANDOFF  0x2 /* header flag: handoff marker written */
+
+typedef struct {
+	u16 stage;
+	u16 flags;
+	u32 arg;
+	u32 time_lo;
+	u32 time_hi;
+} boottime_entry_t;
+
+typedef struct {
+	u32 magic;
+	u16 version;
+	u16 count;
+	u32 counts_per_second;
+	u32 flags;
+	u32 boot_mode;
+	u32 pads[3];
+	boottime_entry_t entry[BOOTTIME_ENTRIES];
+} boottime_t;
+
+/*
+ * boottime_valid -- true if the FSBL left a timeline behind
+ */
+bool boottime_valid(void);
+
+/*
+ * boottime_print -- print the timeline in the format tools/boottime reads
+ */
+void boottime_print(void);
+
+/*
+ * boottime_clear -- invalidate the record so a later warm restart
+ * without the FSBL is not reported with stale numbers
+ */
+void boottime_clear(void);
@@ -0,0 +1,147 @@
+/*
+ * dma_mem.c -- buffers shared with DMA masters
+ */
+#include "dma_mem.h"
+#include "xil_cache.h"
+#include "xil_mmu.h"
+#if defined(__arm__)
+#include "xpseudo_asm.h"
+#endif
+
+#define CHUNKS    (DMA_MEM_SECTION / DMA_MEM_CHUNK)
+#define NO_CLASS  0xFF
+
+static u8 arena[DMA_MEM_KINDS][DMA_MEM_SECTION] __attribute__((aligned(DMA_MEM_SECTION)));
+
+static const u32 attributes[DMA_MEM_KINDS] = {
+	[DMA_MEM_UNCACHED] = NORM_NONCACHE,
+	[DMA_MEM_WRITE_THROUGH] = NORM_WT_CACHE,
+	[DMA_MEM_CACHED] = NORM_WB_CACHE,
+};
+
+typedef struct {
+	void *free[DMA_MEM_CLASSES];    /* free buffers, linked through their first word */
+	u8 chunk_class[CHUNKS];
+	u32 next_chunk;
+	dma_mem_stats_t stats;
+} dma_pool_t;
+
+static dma_pool_t pools[DMA_MEM_KINDS];
+
+/*
+ * the kind of the section addr lies in, DMA_MEM_KINDS outside them
+ */
+static inline u32 kind_of(const void *addr) {
+	UINTPTR off = (UINTPTR)addr - (UINTPTR)arena;
+
+	return off < sizeof(arena) ? (u32)(off / DMA_MEM_SECTION) : DMA_MEM_KINDS;
+}
+
+void dma_mem_init(void) {
+	u32 kind, c;
+
+	for (kind = 0; kind < DMA_MEM_KINDS; kind++) {
+		for (c = 0; c < CHUNKS; c++)
+			pools[kind].chunk_class[c] = NO_CLASS;
+		/* flushes the whole cache, so no dirty line of the section is
+		   left to be written back over it later */
+		Xil_SetTlbAttributes((INTPTR)arena[kind], attributes[kind]);
+	}
+}
+
+void *dma_mem_alloc(dma_mem_kind_t kind, u32 size) {
+	dma_pool_t *p;
+	u32 class = 0, bytes = DMA_MEM_MIN, off;
+	u8 *chunk;
+	void *buf;
+
+	if (kind >= DMA_MEM_KINDS)
+		return NULL;
+	p = &pools[kind];
+	if (size == 0 || size > DMA_MEM_CHUNK) {
+		p->stats.failed++;
+		return NULL;
+	}
+	while (bytes < size) {
+		bytes <<= 1;
+		class++;
+	}
+
+	if (p->free[class] == NULL) {
+		if (p->next_chunk == CHUNKS) {
+			p->stats.failed++;
+			return NULL;
+		}
+		/* thread a fresh chunk onto the free list, lowest address first */
+		chunk = arena[kind] + p->next_chunk * DMA_MEM_CHUNK;
+		p->chunk_class[p->next_chunk++] = (u8)class;
+		p->stats.chunks++;
+		for (off = DMA_MEM_CHUNK; off != 0; off -= bytes) {
+			*(void **)(chunk + off - bytes) = p->free[class];
+			p->free[class] = chunk + off - bytes;
+		}
+	}
+	buf = p->free[class];
+	p->free[class] = *(void **)buf;
+	p->stats.allocs++;
+	return buf;
+}
+
+void dma_mem_free(void *buf) {
+	u32 kind = kind_of(buf);
+	UINTPTR off;
+	u32 class;
+	dma_pool_t *p;
+
+	if (kind == DMA_MEM_KINDS)
+		return;
+	p = &pools[kind];
+	off = (UINTPTR)buf - (UINTPTR)arena[kind];
+	class = p->chunk_class[off / DMA_MEM_CHUNK];
+	if (class == NO_CLASS || (off & ((DMA_MEM_MIN << class) - 1)) != 0)
+		return;
+	*(void **)buf = p->free[class];
+	p->free[class] = buf;
+	p->stats.frees++;
+}
+
+void dma_mem_clean(const void *buf, u32 len) {
+	u32 kind = kind_of(buf);
+
+	if (kind == DMA_MEM_UNCACHED || kind == DMA_MEM_WRITE_THROUGH) {
+		pools[kind].stats.skipped++;
+		return;
+	}
+	pools[DMA_MEM_CACHED].stats.maint++;
+	Xil_DCacheFlushRange((INTPTR)buf, len);
+}
+
+void dma_mem_invalidate(void *buf, u32 len) {
+	u32 kind = kind_of(buf);
+
+	if (kind == DMA_MEM_UNCACHED) {
+		pools[kind].stats.skipped++;
+		return;
+	}
+	if (kind == DMA_MEM_KINDS)
+		kind = DMA_MEM_CACHED;
+	pools[kind].stats.maint++;
+	Xil_DCacheInvalidateRange((INTPTR)buf, len);
+}
+
+dma_mem_kind_t dma_mem_kind(const void *buf) {
+	return (dma_mem_kind_t)kind_of(buf);
+}
+
+void dma_mem_sync(void) {
+#if defined(__arm__)
+	dsb();
+#else
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+void dma_mem_stats(dma_mem_kind_t kind, dma_mem_stats_t *stats) {
+	if (kind < DMA_MEM_KINDS)
+		*stats = pools[kind].stats;
+}
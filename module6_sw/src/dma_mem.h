@@ -0,0 +1,117 @@
+/*
+ * dma_mem.h -- buffers shared with DMA masters
+ *
+ * A buffer the GEM, the PL330 or the PCAP reads or writes has to be
+ * cleaned from the data cache before the device reads it and
+ * invalidated around the device writing it. On ordinary write-back
+ * memory that is a walk over every line of the buffer, in L1 and in
+ * the L2 controller, on every transfer.
+ *
+ * Here the memory for DMA comes from 1 MB sections whose MMU attributes
+ * make some of that work unnecessary, one section per kind:
+ *
+ *   DMA_MEM_UNCACHED       normal non-cacheable; no maintenance at all.
+ *                          For descriptors and other small structures
+ *                          both sides poke at.
+ *   DMA_MEM_WRITE_THROUGH  writes go straight to memory, so nothing is
+ *                          ever dirty: no clean before the device reads,
+ *                          and an invalidate after it writes drops clean
+ *                          lines only. For buffers the CPU mostly writes.
+ *   DMA_MEM_CACHED         write-back, the default mapping of DDR; full
+ *                          maintenance. For buffers the CPU reads a lot.
+ *
+ * Each section is cut into 64 KB chunks and a chunk into buffers of one
+ * size class, a power of two from 32 bytes (one cache line) to 64 KB.
+ * Buffers are aligned to their size class, so no two buffers share a
+ * cache line. Allocation and freeing are O(1) and never give memory
+ * back to the section; they are made from the main loop only.
+ *
+ * dma_mem_clean() and dma_mem_invalidate() do what the buffer's kind
+ * needs and nothing else. Given memory outside the sections they fall
+ * back to the full Xil_DCache*Range() maintenance, so drivers can use
+ * them on any buffer a caller hands in.
+ *
+ *   dma_mem_init();
+ *   bds = dma_mem_alloc(DMA_MEM_UNCACHED, ring_bytes);
+ *   frame = dma_mem_alloc(DMA_MEM_WRITE_THROUGH, 1536);
+ *   ...
+ *   dma_mem_clean(frame, len);      (free on write-through memory)
+ *   dma_mem_sync();                 (descriptor writes before the doorbell)
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define DMA_MEM_SECTION   0x100000  /* MMU section, the unit of attributes */
+#define DMA_MEM_CHUNK     0x10000   /* carved into buffers of one size class */
+#define DMA_MEM_MIN       32        /* smallest buffer, one cache line */
+#define DMA_MEM_CLASSES   12        /* 32 bytes to 64 KB */
+
+typedef enum {
+	DMA_MEM_UNCACHED,
+	DMA_MEM_WRITE_THROUGH,
+	DMA_MEM_CACHED,
+	DMA_MEM_KINDS
+} dma_mem_kind_t;
+
+typedef struct {
+	u32 allocs;
+	u32 frees;
+	u32 failed;         /* allocations refused: too big or out of chunks */
+	u32 chunks;         /* chunks given to a size class so far */
+	u32 maint;          /* clean and invalidate calls that touched the cache */
+	u32 skipped;        /* calls the attributes made unnecessary */
+} dma_mem_stats_t;
+
+/*
+ * dma_mem_init -- set the attributes of the sections; call it once
+ * before the first allocation, with the MMU and caches on
+ */
+void dma_mem_init(void);
+
+/*
+ * dma_mem_alloc -- take a buffer of at least size bytes from the pool
+ * of the given kind; the buffer is aligned to its size class
+ *
+ * returns NULL for a size of 0 or above DMA_MEM_CHUNK, or when the
+ * section has no chunk left for the class
+ */
+void *dma_mem_alloc(dma_mem_kind_t kind, u32 size);
+
+/*
+ * dma_mem_free -- return a buffer from dma_mem_alloc(); anything else
+ * is ignored
+ */
+void dma_mem_free(void *buf);
+
+/*
+ * dma_mem_clean -- make len bytes at buf visible to a device that is
+ * about to read them
+ */
+void dma_mem_clean(const void *buf, u32 len);
+
+/*
+ * dma_mem_invalidate -- drop cached copies of len bytes at buf, before
+ * a device writes them and again before the CPU reads the result
+ */
+void dma_mem_invalidate(void *buf, u32 len);
+
+/*
+ * dma_mem_kind -- the kind of the section buf lies in
+ *
+ * returns DMA_MEM_KINDS for memory outside the sections
+ */
+dma_mem_kind_t dma_mem_kind(const void *buf);
+
+/*
+ * dma_mem_sync -- wait for earlier writes to reach memory; uncached
+ * writes can still sit in the store buffer when a device register is
+ * written next
+ */
+void dma_mem_sync(void);
+
+/*
+ * dma_mem_stats -- read the counters of one kind; cleans of memory
+ * outside the sections count as DMA_MEM_CACHED
+ */
+void dma_mem_stats(dma_mem_kind_t kind, dma_mem_stats_t *stats);
@@ -0,0 +1,274 @@
+/*
+ * fmt.c -- formatted output from precompiled format descriptors
+ */
+#include <stdbool.h>
+#include <string.h>
+#include "fmt.h"
+#include "xparameters.h"
+#include "xil_io.h"
+#include "xuartps_hw.h"
+
+#define FMT_CONSOLE_SIZE 256
+#define FMT_NUM_MAX      12   /* u32 in decimal, with sign */
+#define UART_FIFO_DEPTH  64
+
+/* "00" .. "99", two digits per division by 100 */
+static const char dec_pairs[200] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static const char hex_lower[16] = "0123456789abcdef";
+static const char hex_upper[16] = "0123456789ABCDEF";
+
+FMT_SINK_DEFINE(fmt_console, FMT_CONSOLE_SIZE, fmt_uart_write);
+
+void fmt_flush(fmt_sink_t *sink) {
+	if (sink->len != 0) {
+		sink->write(sink->buf, sink->len);
+		sink->len = 0;
+	}
+}
+
+static void sink_write(fmt_sink_t *sink, const char *p, u32 n) {
+	while (n != 0) {
+		u32 room = sink->size - sink->len;
+		u32 chunk = n < room ? n : room;
+
+		if (room == 0) {
+			fmt_flush(sink);
+			continue;
+		}
+		memcpy(sink->buf + sink->len, p, chunk);
+		sink->len += chunk;
+		p += chunk;
+		n -= chunk;
+	}
+}
+
+static void sink_fill(fmt_sink_t *sink, char c, u32 n) {
+	while (n != 0) {
+		u32 room = sink->size - sink->len;
+		u32 chunk = n < room ? n : room;
+
+		if (room == 0) {
+			fmt_flush(sink);
+			continue;
+		}
+		memset(sink->buf + sink->len, c, chunk);
+		sink->len += chunk;
+		n -= chunk;
+	}
+}
+
+/*
+ * the digits end at end, the return is their count
+ */
+static u32 put_dec(char *end, u32 v) {
+	char *p = end;
+
+	while (v >= 100) {
+		u32 q = v / 100;
+		u32 r = (v - q * 100) * 2;
+
+		*--p = dec_pairs[r + 1];
+		*--p = dec_pairs[r];
+		v = q;
+	}
+	if (v >= 10) {
+		*--p = dec_pairs[v * 2 + 1];
+		*--p = dec_pairs[v * 2];
+	} else {
+		*--p = (char)('0' + v);
+	}
+	return (u32)(end - p);
+}
+
+static u32 put_hex(char *end, u32 v, const char *digits) {
+	char *p = end;
+
+	do {
+		*--p = digits[v & 0xF];
+		v >>= 4;
+	} while (v != 0);
+	return (u32)(end - p);
+}
+
+/*
+ * copy n bytes; the fields and literals of a line are mostly a few bytes
+ * long, shorter than the call into memcpy is worth
+ */
+static inline char *copy(char *p, const char *s, u32 n) {
+	if (n > 16) {
+		memcpy(p, s, n);
+		return p + n;
+	}
+	while (n-- != 0)
+		*p++ = *s++;
+	return p;
+}
+
+static inline char *fill(char *p, char c, u32 n) {
+	while (n-- != 0)
+		*p++ = c;
+	return p;
+}
+
+/*
+ * the bytes a field of n characters takes, padded to the descriptor width
+ */
+static inline u32 field_len(const fmt_desc_t *d, u32 n) {
+	u32 width = d->width < 0 ? (u32)-d->width : (u32)d->width;
+
+	return width > n ? width : n;
+}
+
+/*
+ * write a field of n characters at p, padded to the descriptor width;
+ * neg puts a '-' in front, ahead of any zero padding
+ */
+static inline char *put_field(char *p, const fmt_desc_t *d,
+		const char *s, u32 n, bool neg) {
+	u32 total = n + (neg ? 1 : 0);
+	u32 pad = field_len(d, total) - total;
+	bool left = d->width < 0;
+	bool zero = (d->flags & FMT_FLAG_ZERO) && !left;
+
+	if (pad != 0 && !left && !zero)
+		p = fill(p, ' ', pad);
+	if (neg)
+		*p++ = '-';
+	if (pad != 0 && zero)
+		p = fill(p, '0', pad);
+	p = copy(p, s, n);
+	if (pad != 0 && left)
+		p = fill(p, ' ', pad);
+	return p;
+}
+
+/*
+ * a field longer than the whole sink buffer, written through in pieces
+ */
+static void put_long_field(fmt_sink_t *sink, const fmt_desc_t *d,
+		const char *s, u32 n) {
+	u32 pad = field_len(d, n) - n;
+
+	if (pad != 0 && d->width > 0)
+		sink_fill(sink, ' ', pad);
+	sink_write(sink, s, n);
+	if (pad != 0 && d->width < 0)
+		sink_fill(sink, ' ', pad);
+}
+
+/*
+ * The line is rendered straight into the sink buffer: each descriptor
+ * works out the bytes it takes, the buffer is flushed first when they
+ * do not fit, and the field is written without further checks.
+ */
+void fmt_vout(fmt_sink_t *sink, const fmt_desc_t *fmt, va_list ap) {
+	char num[FMT_NUM_MAX];
+	char *end = num + sizeof(num);
+	char *p = sink->buf + sink->len;
+	char *limit = sink->buf + sink->size;
+	const fmt_desc_t *d;
+	const char *s;
+	bool neg;
+	s32 sv;
+	u32 n, need;
+
+	for (d = fmt; d->kind != FMT_KIND_END; d++) {
+		neg = false;
+		switch (d->kind) {
+		case FMT_KIND_LIT:
+			s = d->lit;
+			n = d->len;
+			need = n;
+			break;
+		case FMT_KIND_STR:
+			s = va_arg(ap, const char *);
+			if (s == NULL)
+				s = "";
+			n = strlen(s);
+			need = field_len(d, n);
+			break;
+		case FMT_KIND_CHR:
+			num[0] = (char)va_arg(ap, int);
+			s = num;
+			n = 1;
+			need = field_len(d, n);
+			break;
+		case FMT_KIND_DEC:
+			sv = va_arg(ap, s32);
+			neg = sv < 0;
+			n = put_dec(end, neg ? (u32)0 - (u32)sv : (u32)sv);
+			s = end - n;
+			need = field_len(d, n + (neg ? 1 : 0));
+			break;
+		case FMT_KIND_UDEC:
+			n = put_dec(end, va_arg(ap, u32));
+			s = end - n;
+			need = field_len(d, n);
+			break;
+		case FMT_KIND_HEX:
+			n = put_hex(end, va_arg(ap, u32),
+					(d->flags & FMT_FLAG_UPPER) ? hex_upper : hex_lower);
+			s = end - n;
+			need = field_len(d, n);
+			break;
+		default:
+			continue;
+		}
+		if (need > (u32)(limit - p)) {
+			sink->len = (u32)(p - sink->buf);
+			fmt_flush(sink);
+			p = sink->buf;
+			if (need > sink->size) {
+				/* only a string or a literal gets this long */
+				if (d->kind == FMT_KIND_LIT)
+					sink_write(sink, s, n);
+				else
+					put_long_field(sink, d, s, n);
+				p = sink->buf + sink->len;
+				continue;
+			}
+		}
+		if (d->kind == FMT_KIND_LIT)
+			p = copy(p, s, n);
+		else
+			p = put_field(p, d, s, n, neg);
+	}
+	sink->len = (u32)(p - sink->buf);
+}
+
+void fmt_out(fmt_sink_t *sink, const fmt_desc_t *fmt, ...) {
+	va_list ap;
+
+	va_start(ap, fmt);
+	fmt_vout(sink, fmt, ap);
+	va_end(ap);
+}
+
+void fmt_puts(fmt_sink_t *sink, const char *s) {
+	sink_write(sink, s, strlen(s));
+}
+
+/*
+ * wait for an empty TX FIFO and fill it, one status read per 64 bytes
+ * instead of one per byte as outbyte() does
+ */
+void fmt_uart_write(const char *data, u32 len) {
+	u32 i, chunk;
+
+	while (len != 0) {
+		while ((XUartPs_ReadReg(STDOUT_BASEADDRESS, XUARTPS_SR_OFFSET) &
+				XUARTPS_SR_TXEMPTY) == 0)
+			;
+		chunk = len < UART_FIFO_DEPTH ? len : UART_FIFO_DEPTH;
+		for (i = 0; i < chunk; i++)
+			XUartPs_WriteReg(STDOUT_BASEADDRESS, XUARTPS_FIFO_OFFSET, (u8)data[i]);
+		data += chunk;
+		len -= chunk;
+	}
+}
@@ -0,0 +1,110 @@
+/*
+ * fmt.h -- formatted output from precompiled format descriptors
+ *
+ * xil_printf and newlib printf parse the format string on every call and
+ * push every character through outbyte(), which reads the UART status
+ * before each byte. Here a format is a const array of descriptors built
+ * with the FMT_* macros, so literal lengths and field widths are worked out
+ * by the compiler, numbers are converted two digits at a time from a table,
+ * and the output goes into a sink buffer that is written to the UART FIFO
+ * in bursts, with one status read per burst.
+ *
+ * What this buys is the formatting, not the console: tools/fmtbench puts a
+ * line into a memory sink in about half the time xil_printf takes, but
+ * through fmt_console the two come out even on the host (the status line
+ * is somewhat slower, the number line about the same). The console path
+ * only saves the per-byte status reads, which matter on the board where
+ * each one is an uncached device read; do not expect more than that from
+ * it. Use a memory sink where a line is built for something other than the
+ * UART.
+ *
+ *   static const fmt_desc_t line[] = {
+ *       FMT_LIT("tick "), FMT_U(6), FMT_LIT(" state "), FMT_S(-12),
+ *       FMT_LIT("\r\n"), FMT_END
+ *   };
+ *   fmt_out(&fmt_console, line, ticks, name);
+ *   fmt_flush(&fmt_console);
+ *
+ * Arguments are taken in descriptor order: FMT_S a const char *, FMT_C an
+ * int, FMT_D an s32 and FMT_U/FMT_X a u32. A negative width left-justifies
+ * the field as "%-Ns" does.
+ */
+#pragma once
+
+#include <stdarg.h>
+#include "xil_types.h"
+
+typedef enum {
+	FMT_KIND_END,
+	FMT_KIND_LIT,
+	FMT_KIND_STR,
+	FMT_KIND_CHR,
+	FMT_KIND_DEC,
+	FMT_KIND_UDEC,
+	FMT_KIND_HEX
+} fmt_kind_t;
+
+#define FMT_FLAG_ZERO  0x1 /* pad numbers with '0' */
+#define FMT_FLAG_UPPER 0x2 /* upper case hex digits */
+
+typedef struct {
+	u8 kind;
+	u8 flags;
+	s16 width;       /* field width, negative is left-justified */
+	u32 len;         /* FMT_LIT: length of lit */
+	const char *lit; /* FMT_LIT: the text */
+} fmt_desc_t;
+
+#define FMT_FIELD(kind, width, flags) { (kind), (flags), (width), 0, NULL }
+
+#define FMT_END       FMT_FIELD(FMT_KIND_END, 0, 0)
+#define FMT_LIT(s)    { FMT_KIND_LIT, 0, 0, sizeof(s) - 1, (s) }
+#define FMT_S(w)      FMT_FIELD(FMT_KIND_STR, (w), 0)
+#define FMT_C         FMT_FIELD(FMT_KIND_CHR, 0, 0)
+#define FMT_D(w)      FMT_FIELD(FMT_KIND_DEC, (w), 0)
+#define FMT_U(w)      FMT_FIELD(FMT_KIND_UDEC, (w), 0)
+#define FMT_U0(w)     FMT_FIELD(FMT_KIND_UDEC, (w), FMT_FLAG_ZERO)
+#define FMT_X(w)      FMT_FIELD(FMT_KIND_HEX, (w), 0)
+#define FMT_X0(w)     FMT_FIELD(FMT_KIND_HEX, (w), FMT_FLAG_ZERO)
+#define FMT_XU0(w)    FMT_FIELD(FMT_KIND_HEX, (w), FMT_FLAG_ZERO | FMT_FLAG_UPPER)
+
+/*
+ * a sink collects output until it is full or flushed, then hands the
+ * whole buffer to its write function
+ */
+typedef struct {
+	char *buf;
+	u32 size;
+	u32 len;
+	void (*write)(const char *data, u32 len);
+} fmt_sink_t;
+
+#define FMT_SINK_DEFINE(name, bytes, write_fn) \
+	static char name##_buf[bytes]; \
+	fmt_sink_t name = { name##_buf, (bytes), 0, (write_fn) }
+
+/*
+ * the console sink, written to the stdout UART
+ */
+extern fmt_sink_t fmt_console;
+
+/*
+ * fmt_out -- render a descriptor list into a sink
+ */
+void fmt_out(fmt_sink_t *sink, const fmt_desc_t *fmt, ...);
+void fmt_vout(fmt_sink_t *sink, const fmt_desc_t *fmt, va_list ap);
+
+/*
+ * fmt_puts -- append a plain string
+ */
+void fmt_puts(fmt_sink_t *sink, const char *s);
+
+/*
+ * fmt_flush -- hand the buffered output to the sink's write function
+ */
+void fmt_flush(fmt_sink_t *sink);
+
+/*
+ * fmt_uart_write -- write a buffer to the stdout UART, a TX FIFO at a time
+ */
+void fmt_uart_write(const char *data, u32 len);
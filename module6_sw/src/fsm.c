@@ -10,8 +10,21 @@
 #include "adc.h"
 #include "led.h"
 #include "io.h"
+#include "input.h"
 #include "gic.h"
 #include "ttc.h"
+#include "boottime.h"
+#include "fmt.h"
+#include "uart_tx.h"
+#include "uart_dma.h"
+#include "dma_mem.h"
+#include "pool.h"
+#include "prof.h"
+#include "udp.h"
+#include "idle.h"
+#include "tslog.h"
+#include "metrics.h"
+#include "xtime_l.h"
 //#include "substation.c"
 
 // Hardware Constants
@@ -32,6 +45,9 @@
 #define PED_RED_TICKS   100
 #define RED_LIGHT_TICKS 30
 
+#define TTC_HZ          100 // input polling rate
+#define FSM_TICK_DIV    10  // TTC ticks per FSM tick (10 Hz)
+
 #define POLLING_INTERVAL 100000 // 100 milliseconds (10 times per second)
 #define MAX_CROSSINGS 10
 
@@ -104,6 +120,14 @@ static bool done = false;
 
 #define UART1_INT_ID  	XPAR_XUARTPS_1_INTR
 #define UART0_INT_ID  	XPAR_XUARTPS_0_INTR
+#define BOARD_IP        UDP_IP(192, 168, 1, 10)
+#define SUBSTATION_IP   UDP_IP(192, 168, 1, 100)
+#define SUBSTATION_PORT 12345
+#define UDP_RESPONSE_MS 20  // wait for the substation over Ethernet
+#define UART_RESPONSE_MS 500 // and over the WiFly UART, 9600 baud
+#define METRICS_EVERY   0   // UPDATE requests per metrics snapshot, 0 for none;
+                            // the substation refuses the longer request, so
+                            // only set it when tools/metagg answers instead
 #define BUTTON3_MASK 	0x08  // Assuming Button 3 corresponds to bit 3
 
 //#define CONFIGURE 0
@@ -113,6 +137,18 @@ static bool done = false;
 
 static XUartPs UartInst1;  // UART1 (Receiving)
 static XUartPs UartInst0;  // UART0 (WiFly module - Forwarding)
+UART_TX_DEFINE(wifly_tx, 1024); // UART0 transmit queue
+static uart_dma_t wifly_dma;       // UART0 responses through the PL330
+static update_response_t *wifly_resp;
+static volatile bool wifly_rx_done;
+static volatile s32 wifly_rx_status;
+static bool net_up;                // substation over UDP instead of UART0
+static bool net_response;
+static FATFS sd_fs;
+static tslog_t history;            // UPDATE responses kept on SD
+static bool history_up;
+static bool profiling;             // BTN1 turned the profiler on
+static const udp_addr_t substation = { SUBSTATION_IP, SUBSTATION_PORT };
 static bool done;
 int Status;
 
@@ -189,44 +225,66 @@ void Uart1Handler(void *CallBackRef, u32 Event, u32 EventData) {
  }
 
 
-// TTC Callback (10Hz = 100ms ticks)
+// TTC Callback (100Hz input polling, 10Hz = 100ms FSM ticks)
 void fsm_ttc_callback(void) {
-    fsm_tick_count++;
-}
+    static unsigned int div = 0;
 
-// Button Callback
-void btn_callback(unsigned int btn) {
-    if (btn & (1 << 0)) {
-               pedestrian_request = true;
-               printf("\n\r[INPUT] Pedestrian request\n\r");
-   }
-           if (btn & (1 << 2)) {
-               pedestrian_request = true;
-               printf("\n\r[INPUT] Pedestrian request\n\r");
-           }
-           if (btn & (1 << 3)) {
-               done = true;
-           }
+    input_poll();
+    if (++div == FSM_TICK_DIV) {
+        div = 0;
+        fsm_tick_count++;
+    }
 }
 
-// Switch Callback
-void sw_callback(unsigned int sw) {
-    // SW0 (bit 0) controls train arrival/clear
-    bool new_train = (sw & 0x1);
-    // SW1 (bit 1) controls maintenance mode
-    bool new_maintenance = (sw & 0x2);
+// Debounced input events, handled in the main loop
+void handle_input(const input_event_t *ev) {
+    if (ev->port == INPUT_BTN && ev->kind == INPUT_PRESS) {
+        // BTN0 and BTN2 request a pedestrian crossing, BTN3 exits
+        if (ev->pin == 0 || ev->pin == 2) {
+            pedestrian_request = true;
+            met_inc(MET_PED_REQUESTS);
+            printf("\n\r[INPUT] Pedestrian request\n\r");
+        }
+        if (ev->pin == 3) {
+            done = true;
+        }
+    }
+    if (ev->port == INPUT_BTN && ev->kind == INPUT_LONG_PRESS && ev->pin == 1) {
+        // holding BTN1 starts the profiler, holding it again stops it and
+        // dumps the profile to the console for tools/profsym, and how much
+        // of the time the core slept. Left off, its timer would wake the
+        // core out of WFI PROF_HZ times a second
+        idle_stats_t idle;
+
+        if (!profiling) {
+            profiling = true;
+            if (!adc_throttled())
+                prof_start(PROF_HZ);
+            printf("[PROF] sampling at %u Hz\n", (unsigned)PROF_HZ);
+            return;
+        }
+        profiling = false;
+        prof_stop();
+        prof_dump(&fmt_console);
+        idle_stats(&idle);
+        printf("[IDLE] asleep %u.%u%%, %u sleeps, %u timer wakeups, %u coalesced\n",
+               (unsigned)(idle.residency / 10), (unsigned)(idle.residency % 10),
+               (unsigned)idle.sleeps, (unsigned)idle.timer_wakeups, (unsigned)idle.coalesced);
+    }
+    if (ev->port == INPUT_SW && ev->kind != INPUT_LONG_PRESS) {
+        bool on = (ev->kind == INPUT_PRESS);
 
-    if(new_train != train_arriving || new_maintenance != maintenance_active) {
+        // SW0 controls train arrival/clear, SW1 maintenance mode
+        if (ev->pin == 0) {
+            train_arriving = on;
+        }
+        if (ev->pin == 1) {
+            maintenance_active = on;
+        }
         printf("\n\r[INPUT] Train: %s | Maintenance: %s\n\r",
                train_arriving ? "ARRIVING" : "CLEAR",
                maintenance_active ? "ON" : "OFF");
     }
-    if (sw & (1 << 0)) {
-           train_arriving = !train_arriving;
-        }
-    if (sw & (1 << 1)) {
-           maintenance_active = !maintenance_active;
-        }
 }
 
 // LED Control
@@ -235,27 +293,43 @@ void setTrafficLED(u32 color) {
 }
 
 // Hardware Initialization
-void hardware_init() {
+s32 hardware_init() {
     gic_init();
+    dma_mem_init();
+    if (pool_init() != XST_SUCCESS) {
+        printf("Pool Init Failed: .pool is smaller than the classes in pool.c\n\r");
+        return XST_FAILURE;
+    }
+    idle_init();
     led_init();
     servo_init();
     adc_init();
-    io_btn_init(btn_callback);
-    io_sw_init(sw_callback);
-    ttc_init(10, fsm_ttc_callback);
+    input_init();
+    train_arriving = (input_level(INPUT_SW) & 0x1) != 0;
+    maintenance_active = (input_level(INPUT_SW) & 0x2) != 0;
+    ttc_init(TTC_HZ, fsm_ttc_callback);
+    return XST_SUCCESS;
 }
 
 // Status Display
+static const fmt_desc_t status_fmt[] = {
+    FMT_LIT("\r"), FMT_S(-15),
+    FMT_LIT(" | Gate: "), FMT_S(-6),
+    FMT_LIT(" | Train: "), FMT_S(-8),
+    FMT_LIT(" | Ped: "), FMT_S(0),
+    FMT_LIT(" \n"), FMT_END
+};
+
 void update_display() {
-    printf("\r%-15s | Gate: %-6s | Train: %-8s | Ped: %s \n",
+    fflush(stdout); /* keep order with earlier printf output */
+    fmt_out(&fmt_console, status_fmt,
            state_names[current_state],
            (current_servo_duty > 7.5) ? "OPEN" : "CLOSED",
            train_arriving ? "ARRIVING" : "CLEAR",
            ((current_state == RED_LIGHT && pedestrian_request) ||
             (current_state >= TRAIN_CLOSING && current_state <= TRAIN_WAIT_PED) ||
-            (current_state == MAINTENANCE)) ? "WALK" : "STOP",
-           fsm_tick_count);
-    fflush(stdout);
+            (current_state == MAINTENANCE)) ? "WALK" : "STOP");
+    fmt_flush(&fmt_console);
 }
 
 // Main FSM
@@ -263,10 +337,18 @@ void run_fsm() {
 	static unsigned int flash_timer = 0;
     static bool blue_led_state = false;
     static SystemState prev_state = MAINTENANCE;
+    static XTime entered;
     float pot_val = adc_get_pot();
 
 
     if(prev_state != current_state) {
+        XTime now;
+
+        // dwell time of the state left, as seen once per pass
+        XTime_GetTime(&now);
+        if(entered != 0)
+            met_observe(MET_DWELL + prev_state, (u32)((now - entered) / (COUNTS_PER_SECOND / 1000)));
+        entered = now;
         printf("\n\r\n\r");
         prev_state = current_state;
     }
@@ -391,7 +473,10 @@ void run_fsm() {
         blue_led_state = !blue_led_state;
         flash_timer = 0;
      }
-    update_display();
+    met_set(MET_STATE, current_state);
+    // over temperature the status line goes out once a second
+    if (!adc_throttled() || flash_timer % 10 == 0)
+        update_display();
     flash_timer++;
 }
 
@@ -434,12 +519,68 @@ void run_fsm() {
 //}
 
 
+// Substation Response
+void handle_response(const update_response_t *resp) {
+		if (resp->type == UPDATE) {
+			if (!adc_throttled()) {
+				printf("response: %d,\n", resp->type);
+				printf("[UPDATE] Received valid response from server:\n");
+				printf("Last update values:\n");
+				for (int j = 0; j < 30; j++) {
+					printf("Device %d: %d\n", j, resp->values[j]);
+
+				}
+			}
+		} else {
+			printf("response: %d,\n", resp->type);
+			printf("[UPDATE] Invalid response received\n");
+			met_inc(MET_INVALID_RESPONSES);
+		}
+		if (history_up && resp->type == UPDATE) {
+			s32 columns[TS_COLUMNS];
+			XTime now;
+
+			XTime_GetTime(&now);
+			columns[0] = resp->average;
+			for (int j = 0; j < 30; j++)
+				columns[1 + j] = resp->values[j];
+			tslog_append(&history, resp->id, now / (COUNTS_PER_SECOND / 1000), columns);
+		}
+		if(resp->values[27]==1){
+			//send to maintenance mode
+			maintenance_active = true;
+
+		}
+		else if(resp->values[27]==-1){
+			//leave maintenance mode
+			maintenance_active = false;
+		}
+}
+
+// UART0 response received through the PL330, from the DMA interrupt
+void wifly_recv_done(void *ref, u32 bytes, s32 status) {
+    wifly_rx_status = status;
+    wifly_rx_done = true;
+}
+
+// UDP receive handler, the response is read in place in the receive buffer
+void substation_recv(void *ref, const udp_addr_t *from, void *data, u32 len) {
+    if (from->ip == SUBSTATION_IP && len == sizeof(update_response_t)) {
+        handle_response((const update_response_t *)data);
+        net_response = true;
+    }
+}
+
+
 int main() {
-    hardware_init();
+    if (hardware_init() != XST_SUCCESS)
+        return XST_FAILURE;
     ttc_start();
     setvbuf(stdin, NULL, _IONBF, 0);
     setvbuf(stdout, NULL, _IONBF, 0);
     printf("\n\r[initialized]\n\r");
+    boottime_print();
+    boottime_clear();
     printf("Switch 0: Train Control | Switch 1: Maintenance Mode\n\r");
     printf("Normal sequence: GREEN (10s) → YELLOW (3s) → RED (3s/10s)\n\r");
     // Lookup UART1 (Receiving)
@@ -506,64 +647,143 @@ int main() {
     	XUartPs_SetHandler(&UartInst0, Uart0Handler, (void *)&UartInst0);
     	printf("UART0 Handler Set\n");
 
-    	// Connect UART0 interrupt to GIC
-    	gic_connect(UART0_INT_ID, (Xil_InterruptHandler)XUartPs_InterruptHandler, &UartInst0);
+    	// Connect UART0 interrupt to GIC through the transmit queue
+    	Status = uart_tx_init(&wifly_tx, &UartInst0, UART0_INT_ID);
+    	if (Status != XST_SUCCESS) {
+        	printf("UART0 TX Queue Failed! Status: %d\n", Status);
+        	return XST_FAILURE;
+    	}
     	printf("UART0 Interrupt Connected\n");
 
+    	// DMA channels 0 and 1 for UART0, the response lands in write-through
+    	// memory so it needs no cache line of its own
+    	wifly_resp = dma_mem_alloc(DMA_MEM_WRITE_THROUGH, sizeof(update_response_t));
+    	if (wifly_resp == NULL || uart_dma_init(&wifly_dma, &wifly_tx, 0, 1) != XST_SUCCESS) {
+        	printf("UART0 DMA Failed!\n");
+        	return XST_FAILURE;
+    	}
+
+    	// Prefer Ethernet for the substation, the WiFly UART stays as fallback
+    	static const udp_config_t net = { UDP_MAC_DEFAULT, BOARD_IP, SUBSTATION_PORT };
+    	net_up = udp_init(&net, substation_recv, NULL) == XST_SUCCESS;
+    	printf("Substation over %s\n", net_up ? "UDP" : "UART0");
+    	history_up = f_mount(&sd_fs, "0:/", 1) == FR_OK &&
+    	             tslog_open(&history, "0:/HISTORY.TSL") == XST_SUCCESS;
+    	printf("History %s\n", history_up ? "on SD, 0:/HISTORY.TSL" : "off, no SD card");
+
 
     
     while(!done) {
+        input_event_t ev;
 
+        while (input_get(&ev)) {
+            handle_input(&ev);
+        }
+        if (adc_health_poll()) {
+            // over temperature the profiler is the first thing to go
+            if (adc_throttled())
+                prof_stop();
+            else if (profiling)
+                prof_start(PROF_HZ);
+        }
         run_fsm();
-    	printf("\n[UPDATE]\n");
-
-
+        if (!adc_throttled())
+            printf("\n[UPDATE]\n");
+        met_inc(MET_UPDATES);
+
+        if (net_up) {
+            // Ethernet: the request is built in the transmit buffer and the
+            // response handled in the receive buffer, nothing is copied; the
+            // core sleeps between GEM interrupts while it waits for the
+            // response. Every METRICS_EVERY requests a metrics snapshot
+            // rides after the request; the substation binary here takes
+            // only the bare request, tools/metagg takes both
+            static u32 exports;
+            update_request_t *req = udp_alloc();
+            idle_timer_t timeout = { 0 };
+            XTime start, now;
+            u32 snap = 0;
+
+            if (req != NULL) {
+                req->type = UPDATE;
+                req->id = 0;
+                req->value = 0;
+                if (METRICS_EVERY != 0 && ++exports == METRICS_EVERY) {
+                    exports = 0;
+                    snap = met_snapshot((u8 *)(req + 1), UDP_PAYLOAD_MAX - sizeof(*req));
+                }
+                net_response = false;
+                XTime_GetTime(&start);
+                udp_send(req, sizeof(*req) + snap, &substation);
+                idle_timer_start(&timeout, UDP_RESPONSE_MS * 1000);
+                for (;;) {
+                    udp_poll();
+                    if (net_response || idle_timer_expired(&timeout))
+                        break;
+                    idle_wait();
+                }
+                idle_timer_cancel(&timeout);
+                XTime_GetTime(&now);
+                if (net_response) {
+                    u32 us = (u32)((now - start) / (COUNTS_PER_SECOND / 1000000));
+
+                    if (!adc_throttled())
+                        printf("[UPDATE] Round trip %u us\n", (unsigned)us);
+                    met_observe(MET_UPDATE_RTT, us);
+                    if (snap != 0)
+                        met_ack();
+                } else {
+                    printf("[UPDATE] No response from substation\n");
+                    met_inc(MET_UDP_TIMEOUTS);
+                }
+            }
+        } else {
+        	// UART0: the PL330 moves the response out of the FIFO (see
+        	// uart_dma.h) and the core sleeps until it is in or the
+        	// timeout passes
         	update_request_t update_msg;
+        	idle_timer_t timeout = { 0 };
+
         	update_msg.type = UPDATE;
         	update_msg.id = 0;
 //        	update_msg.value = pot_percentage;
 
 //        	printf("[UPDATE] Sending update message (ID: %d, Value: %d)\n",
 //               	update_msg.id, update_msg.value);
-        	XUartPs_Send(&UartInst0, (u8 *)&update_msg, sizeof(update_request_t));
-
-        	usleep(50000);
-        // Receive response
-		update_response_t resp;
-		int bytes_r = 0;
-		while (bytes_r < sizeof(update_response_t)) {
-			bytes_r += XUartPs_Recv(&UartInst0,
-					(u8 *)&resp + bytes_r,
-					sizeof(update_response_t) - bytes_r);
-		}
-		printf("response: %d,\n", resp.type);
-
-		if (resp.type == UPDATE) {
-			printf("[UPDATE] Received valid response from server:\n");
-			printf("Last update values:\n");
-			for (int j = 0; j < 30; j++) {
-				printf("Device %d: %d\n", j, resp.values[j]);
-
-			}
-		} else {
-			printf("[UPDATE] Invalid response received\n");
-		}
-		if(resp.values[27]==1){
-			//send to maintenance mode
-			maintenance_active = true;
-
-		}
-		else if(resp.values[27]==-1){
-			//leave maintenance mode
-			maintenance_active = false;
-		}
-
+        	wifly_rx_done = false;
+        	if (uart_dma_recv(&wifly_dma, wifly_resp, sizeof(*wifly_resp),
+        	                  wifly_recv_done, NULL) != XST_SUCCESS) {
+        		printf("[UPDATE] WiFly receive failed to start\n");
+        	} else if (!uart_tx_send(&wifly_tx, &update_msg, sizeof(update_request_t))) {
+        		// the queue is full; no request went out, so none will come back
+        		uart_tx_stats_t tx;
+
+        		uart_dma_rx_cancel(&wifly_dma);
+        		uart_tx_stats(&wifly_tx, &tx);
+        		printf("[UPDATE] WiFly queue full, request dropped (%u so far)\n",
+        		       (unsigned)tx.dropped_msgs);
+        	} else {
+        		idle_timer_start(&timeout, UART_RESPONSE_MS * 1000);
+        		while (!wifly_rx_done && !idle_timer_expired(&timeout))
+        			idle_wait();
+        		idle_timer_cancel(&timeout);
+        		if (!wifly_rx_done)
+        			uart_dma_rx_cancel(&wifly_dma);
+        		if (wifly_rx_status == XST_SUCCESS) {
+        			handle_response(wifly_resp);
+        		} else {
+        			printf("[UPDATE] No response from substation\n");
+        			met_inc(MET_UART_TIMEOUTS);
+        		}
+        	}
+        }
 
-        usleep(50000);
+        idle_sleep_us(50000);
 
 
     }
 
+    tslog_close(&history);
     printf("\n\r[shutdown]\n\r");
     return 0;
 }
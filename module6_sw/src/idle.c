@@ -0,0 +1,169 @@
+/*
+ * idle.c -- timed waits that sleep the core instead of spinning
+ */
+#include "idle.h"
+#include "xparameters.h"
+#include "xil_io.h"
+#include "xil_exception.h"
+#include "xstatus.h"
+#include "gic.h"
+
+/* global timer registers past the counter and control ones in xtime_l.h */
+#define GTIMER_STATUS_OFFSET     0x0CU   /* event flag, write 1 to clear */
+#define GTIMER_COMPARE_LOWER     0x10U
+#define GTIMER_COMPARE_UPPER     0x14U
+
+#define GTIMER_CTRL_COMP_ENABLE  0x02U
+#define GTIMER_CTRL_IRQ_ENABLE   0x04U
+#define GTIMER_CTRL_AUTO_INC     0x08U
+
+#define COUNTS_PER_US (COUNTS_PER_SECOND / 1000000)
+
+static idle_timer_t *timers;     /* started and not yet expired or cancelled */
+static XTime started;
+static idle_stats_t stats;
+
+static inline u32 ctrl(void) {
+	return Xil_In32(GLOBAL_TMR_BASEADDR + GTIMER_CONTROL_OFFSET);
+}
+
+static void disarm(void) {
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_CONTROL_OFFSET,
+		  ctrl() & ~(GTIMER_CTRL_COMP_ENABLE | GTIMER_CTRL_IRQ_ENABLE | GTIMER_CTRL_AUTO_INC));
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_STATUS_OFFSET, 1);
+}
+
+/*
+ * one-shot interrupt when the counter reaches wake; the comparator is
+ * disabled while both halves are written so it cannot match half way
+ */
+static void arm(XTime wake) {
+	disarm();
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_COMPARE_LOWER, (u32)wake);
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_COMPARE_UPPER, (u32)(wake >> 32));
+	Xil_Out32(GLOBAL_TMR_BASEADDR + GTIMER_CONTROL_OFFSET,
+		  ctrl() | GTIMER_CTRL_COMP_ENABLE | GTIMER_CTRL_IRQ_ENABLE);
+}
+
+static void idle_isr(void *ref) {
+	(void)ref;
+	disarm();
+	stats.timer_wakeups++;
+}
+
+s32 idle_init(void) {
+	disarm();
+	if (gic_connect(XPAR_GLOBAL_TMR_INTR, idle_isr, NULL) != XST_SUCCESS)
+		return XST_FAILURE;
+	XTime_GetTime(&started);
+	return XST_SUCCESS;
+}
+
+void idle_timer_start(idle_timer_t *t, u32 us) {
+	XTime now;
+
+	XTime_GetTime(&now);
+	t->deadline = now + (XTime)us * COUNTS_PER_US;
+	if (!t->active) {
+		t->active = true;
+		t->next = timers;
+		timers = t;
+	}
+}
+
+void idle_timer_cancel(idle_timer_t *t) {
+	idle_timer_t **p;
+
+	if (!t->active)
+		return;
+	for (p = &timers; *p != NULL; p = &(*p)->next) {
+		if (*p == t) {
+			*p = t->next;
+			break;
+		}
+	}
+	t->active = false;
+}
+
+bool idle_timer_expired(const idle_timer_t *t) {
+	XTime now;
+
+	XTime_GetTime(&now);
+	return now >= t->deadline;
+}
+
+/*
+ * drop the timers that are due at now and count them in *due; returns
+ * the wakeup for the rest, the last deadline within IDLE_SLACK_US of the
+ * earliest, or 0 when none is left
+ */
+static XTime next_wake(XTime now, u32 *due) {
+	idle_timer_t **p = &timers, *t;
+	XTime first = 0, wake = 0;
+
+	*due = 0;
+	while ((t = *p) != NULL) {
+		if (t->deadline <= now) {
+			*p = t->next;
+			t->active = false;
+			(*due)++;
+			continue;
+		}
+		if (first == 0 || t->deadline < first)
+			first = t->deadline;
+		p = &t->next;
+	}
+	if (*due > 1)
+		stats.coalesced += *due - 1;
+	for (t = timers; t != NULL; t = t->next)
+		if (t->deadline <= first + (XTime)IDLE_SLACK_US * COUNTS_PER_US && t->deadline > wake)
+			wake = t->deadline;
+	return wake;
+}
+
+void idle_wait(void) {
+	XTime now, wake, woke;
+	u32 due;
+
+	/* masked, an interrupt after the check still ends the WFI; it is
+	   taken once the mask drops */
+	Xil_ExceptionDisableMask(XIL_EXCEPTION_IRQ);
+	XTime_GetTime(&now);
+	wake = next_wake(now, &due);
+	if (wake != 0)
+		arm(wake);
+	else
+		disarm();
+	XTime_GetTime(&woke);
+	if (due != 0 || (wake != 0 && woke >= wake)) {
+		/* a waiter is due already */
+		Xil_ExceptionEnableMask(XIL_EXCEPTION_IRQ);
+		return;
+	}
+#if defined(__arm__)
+	__asm__ __volatile__("dsb\n\twfi" : : : "memory");
+#endif
+	XTime_GetTime(&woke);
+	stats.sleep_counts += woke - now;
+	stats.sleeps++;
+	Xil_ExceptionEnableMask(XIL_EXCEPTION_IRQ);
+}
+
+void idle_sleep_us(u32 us) {
+	idle_timer_t t = { 0 };
+
+	idle_timer_start(&t, us);
+	while (!idle_timer_expired(&t))
+		idle_wait();
+	idle_timer_cancel(&t);
+}
+
+void idle_stats(idle_stats_t *out) {
+	XTime now;
+
+	XTime_GetTime(&now);
+	*out = stats;
+	out->total_counts = now - started;
+	out->residency = out->total_counts != 0 ?
+		(u32)(out->sleep_counts * 1000 / out->total_counts) : 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * idle.h -- timed waits that sleep the core instead of spinning
+ *
+ * usleep() in the BSP spins on the global timer until the deadline, so
+ * the main loop burns a full 667 MHz core through every wait. Here a
+ * wait programs the comparator of the SCU global timer, the counter
+ * XTime_GetTime() reads, for a one-shot interrupt at the deadline and
+ * executes WFI. Any other interrupt (the TTC tick, the UARTs, the GEM)
+ * wakes the core as well, so a wait can also end early on an event.
+ * The SCU private timer is left to the profiler (prof.h).
+ *
+ * Waits are idle_timer_t deadlines registered with the service; one
+ * comparator serves all of them. When deadlines lie within IDLE_SLACK_US
+ * of the earliest, the core sleeps through to the last of them and
+ * they expire on the same wakeup, so several waiters cost one
+ * interrupt.
+ *
+ * The check for a pending deadline and the WFI run with IRQs masked,
+ * so an interrupt arriving in between is not lost: a masked interrupt
+ * still ends WFI and is taken as soon as the mask drops. Time spent in
+ * WFI is added up, and idle_stats() reports it against the time since
+ * idle_init() as the sleep residency.
+ *
+ *   idle_timer_t timeout;
+ *   idle_timer_start(&timeout, 20000);
+ *   while (!done && !idle_timer_expired(&timeout))
+ *       idle_wait();
+ *   idle_timer_cancel(&timeout);
+ *
+ * All calls are made from the main loop.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+#include "xtime_l.h"
+
+#define IDLE_SLACK_US 1000  /* how late a deadline may expire to share a wakeup */
+
+typedef struct idle_timer {
+	XTime deadline;
+	bool active;
+	struct idle_timer *next;
+} idle_timer_t;
+
+typedef struct {
+	u64 sleep_counts;   /* global timer counts spent in WFI */
+	u64 total_counts;   /* counts since idle_init() */
+	u32 residency;      /* sleep share of the total, in 0.1 % */
+	u32 sleeps;         /* WFIs executed */
+	u32 timer_wakeups;  /* comparator interrupts */
+	u32 coalesced;      /* deadlines that expired on another's wakeup */
+} idle_stats_t;
+
+/*
+ * idle_init -- connect the global timer interrupt and start counting
+ * residency
+ *
+ * returns XST_SUCCESS on success; otherwise XST_FAILURE
+ */
+s32 idle_init(void);
+
+/*
+ * idle_timer_start -- (re)arm t to expire us microseconds from now
+ */
+void idle_timer_start(idle_timer_t *t, u32 us);
+
+/*
+ * idle_timer_cancel -- take t off the service; needed before a timer on
+ * the stack goes out of scope
+ */
+void idle_timer_cancel(idle_timer_t *t);
+
+/*
+ * idle_timer_expired -- whether the deadline of t has passed
+ */
+bool idle_timer_expired(const idle_timer_t *t);
+
+/*
+ * idle_wait -- sleep until the next (coalesced) deadline or any other
+ * interrupt, whichever is first; returns at once when a deadline has
+ * already passed
+ */
+void idle_wait(void);
+
+/*
+ * idle_sleep_us -- sleep for us microseconds, the replacement for usleep()
+ */
+void idle_sleep_us(u32 us);
+
+/*
+ * idle_stats -- read the counters
+ */
+void idle_stats(idle_stats_t *stats);
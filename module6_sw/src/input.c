@@ -0,0 +1,181 @@
+/*
+ * input.c -- debounced button and switch events
+ */
+#include "input.h"
+#include "io.h"
+
+#define COUNTS_PER_MS (COUNTS_PER_SECOND / 1000)
+
+typedef struct {
+	u32 raw;                        /* last level read */
+	u32 stable;                     /* debounced level */
+	u32 long_sent;                  /* pins whose long press went out */
+	bool masked;                    /* interrupt off until the next poll */
+	XTime first[INPUT_PINS];        /* first edge of the current burst */
+	XTime last[INPUT_PINS];         /* latest edge */
+	XTime down[INPUT_PINS];         /* start of the current press */
+	u8 edges[INPUT_PINS];
+	u16 debounce_ms[INPUT_PINS];
+	u16 long_ms[INPUT_PINS];
+	u32 (*read)(void);
+	void (*irq)(bool enable);
+} input_port_state_t;
+
+static input_port_state_t ports[INPUT_PORTS];
+static input_event_t queue[INPUT_QUEUE];
+static volatile u32 q_head, q_tail;   /* written by the tick, read by main */
+static input_stats_t stats;
+
+/*
+ * note the edges between the last level read and value
+ */
+static void port_sample(input_port_state_t *p, u32 value, XTime now) {
+	u32 changed = value ^ p->raw;
+	u32 pin;
+
+	for (pin = 0; pin < INPUT_PINS; pin++) {
+		if ((changed & (1u << pin)) == 0)
+			continue;
+		/* a burst starts with the first edge away from the stable level */
+		if (((p->raw ^ p->stable) & (1u << pin)) == 0) {
+			p->first[pin] = now;
+			p->edges[pin] = 0;
+		}
+		p->last[pin] = now;
+		if (p->edges[pin] != 0xFF)
+			p->edges[pin]++;
+		stats.edges++;
+	}
+	p->raw = value;
+}
+
+static void push(input_port_t port, u32 pin, input_kind_t kind, XTime time, u32 held_ms) {
+	input_event_t *ev;
+
+	if (q_head - q_tail == INPUT_QUEUE) {
+		stats.dropped++;
+		return;
+	}
+	ev = &queue[q_head & (INPUT_QUEUE - 1)];
+	ev->port = (u8)port;
+	ev->pin = (u8)pin;
+	ev->kind = (u8)kind;
+	ev->edges = ports[port].edges[pin];
+	ev->held_ms = held_ms;
+	ev->time = time;
+	__atomic_store_n(&q_head, q_head + 1, __ATOMIC_RELEASE);
+	stats.events++;
+}
+
+static void edge(input_port_t port, u32 value) {
+	input_port_state_t *p = &ports[port];
+	XTime now;
+
+	XTime_GetTime(&now);
+	stats.irqs++;
+	port_sample(p, value, now);
+	/* quiet until the next tick, the tick reads the pins itself */
+	p->masked = true;
+	p->irq(false);
+}
+
+static void btn_edge(u32 value) {
+	edge(INPUT_BTN, value);
+}
+
+static void sw_edge(u32 value) {
+	edge(INPUT_SW, value);
+}
+
+static void port_init(input_port_t port, u32 (*read)(void), void (*irq)(bool),
+		u32 debounce_ms, u32 long_ms) {
+	input_port_state_t *p = &ports[port];
+	u32 pin;
+
+	p->read = read;
+	p->irq = irq;
+	for (pin = 0; pin < INPUT_PINS; pin++) {
+		p->debounce_ms[pin] = (u16)debounce_ms;
+		p->long_ms[pin] = (u16)long_ms;
+	}
+}
+
+void input_init(void) {
+	input_port_t port;
+
+	port_init(INPUT_BTN, io_btn_read, io_btn_irq, INPUT_BTN_DEBOUNCE_MS, INPUT_LONG_PRESS_MS);
+	port_init(INPUT_SW, io_sw_read, io_sw_irq, INPUT_SW_DEBOUNCE_MS, 0);
+	io_btn_init(btn_edge);
+	io_sw_init(sw_edge);
+	for (port = 0; port < INPUT_PORTS; port++)
+		ports[port].raw = ports[port].stable = ports[port].read();
+}
+
+void input_set_debounce(input_port_t port, u32 pin, u32 ms) {
+	if (port < INPUT_PORTS && pin < INPUT_PINS)
+		ports[port].debounce_ms[pin] = (u16)ms;
+}
+
+void input_set_long_press(input_port_t port, u32 pin, u32 ms) {
+	if (port < INPUT_PORTS && pin < INPUT_PINS)
+		ports[port].long_ms[pin] = (u16)ms;
+}
+
+void input_poll(void) {
+	input_port_t port;
+	XTime now;
+	u32 pin, bit;
+
+	XTime_GetTime(&now);
+	for (port = 0; port < INPUT_PORTS; port++) {
+		input_port_state_t *p = &ports[port];
+
+		if (p->read == NULL)
+			continue;
+		port_sample(p, p->read(), now);
+
+		for (pin = 0; pin < INPUT_PINS; pin++) {
+			bit = 1u << pin;
+			if ((p->raw ^ p->stable) & bit) {
+				if (now - p->last[pin] < (XTime)p->debounce_ms[pin] * COUNTS_PER_MS)
+					continue;
+				p->stable ^= bit;
+				if (p->stable & bit) {
+					p->down[pin] = p->first[pin];
+					p->long_sent &= ~bit;
+					push(port, pin, INPUT_PRESS, p->first[pin], 0);
+				} else {
+					push(port, pin, INPUT_RELEASE, p->first[pin],
+					     (u32)((p->first[pin] - p->down[pin]) / COUNTS_PER_MS));
+				}
+			} else if ((p->stable & bit) && !(p->long_sent & bit) && p->long_ms[pin] != 0 &&
+				   now - p->down[pin] >= (XTime)p->long_ms[pin] * COUNTS_PER_MS) {
+				p->long_sent |= bit;
+				push(port, pin, INPUT_LONG_PRESS, now,
+				     (u32)((now - p->down[pin]) / COUNTS_PER_MS));
+			}
+		}
+		if (p->masked) {
+			p->masked = false;
+			p->irq(true);
+		}
+	}
+}
+
+bool input_get(input_event_t *ev) {
+	u32 tail = q_tail;
+
+	if (tail == __atomic_load_n(&q_head, __ATOMIC_ACQUIRE))
+		return false;
+	*ev = queue[tail & (INPUT_QUEUE - 1)];
+	__atomic_store_n(&q_tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+u32 input_level(input_port_t port) {
+	return port < INPUT_PORTS ? ports[port].stable : 0;
+}
+
+void input_stats(input_stats_t *out) {
+	*out = stats;
+}
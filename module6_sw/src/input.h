@@ -0,0 +1,98 @@
+/*
+ * input.h -- debounced button and switch events
+ *
+ * io.c raises an interrupt on every raw edge, so a bouncing contact
+ * gives a burst of interrupts and would run the application callback
+ * once per bounce. Here the GPIO interrupt only time stamps the edge
+ * with the global timer and masks itself; input_poll(), run from the
+ * TTC tick, unmasks it again, so a port interrupts at most once per
+ * tick however much it bounces.
+ *
+ * A pin's new level is accepted once it has been stable for the pin's
+ * debounce window. The burst is then reported as one event carrying
+ * the time of its first edge and the number of edges it had. A button
+ * held past its long press time also reports a long press.
+ *
+ * Events are queued for the main loop, which reads them with
+ * input_get(), so no callback runs in interrupt context.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+#include "xtime_l.h"
+
+#define INPUT_PINS             8     /* per port */
+#define INPUT_QUEUE            16    /* events, a power of two */
+#define INPUT_BTN_DEBOUNCE_MS  20
+#define INPUT_SW_DEBOUNCE_MS   50
+#define INPUT_LONG_PRESS_MS    1000
+
+typedef enum {
+	INPUT_BTN,
+	INPUT_SW,
+	INPUT_PORTS
+} input_port_t;
+
+typedef enum {
+	INPUT_PRESS,        /* button pressed, switch turned on */
+	INPUT_RELEASE,      /* button released, switch turned off */
+	INPUT_LONG_PRESS    /* button still held after its long press time */
+} input_kind_t;
+
+typedef struct {
+	u8 port;            /* input_port_t */
+	u8 pin;
+	u8 kind;            /* input_kind_t */
+	u8 edges;           /* edges seen in the burst; bounces while the
+	                       interrupt is masked are not counted */
+	u32 held_ms;        /* release and long press: time since the press */
+	XTime time;         /* global timer count at the first edge */
+} input_event_t;
+
+typedef struct {
+	u32 irqs;           /* GPIO interrupts taken */
+	u32 edges;          /* raw edges seen */
+	u32 events;         /* events queued */
+	u32 dropped;        /* events lost to a full queue */
+} input_stats_t;
+
+/*
+ * input_init -- set up the buttons and switches with the default
+ * windows; the current levels are taken as stable
+ */
+void input_init(void);
+
+/*
+ * input_set_debounce -- set the debounce window of a pin, in ms
+ */
+void input_set_debounce(input_port_t port, u32 pin, u32 ms);
+
+/*
+ * input_set_long_press -- set the long press time of a pin, in ms;
+ * 0 turns long press events off
+ */
+void input_set_long_press(input_port_t port, u32 pin, u32 ms);
+
+/*
+ * input_poll -- settle debounced pins and rearm the interrupts; call it
+ * from a periodic tick, its period bounds the GPIO interrupt rate
+ */
+void input_poll(void);
+
+/*
+ * input_get -- take the oldest event
+ *
+ * returns false when there is none
+ */
+bool input_get(input_event_t *ev);
+
+/*
+ * input_level -- the debounced level of every pin of a port
+ */
+u32 input_level(input_port_t port);
+
+/*
+ * input_stats -- read the counters
+ */
+void input_stats(input_stats_t *stats);
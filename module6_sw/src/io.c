@@ -6,35 +6,23 @@ static XGpio btnport;
 static XGpio swport;
 static void (*btn_callback)(u32 btn);
 static void (*sw_callback)(u32 sw);
-static u32 btn_prev_state = 0;
-static u32 sw_prev_state = 0;
-
 void btn_handler(void *devicep) {
     XGpio *dev = (XGpio *)devicep;
 
-    u32 btn_value = XGpio_DiscreteRead(dev, 1);
-    u32 btn_pressed = btn_value & ~btn_prev_state;
-
-    if (btn_pressed && btn_callback) {
-        btn_callback(btn_pressed);
-    }
-
-    btn_prev_state = btn_value;
+    // Clear first so an edge during the callback raises a new interrupt
     XGpio_InterruptClear(dev, XGPIO_IR_CH1_MASK);
+    if (btn_callback) {
+        btn_callback(XGpio_DiscreteRead(dev, 1));
+    }
 }
 
 void sw_handler(void *devicep) {
     XGpio *dev = (XGpio *)devicep;
 
-    u32 sw_value = XGpio_DiscreteRead(dev, 1);
-    u32 sw_changed = sw_value ^ sw_prev_state;
-
-    if (sw_changed && sw_callback) {
-        sw_callback(sw_changed);
-    }
-
-    sw_prev_state = sw_value;
     XGpio_InterruptClear(dev, XGPIO_IR_CH1_MASK);
+    if (sw_callback) {
+        sw_callback(XGpio_DiscreteRead(dev, 1));
+    }
 }
 
 void io_btn_init(void (*callback)(u32 btn)) {
@@ -58,6 +46,18 @@ void io_btn_init(void (*callback)(u32 btn)) {
     XGpio_InterruptEnable(&btnport, XGPIO_IR_CH1_MASK);
 }
 
+u32 io_btn_read(void) {
+    return XGpio_DiscreteRead(&btnport, 1);
+}
+
+void io_btn_irq(bool enable) {
+    if (enable) {
+        XGpio_InterruptEnable(&btnport, XGPIO_IR_CH1_MASK);
+    } else {
+        XGpio_InterruptDisable(&btnport, XGPIO_IR_CH1_MASK);
+    }
+}
+
 void io_btn_close(void) {
     // Disconnect the interrupt handler
     gic_disconnect(XPAR_FABRIC_GPIO_1_VEC_ID);
@@ -87,6 +87,18 @@ void io_sw_init(void (*callback)(u32 sw)) {
     XGpio_InterruptEnable(&swport, XGPIO_IR_CH1_MASK);
 }
 
+u32 io_sw_read(void) {
+    return XGpio_DiscreteRead(&swport, 1);
+}
+
+void io_sw_irq(bool enable) {
+    if (enable) {
+        XGpio_InterruptEnable(&swport, XGPIO_IR_CH1_MASK);
+    } else {
+        XGpio_InterruptDisable(&swport, XGPIO_IR_CH1_MASK);
+    }
+}
+
 void io_sw_close(void) {
     // Disconnect the switch interrupt handler
     gic_disconnect(XPAR_FABRIC_GPIO_2_VEC_ID);
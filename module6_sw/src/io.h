@@ -11,10 +11,21 @@
 #include "xil_types.h"		/* types used by xilinx */
 
 /*
- * initialize the btns providing a callback
+ * initialize the btns providing a callback; it runs in the interrupt on
+ * every edge and is given the state of all buttons
  */
 void io_btn_init(void (*btn_callback)(u32 btn));
 
+/*
+ * read the btns
+ */
+u32 io_btn_read(void);
+
+/*
+ * enable or disable the btn interrupt
+ */
+void io_btn_irq(bool enable);
+
 /*
  * close the btns
  */
@@ -22,10 +33,21 @@ void io_btn_close(void);
 
 
 /*
- * initialize the switches providing a callback
+ * initialize the switches providing a callback; it runs in the interrupt
+ * on every edge and is given the state of all switches
  */
 void io_sw_init(void (*sw_callback)(u32 sw));
 
+/*
+ * read the switches
+ */
+u32 io_sw_read(void);
+
+/*
+ * enable or disable the switch interrupt
+ */
+void io_sw_irq(bool enable);
+
 /*
  * close the switches
  */
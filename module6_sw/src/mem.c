@@ -0,0 +1,196 @@
+/*
+ * mem.c -- memory copy and fill for frame and log buffers
+ */
+#include <stdint.h>
+#include "mem.h"
+
+#if defined(__arm__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MEM_BLOCK     64
+#define MEM_ANY_SRC   1   /* vld1.8 takes any source alignment */
+#else
+#define MEM_BLOCK     32
+#define MEM_ANY_SRC   0
+#endif
+
+#define MEM_SMALL     16  /* below this plain byte copies win */
+#define MEM_PREFETCH  96  /* bytes ahead of the source */
+
+/* word access through byte pointers */
+typedef u32 __attribute__((__may_alias__)) mem_word_t;
+
+static inline void copy_bytes(u8 *d, const u8 *s, u32 n) {
+	while (n-- != 0)
+		*d++ = *s++;
+}
+
+/*
+ * copy whole blocks, d is word aligned (and so is s unless MEM_ANY_SRC);
+ * returns the bytes copied
+ */
+static u32 copy_blocks(u8 *d, const u8 *s, u32 n) {
+	u32 done = n & ~(u32)(MEM_BLOCK - 1);
+
+#if defined(__arm__) && defined(__ARM_NEON)
+	for (; n >= MEM_BLOCK; n -= MEM_BLOCK) {
+		uint8x16_t q0, q1, q2, q3;
+
+		__builtin_prefetch(s + MEM_PREFETCH);
+		q0 = vld1q_u8(s);
+		q1 = vld1q_u8(s + 16);
+		q2 = vld1q_u8(s + 32);
+		q3 = vld1q_u8(s + 48);
+		vst1q_u8(d, q0);
+		vst1q_u8(d + 16, q1);
+		vst1q_u8(d + 32, q2);
+		vst1q_u8(d + 48, q3);
+		s += MEM_BLOCK;
+		d += MEM_BLOCK;
+	}
+#elif defined(__arm__)
+	for (; n >= MEM_BLOCK; n -= MEM_BLOCK) {
+		__asm__ volatile(
+			"pld	[%1, #96]\n\t"
+			"ldmia	%1!, {r3-r6, r8-r10, r12}\n\t"
+			"stmia	%0!, {r3-r6, r8-r10, r12}\n\t"
+			: "+r" (d), "+r" (s)
+			:
+			: "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12", "memory");
+	}
+#else
+	mem_word_t *dw = (mem_word_t *)d;
+	const mem_word_t *sw = (const mem_word_t *)s;
+
+	for (; n >= MEM_BLOCK; n -= MEM_BLOCK) {
+		u32 w0 = sw[0], w1 = sw[1], w2 = sw[2], w3 = sw[3];
+		u32 w4 = sw[4], w5 = sw[5], w6 = sw[6], w7 = sw[7];
+
+		dw[0] = w0; dw[1] = w1; dw[2] = w2; dw[3] = w3;
+		dw[4] = w4; dw[5] = w5; dw[6] = w6; dw[7] = w7;
+		sw += 8;
+		dw += 8;
+	}
+#endif
+	return done;
+}
+
+/*
+ * d is word aligned, s is not: load aligned words and shift neighbours
+ * together (little endian). Stops with at least 4 bytes left so the last
+ * load never reaches past the source; returns the bytes copied
+ */
+static u32 copy_shifted(u8 *d, const u8 *s, u32 n) {
+	u32 off = (u32)((uintptr_t)s & 3);
+	u32 sh = off * 8;
+	const mem_word_t *sw = (const mem_word_t *)(s - off);
+	mem_word_t *dw = (mem_word_t *)d;
+	u32 lo = *sw++;
+	u32 w1, w2, w3, w4;
+	u32 done = 0;
+
+	while (n - done >= 20) {
+		w1 = sw[0];
+		w2 = sw[1];
+		w3 = sw[2];
+		w4 = sw[3];
+		dw[0] = (lo >> sh) | (w1 << (32 - sh));
+		dw[1] = (w1 >> sh) | (w2 << (32 - sh));
+		dw[2] = (w2 >> sh) | (w3 << (32 - sh));
+		dw[3] = (w3 >> sh) | (w4 << (32 - sh));
+		lo = w4;
+		sw += 4;
+		dw += 4;
+		done += 16;
+	}
+	while (n - done >= 8) {
+		w1 = *sw++;
+		*dw++ = (lo >> sh) | (w1 << (32 - sh));
+		lo = w1;
+		done += 4;
+	}
+	return done;
+}
+
+void mem_copy(void *dst, const void *src, u32 n) {
+	u8 *d = dst;
+	const u8 *s = src;
+	u32 k;
+
+	if (n >= MEM_SMALL) {
+		k = (u32)(-(uintptr_t)d & 3);
+		copy_bytes(d, s, k);
+		d += k;
+		s += k;
+		n -= k;
+
+		if (MEM_ANY_SRC || ((uintptr_t)s & 3) == 0) {
+			k = copy_blocks(d, s, n);
+			d += k;
+			s += k;
+			n -= k;
+			if (((uintptr_t)s & 3) == 0) {
+				for (; n >= 4; n -= 4, d += 4, s += 4)
+					*(mem_word_t *)d = *(const mem_word_t *)s;
+			}
+		} else {
+			k = copy_shifted(d, s, n);
+			d += k;
+			s += k;
+			n -= k;
+		}
+	}
+	copy_bytes(d, s, n);
+}
+
+void mem_set(void *dst, u8 c, u32 n) {
+	u8 *d = dst;
+	u32 w = c * 0x01010101u;
+	u32 k;
+
+	if (n >= MEM_SMALL) {
+		k = (u32)(-(uintptr_t)d & 3);
+		n -= k;
+		while (k-- != 0)
+			*d++ = c;
+
+#if defined(__arm__) && defined(__ARM_NEON)
+		{
+			uint8x16_t q = vdupq_n_u8(c);
+
+			for (; n >= MEM_BLOCK; n -= MEM_BLOCK, d += MEM_BLOCK) {
+				vst1q_u8(d, q);
+				vst1q_u8(d + 16, q);
+				vst1q_u8(d + 32, q);
+				vst1q_u8(d + 48, q);
+			}
+		}
+#elif defined(__arm__)
+		if (n >= MEM_BLOCK) {
+			register u32 r3 __asm__("r3") = w;
+			register u32 r4 __asm__("r4") = w;
+			register u32 r5 __asm__("r5") = w;
+			register u32 r6 __asm__("r6") = w;
+
+			for (; n >= MEM_BLOCK; n -= MEM_BLOCK) {
+				__asm__ volatile(
+					"stmia	%0!, {%1-%4}\n\t"
+					"stmia	%0!, {%1-%4}\n\t"
+					: "+r" (d)
+					: "r" (r3), "r" (r4), "r" (r5), "r" (r6)
+					: "memory");
+			}
+		}
+#else
+		for (; n >= MEM_BLOCK; n -= MEM_BLOCK, d += MEM_BLOCK) {
+			mem_word_t *dw = (mem_word_t *)d;
+
+			dw[0] = w; dw[1] = w; dw[2] = w; dw[3] = w;
+			dw[4] = w; dw[5] = w; dw[6] = w; dw[7] = w;
+		}
+#endif
+		for (; n >= 4; n -= 4, d += 4)
+			*(mem_word_t *)d = w;
+	}
+	while (n-- != 0)
+		*d++ = c;
+}
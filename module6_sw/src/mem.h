@@ -0,0 +1,30 @@
+/*
+ * mem.h -- memory copy and fill for frame and log buffers
+ *
+ * Xil_MemCpy copies an int at a time through possibly unaligned pointers
+ * and has no fill counterpart. mem_copy()/mem_set() align the destination
+ * first and then move whole blocks:
+ *
+ *   ARM, no NEON   32 byte blocks (one L1 line) with ldm/stm of 8
+ *                  registers and a pld ahead of the source
+ *   ARM with NEON  64 byte blocks with vld1/vst1 and a prefetch, source
+ *                  alignment does not matter (built with -mfpu=neon)
+ *   other hosts    the portable C version, unrolled 8 words
+ *
+ * A source that stays misaligned after the destination is aligned is
+ * copied with aligned word loads shifted together. Neither function
+ * handles overlapping buffers.
+ */
+#pragma once
+
+#include "xil_types.h"
+
+/*
+ * mem_copy -- copy n bytes from src to dst
+ */
+void mem_copy(void *dst, const void *src, u32 n);
+
+/*
+ * mem_set -- fill n bytes at dst with c
+ */
+void mem_set(void *dst, u8 c, u32 n);
@@ -0,0 +1,239 @@
+/*
+ * metrics.c -- fixed memory counters, gauges and histograms
+ */
+#include <string.h>
+#include "metrics.h"
+
+#define SERIES_BYTES_MAX (5 + 5 + MET_HIST_BUCKETS * (5 + 5) + 10)
+
+const char *const met_names[MET_SERIES] = {
+	"updates", "uart_timeouts", "udp_timeouts", "invalid_responses",
+	"servo_clamp_min", "servo_clamp_max", "gate_cycles", "ped_requests",
+	"state", "servo_duty",
+	"update_rtt_us",
+	"dwell.RED_LIGHT", "dwell.YELLOW_LIGHT1", "dwell.GREEN_LIGHT",
+	"dwell.YELLOW_LIGHT2", "dwell.TRAIN_CLOSING", "dwell.TRAIN_CLOSED",
+	"dwell.TRAIN_OPENING", "dwell.TRAIN_WAIT_PED", "dwell.MAINTENANCE"
+};
+
+static met_state_t cur;       /* the live values */
+static met_state_t base;      /* as of the acknowledged snapshot */
+static met_state_t sent;      /* base, with the series of the last snapshot */
+static u32 seq, base_seq;
+static bool pending;          /* a snapshot is waiting for met_ack() */
+
+static inline u64 zigzag(s64 v) {
+	return ((u64)v << 1) ^ (u64)(v >> 63);
+}
+
+static inline s64 unzigzag(u64 v) {
+	return (s64)(v >> 1) ^ -(s64)(v & 1);
+}
+
+static inline u8 *put_varint(u8 *p, u64 v) {
+	while (v >= 0x80) {
+		*p++ = (u8)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (u8)v;
+	return p;
+}
+
+/* NULL past end or on an overlong encoding */
+static inline const u8 *get_varint(const u8 *p, const u8 *end, u64 *v) {
+	u64 r = 0;
+	u32 shift;
+
+	for (shift = 0; p < end && shift < 64; shift += 7) {
+		u8 b = *p++;
+
+		r |= (u64)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) {
+			*v = r;
+			return p;
+		}
+	}
+	return NULL;
+}
+
+u32 met_bucket(u32 v) {
+	u32 e, b;
+
+	if (v < MET_HIST_SUB)
+		return v;
+	e = 31 - __builtin_clz(v);
+	b = ((e - MET_HIST_BITS + 1) << MET_HIST_BITS) | ((v >> (e - MET_HIST_BITS)) & (MET_HIST_SUB - 1));
+	return b < MET_HIST_BUCKETS ? b : MET_HIST_BUCKETS - 1;
+}
+
+u32 met_bucket_low(u32 b) {
+	u32 e;
+
+	if (b < MET_HIST_SUB)
+		return b;
+	e = (b >> MET_HIST_BITS) + MET_HIST_BITS - 1;
+	return (MET_HIST_SUB | (b & (MET_HIST_SUB - 1))) << (e - MET_HIST_BITS);
+}
+
+void met_add(u32 id, u32 n) {
+	cur.counter[id] += n;
+}
+
+void met_set(u32 id, s32 v) {
+	cur.gauge[id - MET_COUNTERS] = v;
+}
+
+void met_observe(u32 id, u32 v) {
+	met_hist_t *h = &cur.hist[id - MET_GAUGES_END];
+
+	h->count[met_bucket(v)]++;
+	h->sum += v;
+}
+
+void met_read(met_state_t *st) {
+	*st = cur;
+}
+
+/*
+ * the delta of series id from b to c after its id gap, at p; returns the
+ * end, or p when the series did not change
+ */
+static u8 *put_series(u8 *p, u32 gap, u32 id, const met_state_t *c, const met_state_t *b) {
+	u8 *q = put_varint(p, gap);
+
+	switch (met_kind(id)) {
+	case MET_COUNTER:
+		if (c->counter[id] == b->counter[id])
+			return p;
+		return put_varint(q, c->counter[id] - b->counter[id]);
+	case MET_GAUGE: {
+		u32 g = id - MET_COUNTERS;
+
+		if (c->gauge[g] == b->gauge[g])
+			return p;
+		return put_varint(q, zigzag((s64)c->gauge[g] - b->gauge[g]));
+	}
+	default: {
+		const met_hist_t *hc = &c->hist[id - MET_GAUGES_END];
+		const met_hist_t *hb = &b->hist[id - MET_GAUGES_END];
+		u32 i, n = 0, last = 0;
+
+		if (hc->sum == hb->sum && memcmp(hc->count, hb->count, sizeof(hc->count)) == 0)
+			return p;
+		for (i = 0; i < MET_HIST_BUCKETS; i++)
+			n += hc->count[i] != hb->count[i];
+		q = put_varint(q, n);
+		for (i = 0; i < MET_HIST_BUCKETS; i++) {
+			if (hc->count[i] == hb->count[i])
+				continue;
+			q = put_varint(q, i - last);
+			q = put_varint(q, hc->count[i] - hb->count[i]);
+			last = i + 1;
+		}
+		return put_varint(q, hc->sum - hb->sum);
+	}
+	}
+}
+
+static void copy_series(met_state_t *to, const met_state_t *from, u32 id) {
+	switch (met_kind(id)) {
+	case MET_COUNTER:
+		to->counter[id] = from->counter[id];
+		break;
+	case MET_GAUGE:
+		to->gauge[id - MET_COUNTERS] = from->gauge[id - MET_COUNTERS];
+		break;
+	default:
+		to->hist[id - MET_GAUGES_END] = from->hist[id - MET_GAUGES_END];
+		break;
+	}
+}
+
+u32 met_snapshot(u8 *buf, u32 size) {
+	u8 tmp[SERIES_BYTES_MAX];
+	u8 *p = buf, *end = buf + size;
+	u32 id, next = 0, len;
+
+	pending = false;
+	if (size < 1 + 5 + 5)
+		return 0;
+	*p++ = MET_MAGIC;
+	p = put_varint(p, seq + 1);
+	p = put_varint(p, base_seq);
+	sent = base;
+	for (id = 0; id < MET_SERIES; id++) {
+		len = put_series(tmp, id - next, id, &cur, &base) - tmp;
+		if (len == 0 || len > (u32)(end - p))
+			continue;
+		memcpy(p, tmp, len);
+		p += len;
+		copy_series(&sent, &cur, id);
+		next = id + 1;
+	}
+	if (next == 0)
+		return 0;
+	seq++;
+	pending = true;
+	return p - buf;
+}
+
+void met_ack(void) {
+	if (pending) {
+		base = sent;
+		base_seq = seq;
+		pending = false;
+	}
+}
+
+bool met_decode(const u8 *buf, u32 len, u32 *seq_out, u32 *base_out, met_state_t *st) {
+	const u8 *p = buf, *end = buf + len;
+	u64 v, gap, n, i;
+	u32 id = 0;
+
+	if (len < 1 || *p++ != MET_MAGIC)
+		return false;
+	if ((p = get_varint(p, end, &v)) == NULL)
+		return false;
+	*seq_out = (u32)v;
+	if ((p = get_varint(p, end, &v)) == NULL)
+		return false;
+	*base_out = (u32)v;
+	while (p < end) {
+		if ((p = get_varint(p, end, &gap)) == NULL || gap >= MET_SERIES - id)
+			return false;
+		id += (u32)gap;
+		switch (met_kind(id)) {
+		case MET_COUNTER:
+			if ((p = get_varint(p, end, &v)) == NULL)
+				return false;
+			st->counter[id] += (u32)v;
+			break;
+		case MET_GAUGE:
+			if ((p = get_varint(p, end, &v)) == NULL)
+				return false;
+			st->gauge[id - MET_COUNTERS] += (s32)unzigzag(v);
+			break;
+		default: {
+			met_hist_t *h = &st->hist[id - MET_GAUGES_END];
+			u32 b = 0;
+
+			if ((p = get_varint(p, end, &n)) == NULL || n > MET_HIST_BUCKETS)
+				return false;
+			for (i = 0; i < n; i++) {
+				if ((p = get_varint(p, end, &gap)) == NULL || gap >= MET_HIST_BUCKETS - b)
+					return false;
+				b += (u32)gap;
+				if ((p = get_varint(p, end, &v)) == NULL)
+					return false;
+				h->count[b++] += (u32)v;
+			}
+			if ((p = get_varint(p, end, &v)) == NULL)
+				return false;
+			h->sum += v;
+			break;
+		}
+		}
+		id++;
+	}
+	return true;
+}
@@ -0,0 +1,172 @@
+/*
+ * metrics.h -- fixed memory counters, gauges and histograms, exported
+ * to the substation on UPDATE requests
+ *
+ * What the FSM does in the field was only ever printed to the console:
+ * how long it sits in each state, how often the gate cycles, UPDATE
+ * exchanges that time out or come back invalid, servo commands clamped
+ * to the limits. Here each of those is a series in a registry of fixed
+ * size, laid out at compile time; the series ids below are the wire
+ * format, so new series are only ever appended to their group.
+ *
+ *   counter    u32, only goes up
+ *   gauge      s32, the last value set
+ *   histogram  log-linear buckets of u32 samples, and their sum
+ *
+ * A histogram has MET_HIST_SUB linear buckets per power of two, so a
+ * sample lands in a bucket at most 25% wider than its value: 0..3 get a
+ * bucket each, then 4, 5, 6, 7, then 8-9, 10-11, 12-13, 14-15, and so on
+ * up to the last bucket, which takes everything from 114688 up.
+ *
+ * A snapshot holds only the series that changed since the last one the
+ * substation acknowledged, each as a delta from it:
+ *
+ *   u8 MET_MAGIC, varint seq, varint base
+ *   per changed series, in id order:
+ *     varint   id gap from the series before, less one
+ *     counter  varint increase
+ *     gauge    zigzag varint change
+ *     hist     varint buckets changed, per bucket the varint index gap
+ *              and the varint count increase, then the varint sum
+ *              increase
+ *
+ * seq numbers the snapshots from 1 each boot and base is the seq the
+ * deltas are taken from, 0 for the zero state at boot. The base only
+ * moves on met_ack(), when the UPDATE the snapshot rode on was answered,
+ * so a lost datagram costs nothing: the next snapshot carries its
+ * changes too, over the same base. The receiver keeps the state at the
+ * base and replaces, rather than adds, a snapshot over a base it already
+ * applied one to (tools/metagg). A quiet FSM sends a few bytes, and
+ * nothing at all when no series changed. The substation binary takes
+ * only the bare 12 byte UPDATE, so the export stays off (METRICS_EVERY
+ * in fsm.c) unless tools/metagg answers in its place.
+ *
+ *   met_inc(MET_GATE_CYCLES);
+ *   met_observe(MET_DWELL + state, ms);
+ *   ...
+ *   len = met_snapshot(buf, size);    // after the UPDATE request
+ *   ...
+ *   met_ack();                        // the response came back
+ *
+ * This file is the registry and the codec; the codec is shared with
+ * tools/metagg on the host. Varints are little endian base 128, as in
+ * tsblock.h. All calls are made from the main loop.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+
+#define MET_MAGIC        0x6D     /* 'm' */
+#define MET_HIST_BITS    2
+#define MET_HIST_SUB     (1 << MET_HIST_BITS)
+#define MET_HIST_BUCKETS 64
+#define MET_STATES       9        /* SystemState in fsm.c */
+
+/* the series; ids are the wire format */
+enum {
+	/* counters */
+	MET_UPDATES,            /* UPDATE requests sent */
+	MET_UART_TIMEOUTS,      /* no response over UART0 */
+	MET_UDP_TIMEOUTS,       /* no response over Ethernet */
+	MET_INVALID_RESPONSES,  /* a response that was not an UPDATE */
+	MET_SERVO_CLAMP_MIN,    /* servo_set() below the limit */
+	MET_SERVO_CLAMP_MAX,    /* servo_set() above the limit */
+	MET_GATE_CYCLES,        /* the gate closed */
+	MET_PED_REQUESTS,
+	MET_COUNTERS,
+
+	/* gauges */
+	MET_STATE = MET_COUNTERS,
+	MET_SERVO_DUTY,         /* hundredths of a percent */
+	MET_GAUGES_END,
+
+	/* histograms */
+	MET_UPDATE_RTT = MET_GAUGES_END,  /* us */
+	MET_DWELL,              /* ms per visit, MET_DWELL + state */
+	MET_SERIES = MET_DWELL + MET_STATES
+};
+
+#define MET_GAUGES (MET_GAUGES_END - MET_COUNTERS)
+#define MET_HISTS  (MET_SERIES - MET_GAUGES_END)
+
+typedef enum {
+	MET_COUNTER,
+	MET_GAUGE,
+	MET_HIST
+} met_kind_t;
+
+typedef struct {
+	u32 count[MET_HIST_BUCKETS];
+	u64 sum;
+} met_hist_t;
+
+/* the value of every series */
+typedef struct {
+	u32 counter[MET_COUNTERS];
+	s32 gauge[MET_GAUGES];
+	met_hist_t hist[MET_HISTS];
+} met_state_t;
+
+/* the series' names, "dwell.RED_LIGHT" and so on */
+extern const char *const met_names[MET_SERIES];
+
+static inline met_kind_t met_kind(u32 id) {
+	return id < MET_COUNTERS ? MET_COUNTER : id < MET_GAUGES_END ? MET_GAUGE : MET_HIST;
+}
+
+/*
+ * met_add -- add n to counter id
+ */
+void met_add(u32 id, u32 n);
+
+#define met_inc(id) met_add((id), 1)
+
+/*
+ * met_set -- set gauge id to v
+ */
+void met_set(u32 id, s32 v);
+
+/*
+ * met_observe -- add sample v to histogram id
+ */
+void met_observe(u32 id, u32 v);
+
+/*
+ * met_snapshot -- encode the series changed since the acknowledged
+ * snapshot into buf; a series that does not fit in size bytes waits for
+ * the next snapshot
+ *
+ * returns the length, 0 when nothing changed
+ */
+u32 met_snapshot(u8 *buf, u32 size);
+
+/*
+ * met_ack -- the last snapshot was received; later snapshots are taken
+ * from it
+ */
+void met_ack(void);
+
+/*
+ * met_read -- copy the current value of every series
+ */
+void met_read(met_state_t *st);
+
+/*
+ * met_bucket -- the histogram bucket of sample v
+ */
+u32 met_bucket(u32 v);
+
+/*
+ * met_bucket_low -- the smallest sample in bucket b
+ */
+u32 met_bucket_low(u32 b);
+
+/*
+ * met_decode -- apply the snapshot in buf[0..len) to st, which holds the
+ * state at its base, and return its seq and base; st is left partly
+ * updated when the snapshot is malformed
+ *
+ * returns true on success; otherwise false
+ */
+bool met_decode(const u8 *buf, u32 len, u32 *seq, u32 *base, met_state_t *st);
@@ -0,0 +1,128 @@
+/*
+ * pool.c -- fixed block allocator for messages, records and frames
+ */
+#include <stdbool.h>
+#include "pool.h"
+#include "xstatus.h"
+
+#define NONE      0xFFFFu   /* empty free list */
+#define TAG_ONE   0x10000u  /* head = tag << 16 | first free block */
+
+/* from lscript.ld */
+extern u8 _pool_start[];
+extern u8 _pool_end[];
+
+typedef struct {
+	u32 size;
+	u32 blocks;
+	u8 *base;
+	u8 *end;
+	u32 head;           /* the tag changes with every update, so a head
+	                       that was popped and pushed back meanwhile does
+	                       not compare equal */
+	u32 in_use;
+	u32 high_water;
+	u32 allocs;
+	u32 fails;
+} pool_class_t;
+
+static pool_class_t classes[POOL_CLASSES] = {
+	{ .size = 32,   .blocks = 256 },
+	{ .size = 64,   .blocks = 128 },
+	{ .size = 128,  .blocks = 64 },
+	{ .size = 256,  .blocks = 32 },
+	{ .size = 512,  .blocks = 16 },
+	{ .size = 1024, .blocks = 8 },
+	{ .size = 2048, .blocks = 6 },
+	{ .size = 4096, .blocks = 1 },
+};
+
+static inline u32 *link_of(pool_class_t *c, u32 idx) {
+	return (u32 *)(c->base + idx * c->size);
+}
+
+s32 pool_init(void) {
+	u8 *p = _pool_start;
+	pool_class_t *c;
+	u32 i;
+
+	for (c = classes; c < classes + POOL_CLASSES; c++) {
+		if (c->blocks >= NONE || c->size * c->blocks > (u32)(_pool_end - p))
+			return XST_FAILURE;
+		c->base = p;
+		p += c->size * c->blocks;
+		c->end = p;
+		for (i = 0; i < c->blocks; i++)
+			*link_of(c, i) = i + 1 < c->blocks ? i + 1 : NONE;
+		c->head = c->blocks != 0 ? 0 : NONE;
+	}
+	return XST_SUCCESS;
+}
+
+void *pool_alloc(u32 size) {
+	pool_class_t *c = classes;
+	u32 old, new, idx, use, hw;
+
+	if (size == 0 || size > POOL_MAX)
+		return NULL;
+	while (c->size < size)
+		c++;
+
+	old = __atomic_load_n(&c->head, __ATOMIC_ACQUIRE);
+	do {
+		idx = old & 0xFFFF;
+		if (idx == NONE) {
+			__atomic_add_fetch(&c->fails, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+		/* may be stale if the block was taken meanwhile; the tag then
+		   fails the exchange */
+		new = ((old + TAG_ONE) & ~0xFFFFu) | (*link_of(c, idx) & 0xFFFF);
+	} while (!__atomic_compare_exchange_n(&c->head, &old, new, true,
+					      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	use = __atomic_add_fetch(&c->in_use, 1, __ATOMIC_RELAXED);
+	hw = __atomic_load_n(&c->high_water, __ATOMIC_RELAXED);
+	while (use > hw && !__atomic_compare_exchange_n(&c->high_water, &hw, use, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	__atomic_add_fetch(&c->allocs, 1, __ATOMIC_RELAXED);
+	return c->base + idx * c->size;
+}
+
+void pool_free(void *block) {
+	u8 *p = block;
+	pool_class_t *c;
+	u32 old, new, idx;
+
+	for (c = classes; c < classes + POOL_CLASSES; c++)
+		if (p >= c->base && p < c->end)
+			break;
+	if (c == classes + POOL_CLASSES || (u32)(p - c->base) % c->size != 0)
+		return;
+	idx = (u32)(p - c->base) / c->size;
+
+	/* counted out before it can be taken again, so in_use never
+	   exceeds the blocks of the class */
+	__atomic_sub_fetch(&c->in_use, 1, __ATOMIC_RELAXED);
+	old = __atomic_load_n(&c->head, __ATOMIC_RELAXED);
+	do {
+		*link_of(c, idx) = old & 0xFFFF;
+		new = ((old + TAG_ONE) & ~0xFFFFu) | idx;
+	} while (!__atomic_compare_exchange_n(&c->head, &old, new, true,
+					      __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void pool_stats(u32 class, pool_stats_t *stats) {
+	pool_class_t *c;
+
+	if (class >= POOL_CLASSES)
+		return;
+	c = &classes[class];
+	stats->size = c->size;
+	stats->blocks = c->blocks;
+	stats->in_use = c->in_use;
+	stats->high_water = c->high_water;
+	stats->allocs = c->allocs;
+	stats->fails = c->fails;
+}
@@ -0,0 +1,76 @@
+/*
+ * pool.h -- fixed block allocator for messages, records and frames
+ *
+ * malloc() in the standalone BSP grows the heap through _sbrk() and
+ * newlib's allocator, so how long a call takes and how the heap breaks
+ * up depends on everything allocated before it. Here memory comes from
+ * a region of its own in lscript.ld (.pool, _POOL_SIZE bytes), cut at
+ * pool_init() into a fixed number of blocks per size class:
+ *
+ *   class   32   64  128  256  512  1024  2048  4096
+ *   blocks 256  128   64   32   16     8     6     1
+ *
+ * The 4096 byte block is the one tslog.h stages its sealed blocks in.
+ *
+ * pool_alloc() takes a block of the smallest class that fits and
+ * pool_free() puts it back, both in constant time. A class that runs
+ * dry does not borrow from a larger one or from the heap: the call
+ * returns NULL at once and the failure is counted, so a leak or an
+ * undersized class shows up in pool_stats() rather than as a slow
+ * drift. The high water mark of each class tells how far its count
+ * can be trimmed.
+ *
+ * The free lists are lock-free, so blocks can be taken and returned
+ * from interrupt handlers as well as from the main loop.
+ *
+ *   pool_init();
+ *   msg = pool_alloc(sizeof(*msg));
+ *   if (msg == NULL)
+ *       return XST_FAILURE;
+ *   ...
+ *   pool_free(msg);
+ */
+#pragma once
+
+#include "xil_types.h"
+
+#define POOL_CLASSES   8
+#define POOL_MIN       32    /* smallest block, one cache line */
+#define POOL_MAX       4096  /* largest block, a tsblock.h block */
+
+typedef struct {
+	u32 size;           /* block size */
+	u32 blocks;         /* blocks in the class */
+	u32 in_use;
+	u32 high_water;     /* most blocks ever in use at once */
+	u32 allocs;
+	u32 fails;          /* allocations refused with the class empty */
+} pool_stats_t;
+
+/*
+ * pool_init -- cut the .pool region into the blocks of every class
+ *
+ * returns XST_SUCCESS on success; otherwise XST_FAILURE when the classes
+ * do not fit in _POOL_SIZE
+ */
+s32 pool_init(void);
+
+/*
+ * pool_alloc -- take a block of at least size bytes, aligned to its size
+ * up to 32 bytes
+ *
+ * returns NULL for a size of 0 or above POOL_MAX, or when the class is
+ * empty
+ */
+void *pool_alloc(u32 size);
+
+/*
+ * pool_free -- return a block from pool_alloc(); NULL is ignored
+ */
+void pool_free(void *block);
+
+/*
+ * pool_stats -- read the counters of class (0 for POOL_MIN bytes up to
+ * POOL_CLASSES - 1)
+ */
+void pool_stats(u32 class, pool_stats_t *stats);
@@ -0,0 +1,186 @@
+/*
+ * prof.c -- statistical sampling profiler
+ */
+#include <stdbool.h>
+#include "prof.h"
+#include "xparameters.h"
+#include "xscutimer.h"
+#include "gic.h"
+
+#define TIMER_HZ (XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ / 2)  /* PERIPHCLK */
+
+/* from lscript.ld and asm_vectors.S */
+extern u32 __irq_stack[];
+extern u32 _irq_stack_end[];
+extern u32 _stack_end[];
+extern u32 __stack[];
+extern u32 _vector_table[];
+extern u32 __rodata_start[];
+
+static XScuTimer timer;
+static bool timer_ready;
+static prof_sample_t ring[PROF_SAMPLES];
+static volatile u32 r_head, r_tail;  /* written by the interrupt, read by main */
+static prof_stats_t stats;
+
+static inline bool in_text(u32 addr) {
+	return addr >= (u32)(UINTPTR)_vector_table && addr < (u32)(UINTPTR)__rodata_start &&
+	       (addr & 3) == 0;
+}
+
+static inline bool in_stack(u32 addr) {
+	return addr >= (u32)(UINTPTR)_stack_end && addr < (u32)(UINTPTR)__stack &&
+	       (addr & 3) == 0;
+}
+
+static inline bool in_irq_stack(u32 addr) {
+	return addr >= (u32)(UINTPTR)_irq_stack_end && addr < (u32)(UINTPTR)__irq_stack;
+}
+
+/*
+ * the stack pointer and link register of the interrupted SYS mode code
+ */
+static inline void sys_regs(u32 *sp, u32 *lr) {
+#if defined(__arm__)
+	u32 cpsr;
+
+	__asm__ __volatile__(
+		"mrs %0, cpsr\n\t"
+		"cps #0x1F\n\t"
+		"mov %1, sp\n\t"
+		"mov %2, lr\n\t"
+		"msr cpsr_c, %0"
+		: "=&r" (cpsr), "=&r" (*sp), "=&r" (*lr) : : "memory");
+#else
+	*sp = 0;
+	*lr = 0;
+#endif
+}
+
+/*
+ * fill pc[] with the interrupted PC and the return addresses above it;
+ * fp is the frame of the interrupt handler
+ *
+ * returns the number of entries
+ */
+static u32 walk(u32 *pc, u32 fp) {
+	u32 n = 0, hops, sp, lr, next, ret;
+
+	/* IRQHandler pushed {r0-r3, r12, lr} first; lr is the PC + 4 */
+	pc[n++] = __irq_stack[-1] - 4;
+	sys_regs(&sp, &lr);
+
+	/* leave the frames of the interrupt path on the IRQ stack; what
+	   remains in fp is the interrupted code's own */
+	for (hops = 0; hops < 8 && in_irq_stack(fp); hops++)
+		fp = ((u32 *)(UINTPTR)fp)[-1];
+	if (!in_stack(fp) || fp < sp)
+		return n;
+
+	/* GCC in ARM mode points fp at the saved lr, with the caller's fp
+	   below it; a leaf function saves only fp, and its return address
+	   is still in lr */
+	next = ((u32 *)(UINTPTR)fp)[0];
+	if (!in_text(next) && in_stack(next) && next > fp) {
+		if (!in_text(lr))
+			return n;
+		pc[n++] = lr;
+		fp = next;
+	}
+	while (n < PROF_DEPTH) {
+		ret = ((u32 *)(UINTPTR)fp)[0];
+		next = ((u32 *)(UINTPTR)fp)[-1];
+		if (!in_text(ret))
+			break;
+		pc[n++] = ret;
+		if (!in_stack(next) || next <= fp)
+			break;
+		fp = next;
+	}
+	return n;
+}
+
+static void prof_isr(void *ref) {
+	u32 head = r_head, n, i;
+	prof_sample_t *s;
+
+	XScuTimer_ClearInterruptStatus((XScuTimer *)ref);
+	stats.samples++;
+	if (head - __atomic_load_n(&r_tail, __ATOMIC_ACQUIRE) == PROF_SAMPLES) {
+		stats.dropped++;
+		return;
+	}
+	s = &ring[head & (PROF_SAMPLES - 1)];
+	n = walk(s->pc, (u32)(UINTPTR)__builtin_frame_address(0));
+	for (i = n; i < PROF_DEPTH; i++)
+		s->pc[i] = 0;
+	stats.frames += n - 1;
+	__atomic_store_n(&r_head, head + 1, __ATOMIC_RELEASE);
+}
+
+s32 prof_start(u32 hz) {
+	XScuTimer_Config *config;
+
+	if (hz == 0 || hz > TIMER_HZ)
+		return XST_FAILURE;
+	if (!timer_ready) {
+		config = XScuTimer_LookupConfig(XPAR_XSCUTIMER_0_DEVICE_ID);
+		if (config == NULL ||
+		    XScuTimer_CfgInitialize(&timer, config, config->BaseAddr) != XST_SUCCESS)
+			return XST_FAILURE;
+		if (gic_connect(XPAR_SCUTIMER_INTR, prof_isr, &timer) != XST_SUCCESS)
+			return XST_FAILURE;
+		timer_ready = true;
+	}
+	XScuTimer_Stop(&timer);
+	XScuTimer_LoadTimer(&timer, TIMER_HZ / hz - 1);
+	XScuTimer_EnableAutoReload(&timer);
+	XScuTimer_ClearInterruptStatus(&timer);
+	XScuTimer_EnableInterrupt(&timer);
+	stats.hz = hz;
+	XScuTimer_Start(&timer);
+	return XST_SUCCESS;
+}
+
+void prof_stop(void) {
+	if (timer_ready) {
+		XScuTimer_Stop(&timer);
+		XScuTimer_DisableInterrupt(&timer);
+	}
+}
+
+static const fmt_desc_t header_fmt[] = {
+	FMT_LIT("# prof hz "), FMT_U(0), FMT_LIT(" depth "), FMT_U(0),
+	FMT_LIT(" samples "), FMT_U(0), FMT_LIT(" dropped "), FMT_U(0),
+	FMT_LIT("\r\n"), FMT_END
+};
+
+static const fmt_desc_t addr_fmt[] = {
+	FMT_X0(8), FMT_END
+};
+
+u32 prof_dump(fmt_sink_t *sink) {
+	u32 tail = r_tail, head = __atomic_load_n(&r_head, __ATOMIC_ACQUIRE);
+	u32 count = head - tail, i;
+	const prof_sample_t *s;
+
+	fmt_out(sink, header_fmt, stats.hz, (u32)PROF_DEPTH, count, stats.dropped);
+	for (; tail != head; tail++) {
+		s = &ring[tail & (PROF_SAMPLES - 1)];
+		for (i = 0; i < PROF_DEPTH && s->pc[i] != 0; i++) {
+			if (i != 0)
+				fmt_puts(sink, " ");
+			fmt_out(sink, addr_fmt, s->pc[i]);
+		}
+		fmt_puts(sink, "\r\n");
+		/* hand the slot back as soon as it is written out */
+		__atomic_store_n(&r_tail, tail + 1, __ATOMIC_RELEASE);
+	}
+	fmt_flush(sink);
+	stats.dumped += count;
+	return count;
+}
+
+void prof_stats(prof_stats_t *out) {
+	*out = stats;
+}
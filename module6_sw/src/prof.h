@@ -0,0 +1,78 @@
+/*
+ * prof.h -- statistical sampling profiler
+ *
+ * The BSP's profile/ code only feeds gprof through XSDB, so it needs a
+ * JTAG cable on the board. Here the SCU private timer interrupts the
+ * core prof_start() times a second and each interrupt records where
+ * the main loop was: the interrupted PC and a few return addresses
+ * from the frame pointer chain, innermost first.
+ *
+ * The PC is the return address IRQHandler (asm_vectors.S) saves first
+ * on the IRQ stack; interrupts do not nest in the BSP, so it is always
+ * the top word. The stack comes from walking the frame pointers of the
+ * SYS mode stack the main loop runs on. Every frame is checked to lie
+ * above the last one and inside the stack, and every return address to
+ * lie in the code, so a function without a frame (a build without
+ * -fno-omit-frame-pointer, or a sample taken in a prologue) cuts the
+ * stack short rather than producing junk. The Debug build (-O0, ARM
+ * mode) always has frame pointers.
+ *
+ * Samples go into a ring the interrupt fills and prof_dump() drains, so
+ * the interrupt never waits on the export. A full ring drops samples
+ * and counts them.
+ *
+ * The profile is written as text through a fmt sink: fmt_console for
+ * the UART, or a sink whose write function appends to a file on SD.
+ * tools/profsym turns it into folded stacks for flamegraph.pl:
+ *
+ *   prof_start(PROF_HZ);
+ *   ...
+ *   prof_dump(&fmt_console);
+ *
+ *   profsym -e module6_sw.elf capture.txt | flamegraph.pl > prof.svg
+ */
+#pragma once
+
+#include "xil_types.h"
+#include "fmt.h"
+
+#define PROF_HZ        1000
+#define PROF_DEPTH     8      /* the PC and up to 7 return addresses */
+#define PROF_SAMPLES   1024   /* a power of two */
+
+typedef struct {
+	u32 pc[PROF_DEPTH]; /* innermost first, 0 past the end of the stack */
+} prof_sample_t;
+
+typedef struct {
+	u32 hz;
+	u32 samples;        /* taken */
+	u32 dropped;        /* lost to a full ring */
+	u32 frames;         /* return addresses recorded, over all samples */
+	u32 dumped;         /* written out by prof_dump() */
+} prof_stats_t;
+
+/*
+ * prof_start -- sample hz times a second
+ *
+ * returns XST_SUCCESS on success; otherwise XST_FAILURE
+ */
+s32 prof_start(u32 hz);
+
+/*
+ * prof_stop -- stop sampling; the samples not dumped yet are kept
+ */
+void prof_stop(void);
+
+/*
+ * prof_dump -- write the samples taken since the last dump to sink,
+ * a header line and one line of hex addresses per sample, and flush it
+ *
+ * returns the number of samples written
+ */
+u32 prof_dump(fmt_sink_t *sink);
+
+/*
+ * prof_stats -- read the counters
+ */
+void prof_stats(prof_stats_t *stats);
@@ -9,6 +9,7 @@
  */
 
 #include "servo.h"
+#include "metrics.h"
 
 #define PERIOD 1000000             /* s_axi_aclk = 50MHz -- 20ms period = 1x10^6 * 1/(50*10^-9) */
 
@@ -39,17 +40,26 @@ void servo_init(void) {
 
 
 void servo_set(double dutycycle) {
+	static bool closed;
 	u32 thigh;
 
 	if(dutycycle < MIN) {
 		dutycycle = MIN;
 		printf("\n[ERROR: minimum limit exceeded]\n");
+		met_inc(MET_SERVO_CLAMP_MIN);
 	}
 
 	if(dutycycle > MAX) {
 		dutycycle = MAX;
 		printf("\n[ERROR: maximum limit exceeded]\n");
+		met_inc(MET_SERVO_CLAMP_MAX);
 	}
+	if((dutycycle < MID) != closed) {
+		closed = !closed;
+		if(closed)
+			met_inc(MET_GATE_CYCLES);
+	}
+	met_set(MET_SERVO_DUTY, (s32)(dutycycle * 100));
 	thigh = (u32)(dutycycle*(PERIOD/100));
 	XTmrCtr_Stop(&tmr,0);
 	XTmrCtr_Stop(&tmr,1);
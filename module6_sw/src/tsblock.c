@@ -0,0 +1,199 @@
+/*
+ * tsblock.c -- compressed columnar blocks of substation UPDATE history
+ */
+#include <stddef.h>
+#include <string.h>
+#include "tsblock.h"
+
+static u32 crc_table[256];
+
+static inline u64 zigzag(s64 v) {
+	return ((u64)v << 1) ^ (u64)(v >> 63);
+}
+
+static inline s64 unzigzag(u64 v) {
+	return (s64)(v >> 1) ^ -(s64)(v & 1);
+}
+
+static inline u32 varint_len(u64 v) {
+	u32 n = 1;
+
+	while (v >= 0x80) {
+		v >>= 7;
+		n++;
+	}
+	return n;
+}
+
+static inline u8 *put_varint(u8 *p, u64 v) {
+	while (v >= 0x80) {
+		*p++ = (u8)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (u8)v;
+	return p;
+}
+
+/* NULL past end or on an overlong encoding */
+static inline const u8 *get_varint(const u8 *p, const u8 *end, u64 *v) {
+	u64 r = 0;
+	u32 shift;
+
+	for (shift = 0; p < end && shift < 64; shift += 7) {
+		u8 b = *p++;
+
+		r |= (u64)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) {
+			*v = r;
+			return p;
+		}
+	}
+	return NULL;
+}
+
+void ts_builder_reset(ts_builder_t *b, u32 unit, u32 boot) {
+	memset(&b->hdr, 0, sizeof(b->hdr));
+	b->hdr.magic = TS_MAGIC;
+	b->hdr.columns = TS_COLUMNS;
+	b->hdr.unit = unit;
+	b->hdr.boot = boot;
+	b->bytes = 0;
+	b->last_delta = 0;
+}
+
+bool ts_builder_add(ts_builder_t *b, u64 t, const s32 *values) {
+	u32 n = b->hdr.rows, bytes = b->bytes, c;
+	s64 delta = 0;
+
+	if (n == TS_ROWS_MAX)
+		return false;
+	if (n > 0) {
+		delta = (s64)(t - b->t[n - 1]);
+		bytes += varint_len(zigzag(delta - b->last_delta));
+		for (c = 0; c < TS_COLUMNS; c++)
+			bytes += varint_len(zigzag((s64)values[c] - b->v[n - 1][c]));
+	} else {
+		for (c = 0; c < TS_COLUMNS; c++)
+			bytes += varint_len(zigzag(values[c]));
+	}
+	if (bytes > TS_PAYLOAD)
+		return false;
+
+	b->t[n] = t;
+	memcpy(b->v[n], values, sizeof(b->v[n]));
+	for (c = 0; c < TS_COLUMNS; c++) {
+		if (n == 0 || values[c] < b->hdr.min[c])
+			b->hdr.min[c] = values[c];
+		if (n == 0 || values[c] > b->hdr.max[c])
+			b->hdr.max[c] = values[c];
+	}
+	if (n == 0)
+		b->hdr.t_first = t;
+	b->hdr.t_last = t;
+	b->hdr.rows = n + 1;
+	b->last_delta = delta;
+	b->bytes = bytes;
+	return true;
+}
+
+u32 ts_builder_seal(ts_builder_t *b, u8 *block) {
+	ts_header_t *h = &b->hdr;
+	u8 *payload = block + sizeof(ts_header_t), *p = payload;
+	s64 delta, prev_delta = 0;
+	u32 r, c;
+
+	memset(block, 0, TS_BLOCK_SIZE);
+	h->offset[0] = 0;
+	for (r = 1; r < h->rows; r++) {
+		delta = (s64)(b->t[r] - b->t[r - 1]);
+		p = put_varint(p, zigzag(delta - prev_delta));
+		prev_delta = delta;
+	}
+	for (c = 0; c < TS_COLUMNS; c++) {
+		h->offset[1 + c] = (u16)(p - payload);
+		if (h->min[c] == h->max[c])
+			continue;
+		p = put_varint(p, zigzag(b->v[0][c]));
+		for (r = 1; r < h->rows; r++)
+			p = put_varint(p, zigzag((s64)b->v[r][c] - b->v[r - 1][c]));
+	}
+	h->offset[1 + TS_COLUMNS] = (u16)(p - payload);
+	h->length = (u32)(p - payload);
+	h->crc = 0;
+	memcpy(block, h, sizeof(*h));
+	h->crc = ts_crc32(0, block, TS_BLOCK_SIZE);
+	memcpy(block + offsetof(ts_header_t, crc), &h->crc, sizeof(h->crc));
+	return h->rows;
+}
+
+bool ts_block_check(const u8 *block) {
+	const ts_header_t *h = (const ts_header_t *)block;
+	u32 zero = 0, crc;
+
+	if (h->magic != TS_MAGIC || h->columns != TS_COLUMNS || h->rows == 0 ||
+	    h->rows > TS_ROWS_MAX || h->length > TS_PAYLOAD ||
+	    h->offset[1 + TS_COLUMNS] != h->length)
+		return false;
+	crc = ts_crc32(0, block, offsetof(ts_header_t, crc));
+	crc = ts_crc32(crc, &zero, sizeof(zero));
+	crc = ts_crc32(crc, block + offsetof(ts_header_t, crc) + sizeof(zero),
+		       TS_BLOCK_SIZE - offsetof(ts_header_t, crc) - sizeof(zero));
+	return crc == h->crc;
+}
+
+u32 ts_block_times(const u8 *block, u64 *t) {
+	const ts_header_t *h = (const ts_header_t *)block;
+	const u8 *p = block + sizeof(*h) + h->offset[0];
+	const u8 *end = block + sizeof(*h) + h->offset[1];
+	s64 delta = 0;
+	u64 z;
+	u32 r;
+
+	t[0] = h->t_first;
+	for (r = 1; r < h->rows; r++) {
+		if ((p = get_varint(p, end, &z)) == NULL)
+			return r;
+		delta += unzigzag(z);
+		t[r] = t[r - 1] + (u64)delta;
+	}
+	return r;
+}
+
+u32 ts_block_column(const u8 *block, u32 c, s32 *v) {
+	const ts_header_t *h = (const ts_header_t *)block;
+	const u8 *p = block + sizeof(*h) + h->offset[1 + c];
+	const u8 *end = block + sizeof(*h) + h->offset[2 + c];
+	s64 x = 0;
+	u64 z;
+	u32 r;
+
+	if (p == end) {
+		for (r = 0; r < h->rows; r++)
+			v[r] = h->min[c];
+		return r;
+	}
+	for (r = 0; r < h->rows; r++) {
+		if ((p = get_varint(p, end, &z)) == NULL)
+			return r;
+		x += unzigzag(z);
+		v[r] = (s32)x;
+	}
+	return r;
+}
+
+u32 ts_crc32(u32 crc, const void *data, u32 len) {
+	const u8 *p = data;
+	u32 i, j, k;
+
+	if (crc_table[1] == 0) {
+		for (i = 0; i < 256; i++) {
+			for (k = i, j = 0; j < 8; j++)
+				k = (k & 1) ? (k >> 1) ^ 0xEDB88320 : k >> 1;
+			crc_table[i] = k;
+		}
+	}
+	crc = ~crc;
+	while (len--)
+		crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
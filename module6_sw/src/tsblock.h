@@ -0,0 +1,110 @@
+/*
+ * tsblock.h -- compressed columnar blocks of substation UPDATE history
+ *
+ * One row is an UPDATE response: a millisecond timestamp and 31 columns,
+ * the average and values[30]. Rows are collected into fixed size blocks,
+ * TS_BLOCK_SIZE bytes, laid out column by column:
+ *
+ *   header     unit, boot, row count, first and last timestamp, CRC
+ *   offsets    where each column starts in the payload
+ *   index      min and max of every value column
+ *   payload    timestamps, then column 0 (average) .. column 30
+ *
+ * Timestamps are stored as delta-of-delta and values as deltas from the
+ * row before, both zigzag varints. A steady update rate makes most
+ * timestamps one byte, and slowly moving values one byte each. A
+ * column that is constant over the block takes no payload at all; its
+ * min is the value.
+ *
+ * A reader skips blocks on the header alone: the time range, the unit
+ * and the index answer "was any value of column c between a and b" for
+ * the whole block. It decodes only the columns it needs.
+ *
+ * This file is the codec only, shared by the board (tslog.c, which
+ * writes the blocks through xilffs) and tools/tsread on the host. Blocks
+ * are little endian, as both ends are.
+ *
+ *   ts_builder_reset(&b, unit, boot);
+ *   while (!ts_builder_add(&b, t, values))
+ *       write(ts_builder_seal(&b, block)), ts_builder_reset(&b, unit, boot);
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+
+#define TS_BLOCK_SIZE   4096     /* 8 sectors */
+#define TS_COLUMNS      31       /* average, values[0..29] */
+#define TS_ROWS_MAX     128
+#define TS_MAGIC        0x31425354  /* "TSB1" */
+
+typedef struct {
+	u32 magic;
+	u16 rows;
+	u16 columns;                    /* TS_COLUMNS */
+	u32 unit;                       /* the responder's id */
+	u32 boot;                       /* board boots since the log began */
+	u64 t_first;                    /* ms since that boot */
+	u64 t_last;
+	u32 length;                     /* payload bytes */
+	u32 crc;                        /* CRC-32 of the block, taken as 0 */
+	u16 offset[TS_COLUMNS + 2];     /* [0] timestamps, [1 + c] column c, end */
+	s32 min[TS_COLUMNS];
+	s32 max[TS_COLUMNS];
+} ts_header_t;
+
+#define TS_PAYLOAD (TS_BLOCK_SIZE - sizeof(ts_header_t))
+
+typedef struct {
+	ts_header_t hdr;
+	u64 t[TS_ROWS_MAX];
+	s32 v[TS_ROWS_MAX][TS_COLUMNS];
+	u32 bytes;                      /* payload bound of the rows so far */
+	s64 last_delta;
+} ts_builder_t;
+
+/*
+ * ts_builder_reset -- start an empty block
+ */
+void ts_builder_reset(ts_builder_t *b, u32 unit, u32 boot);
+
+/*
+ * ts_builder_add -- add a row at t ms with TS_COLUMNS values
+ *
+ * returns false, and leaves the block as it was, when the row does not
+ * fit; the block is then sealed and a new one started
+ */
+bool ts_builder_add(ts_builder_t *b, u64 t, const s32 *values);
+
+/*
+ * ts_builder_seal -- encode the rows added into block, TS_BLOCK_SIZE bytes
+ *
+ * returns the number of rows
+ */
+u32 ts_builder_seal(ts_builder_t *b, u8 *block);
+
+/*
+ * ts_block_check -- whether block holds a block with a good CRC
+ */
+bool ts_block_check(const u8 *block);
+
+/*
+ * ts_block_times -- decode the timestamps of block into t, one per row;
+ * block has passed ts_block_check()
+ *
+ * returns the number of rows
+ */
+u32 ts_block_times(const u8 *block, u64 *t);
+
+/*
+ * ts_block_column -- decode value column c of block into v, one per row;
+ * block has passed ts_block_check()
+ *
+ * returns the number of rows
+ */
+u32 ts_block_column(const u8 *block, u32 c, s32 *v);
+
+/*
+ * ts_crc32 -- CRC-32 (IEEE) of len bytes, continuing from crc (0 to start)
+ */
+u32 ts_crc32(u32 crc, const void *data, u32 len);
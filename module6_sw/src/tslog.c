@@ -0,0 +1,106 @@
+/*
+ * tslog.c -- append-only UPDATE history on SD
+ */
+#include "tslog.h"
+#include "pool.h"
+#include "xstatus.h"
+
+#define BOOT_SEARCH 8   /* blocks searched back for the last good one */
+
+/*
+ * the boot number of the last good block in the first whole bytes of
+ * the file, or 0 if there is none
+ */
+static u32 last_boot(FIL *file, FSIZE_t whole, u8 *block) {
+	FSIZE_t pos = whole;
+	UINT br;
+	u32 n;
+
+	for (n = 0; n < BOOT_SEARCH && pos >= TS_BLOCK_SIZE; n++) {
+		pos -= TS_BLOCK_SIZE;
+		if (f_lseek(file, pos) != FR_OK ||
+		    f_read(file, block, TS_BLOCK_SIZE, &br) != FR_OK || br != TS_BLOCK_SIZE)
+			return 0;
+		if (ts_block_check(block))
+			return ((const ts_header_t *)block)->boot + 1;
+	}
+	return 0;
+}
+
+s32 tslog_open(tslog_t *log, const char *path) {
+	FSIZE_t size, whole;
+
+	log->open = false;
+	log->blocks = 0;
+	log->rows = 0;
+	log->errors = 0;
+	log->block = pool_alloc(TS_BLOCK_SIZE);
+	if (log->block == NULL)
+		return XST_FAILURE;
+	if (f_open(&log->file, path, FA_READ | FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) {
+		pool_free(log->block);
+		return XST_FAILURE;
+	}
+	size = f_size(&log->file);
+	whole = size - size % TS_BLOCK_SIZE;
+	log->boot = last_boot(&log->file, whole, log->block);
+	/* cut off a block torn by a power loss */
+	if (f_lseek(&log->file, whole) != FR_OK ||
+	    (whole != size && f_truncate(&log->file) != FR_OK)) {
+		f_close(&log->file);
+		pool_free(log->block);
+		return XST_FAILURE;
+	}
+	ts_builder_reset(&log->b, 0, log->boot);
+	log->open = true;
+	return XST_SUCCESS;
+}
+
+s32 tslog_flush(tslog_t *log) {
+	FSIZE_t end;
+	UINT bw;
+	s32 status = XST_SUCCESS;
+
+	if (!log->open || log->b.hdr.rows == 0)
+		return XST_SUCCESS;
+	end = f_tell(&log->file);
+	ts_builder_seal(&log->b, log->block);
+	if (f_write(&log->file, log->block, TS_BLOCK_SIZE, &bw) != FR_OK || bw != TS_BLOCK_SIZE ||
+	    f_sync(&log->file) != FR_OK) {
+		/* drop the block, and whatever part of it made it to the file */
+		log->errors++;
+		if (f_lseek(&log->file, end) == FR_OK)
+			f_truncate(&log->file);
+		status = XST_FAILURE;
+	} else {
+		log->blocks++;
+	}
+	ts_builder_reset(&log->b, log->b.hdr.unit, log->boot);
+	return status;
+}
+
+s32 tslog_append(tslog_t *log, u32 unit, u64 t, const s32 *values) {
+	s32 status = XST_SUCCESS;
+
+	if (!log->open)
+		return XST_FAILURE;
+	if (log->b.hdr.rows > 0 && log->b.hdr.unit != unit)
+		status = tslog_flush(log);
+	log->b.hdr.unit = unit;
+	if (!ts_builder_add(&log->b, t, values)) {
+		status = tslog_flush(log);
+		log->b.hdr.unit = unit;
+		ts_builder_add(&log->b, t, values);
+	}
+	log->rows++;
+	return status;
+}
+
+void tslog_close(tslog_t *log) {
+	if (!log->open)
+		return;
+	tslog_flush(log);
+	f_close(&log->file);
+	pool_free(log->block);
+	log->open = false;
+}
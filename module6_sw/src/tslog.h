@@ -0,0 +1,78 @@
+/*
+ * tslog.h -- append-only UPDATE history on SD
+ *
+ * Keeps every UPDATE response in a file of tsblock.h blocks written
+ * through xilffs, so months of values per unit can be pulled off the
+ * card after an incident and scanned with tools/tsread.
+ *
+ * Rows collect in RAM until a block is full, then the block is written
+ * with one f_write() at a block aligned offset (eight sectors, a single
+ * multi-block command) and f_sync()ed. A power loss costs the rows of the
+ * block being filled and nothing before it. tslog_flush() writes a part
+ * full block early, at the cost of the space it leaves empty.
+ *
+ * Timestamps are milliseconds since boot. Every time the log is opened the
+ * boot number is one more than that of the last block in the file, so
+ * (boot, t) orders the rows across power cycles. A torn block at the end
+ * of the file is cut off on open.
+ *
+ *   f_mount(&fs, "0:/", 1);
+ *   tslog_open(&history, "0:/HISTORY.TSL");
+ *   ...
+ *   tslog_append(&history, resp->id, now_ms, columns);
+ *   ...
+ *   tslog_close(&history);
+ *
+ * The sealed block is staged in a TS_BLOCK_SIZE block taken from the
+ * pool (pool.h) while the log is open, so a board without a card does
+ * not carry it; pool_init() has to have run before tslog_open().
+ *
+ * All calls are made from the main loop.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+#include "ff.h"
+#include "tsblock.h"
+
+typedef struct {
+	FIL file;
+	ts_builder_t b;
+	u8 *block;          /* sealed blocks go from here to the card by DMA,
+	                       past ff.c; a pool block, so aligned */
+	bool open;
+	u32 boot;
+	u32 blocks;         /* written since open */
+	u32 rows;           /* appended since open */
+	u32 errors;         /* failed writes, the block is dropped */
+} tslog_t;
+
+/*
+ * tslog_open -- open or create the log at path on a mounted volume
+ *
+ * returns XST_SUCCESS on success; otherwise XST_FAILURE, also when the
+ * pool has no block left for it
+ */
+s32 tslog_open(tslog_t *log, const char *path);
+
+/*
+ * tslog_append -- add a row for unit at t ms with TS_COLUMNS values,
+ * writing out the block when it is full or the unit changes
+ *
+ * returns XST_SUCCESS on success; otherwise XST_FAILURE if a block
+ * write failed
+ */
+s32 tslog_append(tslog_t *log, u32 unit, u64 t, const s32 *values);
+
+/*
+ * tslog_flush -- write the rows collected so far as a block
+ *
+ * returns XST_SUCCESS on success; otherwise XST_FAILURE
+ */
+s32 tslog_flush(tslog_t *log);
+
+/*
+ * tslog_close -- flush and close the log
+ */
+void tslog_close(tslog_t *log);
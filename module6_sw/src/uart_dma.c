@@ -0,0 +1,336 @@
+/*
+ * uart_dma.c -- bulk UART transfers through the PS DMA controller (PL330)
+ */
+#include <string.h>
+#include "uart_dma.h"
+#include "xparameters.h"
+#include "xil_io.h"
+#include "xil_exception.h"
+#include "dma_mem.h"
+#include "xuartps_hw.h"
+#include "gic.h"
+
+#define DMA_DEVICE_ID  XPAR_XDMAPS_1_DEVICE_ID /* the secure DMAC */
+#define RX_CHUNK       32  /* bytes per receive program, under the 64 byte FIFO */
+#define TX_PIECES      8   /* segments one transmit program may cover */
+#define CACHE_LINE     32
+
+#define UART_RX_DATA_IXR (XUARTPS_IXR_RXOVR | XUARTPS_IXR_RXEMPTY | \
+			  XUARTPS_IXR_RXFULL | XUARTPS_IXR_TOUT)
+
+/*
+ * PL330 instructions (DDI 0424, section 4.3) and channel control
+ * fields. Every transfer here is single bytes, burst length one, so
+ * only the increment bits of CCR are set
+ */
+#define DMA_MOV_SAR   0
+#define DMA_MOV_CCR   1
+#define DMA_MOV_DAR   2
+#define DMA_CCR_SRC_INC 0x00000001u
+#define DMA_CCR_DST_INC 0x00004000u
+
+static XDmaPs dma;
+static bool dma_ready;
+static uart_dma_t *chan_owner[XDMAPS_CHANNELS_PER_DEV];
+
+static const Xil_InterruptHandler done_isr[XDMAPS_CHANNELS_PER_DEV] = {
+	(Xil_InterruptHandler)XDmaPs_DoneISR_0, (Xil_InterruptHandler)XDmaPs_DoneISR_1,
+	(Xil_InterruptHandler)XDmaPs_DoneISR_2, (Xil_InterruptHandler)XDmaPs_DoneISR_3,
+	(Xil_InterruptHandler)XDmaPs_DoneISR_4, (Xil_InterruptHandler)XDmaPs_DoneISR_5,
+	(Xil_InterruptHandler)XDmaPs_DoneISR_6, (Xil_InterruptHandler)XDmaPs_DoneISR_7
+};
+
+static const u32 done_irq[XDMAPS_CHANNELS_PER_DEV] = {
+	XPAR_XDMAPS_0_DONE_INTR_0, XPAR_XDMAPS_0_DONE_INTR_1,
+	XPAR_XDMAPS_0_DONE_INTR_2, XPAR_XDMAPS_0_DONE_INTR_3,
+	XPAR_XDMAPS_0_DONE_INTR_4, XPAR_XDMAPS_0_DONE_INTR_5,
+	XPAR_XDMAPS_0_DONE_INTR_6, XPAR_XDMAPS_0_DONE_INTR_7
+};
+
+static u8 *op_mov(u8 *p, u32 rd, u32 imm) {
+	p[0] = 0xBC;
+	p[1] = (u8)rd;
+	p[2] = (u8)imm;
+	p[3] = (u8)(imm >> 8);
+	p[4] = (u8)(imm >> 16);
+	p[5] = (u8)(imm >> 24);
+	return p + 6;
+}
+
+/* DMALP lc0 n; DMALD; DMAST; DMALPEND lc0, n from 1 to 256 */
+static u8 *op_copy_loop(u8 *p, u32 n) {
+	p[0] = 0x20;
+	p[1] = (u8)(n - 1);
+	p[2] = 0x04;
+	p[3] = 0x08;
+	p[4] = 0x38;
+	p[5] = 2;
+	return p + 6;
+}
+
+/* DMAWMB; DMASEV chan; DMAEND */
+static u8 *op_finish(u8 *p, u32 chan) {
+	p[0] = 0x13;
+	p[1] = 0x34;
+	p[2] = (u8)(chan << 3);
+	p[3] = 0x00;
+	return p + 4;
+}
+
+static s32 prog_start(u32 chan, XDmaPs_Cmd *cmd, u8 *prog, u8 *end) {
+	dma_mem_clean(prog, (u32)(end - prog));
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->UserDmaProg = prog;
+	cmd->UserDmaProgLength = (int)(end - prog);
+	return XDmaPs_Start(&dma, chan, cmd, 0);
+}
+
+static void tx_finish(uart_dma_t *ud, s32 status) {
+	ud->tx_busy = 0;
+	__atomic_store_n(&ud->tx_pending, 0, __ATOMIC_RELEASE);
+	if (ud->tx_done != NULL)
+		ud->tx_done(ud->tx_ref, ud->tx_bytes, status);
+	uart_tx_kick(ud->q);
+}
+
+/*
+ * the FIFO is empty: start a program moving the next room bytes into it
+ */
+void uart_dma_tx_chunk(uart_dma_t *ud, u32 room) {
+	UINTPTR fifo = ud->q->uart->Config.BaseAddress + XUARTPS_FIFO_OFFSET;
+	u8 *p = ud->tx_prog;
+	u32 pieces, n;
+
+	p = op_mov(p, DMA_MOV_CCR, DMA_CCR_SRC_INC);
+	p = op_mov(p, DMA_MOV_DAR, (u32)fifo);
+	for (pieces = 0; pieces < TX_PIECES && room != 0 && ud->seg < ud->nsegs; pieces++) {
+		const uart_dma_seg_t *s = &ud->segs[ud->seg];
+
+		n = s->len - ud->off < room ? s->len - ud->off : room;
+		if (n != 0) {
+			p = op_mov(p, DMA_MOV_SAR, (u32)(UINTPTR)((const u8 *)s->data + ud->off));
+			p = op_copy_loop(p, n);
+			ud->off += n;
+			ud->tx_bytes += n;
+			room -= n;
+		}
+		if (ud->off == s->len) {
+			ud->seg++;
+			ud->off = 0;
+		}
+	}
+	p = op_finish(p, ud->tx_chan);
+
+	ud->tx_busy = 1;
+	if (prog_start(ud->tx_chan, &ud->tx_cmd, ud->tx_prog, p) != XST_SUCCESS)
+		tx_finish(ud, XST_FAILURE);
+}
+
+static void tx_dma_done(unsigned int chan, XDmaPs_Cmd *cmd, void *ref) {
+	uart_dma_t *ud = ref;
+
+	if (ud->seg == ud->nsegs) {
+		tx_finish(ud, XST_SUCCESS);
+	} else {
+		ud->tx_busy = 0;
+		uart_tx_kick(ud->q);
+	}
+}
+
+/*
+ * set the trigger level to the next chunk and wait for it
+ */
+static void rx_arm(uart_dma_t *ud) {
+	UINTPTR base = ud->q->uart->Config.BaseAddress;
+	u32 left = ud->rx_len - ud->rx_off;
+
+	XUartPs_WriteReg(base, XUARTPS_RXWM_OFFSET, left < RX_CHUNK ? left : RX_CHUNK);
+	XUartPs_WriteReg(base, XUARTPS_ISR_OFFSET, XUARTPS_IXR_RXOVR);
+	XUartPs_WriteReg(base, XUARTPS_IER_OFFSET, XUARTPS_IXR_RXOVR);
+}
+
+static void rx_finish(uart_dma_t *ud, s32 status) {
+	UINTPTR base = ud->q->uart->Config.BaseAddress;
+
+	dma_mem_invalidate(ud->rx_buf, ud->rx_len);
+	XUartPs_WriteReg(base, XUARTPS_IDR_OFFSET, UART_RX_DATA_IXR);
+	XUartPs_WriteReg(base, XUARTPS_RXWM_OFFSET, ud->rx_wm);
+	XUartPs_WriteReg(base, XUARTPS_ISR_OFFSET, UART_RX_DATA_IXR);
+	XUartPs_WriteReg(base, XUARTPS_IER_OFFSET, ud->rx_imr);
+	ud->rx_chunk = 0;
+	ud->rx_cancel = 0;
+	__atomic_store_n(&ud->rx_pending, 0, __ATOMIC_RELEASE);
+	if (ud->rx_done != NULL)
+		ud->rx_done(ud->rx_ref, ud->rx_off, status);
+}
+
+/*
+ * receive interrupts while a receive runs; returns the ones it took
+ */
+u32 uart_dma_rx_isr(uart_dma_t *ud, u32 pending) {
+	UINTPTR base = ud->q->uart->Config.BaseAddress;
+	u8 *p = ud->rx_prog;
+	u32 left;
+
+	if (!ud->rx_pending)
+		return 0;
+	if ((pending & XUARTPS_IXR_RXOVR) && ud->rx_chunk == 0) {
+		left = ud->rx_len - ud->rx_off;
+		ud->rx_chunk = left < RX_CHUNK ? left : RX_CHUNK;
+		XUartPs_WriteReg(base, XUARTPS_IDR_OFFSET, XUARTPS_IXR_RXOVR);
+		XUartPs_WriteReg(base, XUARTPS_ISR_OFFSET, XUARTPS_IXR_RXOVR);
+
+		p = op_mov(p, DMA_MOV_CCR, DMA_CCR_DST_INC);
+		p = op_mov(p, DMA_MOV_SAR, (u32)(base + XUARTPS_FIFO_OFFSET));
+		p = op_mov(p, DMA_MOV_DAR, (u32)(UINTPTR)(ud->rx_buf + ud->rx_off));
+		p = op_copy_loop(p, ud->rx_chunk);
+		p = op_finish(p, ud->rx_chan);
+		if (prog_start(ud->rx_chan, &ud->rx_cmd, ud->rx_prog, p) != XST_SUCCESS) {
+			ud->rx_chunk = 0;
+			rx_finish(ud, XST_FAILURE);
+		}
+	}
+	return pending & UART_RX_DATA_IXR;
+}
+
+static void rx_dma_done(unsigned int chan, XDmaPs_Cmd *cmd, void *ref) {
+	uart_dma_t *ud = ref;
+
+	ud->rx_off += ud->rx_chunk;
+	ud->rx_chunk = 0;
+	if (ud->rx_cancel)
+		rx_finish(ud, XST_TIMEOUT);
+	else if (ud->rx_off == ud->rx_len)
+		rx_finish(ud, XST_SUCCESS);
+	else
+		rx_arm(ud);
+}
+
+static void dma_fault(unsigned int chan, XDmaPs_Cmd *cmd, void *ref) {
+	uart_dma_t *ud = chan_owner[chan];
+
+	if (ud == NULL)
+		return;
+	if (chan == ud->tx_chan && ud->tx_pending)
+		tx_finish(ud, XST_FAILURE);
+	else if (chan == ud->rx_chan && ud->rx_pending)
+		rx_finish(ud, XST_FAILURE);
+}
+
+bool uart_dma_tx_pending(uart_dma_t *ud) {
+	return __atomic_load_n(&ud->tx_pending, __ATOMIC_ACQUIRE) != 0;
+}
+
+bool uart_dma_tx_busy(uart_dma_t *ud) {
+	return ud->tx_busy != 0;
+}
+
+u32 uart_dma_tx_mark(uart_dma_t *ud) {
+	return ud->mark;
+}
+
+s32 uart_dma_init(uart_dma_t *ud, uart_tx_t *q, u32 tx_chan, u32 rx_chan) {
+	XDmaPs_Config *config;
+
+	if (tx_chan >= XDMAPS_CHANNELS_PER_DEV || rx_chan >= XDMAPS_CHANNELS_PER_DEV ||
+	    tx_chan == rx_chan)
+		return XST_FAILURE;
+	if (!dma_ready) {
+		config = XDmaPs_LookupConfig(DMA_DEVICE_ID);
+		if (config == NULL ||
+		    XDmaPs_CfgInitialize(&dma, config, config->BaseAddress) != XST_SUCCESS)
+			return XST_FAILURE;
+		XDmaPs_SetFaultHandler(&dma, dma_fault, NULL);
+		if (gic_connect(XPAR_XDMAPS_0_FAULT_INTR,
+				(Xil_InterruptHandler)XDmaPs_FaultISR, &dma) != XST_SUCCESS)
+			return XST_FAILURE;
+		dma_ready = true;
+	}
+
+	memset(ud, 0, sizeof(*ud));
+	ud->q = q;
+	ud->tx_chan = tx_chan;
+	ud->rx_chan = rx_chan;
+	XDmaPs_SetDoneHandler(&dma, tx_chan, tx_dma_done, ud);
+	XDmaPs_SetDoneHandler(&dma, rx_chan, rx_dma_done, ud);
+	if (gic_connect(done_irq[tx_chan], done_isr[tx_chan], &dma) != XST_SUCCESS ||
+	    gic_connect(done_irq[rx_chan], done_isr[rx_chan], &dma) != XST_SUCCESS)
+		return XST_FAILURE;
+	chan_owner[tx_chan] = ud;
+	chan_owner[rx_chan] = ud;
+	q->dma = ud;
+	return XST_SUCCESS;
+}
+
+s32 uart_dma_send(uart_dma_t *ud, const uart_dma_seg_t *segs, u32 nsegs,
+		uart_dma_done_t done, void *ref) {
+	u32 i;
+
+	if (uart_dma_tx_pending(ud))
+		return XST_DEVICE_BUSY;
+	for (i = 0; i < nsegs; i++)
+		dma_mem_clean(segs[i].data, segs[i].len);
+
+	ud->segs = segs;
+	ud->nsegs = nsegs;
+	ud->seg = 0;
+	ud->off = 0;
+	ud->tx_bytes = 0;
+	ud->tx_done = done;
+	ud->tx_ref = ref;
+	ud->mark = __atomic_load_n(&ud->q->head, __ATOMIC_ACQUIRE);
+	__atomic_store_n(&ud->tx_pending, 1, __ATOMIC_RELEASE);
+	uart_tx_kick(ud->q);
+	return XST_SUCCESS;
+}
+
+s32 uart_dma_recv(uart_dma_t *ud, void *buf, u32 len,
+		uart_dma_done_t done, void *ref) {
+	UINTPTR base = ud->q->uart->Config.BaseAddress;
+	u32 kind = dma_mem_kind(buf);
+
+	if (ud->rx_pending)
+		return XST_DEVICE_BUSY;
+	if (len == 0)
+		return XST_INVALID_PARAM;
+	if (kind != DMA_MEM_UNCACHED && kind != DMA_MEM_WRITE_THROUGH &&
+	    (((UINTPTR)buf | len) & (CACHE_LINE - 1)) != 0)
+		return XST_INVALID_PARAM;
+	dma_mem_invalidate(buf, len);
+
+	ud->rx_buf = buf;
+	ud->rx_len = len;
+	ud->rx_off = 0;
+	ud->rx_chunk = 0;
+	ud->rx_done = done;
+	ud->rx_ref = ref;
+	ud->rx_wm = XUartPs_ReadReg(base, XUARTPS_RXWM_OFFSET);
+	ud->rx_imr = XUartPs_ReadReg(base, XUARTPS_IMR_OFFSET) & UART_RX_DATA_IXR;
+	XUartPs_WriteReg(base, XUARTPS_IDR_OFFSET, UART_RX_DATA_IXR);
+	/* whatever is still in the FIFO belongs to an earlier exchange */
+	while (XUartPs_IsReceiveData(base))
+		(void)XUartPs_ReadReg(base, XUARTPS_FIFO_OFFSET);
+	ud->rx_pending = 1;
+	rx_arm(ud);
+	return XST_SUCCESS;
+}
+
+/*
+ * a program in flight reads bytes already in the FIFO and ends within
+ * microseconds; its done interrupt finishes the receive
+ */
+void uart_dma_rx_cancel(uart_dma_t *ud) {
+	UINTPTR base = ud->q->uart->Config.BaseAddress;
+
+	Xil_ExceptionDisableMask(XIL_EXCEPTION_IRQ);
+	if (ud->rx_pending) {
+		XUartPs_WriteReg(base, XUARTPS_IDR_OFFSET, XUARTPS_IXR_RXOVR);
+		if (ud->rx_chunk == 0)
+			rx_finish(ud, XST_TIMEOUT);
+		else
+			ud->rx_cancel = 1;
+	}
+	Xil_ExceptionEnableMask(XIL_EXCEPTION_IRQ);
+	while (__atomic_load_n(&ud->rx_pending, __ATOMIC_ACQUIRE))
+		;
+}
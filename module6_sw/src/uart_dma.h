@@ -0,0 +1,144 @@
+/*
+ * uart_dma.h -- bulk UART transfers through the PS DMA controller (PL330)
+ *
+ * Pushing a history log or the boot timeline through the FIFO a byte at
+ * a time keeps the CPU busy for seconds at 9600 baud. Here the PL330
+ * moves the bytes between memory and the UART FIFO and the CPU only
+ * writes a short DMA program per FIFO load.
+ *
+ * The PS UARTs have no PL330 peripheral request lines on the Zynq-7000,
+ * so the FIFO paces the transfers through the UART interrupt instead:
+ *
+ *   transmit  every TX empty interrupt starts one DMA program that
+ *             writes the next 64 bytes (a FIFO) into the TX FIFO. The
+ *             program is a chain of load/store loops, one per log
+ *             segment it covers, so a scatter-gather list goes out
+ *             without being gathered into one buffer first.
+ *   receive   the RX trigger level is set to the next chunk (at most
+ *             32 bytes) and the RX trigger interrupt starts a program
+ *             that reads exactly that many bytes out of the FIFO.
+ *
+ * Transmit runs inside a uart_tx queue (uart_tx.h) so bulk data and
+ * queued messages do not interleave: the transfer starts once the
+ * messages queued before it are out, and messages queued after it wait
+ * behind it (and are dropped once the ring fills).
+ *
+ * Segments are cleaned from the data cache before the transfer starts
+ * and a receive buffer is invalidated before and after, so the buffers
+ * can be cached; buffers from the dma_mem.h pools get only the
+ * maintenance their mapping needs. A receive into write-back memory
+ * must start and end on a 32 byte cache line, since the invalidate
+ * would drop the CPU's writes to anything sharing a line with it; one
+ * into the uncached or write-through pools may have any size, as
+ * nothing there is ever dirty.
+ *
+ * A receive runs until len bytes came in, so a peer that stops sending
+ * would hold it forever; the caller ends it with uart_dma_rx_cancel()
+ * when its own deadline passes. It starts by emptying the RX FIFO, which
+ * drops the rest of a reply that came in after an earlier receive was
+ * cancelled.
+ *
+ *   static const uart_dma_seg_t log[] = { { hdr, sizeof(hdr) }, { body, n } };
+ *   uart_dma_init(&wifly_dma, &wifly_tx, 0, 1);
+ *   uart_dma_send(&wifly_dma, log, 2, upload_done, NULL);
+ *   uart_dma_recv(&wifly_dma, resp, sizeof(*resp), resp_done, NULL);
+ *   ...
+ *   uart_dma_rx_cancel(&wifly_dma);   (no response in time)
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+#include "xdmaps.h"
+#include "uart_tx.h"
+
+#define UART_DMA_PROG_SIZE 128 /* bytes of DMA program per direction */
+
+typedef struct {
+	const void *data;
+	u32 len;
+} uart_dma_seg_t;
+
+/*
+ * called from the DMA interrupt when a transfer ends; bytes is the count
+ * moved, status XST_SUCCESS or XST_FAILURE after a DMA fault
+ */
+typedef void (*uart_dma_done_t)(void *ref, u32 bytes, s32 status);
+
+typedef struct uart_dma {
+	uart_tx_t *q;
+	u32 tx_chan;
+	u32 rx_chan;
+
+	/* transmit */
+	const uart_dma_seg_t *segs;
+	u32 nsegs;
+	u32 seg;            /* next segment and offset into it */
+	u32 off;
+	u32 tx_bytes;       /* bytes handed to the DMA so far */
+	u32 mark;           /* ring position the transfer is queued behind */
+	volatile u32 tx_pending;  /* a transfer is queued or running */
+	volatile u32 tx_busy;     /* a DMA program is in flight */
+	uart_dma_done_t tx_done;
+	void *tx_ref;
+	XDmaPs_Cmd tx_cmd;
+	u8 tx_prog[UART_DMA_PROG_SIZE] __attribute__((aligned(32)));
+
+	/* receive */
+	u8 *rx_buf;
+	u32 rx_len;
+	u32 rx_off;
+	u32 rx_chunk;       /* bytes the program in flight reads */
+	u32 rx_wm;          /* trigger level and mask to restore at the end */
+	u32 rx_imr;
+	volatile u32 rx_pending;
+	volatile u32 rx_cancel;   /* end the receive with the chunk in flight */
+	uart_dma_done_t rx_done;
+	void *rx_ref;
+	XDmaPs_Cmd rx_cmd;
+	u8 rx_prog[UART_DMA_PROG_SIZE] __attribute__((aligned(32)));
+} uart_dma_t;
+
+/*
+ * uart_dma_init -- attach DMA channels tx_chan and rx_chan to the queue
+ * q (already set up with uart_tx_init) and connect their interrupts
+ *
+ * returns XST_SUCCESS on success; otherwise XST_FAILURE
+ */
+s32 uart_dma_init(uart_dma_t *ud, uart_tx_t *q, u32 tx_chan, u32 rx_chan);
+
+/*
+ * uart_dma_send -- send the nsegs segments in order; segs and the data
+ * must stay untouched until done is called
+ *
+ * returns XST_SUCCESS once queued, XST_DEVICE_BUSY while a transfer is
+ * still running
+ */
+s32 uart_dma_send(uart_dma_t *ud, const uart_dma_seg_t *segs, u32 nsegs,
+		uart_dma_done_t done, void *ref);
+
+/*
+ * uart_dma_recv -- receive exactly len bytes into buf
+ *
+ * returns XST_SUCCESS once started, XST_DEVICE_BUSY while a receive is
+ * still running, XST_INVALID_PARAM for cached memory that does not
+ * start and end on a cache line
+ */
+s32 uart_dma_recv(uart_dma_t *ud, void *buf, u32 len,
+		uart_dma_done_t done, void *ref);
+
+/*
+ * uart_dma_rx_cancel -- end a running receive; done is called with the
+ * bytes that came in and XST_TIMEOUT before this returns. Call it from
+ * the main loop, not from an interrupt handler
+ */
+void uart_dma_rx_cancel(uart_dma_t *ud);
+
+/*
+ * used by uart_tx.c from the UART interrupt and the queue drain
+ */
+bool uart_dma_tx_pending(uart_dma_t *ud);
+bool uart_dma_tx_busy(uart_dma_t *ud);
+u32 uart_dma_tx_mark(uart_dma_t *ud);
+void uart_dma_tx_chunk(uart_dma_t *ud, u32 room);
+u32 uart_dma_rx_isr(uart_dma_t *ud, u32 pending);
@@ -0,0 +1,234 @@
+/*
+ * uart_tx.c -- interrupt driven UART transmit queue
+ */
+#include "uart_tx.h"
+#include "xil_io.h"
+#include "xuartps_hw.h"
+#include "gic.h"
+#include "mem.h"
+#include "uart_dma.h"
+
+#define UART_FIFO_DEPTH 64
+
+/*
+ * every record starts with a header word; the payload follows, padded to
+ * a word. A record never wraps: when it does not fit before the end of
+ * the ring, the rest of the ring is reserved with it as a pad record.
+ * The drain zeroes a record before freeing it, so a later header landing
+ * on old payload never reads as ready before its producer sets it
+ */
+#define REC_READY  0x80000000u
+#define REC_PAD    0x40000000u
+#define REC_LEN    0x0000FFFFu
+#define REC_HDR    4
+
+/* receive and error interrupts, left to the driver */
+#define UART_RX_IXR (XUARTPS_IXR_MASK & ~(XUARTPS_IXR_TXEMPTY | XUARTPS_IXR_TXFULL))
+
+static inline u32 rec_size(u32 len) {
+	return REC_HDR + ((len + 3) & ~3u);
+}
+
+static inline u32 *rec_hdr(uart_tx_t *q, u32 pos) {
+	return (u32 *)(q->ring + (pos & (q->size - 1)));
+}
+
+static void stat_max(volatile u32 *max, u32 v) {
+	u32 cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+	while (v > cur &&
+	       !__atomic_compare_exchange_n(max, &cur, v, true,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/*
+ * true when the record at tail can be sent; records from stop on wait
+ * for a DMA transfer queued ahead of them
+ */
+static bool ring_ready(uart_tx_t *q, u32 stop) {
+	u32 tail = q->tail;
+
+	return tail != stop &&
+	       (__atomic_load_n(rec_hdr(q, tail), __ATOMIC_ACQUIRE) & REC_READY) != 0;
+}
+
+static u32 ring_stop(uart_tx_t *q) {
+	if (q->dma != NULL && uart_dma_tx_pending(q->dma))
+		return uart_dma_tx_mark(q->dma);
+	return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * write up to room bytes of ready records to the FIFO; only the drain
+ * owner calls this
+ */
+static void ring_drain(uart_tx_t *q, u32 room, u32 stop) {
+	UINTPTR base = q->uart->Config.BaseAddress;
+
+	while (room != 0 && ring_ready(q, stop)) {
+		u32 tail = q->tail;
+		u32 *hdr = rec_hdr(q, tail);
+		u32 h = *hdr;
+		u32 len = h & REC_LEN;
+		u32 pos = tail & (q->size - 1);
+		const u8 *p;
+		u32 n;
+
+		if (h & REC_PAD) {
+			mem_set(hdr, 0, q->size - pos);
+			__atomic_store_n(&q->tail, tail + (q->size - pos), __ATOMIC_RELEASE);
+			continue;
+		}
+		p = q->ring + pos + REC_HDR + q->rd;
+		n = len - q->rd < room ? len - q->rd : room;
+		room -= n;
+		q->rd += n;
+		q->stats.sent_bytes += n;
+		while (n-- != 0)
+			XUartPs_WriteReg(base, XUARTPS_FIFO_OFFSET, *p++);
+		if (q->rd == len) {
+			mem_set(hdr, 0, rec_size(len));
+			q->rd = 0;
+			q->stats.sent_msgs++;
+			__atomic_store_n(&q->tail, tail + rec_size(len), __ATOMIC_RELEASE);
+		}
+	}
+}
+
+/*
+ * true when a queued DMA transfer is next in line
+ */
+static bool dma_next(uart_tx_t *q) {
+	return q->dma != NULL && uart_dma_tx_pending(q->dma) &&
+	       q->tail == uart_dma_tx_mark(q->dma);
+}
+
+/*
+ * fill an empty FIFO, then leave the TX empty interrupt enabled only
+ * while there is more to send. Writing to an empty FIFO clears the
+ * sticky TX empty status first, so the next empty edge interrupts.
+ * While a DMA chunk is in flight the interrupt stays off; the DMA done
+ * handler kicks the queue again
+ */
+static void tx_start(uart_tx_t *q) {
+	UINTPTR base = q->uart->Config.BaseAddress;
+
+	if (q->dma != NULL && uart_dma_tx_busy(q->dma)) {
+		XUartPs_WriteReg(base, XUARTPS_IDR_OFFSET, XUARTPS_IXR_TXEMPTY);
+		return;
+	}
+	if (XUartPs_ReadReg(base, XUARTPS_SR_OFFSET) & XUARTPS_SR_TXEMPTY) {
+		XUartPs_WriteReg(base, XUARTPS_ISR_OFFSET, XUARTPS_IXR_TXEMPTY);
+		if (dma_next(q))
+			uart_dma_tx_chunk(q->dma, UART_FIFO_DEPTH);
+		else
+			ring_drain(q, UART_FIFO_DEPTH, ring_stop(q));
+	}
+	if (ring_ready(q, ring_stop(q)) || dma_next(q))
+		XUartPs_WriteReg(base, XUARTPS_IER_OFFSET, XUARTPS_IXR_TXEMPTY);
+	else
+		XUartPs_WriteReg(base, XUARTPS_IDR_OFFSET, XUARTPS_IXR_TXEMPTY);
+}
+
+/*
+ * run tx_start() unless someone else is; if so, leave a kick for them
+ * so records committed meanwhile are not left behind
+ */
+void uart_tx_kick(uart_tx_t *q) {
+	u32 idle;
+
+	__atomic_store_n(&q->kick, 1, __ATOMIC_RELEASE);
+	for (;;) {
+		idle = 0;
+		if (!__atomic_compare_exchange_n(&q->busy, &idle, 1, false,
+						 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return;
+		__atomic_store_n(&q->kick, 0, __ATOMIC_RELAXED);
+		tx_start(q);
+		__atomic_store_n(&q->busy, 0, __ATOMIC_RELEASE);
+		if (__atomic_load_n(&q->kick, __ATOMIC_ACQUIRE) == 0)
+			return;
+	}
+}
+
+static void uart_tx_isr(void *ref) {
+	uart_tx_t *q = ref;
+	UINTPTR base = q->uart->Config.BaseAddress;
+	u32 pending = XUartPs_ReadReg(base, XUARTPS_IMR_OFFSET) &
+		      XUartPs_ReadReg(base, XUARTPS_ISR_OFFSET);
+
+	if (q->dma != NULL)
+		pending &= ~uart_dma_rx_isr(q->dma, pending);
+	if (pending & UART_RX_IXR) {
+		/*
+		 * the driver reads the status itself and, seeing TX empty with
+		 * no XUartPs_Send() of its own running, would turn the TX
+		 * interrupt off and report a XUARTPS_EVENT_SENT_DATA nobody
+		 * sent; mask the TX bits for the call so it sees only its own
+		 */
+		u32 tx = XUartPs_ReadReg(base, XUARTPS_IMR_OFFSET) &
+			 (XUARTPS_IXR_TXEMPTY | XUARTPS_IXR_TXFULL);
+
+		if (tx != 0)
+			XUartPs_WriteReg(base, XUARTPS_IDR_OFFSET, tx);
+		XUartPs_InterruptHandler(q->uart);
+		if (tx != 0)
+			XUartPs_WriteReg(base, XUARTPS_IER_OFFSET, tx);
+	}
+	if (pending & XUARTPS_IXR_TXEMPTY) {
+		q->stats.irqs++;
+		/* a drain we interrupted turns it back on when it finishes */
+		if (__atomic_load_n(&q->busy, __ATOMIC_ACQUIRE))
+			XUartPs_WriteReg(base, XUARTPS_IDR_OFFSET, XUARTPS_IXR_TXEMPTY);
+		uart_tx_kick(q);
+	}
+}
+
+s32 uart_tx_init(uart_tx_t *q, XUartPs *uart, u32 int_id) {
+	if (q->size < 2 * REC_HDR || (q->size & (q->size - 1)) != 0)
+		return XST_FAILURE;
+	q->uart = uart;
+	q->dma = NULL;
+	q->head = q->tail = q->rd = 0;
+	q->busy = q->kick = 0;
+	mem_set(q->ring, 0, q->size);
+	mem_set(&q->stats, 0, sizeof(q->stats));
+	XUartPs_WriteReg(uart->Config.BaseAddress, XUARTPS_IDR_OFFSET,
+			 XUARTPS_IXR_TXEMPTY | XUARTPS_IXR_TXFULL);
+	return gic_connect(int_id, (Xil_InterruptHandler)uart_tx_isr, q);
+}
+
+bool uart_tx_send(uart_tx_t *q, const void *data, u32 len) {
+	u32 need = rec_size(len);
+	u32 head, tail, pos, pad;
+
+	head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	do {
+		tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+		pos = head & (q->size - 1);
+		pad = need > q->size - pos ? q->size - pos : 0;
+		if (len == 0 || len > REC_LEN || head + pad + need - tail > q->size) {
+			__atomic_fetch_add(&q->stats.dropped_msgs, 1, __ATOMIC_RELAXED);
+			__atomic_fetch_add(&q->stats.dropped_bytes, len, __ATOMIC_RELAXED);
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(&q->head, &head, head + pad + need, true,
+					      __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+	stat_max(&q->stats.depth_max, head + pad + need - tail);
+
+	if (pad != 0) {
+		__atomic_store_n(rec_hdr(q, head), REC_READY | REC_PAD, __ATOMIC_RELEASE);
+		head += pad;
+	}
+	mem_copy(q->ring + (head & (q->size - 1)) + REC_HDR, data, len);
+	__atomic_store_n(rec_hdr(q, head), REC_READY | len, __ATOMIC_RELEASE);
+	uart_tx_kick(q);
+	return true;
+}
+
+void uart_tx_stats(uart_tx_t *q, uart_tx_stats_t *stats) {
+	*stats = q->stats;
+	stats->depth = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) -
+		       __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,85 @@
+/*
+ * uart_tx.h -- interrupt driven UART transmit queue
+ *
+ * XUartPs_Send() keeps a pointer to one caller buffer per instance and
+ * feeds it to the FIFO from the interrupt, so the buffer has to outlive
+ * the transfer and a second send overwrites the first. Here a message is
+ * copied into a ring owned by the queue and the TX empty interrupt drains
+ * the ring into the 64 byte FIFO, so the caller's buffer is free as soon
+ * as uart_tx_send() returns.
+ *
+ * Any number of producers (the main loop, a logger, interrupt handlers)
+ * can send at once. A producer reserves its record with a compare and
+ * swap on the ring head, copies the message in, then marks the record
+ * ready; the drain stops at the first record that is not ready yet, so
+ * messages go out whole and in reservation order. Nothing waits: a
+ * message that does not fit is dropped and counted.
+ *
+ *   UART_TX_DEFINE(wifly_tx, 1024);
+ *   uart_tx_init(&wifly_tx, &UartInst0, UART0_INT_ID);
+ *   uart_tx_send(&wifly_tx, &msg, sizeof(msg));
+ *
+ * uart_tx_init() connects the UART interrupt itself; receive and error
+ * interrupts are passed on to XUartPs_InterruptHandler and the handler
+ * set with XUartPs_SetHandler, as before, unless a uart_dma receive
+ * (uart_dma.h) is running on the same UART.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+#include "xuartps.h"
+
+typedef struct {
+	u32 depth;          /* bytes in the ring, record headers included */
+	u32 depth_max;      /* high water mark of depth */
+	u32 sent_msgs;      /* messages fully written to the FIFO */
+	u32 sent_bytes;     /* payload bytes written to the FIFO */
+	u32 dropped_msgs;   /* messages refused for lack of room */
+	u32 dropped_bytes;
+	u32 irqs;           /* TX empty interrupts taken */
+} uart_tx_stats_t;
+
+typedef struct {
+	u8 *ring;           /* size bytes, a power of two */
+	u32 size;
+	volatile u32 head;  /* next byte to reserve, free running */
+	volatile u32 tail;  /* first byte not yet sent, free running */
+	u32 rd;             /* bytes of the record at tail already sent */
+	volatile u32 busy;  /* the drain is running */
+	volatile u32 kick;  /* a drain was asked for while busy */
+	XUartPs *uart;
+	struct uart_dma *dma; /* bulk DMA transfers, see uart_dma.h */
+	uart_tx_stats_t stats;
+} uart_tx_t;
+
+/* reserve a ring of bytes (a power of two) for a queue called name */
+#define UART_TX_DEFINE(name, bytes) \
+	static u8 name##_ring[bytes] __attribute__((aligned(4))); \
+	uart_tx_t name = { name##_ring, (bytes) }
+
+/*
+ * uart_tx_init -- attach the queue to an initialized UART and connect
+ * its interrupt id at the gic
+ *
+ * returns XST_SUCCESS on success; otherwise XST_FAILURE
+ */
+s32 uart_tx_init(uart_tx_t *q, XUartPs *uart, u32 int_id);
+
+/*
+ * uart_tx_send -- queue len bytes for transmission, never blocks
+ *
+ * returns false if the message did not fit and was dropped
+ */
+bool uart_tx_send(uart_tx_t *q, const void *data, u32 len);
+
+/*
+ * uart_tx_kick -- refill the FIFO if it is empty and rearm the TX empty
+ * interrupt; for the DMA path, senders do not need it
+ */
+void uart_tx_kick(uart_tx_t *q);
+
+/*
+ * uart_tx_stats -- read the queue counters
+ */
+void uart_tx_stats(uart_tx_t *q, uart_tx_stats_t *stats);
@@ -0,0 +1,577 @@
+/*
+ * udp.c -- zero-copy UDP/IP over the PS Ethernet MAC (GEM0)
+ */
+#include <string.h>
+#include "udp.h"
+#include "xparameters.h"
+#include "xil_io.h"
+#include "dma_mem.h"
+#include "xtime_l.h"
+#include "xemacps.h"
+#include "gic.h"
+
+#define FRAME_OFF     2     /* frame start in its buffer, aligns the IP header */
+#define ETH_HDR       14
+#define IP_HDR        20
+#define UDP_HDR       8
+#define ARP_LEN       28
+#define HDRS          (ETH_HDR + IP_HDR + UDP_HDR)
+#define ETH_MIN       60    /* shortest frame without the FCS */
+
+#define ETHERTYPE_IP  0x0800
+#define ETHERTYPE_ARP 0x0806
+#define IP_PROTO_UDP  17
+#define IP_DF         0x4000
+#define IP_FRAG_MASK  0x3FFF /* more fragments and fragment offset */
+#define IP_BROADCAST  0xFFFFFFFFu
+#define ARP_REQUEST   1
+#define ARP_REPLY     2
+
+#define SLCR_LOCK          0xF8000004
+#define SLCR_UNLOCK        0xF8000008
+#define SLCR_GEM0_CLK_CTRL 0xF8000140
+#define SLCR_LOCK_KEY      0x767B
+#define SLCR_UNLOCK_KEY    0xDF0D
+#define SLCR_GEM_DIV_MASK  0xFC0FC0FF /* clears DIVISOR1 and DIVISOR0 */
+
+/* IEEE 802.3 clause 22 PHY registers */
+#define PHY_BMCR    0
+#define PHY_BMSR    1
+#define PHY_ID1     2
+#define PHY_ANAR    4
+#define PHY_ANLPAR  5
+#define PHY_GBCR    9
+#define PHY_GBSR    10
+#define BMCR_ANENABLE   0x1000
+#define BMCR_ANRESTART  0x0200
+#define BMSR_LINK       0x0004
+#define BMSR_ANCOMPLETE 0x0020
+#define ANAR_10FULL     0x0040
+#define ANAR_100HALF    0x0080
+#define ANAR_100FULL    0x0100
+#define GBCR_1000FULL   0x0200
+#define GBSR_1000FULL   0x0800
+
+/*
+ * The descriptors sit in uncached memory. Transmit buffers are write
+ * through, so a frame needs no clean before it goes out; receive buffers
+ * stay write-back for the handler and are invalidated around each frame.
+ */
+static u8 *rx_pool;
+static u8 *tx_pool;
+#define RX_BUF(idx)   (rx_pool + (idx) * UDP_BUF_SIZE)
+#define TX_BUF(idx)   (tx_pool + (idx) * UDP_BUF_SIZE)
+static u8 tx_free[UDP_TX_BUFS];     /* stack of free transmit buffers */
+static u32 tx_nfree;
+
+typedef struct {
+	u32 ip;
+	u8 mac[6];
+} arp_entry_t;
+
+static arp_entry_t arp[UDP_ARP_ENTRIES];
+static u32 arp_next;
+static s32 pending = -1;            /* buffer waiting for an ARP reply */
+static u32 pending_ip;
+static u32 pending_len;
+
+static XEmacPs emac;
+static XEmacPs_Bd bd_template;
+static udp_config_t local;
+static udp_recv_t recv_fn;
+static void *recv_ref;
+static u32 phy_addr;
+static u16 ip_id;
+static udp_stats_t stats;
+
+static const u8 mac_broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static inline void put16(u8 *p, u32 v) {
+	p[0] = (u8)(v >> 8);
+	p[1] = (u8)v;
+}
+
+static inline void put32(u8 *p, u32 v) {
+	p[0] = (u8)(v >> 24);
+	p[1] = (u8)(v >> 16);
+	p[2] = (u8)(v >> 8);
+	p[3] = (u8)v;
+}
+
+static inline u32 get16(const u8 *p) {
+	return ((u32)p[0] << 8) | p[1];
+}
+
+static inline u32 get32(const u8 *p) {
+	return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+static inline u32 bd_index(XEmacPs_BdRing *ring, XEmacPs_Bd *bd) {
+	return (u32)(((UINTPTR)bd - ring->BaseBdAddr) / ring->Separation);
+}
+
+/*
+ * give n receive descriptors back to the GEM, each with the buffer of
+ * the same index; clearing the new bit with the address hands it over
+ */
+static void rx_arm(u32 n) {
+	XEmacPs_BdRing *ring = &XEmacPs_GetRxRing(&emac);
+	XEmacPs_Bd *bd, *first;
+	u32 i, idx;
+
+	if (n == 0 || XEmacPs_BdRingAlloc(ring, n, &bd) != XST_SUCCESS)
+		return;
+	first = bd;
+	for (i = 0; i < n; i++) {
+		idx = bd_index(ring, bd);
+		/* no dirty line may be written back over the frame */
+		dma_mem_invalidate(RX_BUF(idx), UDP_BUF_SIZE);
+		XEmacPs_BdWrite(bd, XEMACPS_BD_STAT_OFFSET, 0);
+		XEmacPs_BdWrite(bd, XEMACPS_BD_ADDR_OFFSET, (u32)(UINTPTR)RX_BUF(idx) |
+				(idx == UDP_RX_BUFS - 1 ? XEMACPS_RXBUF_WRAP_MASK : 0));
+		bd = XEmacPs_BdRingNext(ring, bd);
+	}
+	XEmacPs_BdRingToHw(ring, n, first);
+}
+
+/*
+ * return the buffers of sent frames to the pool
+ */
+static void tx_reclaim(void) {
+	XEmacPs_BdRing *ring = &XEmacPs_GetTxRing(&emac);
+	XEmacPs_Bd *bd = ring->HwHead, *first;
+	u32 n = 0, i, status;
+
+	/* XEmacPs_BdRingFromHwTx() runs on past descriptors the GEM has not
+	   reached yet, so it is only asked for the run that is done */
+	while (n < ring->HwCnt &&
+	       (XEmacPs_BdRead(bd, XEMACPS_BD_STAT_OFFSET) & XEMACPS_TXBUF_USED_MASK) != 0) {
+		n++;
+		bd = XEmacPs_BdRingNext(ring, bd);
+	}
+	if (n == 0)
+		return;
+	n = XEmacPs_BdRingFromHwTx(ring, n, &bd);
+	first = bd;
+	for (i = 0; i < n; i++) {
+		status = XEmacPs_BdRead(bd, XEMACPS_BD_STAT_OFFSET);
+		if (status & (XEMACPS_TXBUF_RETRY_MASK | XEMACPS_TXBUF_URUN_MASK |
+			      XEMACPS_TXBUF_EXH_MASK))
+			stats.tx_errors++;
+		tx_free[tx_nfree++] = (u8)(((u8 *)(UINTPTR)XEmacPs_BdGetBufAddr(bd) -
+					    FRAME_OFF - tx_pool) / UDP_BUF_SIZE);
+		XEmacPs_BdWrite(bd, XEMACPS_BD_STAT_OFFSET,
+				XEMACPS_TXBUF_USED_MASK | (status & XEMACPS_TXBUF_WRAP_MASK));
+		bd = XEmacPs_BdRingNext(ring, bd);
+	}
+	XEmacPs_BdRingFree(ring, n, first);
+}
+
+static s32 tx_get(void) {
+	if (tx_nfree == 0)
+		tx_reclaim();
+	if (tx_nfree == 0)
+		return -1;
+	tx_nfree--;
+	if (tx_nfree < stats.tx_free_min)
+		stats.tx_free_min = tx_nfree;
+	return tx_free[tx_nfree];
+}
+
+/*
+ * queue the frame in transmit buffer idx; there is a descriptor for
+ * every buffer, so the ring never runs out first
+ */
+static void tx_queue(u32 idx, u32 len) {
+	XEmacPs_BdRing *ring = &XEmacPs_GetTxRing(&emac);
+	u8 *frame = TX_BUF(idx) + FRAME_OFF;
+	XEmacPs_Bd *bd;
+
+	if (len < ETH_MIN) {
+		memset(frame + len, 0, ETH_MIN - len);
+		len = ETH_MIN;
+	}
+	dma_mem_clean(frame, len);
+	XEmacPs_BdRingAlloc(ring, 1, &bd);
+	XEmacPs_BdSetAddressTx(bd, (UINTPTR)frame);
+	XEmacPs_BdSetLength(bd, len);
+	XEmacPs_BdSetLast(bd);
+	XEmacPs_BdClearTxUsed(bd);
+	XEmacPs_BdRingToHw(ring, 1, bd);
+	dma_mem_sync();
+	XEmacPs_Transmit(&emac);
+	stats.tx_frames++;
+}
+
+static void arp_send(u32 op, const u8 *mac, u32 ip) {
+	s32 idx = tx_get();
+	u8 *frame, *a;
+
+	if (idx < 0)
+		return;
+	frame = TX_BUF(idx) + FRAME_OFF;
+	a = frame + ETH_HDR;
+	memcpy(frame, op == ARP_REQUEST ? mac_broadcast : mac, 6);
+	memcpy(frame + 6, local.mac, 6);
+	put16(frame + 12, ETHERTYPE_ARP);
+	put16(a, 1);                    /* Ethernet */
+	put16(a + 2, ETHERTYPE_IP);
+	a[4] = 6;
+	a[5] = 4;
+	put16(a + 6, op);
+	memcpy(a + 8, local.mac, 6);
+	put32(a + 14, local.ip);
+	if (op == ARP_REQUEST)
+		memset(a + 18, 0, 6);
+	else
+		memcpy(a + 18, mac, 6);
+	put32(a + 24, ip);
+	tx_queue((u32)idx, ETH_HDR + ARP_LEN);
+	if (op == ARP_REQUEST)
+		stats.arp_requests++;
+	else
+		stats.arp_replies++;
+}
+
+static const u8 *arp_lookup(u32 ip) {
+	u32 i;
+
+	if (ip == IP_BROADCAST)
+		return mac_broadcast;
+	for (i = 0; i < UDP_ARP_ENTRIES; i++)
+		if (arp[i].ip == ip && ip != 0)
+			return arp[i].mac;
+	return NULL;
+}
+
+static void arp_learn(u32 ip, const u8 *mac) {
+	u32 i;
+
+	if (ip == 0 || ip == IP_BROADCAST)
+		return;
+	for (i = 0; i < UDP_ARP_ENTRIES && arp[i].ip != ip; i++)
+		;
+	if (i == UDP_ARP_ENTRIES) {
+		i = arp_next;
+		arp_next = (arp_next + 1) % UDP_ARP_ENTRIES;
+		arp[i].ip = ip;
+	}
+	memcpy(arp[i].mac, mac, 6);
+
+	if (pending >= 0 && pending_ip == ip) {
+		memcpy(TX_BUF(pending) + FRAME_OFF, mac, 6);
+		tx_queue((u32)pending, pending_len);
+		pending = -1;
+	}
+}
+
+static void arp_input(u8 *frame, u32 len) {
+	u8 *a = frame + ETH_HDR;
+
+	if (len < ETH_HDR + ARP_LEN || get16(a) != 1 || get16(a + 2) != ETHERTYPE_IP ||
+	    a[4] != 6 || a[5] != 4 || get32(a + 24) != local.ip) {
+		stats.rx_dropped++;
+		return;
+	}
+	arp_learn(get32(a + 14), a + 8);
+	if (get16(a + 6) == ARP_REQUEST)
+		arp_send(ARP_REPLY, a + 8, get32(a + 14));
+}
+
+static void ip_input(u8 *frame, u32 len) {
+	u8 *ip = frame + ETH_HDR;
+	u8 *udp;
+	u32 ihl, total, ulen;
+	udp_addr_t from;
+
+	if (len < HDRS || (ip[0] >> 4) != 4)
+		goto drop;
+	ihl = (ip[0] & 0xFu) * 4;
+	total = get16(ip + 2);
+	if (ihl < IP_HDR || total < ihl + UDP_HDR || ETH_HDR + total > len ||
+	    (get16(ip + 6) & IP_FRAG_MASK) != 0 || ip[9] != IP_PROTO_UDP ||
+	    get32(ip + 16) != local.ip)
+		goto drop;
+	udp = ip + ihl;
+	ulen = get16(udp + 4);
+	if (ulen < UDP_HDR || ulen > total - ihl || get16(udp + 2) != local.port)
+		goto drop;
+
+	from.ip = get32(ip + 12);
+	from.port = (u16)get16(udp);
+	arp_learn(from.ip, frame + 6);
+	stats.rx_datagrams++;
+	if (recv_fn != NULL)
+		recv_fn(recv_ref, &from, udp + UDP_HDR, ulen - UDP_HDR);
+	return;
+drop:
+	stats.rx_dropped++;
+}
+
+static void rx_poll(void) {
+	XEmacPs_BdRing *ring = &XEmacPs_GetRxRing(&emac);
+	XEmacPs_Bd *bd, *first;
+	u32 n, i, idx, status, len;
+	u8 *frame;
+
+	n = XEmacPs_BdRingFromHwRx(ring, UDP_RX_BUFS, &bd);
+	if (n == 0)
+		return;
+	first = bd;
+	for (i = 0; i < n; i++) {
+		idx = bd_index(ring, bd);
+		status = XEmacPs_BdRead(bd, XEMACPS_BD_STAT_OFFSET);
+		len = status & XEMACPS_RXBUF_LEN_MASK;
+		frame = RX_BUF(idx) + FRAME_OFF;
+		/* drop lines the core pulled in while the GEM was writing */
+		dma_mem_invalidate(RX_BUF(idx), FRAME_OFF + len);
+		stats.rx_frames++;
+
+		if ((status & (XEMACPS_RXBUF_SOF_MASK | XEMACPS_RXBUF_EOF_MASK)) !=
+		    (XEMACPS_RXBUF_SOF_MASK | XEMACPS_RXBUF_EOF_MASK) || len < ETH_HDR)
+			stats.rx_dropped++;
+		else if (get16(frame + 12) == ETHERTYPE_IP)
+			ip_input(frame, len);
+		else if (get16(frame + 12) == ETHERTYPE_ARP)
+			arp_input(frame, len);
+		else
+			stats.rx_dropped++;
+		bd = XEmacPs_BdRingNext(ring, bd);
+	}
+	XEmacPs_BdRingFree(ring, n, first);
+	rx_arm(n);
+}
+
+static u16 phy_read(u32 reg) {
+	u16 value = 0;
+
+	XEmacPs_PhyRead(&emac, phy_addr, reg, &value);
+	return value;
+}
+
+/*
+ * find the PHY, wait for autonegotiation and work out what it settled on
+ *
+ * returns the speed in Mbps, 0 without a PHY or a link
+ */
+static u32 phy_link(bool *full) {
+	u32 bmsr, common;
+	u16 id;
+	XTime start, now;
+
+	for (phy_addr = 0; phy_addr < 32; phy_addr++) {
+		id = phy_read(PHY_ID1);
+		if (id != 0 && id != 0xFFFF)
+			break;
+	}
+	if (phy_addr == 32)
+		return 0;
+	if ((phy_read(PHY_BMCR) & BMCR_ANENABLE) == 0)
+		XEmacPs_PhyWrite(&emac, phy_addr, PHY_BMCR, BMCR_ANENABLE | BMCR_ANRESTART);
+
+	XTime_GetTime(&start);
+	for (;;) {
+		bmsr = phy_read(PHY_BMSR);
+		if ((bmsr & (BMSR_ANCOMPLETE | BMSR_LINK)) == (BMSR_ANCOMPLETE | BMSR_LINK))
+			break;
+		XTime_GetTime(&now);
+		if (now - start > (XTime)UDP_LINK_TIMEOUT_MS * (COUNTS_PER_SECOND / 1000))
+			return 0;
+	}
+
+	if ((phy_read(PHY_GBCR) & GBCR_1000FULL) && (phy_read(PHY_GBSR) & GBSR_1000FULL)) {
+		*full = true;
+		return 1000;
+	}
+	common = phy_read(PHY_ANAR) & phy_read(PHY_ANLPAR);
+	if (common & (ANAR_100FULL | ANAR_100HALF)) {
+		*full = (common & ANAR_100FULL) != 0;
+		return 100;
+	}
+	*full = (common & ANAR_10FULL) != 0;
+	return 10;
+}
+
+/*
+ * set the MAC and its reference clock (SLCR GEM0_CLK_CTRL) to the link
+ */
+static void set_speed(u32 mbps, bool full) {
+	UINTPTR base = emac.Config.BaseAddress;
+	u32 div0, div1, reg;
+
+	XEmacPs_SetOperatingSpeed(&emac, (u16)mbps);
+	reg = XEmacPs_ReadReg(base, XEMACPS_NWCFG_OFFSET);
+	if (full)
+		reg |= XEMACPS_NWCFG_FDEN_MASK;
+	else
+		reg &= ~XEMACPS_NWCFG_FDEN_MASK;
+	XEmacPs_WriteReg(base, XEMACPS_NWCFG_OFFSET, reg);
+
+	if (mbps == 1000) {
+		div0 = emac.Config.S1GDiv0;
+		div1 = emac.Config.S1GDiv1;
+	} else if (mbps == 100) {
+		div0 = emac.Config.S100MDiv0;
+		div1 = emac.Config.S100MDiv1;
+	} else {
+		div0 = emac.Config.S10MDiv0;
+		div1 = emac.Config.S10MDiv1;
+	}
+	Xil_Out32(SLCR_UNLOCK, SLCR_UNLOCK_KEY);
+	reg = Xil_In32(SLCR_GEM0_CLK_CTRL) & SLCR_GEM_DIV_MASK;
+	Xil_Out32(SLCR_GEM0_CLK_CTRL, reg | (div1 << 20) | (div0 << 8));
+	Xil_Out32(SLCR_LOCK, SLCR_LOCK_KEY);
+	stats.link_mbps = mbps;
+}
+
+/*
+ * the frames are picked up by udp_poll(); the interrupt is only counted
+ * and wakes the core from WFI
+ */
+static void emac_isr(void *ref) {
+	stats.irqs++;
+	XEmacPs_IntrHandler(ref);
+}
+
+static void emac_done(void *ref) {
+	(void)ref;
+}
+
+static void emac_error(void *ref, u8 direction, u32 error) {
+	(void)ref;
+	(void)error;
+	if (direction == XEMACPS_RECV)
+		stats.rx_errors++;
+	else
+		stats.tx_errors++;
+}
+
+s32 udp_init(const udp_config_t *cfg, udp_recv_t recv, void *ref) {
+	XEmacPs_Config *config;
+	XEmacPs_BdRing *rx_ring = &XEmacPs_GetRxRing(&emac);
+	XEmacPs_BdRing *tx_ring = &XEmacPs_GetTxRing(&emac);
+	void *rx_bds, *tx_bds;
+	u32 i, mbps, reg;
+	bool full = true;
+
+	local = *cfg;
+	recv_fn = recv;
+	recv_ref = ref;
+
+	config = XEmacPs_LookupConfig(XPAR_XEMACPS_0_DEVICE_ID);
+	if (config == NULL ||
+	    XEmacPs_CfgInitialize(&emac, config, config->BaseAddress) != XST_SUCCESS)
+		return XST_FAILURE;
+	if (XEmacPs_SetMacAddress(&emac, local.mac, 1) != XST_SUCCESS)
+		return XST_FAILURE;
+	XEmacPs_SetMdioDivisor(&emac, MDC_DIV_224);
+	XEmacPs_SetOptions(&emac, XEMACPS_RX_CHKSUM_ENABLE_OPTION |
+			   XEMACPS_TX_CHKSUM_ENABLE_OPTION);
+	reg = XEmacPs_ReadReg(config->BaseAddress, XEMACPS_NWCFG_OFFSET);
+	XEmacPs_WriteReg(config->BaseAddress, XEMACPS_NWCFG_OFFSET,
+			 (reg & ~XEMACPS_NWCFG_RXOFFS_MASK) | (FRAME_OFF << 14));
+
+	rx_pool = dma_mem_alloc(DMA_MEM_CACHED, UDP_RX_BUFS * UDP_BUF_SIZE);
+	tx_pool = dma_mem_alloc(DMA_MEM_WRITE_THROUGH, UDP_TX_BUFS * UDP_BUF_SIZE);
+	rx_bds = dma_mem_alloc(DMA_MEM_UNCACHED, UDP_RX_BUFS * sizeof(XEmacPs_Bd));
+	tx_bds = dma_mem_alloc(DMA_MEM_UNCACHED, UDP_TX_BUFS * sizeof(XEmacPs_Bd));
+	if (rx_pool == NULL || tx_pool == NULL || rx_bds == NULL || tx_bds == NULL)
+		return XST_FAILURE;
+
+	XEmacPs_BdClear(&bd_template);
+	if (XEmacPs_BdRingCreate(rx_ring, (UINTPTR)rx_bds, (UINTPTR)rx_bds,
+				 XEMACPS_BD_ALIGNMENT, UDP_RX_BUFS) != XST_SUCCESS ||
+	    XEmacPs_BdRingClone(rx_ring, &bd_template, XEMACPS_RECV) != XST_SUCCESS)
+		return XST_FAILURE;
+	XEmacPs_BdClear(&bd_template);
+	XEmacPs_BdSetStatus(&bd_template, XEMACPS_TXBUF_USED_MASK);
+	if (XEmacPs_BdRingCreate(tx_ring, (UINTPTR)tx_bds, (UINTPTR)tx_bds,
+				 XEMACPS_BD_ALIGNMENT, UDP_TX_BUFS) != XST_SUCCESS ||
+	    XEmacPs_BdRingClone(tx_ring, &bd_template, XEMACPS_SEND) != XST_SUCCESS)
+		return XST_FAILURE;
+
+	for (i = 0; i < UDP_TX_BUFS; i++)
+		tx_free[i] = (u8)(UDP_TX_BUFS - 1 - i);
+	tx_nfree = UDP_TX_BUFS;
+	stats.tx_free_min = UDP_TX_BUFS;
+	rx_arm(UDP_RX_BUFS);
+
+	mbps = phy_link(&full);
+	if (mbps == 0)
+		return XST_FAILURE;
+	set_speed(mbps, full);
+
+	XEmacPs_SetHandler(&emac, XEMACPS_HANDLER_DMASEND, (void *)emac_done, &emac);
+	XEmacPs_SetHandler(&emac, XEMACPS_HANDLER_DMARECV, (void *)emac_done, &emac);
+	XEmacPs_SetHandler(&emac, XEMACPS_HANDLER_ERROR, (void *)emac_error, &emac);
+	if (gic_connect(XPAR_XEMACPS_0_INTR, emac_isr, &emac) != XST_SUCCESS)
+		return XST_FAILURE;
+	XEmacPs_Start(&emac);
+	return XST_SUCCESS;
+}
+
+void *udp_alloc(void) {
+	s32 idx = tx_get();
+
+	return idx < 0 ? NULL : TX_BUF(idx) + FRAME_OFF + HDRS;
+}
+
+void udp_free(void *buf) {
+	tx_free[tx_nfree++] = (u8)(((u8 *)buf - HDRS - FRAME_OFF - tx_pool) / UDP_BUF_SIZE);
+}
+
+s32 udp_send(void *buf, u32 len, const udp_addr_t *to) {
+	u8 *frame = (u8 *)buf - HDRS;
+	u8 *ip = frame + ETH_HDR;
+	u8 *udp = ip + IP_HDR;
+	u32 idx = (u32)((frame - FRAME_OFF - tx_pool) / UDP_BUF_SIZE);
+	const u8 *mac;
+
+	if (len > UDP_PAYLOAD_MAX) {
+		udp_free(buf);
+		return XST_FAILURE;
+	}
+	memcpy(frame + 6, local.mac, 6);
+	put16(frame + 12, ETHERTYPE_IP);
+	ip[0] = 0x45;                   /* IPv4, no options */
+	ip[1] = 0;
+	put16(ip + 2, IP_HDR + UDP_HDR + len);
+	put16(ip + 4, ip_id++);
+	put16(ip + 6, IP_DF);
+	ip[8] = 64;                     /* time to live */
+	ip[9] = IP_PROTO_UDP;
+	put16(ip + 10, 0);              /* checksums are left to the GEM */
+	put32(ip + 12, local.ip);
+	put32(ip + 16, to->ip);
+	put16(udp, local.port);
+	put16(udp + 2, to->port);
+	put16(udp + 4, UDP_HDR + len);
+	put16(udp + 6, 0);
+
+	mac = arp_lookup(to->ip);
+	if (mac != NULL) {
+		memcpy(frame, mac, 6);
+		tx_queue(idx, HDRS + len);
+		return XST_SUCCESS;
+	}
+	if (pending >= 0) {
+		udp_free(buf);
+		stats.tx_dropped++;
+		arp_send(ARP_REQUEST, NULL, to->ip);
+		return XST_FAILURE;
+	}
+	pending = (s32)idx;
+	pending_ip = to->ip;
+	pending_len = HDRS + len;
+	arp_send(ARP_REQUEST, NULL, to->ip);
+	return XST_SUCCESS;
+}
+
+void udp_poll(void) {
+	rx_poll();
+	tx_reclaim();
+}
+
+void udp_stats(udp_stats_t *out) {
+	*out = stats;
+}
@@ -0,0 +1,137 @@
+/*
+ * udp.h -- zero-copy UDP/IP over the PS Ethernet MAC (GEM0)
+ *
+ * The substation link over the WiFly UART takes a quarter of a second per
+ * UPDATE at 9600 baud. This is a minimal UDP/IP stack on the GEM that gets
+ * the same exchange down to tens of microseconds: IPv4 without options or
+ * fragments, ARP, and nothing else.
+ *
+ * Frames are never copied. Receive and transmit buffers come from two
+ * fixed pools of cache line aligned buffers (dma_mem.h), one receive
+ * buffer per receive descriptor, and go back and forth through the
+ * driver's buffer descriptor rings:
+ *
+ *   receive   the GEM writes a frame into the buffer of the next free
+ *             descriptor; udp_poll() takes it off the ring, invalidates
+ *             it, hands the payload to the receive handler where it lies
+ *             and then gives the same buffer back to the ring.
+ *   transmit  udp_alloc() returns the payload area of a free transmit
+ *             buffer, the caller writes the message straight into it and
+ *             udp_send() puts the Ethernet, IP and UDP headers in front
+ *             of it and queues it on the ring; transmit buffers are
+ *             write-through, so there is nothing to clean.
+ *             The buffer returns to the pool once the GEM has sent it.
+ *
+ * The GEM fills in the IP and UDP checksums on transmit and drops frames
+ * with bad ones on receive. Frames sit two bytes into their buffer so the
+ * IP header and the payload are word aligned.
+ *
+ * All calls are made from the main loop. The GEM interrupt only counts
+ * frames and ends a WFI; the work is done in udp_poll().
+ *
+ *   static const udp_config_t net = { UDP_MAC_DEFAULT, UDP_IP(192, 168, 1, 10), 12345 };
+ *   udp_init(&net, substation_recv, NULL);
+ *   msg = udp_alloc();
+ *   msg->type = UPDATE;
+ *   udp_send(msg, sizeof(*msg), &substation);
+ *   udp_poll();
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "xil_types.h"
+
+#define UDP_BUF_SIZE      1536  /* bytes per buffer, the GEM receive buffer size */
+#define UDP_RX_BUFS       32
+#define UDP_TX_BUFS       16
+#define UDP_PAYLOAD_MAX   1472  /* 1500 byte MTU less the IP and UDP headers */
+#define UDP_ARP_ENTRIES   4
+#define UDP_LINK_TIMEOUT_MS 3000  /* wait for autonegotiation at udp_init */
+
+/* an IPv4 address in host byte order */
+#define UDP_IP(a, b, c, d) \
+	(((u32)(a) << 24) | ((u32)(b) << 16) | ((u32)(c) << 8) | (u32)(d))
+
+/* a locally administered address on the Xilinx OUI */
+#define UDP_MAC_DEFAULT { 0x00, 0x0A, 0x35, 0x01, 0x02, 0x03 }
+
+typedef struct {
+	u32 ip;
+	u16 port;
+} udp_addr_t;
+
+typedef struct {
+	u8 mac[6];
+	u32 ip;
+	u16 port;           /* datagrams to other ports are dropped */
+} udp_config_t;
+
+/*
+ * called from udp_poll() with each datagram for the local port; data
+ * lies in the receive buffer and is only valid until the handler returns
+ */
+typedef void (*udp_recv_t)(void *ref, const udp_addr_t *from, void *data, u32 len);
+
+typedef struct {
+	u32 link_mbps;      /* negotiated speed, 0 with the link down */
+	u32 irqs;           /* GEM interrupts taken */
+	u32 rx_frames;      /* frames taken off the receive ring */
+	u32 rx_datagrams;   /* datagrams passed to the handler */
+	u32 rx_dropped;     /* frames not for us or not understood */
+	u32 rx_errors;      /* receive errors reported by the GEM */
+	u32 tx_frames;      /* frames queued on the transmit ring */
+	u32 tx_dropped;     /* datagrams dropped for want of an ARP entry */
+	u32 tx_errors;      /* transmit errors reported by the GEM */
+	u32 tx_free_min;    /* low water mark of free transmit buffers */
+	u32 arp_requests;   /* ARP requests sent */
+	u32 arp_replies;    /* ARP replies sent */
+} udp_stats_t;
+
+/*
+ * udp_init -- bring up GEM0 with the address in cfg, wait for the link
+ * and set the MAC to the negotiated speed; recv is called with every
+ * datagram for cfg->port. The rings and buffers come from dma_mem, so
+ * dma_mem_init() has to have run.
+ *
+ * returns XST_SUCCESS on success; otherwise XST_FAILURE, also when there
+ * is no PHY or no link within UDP_LINK_TIMEOUT_MS
+ */
+s32 udp_init(const udp_config_t *cfg, udp_recv_t recv, void *ref);
+
+/*
+ * udp_alloc -- take a transmit buffer; the message is written at the
+ * returned address, which is word aligned and has room for
+ * UDP_PAYLOAD_MAX bytes
+ *
+ * returns NULL while every buffer is queued for transmission
+ */
+void *udp_alloc(void);
+
+/*
+ * udp_free -- return a buffer from udp_alloc() that is not going to be
+ * sent
+ */
+void udp_free(void *buf);
+
+/*
+ * udp_send -- send len bytes at buf (from udp_alloc()) to the address
+ * to; the buffer belongs to the stack again whatever the outcome
+ *
+ * A destination without an ARP entry gets an ARP request and the
+ * datagram waits for the reply; a second datagram to an unresolved
+ * address while one is waiting is dropped.
+ *
+ * returns XST_SUCCESS once queued; otherwise XST_FAILURE
+ */
+s32 udp_send(void *buf, u32 len, const udp_addr_t *to);
+
+/*
+ * udp_poll -- hand received datagrams to the handler, answer ARP and
+ * reclaim sent buffers; call it from the main loop
+ */
+void udp_poll(void);
+
+/*
+ * udp_stats -- read the counters
+ */
+void udp_stats(udp_stats_t *stats);
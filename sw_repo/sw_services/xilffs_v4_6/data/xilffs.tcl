@@ -0,0 +1,118 @@
+###############################################################################
+# Copyright (c) 2013 - 2021 Xilinx, Inc.  All rights reserved.
+# SPDX-License-Identifier: MIT
+#
+# As the Vitis xilffs 4.6, and writes cache_sectors to xparameters.h as
+# FILE_SYSTEM_CACHE_SECTORS for src/include/diskcache.h.
+###############################################################################
+
+proc ffs_drc {libhandle} {
+	# check if any SD or RAM interface is there
+	set fs_interface [common::get_property CONFIG.fs_interface $libhandle]
+	set cache_sectors [common::get_property CONFIG.cache_sectors $libhandle]
+
+	if {$fs_interface == 1} {
+		set sdps [hsi::get_cells -hier -filter {IP_NAME == "ps7_sdio" || IP_NAME == "psu_sd" || IP_NAME == "psv_pmc_sd"}]
+		if {[llength $sdps] == 0} {
+			error "This library requires a SD interface in the hardware." "" "mdt_error"
+		}
+	} elseif {$fs_interface != 2} {
+		error "Invalid fs_interface $fs_interface: 1 for SD, 2 for RAM." "" "mdt_error"
+	}
+
+	if {![string is integer -strict $cache_sectors] || $cache_sectors < 0} {
+		error "Invalid cache_sectors $cache_sectors: the number of sectors, 0 for none." "" "mdt_error"
+	}
+}
+
+proc generate {libhandle} {
+
+}
+
+#-------
+# post_generate: called after generate called on all libraries
+#-------
+proc post_generate {libhandle} {
+	xgen_opts_file $libhandle
+}
+
+#-------
+# execs_generate: called after BSP's, libraries and drivers have been compiled
+#-------
+proc execs_generate {libhandle} {
+
+}
+
+proc xgen_opts_file {libhandle} {
+	set file_handle [::hsi::utils::open_include_file "xparameters.h"]
+	puts $file_handle "\n/* Xilinx FAT File System Library (XilFFs) User Settings */"
+
+	set fs_interface [common::get_property CONFIG.fs_interface $libhandle]
+	set read_only [common::get_property CONFIG.read_only $libhandle]
+	set enable_exfat [common::get_property CONFIG.enable_exfat $libhandle]
+	set use_lfn [common::get_property CONFIG.use_lfn $libhandle]
+	set enable_multi_partition [common::get_property CONFIG.enable_multi_partition $libhandle]
+	set num_logical_vol [common::get_property CONFIG.num_logical_vol $libhandle]
+	set use_mkfs [common::get_property CONFIG.use_mkfs $libhandle]
+	set use_strfunc [common::get_property CONFIG.use_strfunc $libhandle]
+	set set_fs_rpath [common::get_property CONFIG.set_fs_rpath $libhandle]
+	set word_access [common::get_property CONFIG.word_access $libhandle]
+	set use_chmod [common::get_property CONFIG.use_chmod $libhandle]
+	set ramfs_size [common::get_property CONFIG.ramfs_size $libhandle]
+	set ramfs_start_addr [common::get_property CONFIG.ramfs_start_addr $libhandle]
+	set cache_sectors [common::get_property CONFIG.cache_sectors $libhandle]
+
+	if {$fs_interface == 1} {
+		puts $file_handle "#define FILE_SYSTEM_INTERFACE_SD"
+	} elseif {$fs_interface == 2} {
+		puts $file_handle "#define FILE_SYSTEM_INTERFACE_RAM"
+		puts $file_handle "#define RAMFS_SIZE $ramfs_size"
+		if {$ramfs_start_addr != ""} {
+			puts $file_handle "#define RAMFS_START_ADDR $ramfs_start_addr"
+		}
+	}
+
+	if {$read_only == true} {
+		puts $file_handle "#define FILE_SYSTEM_READ_ONLY"
+	}
+
+	if {$enable_exfat == true} {
+		puts $file_handle "#define FILE_SYSTEM_FS_EXFAT"
+		if {$use_lfn == 0} {
+			set use_lfn 1
+		}
+	}
+
+	if {$use_lfn != 0} {
+		puts $file_handle "#define FILE_SYSTEM_USE_LFN $use_lfn"
+	}
+
+	if {$enable_multi_partition == true} {
+		puts $file_handle "#define FILE_SYSTEM_MULTI_PARTITION"
+	}
+
+	if {$use_mkfs == true && $read_only == false} {
+		puts $file_handle "#define FILE_SYSTEM_USE_MKFS"
+	}
+
+	if {$num_logical_vol > 10} {
+		puts "WARNING: Number of logical volumes is more than 10, using 10"
+		set num_logical_vol 10
+	}
+	puts $file_handle "#define FILE_SYSTEM_NUM_LOGIC_VOL $num_logical_vol"
+
+	if {$use_chmod == true && $read_only == false} {
+		puts $file_handle "#define FILE_SYSTEM_USE_CHMOD"
+	}
+
+	puts $file_handle "#define FILE_SYSTEM_USE_STRFUNC $use_strfunc"
+	puts $file_handle "#define FILE_SYSTEM_SET_FS_RPATH $set_fs_rpath"
+
+	if {$word_access == true} {
+		puts $file_handle "#define FILE_SYSTEM_WORD_ACCESS"
+	}
+
+	puts $file_handle "#define FILE_SYSTEM_CACHE_SECTORS $cache_sectors"
+
+	close $file_handle
+}
@@ -0,0 +1,94 @@
+/*****************************************************************************/
+/**
+*
+* @file diskcache.h
+*
+* Contains the interface of the sector cache between diskio.c and the card.
+*
+* ff.c keeps a single sector window per volume, so a logger appending to a
+* file on SD reads the same FAT and directory sectors again on every
+* f_sync() and writes each sector with a command of its own. disk_read()
+* and disk_write() go through a small LRU cache of whole sectors instead:
+*
+* - Writes are write-back. A written sector is only marked dirty; the dirty
+*   sectors reach the card at CTRL_SYNC, which ff.c issues at the end of
+*   f_sync(), f_close() and f_mkfs(), sorted by sector and merged into
+*   multi-block writes. A dirty sector evicted before that is written back
+*   together with the dirty sectors next to it.
+* - A read that carries on where the last one on the drive ended fetches
+*   DISK_CACHE_READ_AHEAD sectors more in the same command.
+* - Requests of DISK_CACHE_STAGE sectors or more, such as a large f_read()
+*   or f_write() of a file, go straight to the card. They only take the newer data of
+*   cached sectors (reads) or refresh them (writes).
+*
+* Between two syncs the card holds the last sync plus whatever was evicted,
+* so a power loss costs what it costs without the cache: the data written
+* since the last f_sync().
+*
+* FILE_SYSTEM_CACHE_SECTORS sets the size of the cache, in xparameters.h
+* like the other FILE_SYSTEM_ options (cache_sectors in system.mss, an
+* option this xilffs adds in the workspace's sw_repo); 0 compiles it out
+* and every request goes to the card as before. The
+* application BSP keeps 32 sectors for the UPDATE history on SD. The FSBL
+* BSP sets 0: the FSBL only reads BOOT.BIN, in transfers that bypass the
+* cache anyway, and the lines and staging would take 24 KB of its OCM.
+*
+* The cache calls disk_cache_dev_read() and disk_cache_dev_write() for the
+* transfers; diskio.c provides them for SD and RAM, tools/sdlog for an
+* image file on the host.
+*
+* @note
+*
+******************************************************************************/
+#ifndef ___DISKCACHE_H___
+#define ___DISKCACHE_H___
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************** Include Files *********************************/
+#include "xparameters.h"
+#include "diskio.h"
+
+/************************** Constant Definitions *****************************/
+#ifdef FILE_SYSTEM_CACHE_SECTORS
+#define DISK_CACHE_SECTORS		FILE_SYSTEM_CACHE_SECTORS
+#else
+#define DISK_CACHE_SECTORS		32U	/* 16 KB, plus 8 KB of staging */
+#endif
+#define DISK_CACHE_SECTOR_SIZE	512U
+#define DISK_CACHE_STAGE		8U	/* Sectors per merged transfer */
+#define DISK_CACHE_READ_AHEAD	4U	/* Less than DISK_CACHE_STAGE */
+#define DISK_CACHE_DRIVES		2U
+
+/**************************** Type Definitions *******************************/
+typedef struct {
+	u32 ReadHits;		/* Sectors read from the cache */
+	u32 ReadMisses;		/* Sectors read from the card for a request */
+	u32 ReadAhead;		/* Sectors read from the card ahead of a request */
+	u32 Writes;		/* Sectors written into the cache */
+	u32 WriteBacks;		/* Sectors written from the cache to the card */
+	u32 Evictions;		/* Dirty sectors written back before a sync */
+	u32 Bypassed;		/* Requests that went straight to the card */
+	u32 Commands;		/* Reads and writes issued to the card */
+} DiskCacheStats;
+
+/************************** Function Prototypes ******************************/
+DRESULT disk_cache_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count);
+DRESULT disk_cache_write(BYTE pdrv, const BYTE *buff, DWORD sector,
+		UINT count);
+DRESULT disk_cache_sync(BYTE pdrv);
+void disk_cache_invalidate(BYTE pdrv);
+void disk_cache_stats(DiskCacheStats *Out);
+
+/* Transfers below the cache, provided by the glue layer */
+DRESULT disk_cache_dev_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count);
+DRESULT disk_cache_dev_write(BYTE pdrv, const BYTE *buff, DWORD sector,
+		UINT count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ___DISKCACHE_H___ */
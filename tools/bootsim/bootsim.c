@@ -0,0 +1,524 @@
+/*
+ * bootsim.c -- run the FSBL boot image loader on the host
+ *
+ * Links the unmodified zynq_fsbl/image_mover.c and md5.c against a
+ * BOOT.BIN that is mmap'd as the boot device, and replaces the device
+ * access, PCAP and register layers with models that account simulated
+ * time. LoadBootImage() walks the headers, moves each partition into a
+ * DDR window, verifies checksums and "loads" bitstreams exactly as on the
+ * board, so chunk sizes, device parameters, hashing cost and PCAP overlap
+ * can be tried in seconds instead of reflashing.
+ *
+ * The FSBL passes buffer addresses around as u32, so everything it can
+ * point at has to live below 4 GB: the binary is linked at 0x40000000,
+ * LoadBootImage() runs on a stack mapped with MAP_32BIT and the DDR
+ * window is mapped at its physical address (0x00100000 - 0x3FFFFFFF).
+ *
+ * usage: bootsim [options] BOOT.BIN
+ *   -d qspi|sd     boot device model (default qspi)
+ *   -c n[,n..]     bytes per device command, one run per value
+ *                  (default 4096 for qspi as in QspiAccess, 0 = whole
+ *                  request for sd as in SDAccess)
+ *   -l us          latency per device command
+ *   -b MB/s        device bandwidth
+ *   -p MB/s        PCAP bandwidth
+ *   -f us          fabric init (PROG_B cycle) time
+ *   -h ns          MD5 cost per byte (the FSBL runs with the D-cache off)
+ *   -z ns          LZ4 cost per inflated byte (runs with the D-cache on)
+ *   -o             also overlap the synchronous PCAP transfers with the
+ *                  following device reads (bitstreams started with
+ *                  PcapLoadPartitionAsync always overlap)
+ *   -m n           multiboot register value (image n * 32 KB into flash)
+ *   -t             print the stage timeline as [BOOTTIME] lines
+ *   -v             show the FSBL debug output
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "fsbl.h"
+#include "image_mover.h"
+#include "pcap.h"
+#include "fsbl_hooks.h"
+#include "fsbl_timeline.h"
+#include "md5.h"
+#include "lz4.h"
+
+#define DDR_BASE    0x00100000UL
+#define DDR_SIZE    (0x40000000UL - DDR_BASE)
+#define STACK_SIZE  (1024 * 1024)
+#define MAX_RUNS    16
+#define MAX_MARKS   64
+#define SD_SECTOR   512
+
+typedef struct {
+	const char *name;
+	u32 boot_mode;
+	u32 chunk;		/* bytes per command, 0 = one command per request */
+	double latency_us;	/* per command */
+	double mbps;
+	int sector_align;	/* reads are rounded out to whole sectors */
+} device_t;
+
+static const device_t devices[] = {
+	/* QspiAccess reads through a DATA_SIZE (4 KB) bounce buffer, polled */
+	{ "qspi", QSPI_MODE, 4096, 8.0, 40.0, 0 },
+	/* SDAccess is one f_lseek + f_read per request */
+	{ "sd", SD_MODE, 0, 250.0, 20.0, 1 },
+};
+
+typedef struct {
+	u16 stage;
+	u32 arg;
+	unsigned long long ns;
+} mark_t;
+
+/* model parameters */
+static device_t dev;
+static double pcap_mbps = 128.0;
+static double fabric_init_us = 100.0;
+static double md5_ns_per_byte = 60.0;
+static double lz4_ns_per_byte = 5.0;
+static int overlap;
+static int verbose;
+static u32 multiboot;
+
+/* boot image */
+static const u8 *image;
+static size_t image_size;
+
+/* state of the current run */
+static unsigned long long now_ns;
+static unsigned long long pcap_busy_ns;
+static u32 pcap_src, pcap_len;
+static unsigned long long flash_ns, pcap_ns, md5_ns, lz4_ns;
+static unsigned long flash_cmds, flash_bytes, hazards;
+static double md5_host_ms;
+static mark_t marks[MAX_MARKS];
+static int nmarks;
+static u32 last_status;
+static jmp_buf fallback_jmp;
+static ucontext_t main_ctx, fsbl_ctx;
+static u32 handoff;
+static int fell_back;
+
+/* owned by image_mover.c */
+extern ImageMoverType MoveImage;
+
+/* FSBL globals normally owned by main.c */
+u32 Silicon_Version = SILICON_VERSION_3_1;
+u32 FlashReadBaseAddress;
+u8 LinearBootDeviceFlag;
+static XDcfg DcfgInst;
+XDcfg *DcfgInstPtr = &DcfgInst;
+
+static unsigned long long xfer_ns(unsigned long bytes, double mbps) {
+	return (unsigned long long)(bytes * 1000.0 / mbps);
+}
+
+static int overlaps(u32 a, u32 alen, u32 b, u32 blen) {
+	return a < b + blen && b < a + alen;
+}
+
+static void *host_addr(u32 addr, u32 len) {
+	if ((addr >= DDR_BASE && (unsigned long)addr + len <= DDR_BASE + DDR_SIZE) ||
+	    addr >= 0x40000000UL)
+		return (void *)(uintptr_t)addr;
+	fprintf(stderr, "bootsim: FSBL accessed 0x%08x outside DDR\n", addr);
+	return NULL;
+}
+
+/*
+ * register model, just enough for LoadBootImage
+ */
+static u32 reboot_status;
+
+u32 bootsim_reg_read(UINTPTR Addr) {
+	if (Addr == REBOOT_STATUS_REG)
+		return reboot_status;
+	if (Addr == XPS_DEV_CFG_APB_BASEADDR + XDCFG_MULTIBOOT_ADDR_OFFSET)
+		return multiboot;
+	/* eFuse RSA enable, devcfg status (EFUSE_SEC_EN) and the rest read 0 */
+	return 0;
+}
+
+void bootsim_reg_write(UINTPTR Addr, u32 Value) {
+	if (Addr == REBOOT_STATUS_REG)
+		reboot_status = Value;
+}
+
+/*
+ * boot device model, installed as MoveImage
+ */
+static u32 sim_move(u32 SourceAddress, u32 DestinationAddress, u32 LengthBytes) {
+	u32 start = SourceAddress, end = SourceAddress + LengthBytes;
+	unsigned long cmds;
+	void *dst;
+
+	if ((size_t)SourceAddress + LengthBytes > image_size)
+		return XST_FAILURE;
+	dst = host_addr(DestinationAddress, LengthBytes);
+	if (dst == NULL)
+		return XST_FAILURE;
+
+	if (overlap && now_ns < pcap_busy_ns &&
+	    overlaps(DestinationAddress, LengthBytes, pcap_src, pcap_len)) {
+		fprintf(stderr, "bootsim: read into 0x%08x-0x%08x clobbers in-flight PCAP source\n",
+			DestinationAddress, DestinationAddress + LengthBytes);
+		hazards++;
+	}
+	memcpy(dst, image + SourceAddress, LengthBytes);
+
+	if (dev.sector_align) {
+		start &= ~(SD_SECTOR - 1);
+		end = (end + SD_SECTOR - 1) & ~(SD_SECTOR - 1);
+	}
+	cmds = dev.chunk ? (end - start + dev.chunk - 1) / dev.chunk : 1;
+
+	flash_cmds += cmds;
+	flash_bytes += end - start;
+	flash_ns += (unsigned long long)(cmds * dev.latency_us * 1000.0) + xfer_ns(end - start, dev.mbps);
+	now_ns += (unsigned long long)(cmds * dev.latency_us * 1000.0) + xfer_ns(end - start, dev.mbps);
+	return XST_SUCCESS;
+}
+
+/*
+ * PCAP model
+ */
+static void pcap_run(u32 src, u32 bytes, int async) {
+	unsigned long long t = xfer_ns(bytes, pcap_mbps);
+
+	pcap_ns += t;
+	if (overlap || async) {
+		unsigned long long start = now_ns > pcap_busy_ns ? now_ns : pcap_busy_ns;
+
+		pcap_busy_ns = start + t;
+		pcap_src = src;
+		pcap_len = bytes;
+	} else {
+		now_ns += t;
+	}
+}
+
+u32 PcapDataTransfer(u32 *SourceData, u32 *DestinationData, u32 SourceLength,
+		     u32 DestinationLength, u32 Flags) {
+	u32 bytes = SourceLength << WORD_LENGTH_SHIFT;
+	void *src = host_addr((u32)(uintptr_t)SourceData, bytes);
+	void *dst = host_addr((u32)(uintptr_t)DestinationData, bytes);
+
+	(void)DestinationLength;
+	(void)Flags;	/* decryption is not modelled, data passes through */
+	if (src == NULL || dst == NULL)
+		return XST_FAILURE;
+	if (src != dst)
+		memmove(dst, src, bytes);
+	if (!overlap)
+		PcapWaitAsync();
+	pcap_run((u32)(uintptr_t)SourceData, bytes, 0);
+	return XST_SUCCESS;
+}
+
+u32 PcapLoadPartition(u32 *SourceData, u32 *DestinationData, u32 SourceLength,
+		      u32 DestinationLength, u32 Flags) {
+	(void)DestinationData;
+	(void)DestinationLength;
+	(void)Flags;
+
+	PcapWaitAsync();
+	now_ns += (unsigned long long)(fabric_init_us * 1000.0);
+	FsblTimelineMark(FSBL_TL_STAGE_FABRIC_INIT, 0);
+	pcap_run((u32)(uintptr_t)SourceData, SourceLength << WORD_LENGTH_SHIFT, 0);
+	FsblTimelineMark(FSBL_TL_STAGE_PCAP_DMA, 0);
+	FsblTimelineMark(FSBL_TL_STAGE_PCAP_FPGA, 0);
+	return XST_SUCCESS;
+}
+
+/*
+ * background bitstream load: the DevC interrupt is the end of the busy
+ * window, PcapWaitAsync() blocks until then
+ */
+static int pcap_async;
+
+u32 PcapLoadPartitionAsync(u32 *SourceData, u32 *DestinationData, u32 SourceLength,
+			   u32 DestinationLength, u32 Flags) {
+	(void)DestinationData;
+	(void)DestinationLength;
+	(void)Flags;
+
+	PcapWaitAsync();
+	now_ns += (unsigned long long)(fabric_init_us * 1000.0);
+	FsblTimelineMark(FSBL_TL_STAGE_FABRIC_INIT, 0);
+	pcap_run((u32)(uintptr_t)SourceData, SourceLength << WORD_LENGTH_SHIFT, 1);
+	pcap_async = 1;
+	return XST_SUCCESS;
+}
+
+u32 PcapWaitAsync(void) {
+	u32 lag = 0;
+
+	if (!pcap_async)
+		return XST_SUCCESS;
+	pcap_async = 0;
+	if (now_ns < pcap_busy_ns)
+		now_ns = pcap_busy_ns;
+	else
+		lag = (u32)(now_ns - pcap_busy_ns);
+	FsblTimelineMark(FSBL_TL_STAGE_PCAP_DMA, lag);
+	FsblTimelineMark(FSBL_TL_STAGE_PCAP_FPGA, lag);
+	return XST_SUCCESS;
+}
+
+u32 PcapAsyncOverlaps(u32 Addr, u32 Length) {
+	return pcap_async && now_ns < pcap_busy_ns &&
+	       overlaps(Addr, Length, pcap_src, pcap_len);
+}
+
+/*
+ * hashing: md5() is the real one, wrapped to charge the target cost
+ */
+void __real_md5(u8 *input, u32 len, u8 *digest, boolean doByteSwap);
+
+void __wrap_md5(u8 *input, u32 len, u8 *digest, boolean doByteSwap) {
+	struct timespec t0, t1;
+	unsigned long long t = (unsigned long long)(len * md5_ns_per_byte);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	__real_md5(input, len, digest, doByteSwap);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	md5_host_ms += (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+	md5_ns += t;
+	now_ns += t;
+}
+
+/*
+ * decompression: the real decoder, charged per inflated byte
+ */
+u32 __real_Lz4DecompressFrame(const u8 *Src, u32 SrcLen, u8 *Dst, u32 DstLen, u32 *OutLen);
+
+u32 __wrap_Lz4DecompressFrame(const u8 *Src, u32 SrcLen, u8 *Dst, u32 DstLen, u32 *OutLen) {
+	u32 status = __real_Lz4DecompressFrame(Src, SrcLen, Dst, DstLen, OutLen);
+	unsigned long long t = (unsigned long long)(*OutLen * lz4_ns_per_byte);
+
+	lz4_ns += t;
+	now_ns += t;
+	return status;
+}
+
+void Xil_DCacheEnable(void) {
+}
+
+void Xil_DCacheDisable(void) {
+}
+
+void Xil_DCacheFlush(void) {
+}
+
+/*
+ * rest of the FSBL environment
+ */
+void FsblTimelineMark(u32 Stage, u32 Arg) {
+	if (nmarks == MAX_MARKS)
+		return;
+	marks[nmarks].stage = (u16)Stage;
+	marks[nmarks].arg = Arg;
+	marks[nmarks].ns = now_ns;
+	nmarks++;
+}
+
+void OutputStatus(u32 State) {
+	last_status = State;
+}
+
+void FsblFallback(void) {
+	longjmp(fallback_jmp, 1);
+}
+
+u32 FsblHookBeforeBitstreamDload(void) {
+	return XST_SUCCESS;
+}
+
+u32 FsblHookAfterBitstreamDload(void) {
+	return XST_SUCCESS;
+}
+
+void xil_printf(const char8 *ctrl1, ...) {
+	va_list ap;
+
+	if (!verbose)
+		return;
+	va_start(ap, ctrl1);
+	vprintf(ctrl1, ap);
+	va_end(ap);
+}
+
+/*
+ * runs on the low stack
+ */
+static void fsbl_entry(void) {
+	if (setjmp(fallback_jmp) == 0)
+		handoff = LoadBootImage();
+	else
+		fell_back = 1;
+}
+
+static const char *stage_names[] = {
+	"ENTRY", "PS7_INIT", "DDR_CHECK", "PCAP_INIT", "BOOTDEV_INIT",
+	"HEADERS", "PART_START", "PART_MOVED", "PART_CHECKED", "FABRIC_INIT",
+	"PCAP_DMA", "PCAP_FPGA", "PART_DONE", "IMAGE_LOADED", "HANDOFF",
+	"FALLBACK", "PART_INFLATED"
+};
+
+static void run(void *stack, int timeline) {
+	int i;
+
+	now_ns = pcap_busy_ns = 0;
+	pcap_src = pcap_len = 0;
+	pcap_async = 0;
+	flash_ns = pcap_ns = md5_ns = lz4_ns = 0;
+	flash_cmds = flash_bytes = hazards = 0;
+	md5_host_ms = 0.0;
+	nmarks = 0;
+	last_status = 0;
+	reboot_status = 0;
+	handoff = 0;
+	fell_back = 0;
+
+	MoveImage = sim_move;
+	FsblTimelineMark(FSBL_TL_STAGE_ENTRY, 0);
+
+	getcontext(&fsbl_ctx);
+	fsbl_ctx.uc_stack.ss_sp = stack;
+	fsbl_ctx.uc_stack.ss_size = STACK_SIZE;
+	fsbl_ctx.uc_link = &main_ctx;
+	makecontext(&fsbl_ctx, fsbl_entry, 0);
+	swapcontext(&main_ctx, &fsbl_ctx);
+
+	if (now_ns < pcap_busy_ns)
+		now_ns = pcap_busy_ns;
+	FsblTimelineMark(fell_back ? FSBL_TL_STAGE_FALLBACK : FSBL_TL_STAGE_HANDOFF, handoff);
+
+	printf("%s chunk=%-6u total %9.3f ms  device %9.3f ms (%lu cmds, %lu bytes)  "
+	       "pcap %8.3f ms  md5 %8.3f ms (host %.3f ms)",
+	       dev.name, dev.chunk, now_ns / 1e6, flash_ns / 1e6, flash_cmds, flash_bytes,
+	       pcap_ns / 1e6, md5_ns / 1e6, md5_host_ms);
+	if (lz4_ns)
+		printf("  lz4 %8.3f ms", lz4_ns / 1e6);
+	if (fell_back)
+		printf("  FALLBACK status 0x%x\n", last_status);
+	else
+		printf("  handoff 0x%08x\n", handoff);
+	if (hazards)
+		printf("%lu read(s) overwrote an in-flight PCAP source\n", hazards);
+
+	if (!timeline)
+		return;
+	printf("[BOOTTIME] cps=1000000000 entries=%d mode=%u flags=%u app=0\n",
+	       nmarks, dev.boot_mode, fell_back ? 0 : FSBL_TL_HDR_HANDOFF);
+	for (i = 0; i < nmarks; i++)
+		printf("[BOOTTIME] %d %s 0x%08x %llu\n", i,
+		       marks[i].stage < sizeof(stage_names) / sizeof(stage_names[0]) ?
+		       stage_names[marks[i].stage] : "UNKNOWN",
+		       marks[i].arg, marks[i].ns);
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: bootsim [-d qspi|sd] [-c n[,n..]] [-l us] [-b MB/s] [-p MB/s]\n"
+		"               [-f us] [-h ns] [-z ns] [-o] [-m n] [-t] [-v] BOOT.BIN\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	u32 chunks[MAX_RUNS];
+	int nchunks = 0, timeline = 0, opt, fd, i;
+	double latency = -1.0, mbps = -1.0;
+	struct stat st;
+	void *stack, *ddr;
+	char *p;
+
+	dev = devices[0];
+	while ((opt = getopt(argc, argv, "d:c:l:b:p:f:h:z:om:tv")) != -1) {
+		switch (opt) {
+		case 'd':
+			for (i = 0; i < (int)(sizeof(devices) / sizeof(devices[0])); i++)
+				if (strcmp(optarg, devices[i].name) == 0)
+					break;
+			if (i == (int)(sizeof(devices) / sizeof(devices[0])))
+				usage();
+			dev = devices[i];
+			break;
+		case 'c':
+			for (p = optarg; *p && nchunks < MAX_RUNS; p++) {
+				chunks[nchunks++] = (u32)strtoul(p, &p, 0);
+				if (*p != ',')
+					break;
+			}
+			break;
+		case 'l': latency = atof(optarg); break;
+		case 'b': mbps = atof(optarg); break;
+		case 'p': pcap_mbps = atof(optarg); break;
+		case 'f': fabric_init_us = atof(optarg); break;
+		case 'h': md5_ns_per_byte = atof(optarg); break;
+		case 'z': lz4_ns_per_byte = atof(optarg); break;
+		case 'o': overlap = 1; break;
+		case 'm': multiboot = (u32)strtoul(optarg, NULL, 0); break;
+		case 't': timeline = 1; break;
+		case 'v': verbose = 1; break;
+		default: usage();
+		}
+	}
+	if (optind + 1 != argc)
+		usage();
+	if (latency >= 0.0)
+		dev.latency_us = latency;
+	if (mbps > 0.0)
+		dev.mbps = mbps;
+	if (nchunks == 0)
+		chunks[nchunks++] = dev.chunk;
+	if (dev.mbps <= 0.0 || pcap_mbps <= 0.0)
+		usage();
+
+	fd = open(argv[optind], O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+	image_size = st.st_size;
+	image = mmap(NULL, image_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (image == MAP_FAILED) {
+		perror("mmap image");
+		return 1;
+	}
+	close(fd);
+
+	ddr = mmap((void *)DDR_BASE, DDR_SIZE, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE, -1, 0);
+	if (ddr != (void *)DDR_BASE) {
+		fprintf(stderr, "bootsim: cannot map DDR window at 0x%08lx: %s\n",
+			DDR_BASE, strerror(errno));
+		return 1;
+	}
+
+	stack = mmap(NULL, STACK_SIZE, PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+	if (stack == MAP_FAILED || (uintptr_t)stack + STACK_SIZE > 0xFFFFFFFFUL) {
+		fprintf(stderr, "bootsim: cannot map a stack below 4 GB\n");
+		return 1;
+	}
+
+	for (i = 0; i < nchunks; i++) {
+		dev.chunk = chunks[i];
+		run(stack, timeline);
+	}
+	return 0;
+}
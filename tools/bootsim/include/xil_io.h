@@ -0,0 +1,37 @@
+/*
+ * xil_io.h -- host shim for the FSBL register accessors
+ *
+ * Placed ahead of the BSP include directory when the FSBL sources are built
+ * for the boot image simulator. The BSP header is pulled in for everything
+ * else it declares, but its register accessors dereference physical
+ * addresses, so they are parked under other names and the plain ones are
+ * routed to the simulator's register model.
+ */
+#ifndef BOOTSIM_XIL_IO_H
+#define BOOTSIM_XIL_IO_H
+
+#define Xil_In8   bsp_Xil_In8
+#define Xil_In16  bsp_Xil_In16
+#define Xil_In32  bsp_Xil_In32
+#define Xil_Out8  bsp_Xil_Out8
+#define Xil_Out16 bsp_Xil_Out16
+#define Xil_Out32 bsp_Xil_Out32
+#include_next "xil_io.h"
+#undef Xil_In8
+#undef Xil_In16
+#undef Xil_In32
+#undef Xil_Out8
+#undef Xil_Out16
+#undef Xil_Out32
+
+u32 bootsim_reg_read(UINTPTR Addr);
+void bootsim_reg_write(UINTPTR Addr, u32 Value);
+
+#define Xil_In8(Addr)          ((u8)bootsim_reg_read(Addr))
+#define Xil_In16(Addr)         ((u16)bootsim_reg_read(Addr))
+#define Xil_In32(Addr)         bootsim_reg_read(Addr)
+#define Xil_Out8(Addr, Value)  bootsim_reg_write((Addr), (u8)(Value))
+#define Xil_Out16(Addr, Value) bootsim_reg_write((Addr), (u16)(Value))
+#define Xil_Out32(Addr, Value) bootsim_reg_write((Addr), (u32)(Value))
+
+#endif
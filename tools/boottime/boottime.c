@@ -0,0 +1,219 @@
+/*
+ * boottime.c -- render and compare FSBL boot timelines
+ *
+ * Reads console captures containing the [BOOTTIME] lines printed by
+ * module6_sw/src/boottime.c and prints every boot stage with its absolute
+ * time, the time spent since the previous marker and a proportional bar.
+ * Given two captures it lines the stages up and prints the difference,
+ * which is the quickest way to see what a BOOT.BIN or FSBL change bought.
+ *
+ * usage: boottime [-b bypass_hz] capture.txt [other.txt]
+ *
+ * Markers taken before ps7_init run on the PLL bypass clock; their ticks are
+ * converted with bypass_hz (PS_CLK / 2, 16.67 MHz for a 33.33 MHz PS_CLK).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ENTRIES 64
+#define NAME_LEN 32
+#define BAR_WIDTH 40
+
+typedef struct {
+	char name[NAME_LEN];
+	unsigned long arg;
+	unsigned long long ticks;
+	int pre_pll;
+	double ms;	/* since the FSBL crt0 reset the global timer */
+} entry_t;
+
+typedef struct {
+	const char *path;
+	unsigned long cps;
+	unsigned long mode;
+	unsigned long flags;
+	int count;
+	entry_t entry[MAX_ENTRIES];
+} timeline_t;
+
+static double bypass_hz = 16666666.0;
+
+static int load(const char *path, timeline_t *tl) {
+	FILE *fp;
+	char line[256];
+	unsigned long long pre_ticks = 0;
+	double pre_ms = 0.0;
+	int i;
+
+	memset(tl, 0, sizeof(*tl));
+	tl->path = path;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *p = strstr(line, "[BOOTTIME]");
+		entry_t *e;
+		int idx;
+		char flag[16];
+
+		if (p == NULL)
+			continue;
+		p += strlen("[BOOTTIME]");
+
+		if (sscanf(p, " cps=%lu entries=%*u mode=%lu flags=%lu",
+			   &tl->cps, &tl->mode, &tl->flags) == 3)
+			continue;
+
+		if (tl->count == MAX_ENTRIES)
+			continue;
+		e = &tl->entry[tl->count];
+		flag[0] = '\0';
+		if (sscanf(p, " %d %31s %lx %llu %15s", &idx, e->name, &e->arg,
+			   &e->ticks, flag) < 4)
+			continue;
+		e->pre_pll = (strcmp(flag, "pre-pll") == 0);
+		tl->count++;
+	}
+	fclose(fp);
+
+	if (tl->cps == 0 || tl->count == 0) {
+		fprintf(stderr, "%s: no [BOOTTIME] record found\n", path);
+		return -1;
+	}
+
+	/*
+	 * the counter keeps running across the PLL switch, so everything after
+	 * the last pre-PLL marker is offset from that point at the locked rate
+	 */
+	for (i = 0; i < tl->count; i++) {
+		entry_t *e = &tl->entry[i];
+
+		if (e->pre_pll) {
+			e->ms = (double)e->ticks * 1000.0 / bypass_hz;
+			pre_ticks = e->ticks;
+			pre_ms = e->ms;
+		} else {
+			e->ms = pre_ms + (double)(e->ticks - pre_ticks) * 1000.0 / (double)tl->cps;
+		}
+	}
+	return 0;
+}
+
+static void render(const timeline_t *tl) {
+	double total = tl->entry[tl->count - 1].ms;
+	double prev = 0.0;
+	int i, n;
+
+	printf("%s: %d markers, boot mode 0x%lx, %.3f ms to last marker%s\n",
+	       tl->path, tl->count, tl->mode, total,
+	       (tl->flags & 0x1) ? " (overflowed)" : "");
+	printf("%-14s %-10s %10s %10s\n", "stage", "arg", "at ms", "delta ms");
+
+	for (i = 0; i < tl->count; i++) {
+		const entry_t *e = &tl->entry[i];
+		double delta = e->ms - prev;
+
+		printf("%-14s 0x%08lx %10.3f %10.3f ", e->name, e->arg, e->ms, delta);
+		n = (total > 0.0) ? (int)(delta / total * BAR_WIDTH + 0.5) : 0;
+		while (n-- > 0)
+			putchar('#');
+		putchar('\n');
+		prev = e->ms;
+	}
+}
+
+/* nth occurrence of (name, arg) in tl, or NULL */
+static const entry_t *find(const timeline_t *tl, const entry_t *key, int nth) {
+	int i;
+
+	for (i = 0; i < tl->count; i++) {
+		const entry_t *e = &tl->entry[i];
+
+		if (strcmp(e->name, key->name) == 0 && e->arg == key->arg && nth-- == 0)
+			return e;
+	}
+	return NULL;
+}
+
+static void compare(const timeline_t *a, const timeline_t *b) {
+	double prev_a = 0.0, prev_b = 0.0;
+	int i, j, nth;
+
+	printf("A: %s\nB: %s\n", a->path, b->path);
+	printf("%-14s %-10s %10s %10s %10s %10s\n",
+	       "stage", "arg", "A delta", "B delta", "diff", "B-A at");
+
+	for (i = 0; i < a->count; i++) {
+		const entry_t *ea = &a->entry[i];
+		const entry_t *eb;
+
+		nth = 0;
+		for (j = 0; j < i; j++)
+			if (strcmp(a->entry[j].name, ea->name) == 0 && a->entry[j].arg == ea->arg)
+				nth++;
+
+		eb = find(b, ea, nth);
+		if (eb == NULL) {
+			printf("%-14s 0x%08lx %10.3f %10s\n", ea->name, ea->arg,
+			       ea->ms - prev_a, "-");
+			prev_a = ea->ms;
+			continue;
+		}
+
+		printf("%-14s 0x%08lx %10.3f %10.3f %+10.3f %+10.3f\n",
+		       ea->name, ea->arg, ea->ms - prev_a, eb->ms - prev_b,
+		       (eb->ms - prev_b) - (ea->ms - prev_a), eb->ms - ea->ms);
+		prev_a = ea->ms;
+		prev_b = eb->ms;
+	}
+
+	for (i = 0; i < b->count; i++) {
+		const entry_t *eb = &b->entry[i];
+
+		nth = 0;
+		for (j = 0; j < i; j++)
+			if (strcmp(b->entry[j].name, eb->name) == 0 && b->entry[j].arg == eb->arg)
+				nth++;
+		if (find(a, eb, nth) == NULL)
+			printf("%-14s 0x%08lx %10s %10s (only in B)\n", eb->name, eb->arg, "-", "-");
+	}
+
+	printf("total: A %.3f ms, B %.3f ms, %+.3f ms\n",
+	       a->entry[a->count - 1].ms, b->entry[b->count - 1].ms,
+	       b->entry[b->count - 1].ms - a->entry[a->count - 1].ms);
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: boottime [-b bypass_hz] capture.txt [other.txt]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	static timeline_t a, b;
+	int argi = 1;
+
+	if (argi + 1 < argc && strcmp(argv[argi], "-b") == 0) {
+		bypass_hz = atof(argv[argi + 1]);
+		if (bypass_hz <= 0.0)
+			usage();
+		argi += 2;
+	}
+
+	if (argc - argi == 1) {
+		if (load(argv[argi], &a) != 0)
+			return 1;
+		render(&a);
+	} else if (argc - argi == 2) {
+		if (load(argv[argi], &a) != 0 || load(argv[argi + 1], &b) != 0)
+			return 1;
+		compare(&a, &b);
+	} else {
+		usage();
+	}
+	return 0;
+}
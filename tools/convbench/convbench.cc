@@ -0,0 +1,363 @@
+/*
+ * convbench.cc -- transactions a second through b_transport_converter
+ *
+ * An initiator makes 32 bit reads and writes through the converter of the
+ * PS7 IP's sim_tlm directory to a memory model, as a CPU model does to
+ * BRAM or DDR behind M_AXI_GP0, keeping its time with a quantum keeper.
+ * It is run three times:
+ *
+ *   b_transport   every access a transaction to the memory, through a
+ *                 B_TRANSPORT range
+ *   conv dmi      every access a transaction to the converter, through a
+ *                 DMI_IF range, which the converter serves with a pointer
+ *                 of its own, as for remote-port, which never asks for one
+ *   dmi           the pointer asked for by the initiator when the
+ *                 memory's response allows it, then accesses are a memcpy
+ *                 and the DMI latency
+ *
+ * The runs take turns in one thread, so none is timed over another.
+ * The memory is routed through the converter as a DMI_IF range, then a
+ * TRANSPORT_DBG range, then a B_TRANSPORT range at MEM_SIZE / 2 that the
+ * first run uses. The runs check that a region granted is cut down to its
+ * range, that the TRANSPORT_DBG range still works, that an invalidation
+ * from the memory halfway through drops the pointer and it is asked for
+ * again, and that every word reads back as written. All runs must take
+ * the same simulated time.
+ *
+ * With -b the accesses are bursts of that many bytes, aligned and with no
+ * byte enables, which the conv dmi run copies in one pass. With -r the
+ * three runs are taken that many times over and each keeps its fastest,
+ * which is what the ratios are of; one round on a busy host is noise.
+ *
+ * Built against SystemC (SYSTEMC=) or, without it, the stand-in in scmini/
+ * (SCMINI=1). The ratios between the runs are the result; against the
+ * stand-in they say nothing of SystemC's own per-transaction cost.
+ *
+ * usage: convbench [-n accesses] [-b burst] [-r rounds]
+ *   -n  accesses a run (default 20000000)
+ *   -b  bytes an access, a multiple of 4 (default 4)
+ *   -r  rounds of the three runs (default 1)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "systemc.h"
+#include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/simple_target_socket.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
+
+#include "b_transport_converter.h"
+
+#define MEM_SIZE        (2 << 20)
+#define DMI_SIZE        (MEM_SIZE / 4)
+#define LATENCY         sc_time(10, SC_NS)     /* a 32 bit beat */
+#define MAX_BURST       256
+
+enum { RUN_TRANSPORT, RUN_CONV_DMI, RUN_DMI, RUNS };
+static const char *const run_names[RUNS] = { "b_transport", "conv dmi", "dmi" };
+
+typedef b_transport_converter<32, 32> converter;
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+class memory : public sc_module
+{
+public:
+	tlm_utils::simple_target_socket<memory> socket;
+	unsigned char mem[MEM_SIZE];
+
+	unsigned long grants;
+
+	memory(sc_module_name name) : sc_module(name), socket("socket"), grants(0)
+	{
+		socket.register_b_transport(this, &memory::b_transport);
+		socket.register_transport_dbg(this, &memory::transport_dbg);
+		socket.register_get_direct_mem_ptr(this, &memory::get_direct_mem_ptr);
+		memset(mem, 0, sizeof(mem));
+	}
+
+	void invalidate()
+	{
+		socket->invalidate_direct_mem_ptr(0, MEM_SIZE - 1);
+	}
+
+private:
+	bool copy(tlm::tlm_generic_payload &gp)
+	{
+		sc_dt::uint64 addr = gp.get_address();
+		unsigned int len = gp.get_data_length();
+
+		if (addr >= MEM_SIZE || len > MEM_SIZE - addr) {
+			gp.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+			return false;
+		}
+		if (gp.is_read())
+			memcpy(gp.get_data_ptr(), mem + addr, len);
+		else
+			memcpy(mem + addr, gp.get_data_ptr(), len);
+		gp.set_response_status(tlm::TLM_OK_RESPONSE);
+		return true;
+	}
+
+	void b_transport(tlm::tlm_generic_payload &gp, sc_time &delay)
+	{
+		if (copy(gp)) {
+			delay += (double)((gp.get_data_length() + 3) / 4) * LATENCY;
+			gp.set_dmi_allowed(true);
+		}
+	}
+
+	unsigned int transport_dbg(tlm::tlm_generic_payload &gp)
+	{
+		return copy(gp) ? gp.get_data_length() : 0;
+	}
+
+	bool get_direct_mem_ptr(tlm::tlm_generic_payload &, tlm::tlm_dmi &dmi)
+	{
+		grants++;
+		dmi.set_dmi_ptr(mem);
+		dmi.set_start_address(0);
+		dmi.set_end_address(MEM_SIZE - 1);
+		dmi.set_read_latency(LATENCY);
+		dmi.set_write_latency(LATENCY);
+		dmi.allow_read_write();
+		return true;
+	}
+};
+
+struct result {
+	unsigned long dmi_asks, dmi_drops, errors;
+	double seconds;
+	sc_time simulated;
+};
+
+class initiator : public sc_module
+{
+public:
+	tlm_utils::simple_initiator_socket<initiator> socket;
+	struct result res[RUNS];
+
+	SC_HAS_PROCESS(initiator);
+	initiator(sc_module_name name, memory *target, unsigned long accesses, unsigned int burst,
+		  unsigned int rounds)
+		: sc_module(name), socket("socket"), target(target), accesses(accesses),
+		  burst(burst), rounds(rounds), use_dmi(false), dmi_valid(false)
+	{
+		socket.register_invalidate_direct_mem_ptr(this, &initiator::invalidate_direct_mem_ptr);
+		SC_THREAD(run);
+	}
+
+private:
+	memory *target;
+	unsigned long accesses;
+	unsigned int burst;
+	unsigned int rounds;
+	bool use_dmi;
+	struct result *r;
+	tlm_utils::tlm_quantumkeeper qk;
+	tlm::tlm_generic_payload gp;
+	tlm::tlm_dmi dmi;
+	bool dmi_valid;
+
+	void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+	{
+		if (dmi_valid && start <= dmi.get_end_address() && end >= dmi.get_start_address()) {
+			dmi_valid = false;
+			r->dmi_drops++;
+		}
+	}
+
+	void access(tlm::tlm_command cmd, sc_dt::uint64 addr, uint32_t *data, unsigned int len)
+	{
+		if (dmi_valid && addr >= dmi.get_start_address() &&
+		    addr + len - 1 <= dmi.get_end_address()) {
+			unsigned char *p = dmi.get_dmi_ptr() + (addr - dmi.get_start_address());
+
+			if (cmd == tlm::TLM_READ_COMMAND) {
+				memcpy(data, p, len);
+				qk.inc((double)(len / 4) * dmi.get_read_latency());
+			} else {
+				memcpy(p, data, len);
+				qk.inc((double)(len / 4) * dmi.get_write_latency());
+			}
+		} else {
+			sc_time delay = qk.get_local_time();
+
+			gp.set_command(cmd);
+			gp.set_address(addr);
+			gp.set_data_ptr((unsigned char *)data);
+			gp.set_data_length(len);
+			gp.set_streaming_width(len);
+			gp.set_byte_enable_ptr(NULL);
+			gp.set_dmi_allowed(false);
+			gp.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+			socket->b_transport(gp, delay);
+			qk.set(delay);
+			if (!gp.is_response_ok())
+				r->errors++;
+			if (use_dmi && gp.is_dmi_allowed() && !dmi_valid) {
+				dmi.init();
+				r->dmi_asks++;
+				dmi_valid = socket->get_direct_mem_ptr(gp, dmi);
+			}
+		}
+		if (qk.need_sync())
+			qk.sync();
+	}
+
+	static uint32_t pattern(sc_dt::uint64 addr, unsigned long pass)
+	{
+		return (uint32_t)(addr * 2654435761u) ^ (uint32_t)pass;
+	}
+
+	void measure(int run, unsigned int round)
+	{
+		const sc_dt::uint64 base = run == RUN_TRANSPORT ? MEM_SIZE / 2 : 0;
+		const unsigned int words = burst / 4;
+		unsigned long i, pass = 0, grants = target->grants;
+		uint32_t v[MAX_BURST / 4];
+		sc_dt::uint64 addr = 0;
+		unsigned int w;
+		sc_time start;
+		double t0, seconds;
+
+		use_dmi = run == RUN_DMI;
+		dmi_valid = false;
+		r = &res[run];
+		r->dmi_asks = r->dmi_drops = 0;
+		if (round == 0)
+			r->errors = 0;
+		memset(target->mem, 0, sizeof(target->mem));
+		qk.reset();
+		start = sc_time_stamp();
+		t0 = now_s();
+		for (i = 0; i < accesses; i++) {
+			/* write a pass over the window, then read it back */
+			if (pass % 2 == 0) {
+				for (w = 0; w < words; w++)
+					v[w] = pattern(addr + w * 4, pass);
+				access(tlm::TLM_WRITE_COMMAND, base + addr, v, burst);
+			} else {
+				access(tlm::TLM_READ_COMMAND, base + addr, v, burst);
+				for (w = 0; w < words; w++)
+					if (v[w] != pattern(addr + w * 4, pass - 1))
+						r->errors++;
+			}
+			if (i == accesses / 2)
+				target->invalidate();
+			addr += burst;
+			if (addr + burst > DMI_SIZE) {
+				addr = 0;
+				pass++;
+			}
+		}
+		seconds = now_s() - t0;
+		if (round == 0 || seconds < r->seconds)
+			r->seconds = seconds;
+		qk.sync();
+		r->simulated = sc_time_stamp() - start;
+		grants = target->grants - grants;
+
+		if (run == RUN_DMI) {
+			/* the grant stops at the end of the DMI range */
+			if (dmi_valid && (dmi.get_start_address() != 0 ||
+					  dmi.get_end_address() != DMI_SIZE - 1)) {
+				fprintf(stderr, "convbench: DMI granted for 0x%llx..0x%llx\n",
+					(unsigned long long)dmi.get_start_address(),
+					(unsigned long long)dmi.get_end_address());
+				r->errors++;
+			}
+			if (r->dmi_asks != 2 || r->dmi_drops != 1) {
+				fprintf(stderr, "convbench: DMI asked %lu times, dropped %lu times\n",
+					r->dmi_asks, r->dmi_drops);
+				r->errors++;
+			}
+		} else if (grants != (run == RUN_CONV_DMI ? 2u : 0u)) {
+			/* the converter's own, and again after the invalidation */
+			fprintf(stderr, "convbench: %s: DMI granted %lu times\n", run_names[run], grants);
+			r->errors++;
+		}
+		/* past the DMI range, through transport_dbg */
+		v[0] = 0x5A5A5A5A;
+		access(tlm::TLM_WRITE_COMMAND, DMI_SIZE + 8, v, 4);
+		if (memcmp(target->mem + DMI_SIZE + 8, v, 4) != 0)
+			r->errors++;
+	}
+
+	void run()
+	{
+		unsigned int round;
+		int i;
+
+		for (round = 0; round < rounds; round++)
+			for (i = 0; i < RUNS; i++)
+				measure(i, round);
+	}
+};
+
+int sc_main(int argc, char *argv[])
+{
+	unsigned long accesses = 20000000;
+	unsigned int burst = 4, rounds = 1;
+	initiator *cpu;
+	memory *mem;
+	converter *conv;
+	int opt, i, status = 0;
+
+	while ((opt = getopt(argc, argv, "n:b:r:")) != -1) {
+		switch (opt) {
+		case 'n': accesses = strtoul(optarg, NULL, 0); break;
+		case 'b': burst = strtoul(optarg, NULL, 0); break;
+		case 'r': rounds = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: convbench [-n accesses] [-b burst] [-r rounds]\n");
+			return 2;
+		}
+	}
+	if (burst == 0 || burst % 4 != 0 || burst > MAX_BURST) {
+		fprintf(stderr, "convbench: a burst is 4 to %d bytes, in words\n", MAX_BURST);
+		return 2;
+	}
+	if (rounds == 0) {
+		fprintf(stderr, "convbench: -r takes at least one round\n");
+		return 2;
+	}
+
+	sc_set_time_resolution(1, SC_PS);
+	tlm::tlm_global_quantum::instance().set(sc_time(10, SC_US));
+	converter::add_addr_range(converter::DMI_IF, 0, DMI_SIZE);
+	converter::add_addr_range(converter::TRANSPORT_DBG, DMI_SIZE, MEM_SIZE / 2);
+	converter::add_addr_range(converter::B_TRANSPORT, MEM_SIZE / 2, MEM_SIZE);
+	mem = new memory("mem");
+	conv = new converter("conv");
+	cpu = new initiator("cpu", mem, accesses, burst, rounds);
+	cpu->socket.bind(conv->target_socket);
+	conv->initiator_socket.bind(mem->socket);
+	sc_start();
+
+	for (i = 0; i < RUNS; i++) {
+		struct result *r = &cpu->res[i];
+
+		printf("%-12s %lu accesses of %u bytes in %.3f s, %.1f M/s, %.1fx, %.3f ms simulated\n",
+		       run_names[i], accesses, burst, r->seconds, accesses / r->seconds / 1e6,
+		       cpu->res[RUN_TRANSPORT].seconds / r->seconds, r->simulated.to_seconds() * 1e3);
+		if (r->errors != 0) {
+			fprintf(stderr, "convbench: %s: %lu errors\n", run_names[i], r->errors);
+			status = 1;
+		}
+		if (r->simulated != cpu->res[RUN_TRANSPORT].simulated) {
+			fprintf(stderr, "convbench: %s took a different simulated time\n", run_names[i]);
+			status = 1;
+		}
+	}
+	return status;
+}
@@ -0,0 +1,203 @@
+/*
+ * fmtbench.c -- time module6_sw/src/fmt.c against the BSP xil_printf
+ *
+ * Both are built from the tree: xil_printf.c from the application BSP
+ * with outbyte() standing in for XUartPs_SendByte (one status read and one
+ * FIFO write per character), and fmt.c with its UART accesses routed
+ * through the bootsim xil_io.h shim to a model of the stdout UART. Each
+ * line is rendered by both, the output has to match byte for byte, and the
+ * host time per line and the UART register accesses per line are printed.
+ * "fmt (mem)" renders into a memory sink, the cost of formatting alone.
+ *
+ * The host prices a register access like a store to memory, so the
+ * console rows measure the formatting plus one call per byte on both
+ * sides and come out about even. On the board the UART status read
+ * xil_printf makes before every byte is an uncached device read; the
+ * reads/line column is the part of the comparison that carries over.
+ *
+ * usage: fmtbench [-n lines]
+ *   -n lines  lines per case (default 1000000)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "xil_printf.h"
+#include "xuartps_hw.h"
+#include "fmt.h"
+
+#define OUT_SIZE (1 << 16)
+
+static char out[OUT_SIZE];
+static u32 out_len;
+static unsigned long reg_reads, reg_writes;
+
+static void out_byte(char c) {
+	if (out_len < OUT_SIZE)
+		out[out_len++] = c;
+}
+
+/*
+ * stdout UART for fmt_uart_write(), the TX FIFO is always empty
+ */
+u32 bootsim_reg_read(UINTPTR Addr) {
+	reg_reads++;
+	if (Addr == STDOUT_BASEADDRESS + XUARTPS_SR_OFFSET)
+		return XUARTPS_SR_TXEMPTY;
+	return 0;
+}
+
+void bootsim_reg_write(UINTPTR Addr, u32 Value) {
+	reg_writes++;
+	if (Addr == STDOUT_BASEADDRESS + XUARTPS_FIFO_OFFSET)
+		out_byte((char)Value);
+}
+
+/*
+ * XUartPs_SendByte: wait while the TX FIFO is full, then write
+ */
+void outbyte(char8 c) {
+	reg_reads++;
+	reg_writes++;
+	out_byte(c);
+}
+
+static void mem_write(const char *data, u32 len) {
+	if (out_len + len <= OUT_SIZE) {
+		memcpy(out + out_len, data, len);
+		out_len += len;
+	}
+}
+
+FMT_SINK_DEFINE(mem_sink, 256, mem_write);
+
+static const char *states[] = { "RED_LIGHT", "YELLOW_LIGHT1", "GREEN_LIGHT", "MAINTENANCE" };
+
+static const fmt_desc_t status_fmt[] = {
+	FMT_LIT("\r"), FMT_S(-15),
+	FMT_LIT(" | Gate: "), FMT_S(-6),
+	FMT_LIT(" | Train: "), FMT_S(-8),
+	FMT_LIT(" | Ped: "), FMT_S(0),
+	FMT_LIT(" \n"), FMT_END
+};
+
+static const fmt_desc_t number_fmt[] = {
+	FMT_LIT("[ADC] 0x"), FMT_XU0(8), FMT_LIT(" raw "), FMT_D(6),
+	FMT_LIT(" tick "), FMT_U(0), FMT_LIT(" err "), FMT_D(0),
+	FMT_LIT("\r\n"), FMT_END
+};
+
+static void status_xil(u32 i) {
+	xil_printf("\r%-15s | Gate: %-6s | Train: %-8s | Ped: %s \n",
+		   states[i & 3], (i & 4) ? "OPEN" : "CLOSED",
+		   (i & 8) ? "ARRIVING" : "CLEAR", (i & 16) ? "WALK" : "STOP");
+}
+
+static void status_fmt_out(u32 i) {
+	fmt_out(&fmt_console, status_fmt,
+		states[i & 3], (i & 4) ? "OPEN" : "CLOSED",
+		(i & 8) ? "ARRIVING" : "CLEAR", (i & 16) ? "WALK" : "STOP");
+	fmt_flush(&fmt_console);
+}
+
+static void status_fmt_mem(u32 i) {
+	fmt_out(&mem_sink, status_fmt,
+		states[i & 3], (i & 4) ? "OPEN" : "CLOSED",
+		(i & 8) ? "ARRIVING" : "CLEAR", (i & 16) ? "WALK" : "STOP");
+	fmt_flush(&mem_sink);
+}
+
+static void number_xil(u32 i) {
+	xil_printf("[ADC] 0x%08X raw %6d tick %u err %d\r\n",
+		   i * 2654435761u, (s32)(i % 4096) - 2048, i * 7, -(s32)(i & 0xFFFF));
+}
+
+static void number_fmt_out(u32 i) {
+	fmt_out(&fmt_console, number_fmt,
+		i * 2654435761u, (s32)(i % 4096) - 2048, i * 7, -(s32)(i & 0xFFFF));
+	fmt_flush(&fmt_console);
+}
+
+static void number_fmt_mem(u32 i) {
+	fmt_out(&mem_sink, number_fmt,
+		i * 2654435761u, (s32)(i % 4096) - 2048, i * 7, -(s32)(i & 0xFFFF));
+	fmt_flush(&mem_sink);
+}
+
+static double now_s(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/*
+ * render one line with each, they must agree
+ */
+static void check(const char *name, void (*a)(u32), void (*b)(u32), u32 i) {
+	char ref[256];
+	u32 len;
+
+	out_len = 0;
+	a(i);
+	len = out_len;
+	memcpy(ref, out, len);
+	out_len = 0;
+	b(i);
+	if (out_len != len || memcmp(ref, out, len) != 0) {
+		fprintf(stderr, "fmtbench: %s differs for %u:\n  %.*s\n  %.*s\n",
+			name, i, (int)len, ref, (int)out_len, out);
+		exit(1);
+	}
+}
+
+static void run(const char *name, void (*fn)(u32), u32 lines) {
+	double t0, t1;
+	u32 i, bytes = 0;
+
+	reg_reads = reg_writes = 0;
+	t0 = now_s();
+	for (i = 0; i < lines; i++) {
+		out_len = 0;
+		fn(i);
+		bytes += out_len;
+	}
+	t1 = now_s();
+	printf("  %-10s %7.1f ns/line  %5.1f bytes/line  %5.1f reads %5.1f writes/line\n",
+	       name, (t1 - t0) * 1e9 / lines, (double)bytes / lines,
+	       (double)reg_reads / lines, (double)reg_writes / lines);
+}
+
+int main(int argc, char **argv) {
+	u32 lines = 1000000, i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n': lines = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: fmtbench [-n lines]\n");
+			return 2;
+		}
+	}
+	if (lines == 0)
+		lines = 1;
+
+	for (i = 0; i < 100000; i += 7) {
+		check("status line", status_xil, status_fmt_out, i);
+		check("number line", number_xil, number_fmt_out, i);
+	}
+	check("number line", number_xil, number_fmt_out, 0x80000000u);
+
+	printf("status line (fsm.c update_display)\n");
+	run("xil_printf", status_xil, lines);
+	run("fmt", status_fmt_out, lines);
+	run("fmt (mem)", status_fmt_mem, lines);
+	printf("number line (%%08X %%6d %%u %%d)\n");
+	run("xil_printf", number_xil, lines);
+	run("fmt", number_fmt_out, lines);
+	run("fmt (mem)", number_fmt_mem, lines);
+	return 0;
+}
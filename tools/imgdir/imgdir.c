@@ -0,0 +1,269 @@
+/*
+ * imgdir.c -- lay out multiboot flash images with an image directory
+ *
+ * Places a golden BOOT.BIN at offset 0 and update images after it, each in
+ * the next free 32 KB multiboot slot, and writes the image directory the
+ * FSBL reads on fallback (see zynq_fsbl/image_dir.h) into the last 32 KB of
+ * the flash. The directory lists the updates newest version first and the
+ * golden image last, so a failed update falls back to the previous one and
+ * finally to golden, each with a single directory read.
+ *
+ * -l reads the directory back from a flash image, checks every image
+ * against it and counts the 4 byte flash reads the linear search in
+ * NextValidImageCheck() makes for each fallback, against the two reads
+ * (directory and header checksum word) the directory lookup makes.
+ *
+ * usage: imgdir [-s MB] -o flash.bin golden.bin[:ver] [update.bin[:ver] ...]
+ *        imgdir -l flash.bin
+ *   -s MB   flash size (default 16, the directory goes in the last 32 KB)
+ *   :ver    image version (default 0 for golden, 1, 2, .. for updates)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fsbl.h"
+#include "image_dir.h"
+
+#define MAX_IMAGES	IMAGE_DIR_MAX_ENTRIES
+
+typedef struct {
+	const char *path;
+	u8 *data;
+	long size;
+	u32 offset;
+	u32 version;
+	u32 checksum;
+	int golden;
+} image_t;
+
+static u32 rd32(const u8 *p) {
+	return (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+}
+
+static void wr32(u8 *p, u32 v) {
+	p[0] = (u8)v;
+	p[1] = (u8)(v >> 8);
+	p[2] = (u8)(v >> 16);
+	p[3] = (u8)(v >> 24);
+}
+
+static u8 *read_file(const char *path, long *size) {
+	FILE *f = fopen(path, "rb");
+	u8 *buf;
+
+	if (f == NULL) {
+		perror(path);
+		exit(1);
+	}
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	rewind(f);
+	buf = malloc(*size ? *size : 1);
+	if (buf == NULL || fread(buf, 1, *size, f) != (size_t)*size) {
+		fprintf(stderr, "imgdir: cannot read %s\n", path);
+		exit(1);
+	}
+	fclose(f);
+	return buf;
+}
+
+/*
+ * boot header check of HeaderChecksum()/ImageCheckID(), returns the
+ * checksum word or exits
+ */
+static u32 boot_header(const u8 *img, long size, const char *path) {
+	u32 sum = 0;
+	int i;
+
+	if (size < IMAGE_CHECKSUM_OFFSET + 4 ||
+	    rd32(img + IMAGE_IDENT_OFFSET) != IMAGE_IDENT) {
+		fprintf(stderr, "imgdir: %s: not a boot image\n", path);
+		exit(1);
+	}
+	for (i = 0; i < IMAGE_HEADER_CHECKSUM_COUNT; i++)
+		sum += rd32(img + IMAGE_WIDTH_CHECK_OFFSET + 4 * i);
+	if ((sum ^ 0xFFFFFFFF) != rd32(img + IMAGE_CHECKSUM_OFFSET)) {
+		fprintf(stderr, "imgdir: %s: bad boot header checksum\n", path);
+		exit(1);
+	}
+	return rd32(img + IMAGE_CHECKSUM_OFFSET);
+}
+
+static u32 dir_checksum(const u8 *dir) {
+	u32 sum = 0;
+	int i;
+
+	for (i = 0; i < IMAGE_DIR_SIZE / 4; i++)
+		if (i != 3)
+			sum += rd32(dir + 4 * i);
+	return sum ^ 0xFFFFFFFF;
+}
+
+static int by_fallback_order(const void *a, const void *b) {
+	const image_t *x = a, *y = b;
+
+	if (x->golden != y->golden)
+		return x->golden - y->golden;
+	if (x->version != y->version)
+		return x->version < y->version ? 1 : -1;
+	return x->offset < y->offset ? -1 : 1;
+}
+
+/*
+ * 4 byte reads NextValidImageCheck() makes from the slot after the failed
+ * image until it reaches target; *found is cleared if the search runs off
+ * the end of the flash first (it only moves forward)
+ */
+static long linear_reads(const u8 *flash, u32 size, u32 failed, u32 target, int *found) {
+	long reads = 0;
+	u32 off;
+
+	*found = 0;
+	for (off = failed + GOLDEN_IMAGE_OFFSET; off < size; off += GOLDEN_IMAGE_OFFSET) {
+		reads++;
+		if (rd32(flash + off + IMAGE_IDENT_OFFSET) != IMAGE_IDENT)
+			continue;
+		reads += IMAGE_HEADER_CHECKSUM_COUNT + 1;
+		if (off == target) {
+			*found = 1;
+			break;
+		}
+	}
+	return reads;
+}
+
+static int list(const char *path) {
+	long size;
+	u8 *flash = read_file(path, &size);
+	u32 dir_off = (u32)ImageDirOffset(size), count, i;
+	const u8 *dir = flash + dir_off;
+
+	if (size < 2 * GOLDEN_IMAGE_OFFSET || rd32(dir) != IMAGE_DIR_MAGIC) {
+		fprintf(stderr, "imgdir: %s: no image directory at 0x%x\n", path, dir_off);
+		return 1;
+	}
+	count = rd32(dir + 4);
+	if (count == 0 || count > IMAGE_DIR_MAX_ENTRIES || dir_checksum(dir) != rd32(dir + 12)) {
+		fprintf(stderr, "imgdir: %s: corrupt image directory\n", path);
+		return 1;
+	}
+
+	printf("directory at 0x%08x, %u images, fallback order:\n", dir_off, count);
+	for (i = 0; i < count; i++) {
+		const u8 *e = dir + 16 + 16 * i;
+		u32 off = rd32(e), sum = rd32(e + 8);
+		int ok = off < dir_off && rd32(flash + off + IMAGE_CHECKSUM_OFFSET) == sum;
+
+		printf("  %2u  0x%08x  v%-5u %-6s  header checksum 0x%08x %s\n", i, off,
+		       rd32(e + 4), rd32(e + 12) & IMAGE_DIR_FLAG_GOLDEN ? "golden" : "update",
+		       sum, ok ? "ok" : "MISMATCH");
+	}
+
+	printf("fallback cost in flash reads (linear search / directory):\n");
+	for (i = 0; i + 1 < count; i++) {
+		u32 from = rd32(dir + 16 + 16 * i), to = rd32(dir + 16 + 16 * (i + 1));
+		int found;
+		long reads = linear_reads(flash, (u32)size, from, to, &found);
+
+		printf("  0x%08x -> 0x%08x  %ld%s / 2\n", from, to, reads,
+		       found ? "" : " (not found)");
+	}
+	free(flash);
+	return 0;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: imgdir [-s MB] -o flash.bin golden.bin[:ver] [update.bin[:ver] ...]\n"
+			"       imgdir -l flash.bin\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	image_t img[MAX_IMAGES];
+	const char *out = NULL;
+	u32 flash_mb = 16, flash_size, dir_off, next = 0;
+	u8 *flash, *dir;
+	int opt, n, i, do_list = 0;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "s:o:l")) != -1) {
+		switch (opt) {
+		case 's': flash_mb = atoi(optarg); break;
+		case 'o': out = optarg; break;
+		case 'l': do_list = 1; break;
+		default: usage();
+		}
+	}
+	if (do_list) {
+		if (argc - optind != 1)
+			usage();
+		return list(argv[optind]);
+	}
+	n = argc - optind;
+	if (out == NULL || n < 1 || n > MAX_IMAGES || flash_mb < 1 || flash_mb > 256)
+		usage();
+
+	flash_size = flash_mb << 20;
+	dir_off = (u32)ImageDirOffset(flash_size);
+
+	for (i = 0; i < n; i++) {
+		char *arg = argv[optind + i], *colon = strrchr(arg, ':');
+
+		img[i].version = i;
+		if (colon != NULL) {
+			*colon = 0;
+			img[i].version = strtoul(colon + 1, NULL, 0);
+		}
+		img[i].path = arg;
+		img[i].golden = i == 0;
+		img[i].data = read_file(arg, &img[i].size);
+		img[i].checksum = boot_header(img[i].data, img[i].size, arg);
+		img[i].offset = next;
+		next = (next + img[i].size + GOLDEN_IMAGE_OFFSET - 1) & ~(GOLDEN_IMAGE_OFFSET - 1);
+		if (next > dir_off) {
+			fprintf(stderr, "imgdir: %s does not fit below the directory at 0x%x\n",
+				arg, dir_off);
+			return 1;
+		}
+		if (img[i].offset / GOLDEN_IMAGE_OFFSET > PCAP_MBOOT_REG_REBOOT_OFFSET_MASK) {
+			fprintf(stderr, "imgdir: %s is out of multiboot range\n", arg);
+			return 1;
+		}
+	}
+
+	flash = malloc(flash_size);
+	if (flash == NULL) {
+		perror("imgdir");
+		return 1;
+	}
+	memset(flash, 0xff, flash_size);
+	for (i = 0; i < n; i++)
+		memcpy(flash + img[i].offset, img[i].data, img[i].size);
+
+	qsort(img, n, sizeof(img[0]), by_fallback_order);
+	dir = flash + dir_off;
+	memset(dir, 0, IMAGE_DIR_SIZE);
+	wr32(dir + 0, IMAGE_DIR_MAGIC);
+	wr32(dir + 4, n);
+	for (i = 0; i < n; i++) {
+		u8 *e = dir + 16 + 16 * i;
+
+		wr32(e + 0, img[i].offset);
+		wr32(e + 4, img[i].version);
+		wr32(e + 8, img[i].checksum);
+		wr32(e + 12, img[i].golden ? IMAGE_DIR_FLAG_GOLDEN : 0);
+		printf("%-6s v%-5u 0x%08x  %8ld bytes  %s\n", img[i].golden ? "golden" : "update",
+		       img[i].version, img[i].offset, img[i].size, img[i].path);
+	}
+	wr32(dir + 12, dir_checksum(dir));
+
+	f = fopen(out, "wb");
+	if (f == NULL || fwrite(flash, 1, flash_size, f) != flash_size || fclose(f) != 0) {
+		perror(out);
+		return 1;
+	}
+	printf("directory at 0x%08x, %u MB flash written to %s\n", dir_off, flash_mb, out);
+	return 0;
+}
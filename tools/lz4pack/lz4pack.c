@@ -0,0 +1,337 @@
+/*
+ * lz4pack.c -- compress application partitions of a BOOT.BIN for the FSBL
+ *
+ * Replaces the data of each plain PS partition with an LZ4 frame (see
+ * zynq_fsbl/lz4.h), sets ATTRIBUTE_COMPRESSED_MASK, shrinks the partition
+ * lengths, redoes the header checksum and, when the partition has one, the
+ * MD5 checksum. Partitions stay where they are, so the flash layout does
+ * not change; the FSBL only reads the compressed bytes and inflates them
+ * into the load address.
+ *
+ * Every frame is decoded again with the FSBL's own lz4.c before the image
+ * is written, and the host decode speed is reported.
+ *
+ * Skipped: the FSBL partition, bitstreams, encrypted or signed partitions
+ * (bootgen has to sign the compressed data) and partitions that do not
+ * shrink.
+ *
+ * usage: lz4pack [-p n] [-d depth] [-v] in.bin out.bin
+ *   -p n      only compress partition n
+ *   -d depth  match search depth (default 64, higher is smaller and slower)
+ *   -v        list every partition
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "xstatus.h"
+#include "image_mover.h"
+#include "lz4.h"
+#include "md5.h"
+
+#define HASH_BITS	16
+#define MFLIMIT		12	/* no match starts in the last 12 bytes */
+#define MAX_PARTS	32
+#define ATTR_WORD	(PARTITION_ATTRIBUTE_OFFSET / 4)
+#define CHECKSUM_OFFSET_WORD	8	/* PartHeader.CheckSumOffset */
+
+static int depth = 64;
+static int verbose;
+
+static u32 rd32(const u8 *p) {
+	return (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+}
+
+static void wr32(u8 *p, u32 v) {
+	p[0] = (u8)v;
+	p[1] = (u8)(v >> 8);
+	p[2] = (u8)(v >> 16);
+	p[3] = (u8)(v >> 24);
+}
+
+static u32 hash4(const u8 *p) {
+	return (rd32(p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static u8 *put_len(u8 *op, size_t len) {
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (u8)len;
+	return op;
+}
+
+static u8 *put_seq(u8 *op, const u8 *lit, size_t nlit, u32 off, size_t mlen) {
+	u8 *token = op++;
+	size_t m = mlen ? mlen - LZ4_MIN_MATCH : 0;
+
+	*token = (u8)((nlit < 15 ? nlit : 15) << 4);
+	if (nlit >= 15)
+		op = put_len(op, nlit - 15);
+	memcpy(op, lit, nlit);
+	op += nlit;
+	if (!mlen)
+		return op;
+	*op++ = (u8)off;
+	*op++ = (u8)(off >> 8);
+	*token |= (u8)(m < 15 ? m : 15);
+	if (m >= 15)
+		op = put_len(op, m - 15);
+	return op;
+}
+
+/*
+ * Hash chain LZ4 block compressor; dst must hold n + n / 255 + 16 bytes.
+ */
+static size_t lz4_compress(const u8 *src, size_t n, u8 *dst) {
+	int32_t *head = malloc(sizeof(int32_t) << HASH_BITS);
+	int32_t *chain = malloc(sizeof(int32_t) * (n ? n : 1));
+	size_t ip = 0, anchor = 0;
+	size_t limit = n > MFLIMIT ? n - MFLIMIT : 0;
+	size_t mend = n > LZ4_LAST_LITERALS ? n - LZ4_LAST_LITERALS : 0;
+	u8 *op = dst;
+
+	if (head == NULL || chain == NULL) {
+		perror("lz4pack");
+		exit(1);
+	}
+	memset(head, 0xff, sizeof(int32_t) << HASH_BITS);
+
+	while (ip < limit) {
+		u32 h = hash4(src + ip);
+		int32_t cand = head[h];
+		size_t best = 0, best_off = 0;
+		int d;
+
+		for (d = 0; cand >= 0 && d < depth && ip - cand <= LZ4_MAX_OFFSET; d++) {
+			size_t len = 0;
+
+			while (ip + len < mend && src[cand + len] == src[ip + len])
+				len++;
+			if (len > best) {
+				best = len;
+				best_off = ip - cand;
+			}
+			cand = chain[cand];
+		}
+		chain[ip] = head[h];
+		head[h] = (int32_t)ip;
+
+		if (best < LZ4_MIN_MATCH) {
+			ip++;
+			continue;
+		}
+
+		op = put_seq(op, src + anchor, ip - anchor, (u32)best_off, best);
+		for (size_t p = ip + 1; p < ip + best && p < limit; p++) {
+			h = hash4(src + p);
+			chain[p] = head[h];
+			head[h] = (int32_t)p;
+		}
+		ip += best;
+		anchor = ip;
+	}
+	op = put_seq(op, src + anchor, n - anchor, 0, 0);
+
+	free(head);
+	free(chain);
+	return (size_t)(op - dst);
+}
+
+static double now_s(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/*
+ * Compresses partition data in place; returns the new word length, or 0
+ * if the partition is left alone.
+ */
+static u32 pack(u8 *part, u32 bytes, int num) {
+	size_t cap = bytes + bytes / 255 + 16;
+	u8 *block = malloc(cap);
+	u8 *check = malloc(bytes ? bytes : 1);
+	size_t blen;
+	u32 words, out = 0;
+	double t0, t1;
+	int reps = 0;
+
+	if (block == NULL || check == NULL) {
+		perror("lz4pack");
+		exit(1);
+	}
+	blen = lz4_compress(part, bytes, block);
+	words = (u32)((LZ4_FRAME_HEADER_SIZE + blen + 3) / 4);
+	if ((size_t)words * 4 >= bytes) {
+		printf("partition %d: %u bytes, does not shrink, left alone\n", num, bytes);
+		free(block);
+		free(check);
+		return 0;
+	}
+
+	/* decode with the FSBL decoder before anything is replaced */
+	{
+		u8 *frame = calloc(1, (size_t)words * 4);
+
+		wr32(frame + 0, LZ4_FRAME_MAGIC);
+		wr32(frame + 4, bytes);
+		wr32(frame + 8, (u32)blen);
+		wr32(frame + 12, 0);
+		memcpy(frame + LZ4_FRAME_HEADER_SIZE, block, blen);
+
+		t0 = now_s();
+		do {
+			if (Lz4DecompressFrame(frame, words * 4, check, bytes, &out) != XST_SUCCESS ||
+			    out != bytes || memcmp(check, part, bytes) != 0) {
+				fprintf(stderr, "lz4pack: partition %d does not decode back\n", num);
+				exit(1);
+			}
+			reps++;
+			t1 = now_s();
+		} while (t1 - t0 < 0.2);
+
+		memset(part, 0xff, bytes);
+		memcpy(part, frame, (size_t)words * 4);
+		free(frame);
+	}
+
+	printf("partition %d: %u -> %u bytes (%.1f%%), host decode %.0f MB/s\n",
+	       num, bytes, words * 4, 100.0 * words * 4 / bytes,
+	       (double)bytes * reps / (t1 - t0) / 1e6);
+	free(block);
+	free(check);
+	return words;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: lz4pack [-p n] [-d depth] [-v] in.bin out.bin\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	u8 *img;
+	long size;
+	FILE *f;
+	u32 phdr;
+	int only = -1, opt, i, packed = 0;
+	u32 before = 0, after = 0;
+
+	while ((opt = getopt(argc, argv, "p:d:v")) != -1) {
+		switch (opt) {
+		case 'p': only = atoi(optarg); break;
+		case 'd': depth = atoi(optarg); break;
+		case 'v': verbose = 1; break;
+		default: usage();
+		}
+	}
+	if (argc - optind != 2 || depth < 1)
+		usage();
+
+	f = fopen(argv[optind], "rb");
+	if (f == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	rewind(f);
+	img = malloc(size);
+	if (img == NULL || fread(img, 1, size, f) != (size_t)size) {
+		fprintf(stderr, "lz4pack: cannot read %s\n", argv[optind]);
+		return 1;
+	}
+	fclose(f);
+
+	if (size < IMAGE_PHDR_OFFSET + 4)
+		goto bad;
+	phdr = rd32(img + IMAGE_PHDR_OFFSET);
+
+	for (i = 0; i < MAX_PARTS; i++) {
+		u8 *h = img + phdr + i * PARTITION_HDR_TOTAL_LEN;
+		u32 w[PARTITION_HDR_WORD_COUNT], sum = 0;
+		u32 start, bytes, words;
+		const char *skip = NULL;
+		int k;
+
+		if ((long)(phdr + (i + 1) * PARTITION_HDR_TOTAL_LEN) > size)
+			goto bad;
+		for (k = 0; k < PARTITION_HDR_WORD_COUNT; k++)
+			w[k] = rd32(h + 4 * k);
+		if (w[PARTITION_HDR_CHECKSUM_WORD_COUNT] == 0xFFFFFFFF || w[0] == 0)
+			break;
+
+		start = w[PARTITION_ADDR_OFFSET / 4] * 4;
+		bytes = w[PARTITION_IMAGE_WORD_LEN_OFFSET / 4] * 4;
+		if ((long)start + bytes > size)
+			goto bad;
+
+		if (i == 0)
+			skip = "FSBL";
+		else if (only >= 0 && i != only)
+			skip = "not selected";
+		else if ((w[ATTR_WORD] & ATTRIBUTE_PARTITION_OWNER_MASK) != ATTRIBUTE_PARTITION_OWNER_FSBL)
+			skip = "not owned by the FSBL";
+		else if (!(w[ATTR_WORD] & ATTRIBUTE_PS_IMAGE_MASK))
+			skip = "not a PS partition";
+		else if (w[ATTR_WORD] & ATTRIBUTE_COMPRESSED_MASK)
+			skip = "already compressed";
+		else if (w[ATTR_WORD] & ATTRIBUTE_RSA_PRESENT_MASK)
+			skip = "signed";
+		else if (w[0] != w[1])
+			skip = "encrypted";
+		else if (w[PARTITION_LOAD_ADDRESS_OFFSET / 4] == 0)
+			skip = "no load address";
+		if (skip) {
+			if (verbose)
+				printf("partition %d: %s, skipped\n", i, skip);
+			continue;
+		}
+
+		before += bytes;
+		words = pack(img + start, bytes, i);
+		if (!words) {
+			after += bytes;
+			continue;
+		}
+		after += words * 4;
+		packed++;
+
+		w[0] = w[1] = w[2] = words;
+		w[ATTR_WORD] |= ATTRIBUTE_COMPRESSED_MASK;
+		if (w[ATTR_WORD] & ATTRIBUTE_CHECKSUM_TYPE_MASK) {
+			u32 off = w[CHECKSUM_OFFSET_WORD] * 4;
+
+			if ((long)off + 16 > size)
+				goto bad;
+			md5(img + start, words * 4, img + off, 0);
+		}
+		for (k = 0; k < PARTITION_HDR_CHECKSUM_WORD_COUNT; k++) {
+			sum += w[k];
+			wr32(h + 4 * k, w[k]);
+		}
+		wr32(h + PARTITION_HDR_CHECKSUM_OFFSET, ~sum);
+	}
+
+	if (packed)
+		printf("%d partition(s): %u -> %u bytes read from flash\n", packed, before, after);
+	else
+		printf("nothing compressed\n");
+
+	f = fopen(argv[optind + 1], "wb");
+	if (f == NULL || fwrite(img, 1, size, f) != (size_t)size || fclose(f) != 0) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+	free(img);
+	return 0;
+
+bad:
+	fprintf(stderr, "lz4pack: %s: malformed partition header table\n", argv[optind]);
+	return 1;
+}
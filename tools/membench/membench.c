@@ -0,0 +1,151 @@
+/*
+ * membench.c -- time module6_sw/src/mem.c against Xil_MemCpy and libc
+ *
+ * Builds the portable C path of mem.c (the ldm/stm and NEON paths are ARM
+ * only) and the application BSP's xil_mem.c. mem_copy() and mem_set() are
+ * first checked against memcpy()/memset() for every small length and
+ * source/destination misalignment, with guard bytes around the buffers,
+ * then each copy and fill is timed for aligned and misaligned buffers of
+ * frame and log sizes.
+ *
+ * usage: membench [-m MB]
+ *   -m MB  bytes moved per measurement (default 256)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "xil_types.h"
+#include "xil_mem.h"
+#include "mem.h"
+
+#define BUF_SIZE (256 * 1024)
+#define GUARD    64
+
+static u8 *src_buf, *dst_buf, *ref_buf;
+
+static void die(const char *what, u32 len, u32 so, u32 dof) {
+	fprintf(stderr, "membench: %s wrong for len %u src+%u dst+%u\n", what, len, so, dof);
+	exit(1);
+}
+
+static void check(void) {
+	u32 len, so, dof;
+
+	for (len = 0; len < 300; len++) {
+		for (so = 0; so < 8; so++) {
+			for (dof = 0; dof < 8; dof++) {
+				memset(dst_buf, 0xAA, len + 2 * GUARD);
+				memset(ref_buf, 0xAA, len + 2 * GUARD);
+				mem_copy(dst_buf + GUARD + dof, src_buf + so, len);
+				memcpy(ref_buf + GUARD + dof, src_buf + so, len);
+				if (memcmp(dst_buf, ref_buf, len + 2 * GUARD) != 0)
+					die("mem_copy", len, so, dof);
+
+				mem_set(dst_buf + GUARD + dof, (u8)(len + so), len);
+				memset(ref_buf + GUARD + dof, (u8)(len + so), len);
+				if (memcmp(dst_buf, ref_buf, len + 2 * GUARD) != 0)
+					die("mem_set", len, 0, dof);
+			}
+		}
+	}
+}
+
+static void xil_copy(void *d, const void *s, u32 n) {
+	Xil_MemCpy(d, s, n);
+}
+
+static void libc_copy(void *d, const void *s, u32 n) {
+	memcpy(d, s, n);
+}
+
+static void byte_set(void *d, u8 c, u32 n) {
+	volatile u8 *p = d;
+
+	while (n-- != 0)
+		*p++ = c;
+}
+
+static void libc_set(void *d, u8 c, u32 n) {
+	memset(d, c, n);
+}
+
+static double now_s(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double time_copy(void (*fn)(void *, const void *, u32), u32 len,
+		u32 so, u32 dof, u64 total) {
+	u64 reps = total / len, i;
+	double t0 = now_s();
+
+	for (i = 0; i < reps; i++)
+		fn(dst_buf + dof, src_buf + so, len);
+	return (double)reps * len / (now_s() - t0) / 1e6;
+}
+
+static double time_set(void (*fn)(void *, u8, u32), u32 len, u32 dof, u64 total) {
+	u64 reps = total / len, i;
+	double t0 = now_s();
+
+	for (i = 0; i < reps; i++)
+		fn(dst_buf + dof, (u8)i, len);
+	return (double)reps * len / (now_s() - t0) / 1e6;
+}
+
+int main(int argc, char **argv) {
+	static const u32 sizes[] = { 64, 1024, 16384, 131072 };
+	static const u32 offs[][2] = { { 0, 0 }, { 1, 3 } };
+	u64 total = 256ull << 20;
+	u32 i, j;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:")) != -1) {
+		switch (opt) {
+		case 'm': total = strtoull(optarg, NULL, 0) << 20; break;
+		default:
+			fprintf(stderr, "usage: membench [-m MB]\n");
+			return 2;
+		}
+	}
+
+	src_buf = aligned_alloc(64, BUF_SIZE);
+	dst_buf = aligned_alloc(64, BUF_SIZE);
+	ref_buf = aligned_alloc(64, BUF_SIZE);
+	if (src_buf == NULL || dst_buf == NULL || ref_buf == NULL) {
+		perror("membench");
+		return 1;
+	}
+	for (i = 0; i < BUF_SIZE; i++)
+		src_buf[i] = (u8)(i * 131 + 7);
+	check();
+
+	printf("copy MB/s        Xil_MemCpy   mem_copy     memcpy\n");
+	for (j = 0; j < 2; j++) {
+		for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			u32 so = offs[j][0], dof = offs[j][1];
+
+			printf("%7u src+%u dst+%u %9.0f %10.0f %10.0f\n", sizes[i], so, dof,
+			       time_copy(xil_copy, sizes[i], so, dof, total),
+			       time_copy(mem_copy, sizes[i], so, dof, total),
+			       time_copy(libc_copy, sizes[i], so, dof, total));
+		}
+	}
+	printf("fill MB/s        byte loop    mem_set     memset\n");
+	for (j = 0; j < 2; j++) {
+		for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			u32 dof = offs[j][1];
+
+			printf("%7u dst+%u       %9.0f %10.0f %10.0f\n", sizes[i], dof,
+			       time_set(byte_set, sizes[i], dof, total),
+			       time_set(mem_set, sizes[i], dof, total),
+			       time_set(libc_set, sizes[i], dof, total));
+		}
+	}
+	return 0;
+}
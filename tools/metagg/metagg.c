@@ -0,0 +1,328 @@
+/*
+ * metagg.c -- aggregate the metrics snapshots of the crossings
+ *
+ * Stands in for the substation on its UDP port: every UPDATE request is
+ * answered the way the substation answers it, and the metrics snapshot
+ * fsm.c appends to every METRICS_EVERY-th request is decoded with the
+ * firmware's own codec (module6_sw/src/metrics.c) and applied to the
+ * state kept for the crossing. Every board sends UPDATE with id 0, so a
+ * crossing is its source address and port, not the id.
+ *
+ * A snapshot is a delta from the last one the board saw answered (see
+ * metrics.h). Per crossing the state at that base and the latest state
+ * are kept: a snapshot over the latest moves the base up, one over the
+ * same base as the latest replaces it, since the board did not see the
+ * answer and sent those changes again. A seq that goes back is a reboot;
+ * the totals of the boot before are kept and the new boot counts from
+ * zero. A board that was running before metagg started is counted from
+ * the base of the first snapshot seen.
+ *
+ * Every -i seconds, and on SIGINT, the fleet is printed: per crossing
+ * the snapshot counts and gauges, then every counter summed over the
+ * crossings and all their boots, the gauges' range, and each histogram
+ * merged over the crossings as a count, mean and percentiles. The
+ * percentiles are bucket upper bounds, so within 25% above the truth.
+ *
+ * usage: metagg [-p port] [-i seconds] [-n snapshots]
+ *   -p  UDP port to answer on (default 12345)
+ *   -i  seconds between reports (default 10, 0 for SIGINT only)
+ *   -n  report and exit after this many snapshots
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+#define UPDATE      2
+#define CROSSINGS   64       /* boards tracked at once */
+
+/* the substation wire format, as in fsm.c */
+typedef struct {
+	int type;
+	int id;
+	int value;
+} update_request_t;
+
+typedef struct {
+	int type;
+	int id;
+	int average;
+	int values[30];
+} update_response_t;
+
+typedef struct {
+	struct sockaddr_in addr;
+	int seen;
+	u32 acked_seq, last_seq;
+	met_state_t acked;       /* as of the board's base */
+	met_state_t last;        /* as of the latest snapshot */
+	met_state_t retired;     /* earlier boots, counters and histograms */
+	unsigned long updates, snapshots, replaced, resyncs, boots, bad;
+} crossing_t;
+
+static crossing_t crossings[CROSSINGS];
+static unsigned ncrossings;
+static unsigned long snapshots, malformed, untracked;
+static volatile sig_atomic_t stop;
+
+static void usage(void) {
+	fprintf(stderr, "usage: metagg [-p port] [-i seconds] [-n snapshots]\n");
+	exit(2);
+}
+
+static void on_sigint(int sig) {
+	(void)sig;
+	stop = 1;
+}
+
+/* counters, gauges and histograms of from added to to */
+static void add(met_state_t *to, const met_state_t *from) {
+	u32 i, b;
+
+	for (i = 0; i < MET_COUNTERS; i++)
+		to->counter[i] += from->counter[i];
+	for (i = 0; i < MET_GAUGES; i++)
+		to->gauge[i] += from->gauge[i];
+	for (i = 0; i < MET_HISTS; i++) {
+		for (b = 0; b < MET_HIST_BUCKETS; b++)
+			to->hist[i].count[b] += from->hist[i].count[b];
+		to->hist[i].sum += from->hist[i].sum;
+	}
+}
+
+/* the crossing sending from addr, NULL once the table is full */
+static crossing_t *crossing(const struct sockaddr_in *addr) {
+	unsigned i;
+
+	for (i = 0; i < ncrossings; i++)
+		if (crossings[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+		    crossings[i].addr.sin_port == addr->sin_port)
+			return &crossings[i];
+	if (ncrossings == CROSSINGS)
+		return NULL;
+	crossings[ncrossings].addr = *addr;
+	return &crossings[ncrossings++];
+}
+
+static void apply(crossing_t *c, const u8 *buf, u32 len) {
+	static met_state_t d;
+	u32 seq, base;
+
+	memset(&d, 0, sizeof(d));
+	if (!met_decode(buf, len, &seq, &base, &d)) {
+		c->bad++;
+		malformed++;
+		return;
+	}
+	if (c->seen && seq == c->last_seq)
+		return;         /* a duplicate datagram */
+	if (c->seen && seq < c->last_seq) {
+		add(&c->retired, &c->last);
+		memset(&c->acked, 0, sizeof(c->acked));
+		memset(&c->last, 0, sizeof(c->last));
+		c->acked_seq = c->last_seq = 0;
+		c->boots++;
+	}
+	if (base == c->last_seq && c->last_seq != c->acked_seq) {
+		c->acked = c->last;
+		c->acked_seq = c->last_seq;
+	} else if (base != c->acked_seq) {
+		c->acked = c->last;
+		c->acked_seq = base;
+		c->resyncs++;
+	} else if (c->last_seq != c->acked_seq) {
+		c->replaced++;
+	}
+	c->last = c->acked;
+	add(&c->last, &d);
+	c->last_seq = seq;
+	c->seen = 1;
+	c->snapshots++;
+	snapshots++;
+}
+
+static const char *state_name(s32 s) {
+	if (s < 0 || s >= MET_STATES)
+		return "?";
+	return met_names[MET_DWELL + s] + strlen("dwell.");
+}
+
+/* the upper bound of the bucket holding the q-th fraction of h */
+static unsigned long percentile(const met_hist_t *h, unsigned long count, double q) {
+	unsigned long want = (unsigned long)(q * count + 0.5), seen = 0;
+	u32 b;
+
+	if (want == 0)
+		want = 1;
+	for (b = 0; b < MET_HIST_BUCKETS - 1; b++) {
+		seen += h->count[b];
+		if (seen >= want)
+			return met_bucket_low(b + 1) - 1;
+	}
+	return met_bucket_low(MET_HIST_BUCKETS - 1);
+}
+
+static void report(void) {
+	static met_state_t fleet, total;
+	s32 lo[MET_GAUGES], hi[MET_GAUGES];
+	u32 i, b, n = 0;
+
+	memset(&fleet, 0, sizeof(fleet));
+	printf("\n%lu snapshots, %lu malformed, %lu updates from untracked boards\n",
+	       snapshots, malformed, untracked);
+	printf("%-21s  updates  snapshots  replaced  resyncs  boots  bad  state           duty\n",
+	       "crossing");
+	for (i = 0; i < ncrossings; i++) {
+		crossing_t *c = &crossings[i];
+		char name[32];
+
+		snprintf(name, sizeof(name), "%s:%u", inet_ntoa(c->addr.sin_addr),
+			 (unsigned)ntohs(c->addr.sin_port));
+		printf("%-21s  %7lu  %9lu  %8lu  %7lu  %5lu  %3lu  %-14s  %3d.%02d\n", name,
+		       c->updates, c->snapshots, c->replaced, c->resyncs, c->boots, c->bad,
+		       c->seen ? state_name(c->last.gauge[MET_STATE - MET_COUNTERS]) : "-",
+		       c->last.gauge[MET_SERVO_DUTY - MET_COUNTERS] / 100,
+		       c->last.gauge[MET_SERVO_DUTY - MET_COUNTERS] % 100);
+		if (!c->seen)
+			continue;
+		total = c->retired;
+		add(&total, &c->last);
+		for (b = 0; b < MET_GAUGES; b++) {
+			if (n == 0 || c->last.gauge[b] < lo[b])
+				lo[b] = c->last.gauge[b];
+			if (n == 0 || c->last.gauge[b] > hi[b])
+				hi[b] = c->last.gauge[b];
+		}
+		add(&fleet, &total);
+		n++;
+	}
+	if (n == 0)
+		return;
+
+	printf("\n%-22s  %10s\n", "counter", "total");
+	for (i = 0; i < MET_COUNTERS; i++)
+		printf("%-22s  %10u\n", met_names[i], fleet.counter[i]);
+	printf("\n%-22s  %10s  %10s\n", "gauge", "min", "max");
+	for (i = 0; i < MET_GAUGES; i++)
+		printf("%-22s  %10d  %10d\n", met_names[MET_COUNTERS + i], lo[i], hi[i]);
+	printf("\n%-22s  %10s  %10s  %10s  %10s  %10s\n", "histogram", "count", "mean",
+	       "p50", "p90", "p99");
+	for (i = 0; i < MET_HISTS; i++) {
+		const met_hist_t *h = &fleet.hist[i];
+		unsigned long count = 0;
+
+		for (b = 0; b < MET_HIST_BUCKETS; b++)
+			count += h->count[b];
+		if (count == 0) {
+			printf("%-22s  %10lu\n", met_names[MET_GAUGES_END + i], count);
+			continue;
+		}
+		printf("%-22s  %10lu  %10.1f  %10lu  %10lu  %10lu\n", met_names[MET_GAUGES_END + i],
+		       count, (double)h->sum / count, percentile(h, count, 0.5),
+		       percentile(h, count, 0.9), percentile(h, count, 0.99));
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	struct sockaddr_in addr;
+	struct pollfd pfd;
+	struct sigaction sa;
+	unsigned long limit = 0;
+	int port = 12345, interval = 10, opt, s;
+	time_t next;
+
+	while ((opt = getopt(argc, argv, "p:i:n:")) != -1) {
+		switch (opt) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'n':
+			limit = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc || port <= 0 || port > 65535 || interval < 0)
+		usage();
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	if (s < 0) {
+		perror("socket");
+		return 1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		perror("bind");
+		return 1;
+	}
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_sigint;
+	sigaction(SIGINT, &sa, NULL);
+	printf("metagg on port %d\n", port);
+	fflush(stdout);
+
+	pfd.fd = s;
+	pfd.events = POLLIN;
+	next = time(NULL) + interval;
+	while (!stop && (limit == 0 || snapshots < limit)) {
+		static u8 buf[2048];
+		struct sockaddr_in from;
+		socklen_t from_len = sizeof(from);
+		update_request_t req;
+		update_response_t resp;
+		crossing_t *c;
+		int wait = interval ? (int)(next - time(NULL)) * 1000 : -1;
+		ssize_t len;
+
+		if (interval && wait <= 0) {
+			report();
+			next = time(NULL) + interval;
+			continue;
+		}
+		if (poll(&pfd, 1, wait) <= 0)
+			continue;
+		len = recvfrom(s, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+		if (len < (ssize_t)sizeof(req)) {
+			if (len < 0 && errno != EINTR)
+				perror("recvfrom");
+			continue;
+		}
+		memcpy(&req, buf, sizeof(req));
+		if (req.type != UPDATE)
+			continue;
+		c = crossing(&from);
+		if (c == NULL) {
+			untracked++;
+		} else {
+			c->updates++;
+			if (len > (ssize_t)sizeof(req))
+				apply(c, buf + sizeof(req), len - sizeof(req));
+		}
+
+		memset(&resp, 0, sizeof(resp));
+		resp.type = UPDATE;
+		resp.id = req.id;
+		resp.values[29] = req.value;
+		sendto(s, &resp, sizeof(resp), 0, (struct sockaddr *)&from, from_len);
+	}
+	report();
+	close(s);
+	return 0;
+}
@@ -0,0 +1,281 @@
+/*
+ * poolbench.c -- check and time module6_sw/src/pool.c against malloc
+ *
+ * The pool region comes from the linker as on the board: the tool
+ * defines _pool_start and the Makefile places _pool_end _POOL_SIZE
+ * bytes after it. The run first checks the class layout, alignment,
+ * fail fast exhaustion, the high water marks and that foreign pointers
+ * are ignored by pool_free().
+ *
+ * It then runs a mixed workload of message sized allocations with a
+ * SIGALRM handler standing in for an interrupt: every tick the handler
+ * takes and returns blocks of its own while the main loop is in the
+ * middle of pool_alloc() or pool_free(). Every block carries its
+ * owner's stamp, so a block handed out twice is caught.
+ *
+ * Last, each allocation and free of the same workload is timed, with
+ * pool.c and with the host malloc, and the distribution printed. Host
+ * malloc is a far better allocator than newlib's on the board; the
+ * point is the spread, not the mean.
+ *
+ * usage: poolbench [-n ops]
+ *   -n  allocations in the timed workload (default 2000000)
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "pool.h"
+
+#define POOL_SIZE  0x10000  /* as _POOL_SIZE in lscript.ld and the Makefile */
+#define LIVE       32       /* blocks the workload holds at once */
+#define IRQ_LIVE   8
+
+u8 _pool_start[POOL_SIZE] __attribute__((aligned(32)));
+
+static const u32 sizes[] = { 12, 12, 24, 24, 44, 132, 132, 132, 300, 1500 };
+#define NSIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static int failures;
+static volatile sig_atomic_t irq_bad;
+static volatile unsigned long irq_count, irq_allocs;
+static volatile sig_atomic_t irq_stop;      /* give everything back */
+
+static void check(int ok, const char *what) {
+	if (!ok) {
+		printf("FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+static unsigned long long now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+static int cmp_ull(const void *a, const void *b) {
+	unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u32 rng = 12345;
+
+static u32 next_rand(void) {
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static void stamp(void *p, u32 size, u8 who) {
+	memset(p, who, size);
+}
+
+static int stamped(const void *p, u32 size, u8 who) {
+	const u8 *b = p;
+	u32 i;
+
+	for (i = 0; i < size; i++)
+		if (b[i] != who)
+			return 0;
+	return 1;
+}
+
+/* the interrupt: takes a few blocks, checks the ones it took last time
+   were not touched meanwhile and gives them back */
+static void irq(int sig) {
+	static void *held[IRQ_LIVE];
+	static u32 held_size[IRQ_LIVE];
+	u32 i;
+
+	(void)sig;
+	irq_count++;
+	for (i = 0; i < IRQ_LIVE; i++) {
+		if (held[i] != NULL) {
+			if (!stamped(held[i], held_size[i], 0xEE))
+				irq_bad = 1;
+			pool_free(held[i]);
+			held[i] = NULL;
+		}
+		if (irq_stop)
+			continue;
+		held_size[i] = sizes[(irq_count + i) % NSIZES];
+		held[i] = pool_alloc(held_size[i]);
+		if (held[i] != NULL) {
+			stamp(held[i], held_size[i], 0xEE);
+			irq_allocs++;
+		}
+	}
+}
+
+static void check_layout(void) {
+	pool_stats_t st;
+	void *blocks[256], *p;
+	u32 class, i, n;
+
+	for (class = 0; class < POOL_CLASSES; class++) {
+		pool_stats(class, &st);
+		check(st.size == (u32)POOL_MIN << class, "class sizes");
+		for (n = 0; n < st.blocks; n++) {
+			blocks[n] = pool_alloc(st.size);
+			if (blocks[n] == NULL || ((UINTPTR)blocks[n] & 31) != 0 ||
+			    (u8 *)blocks[n] < _pool_start || (u8 *)blocks[n] + st.size > _pool_start + POOL_SIZE)
+				break;
+			stamp(blocks[n], st.size, (u8)n);
+		}
+		check(n == st.blocks, "every block of a class, aligned, in the region");
+		/* the larger classes are all free, and still nothing is borrowed */
+		check(pool_alloc(st.size) == NULL, "full class fails at once");
+		for (i = 0; i < n; i++)
+			check(stamped(blocks[i], st.size, (u8)i), "blocks do not overlap");
+		pool_stats(class, &st);
+		check(st.fails >= 1 && st.in_use == n && st.high_water == n, "stats with the class full");
+		for (i = 0; i < n; i++)
+			pool_free(blocks[i]);
+		pool_stats(class, &st);
+		check(st.in_use == 0 && st.high_water == n, "high water kept after free");
+	}
+	check(pool_alloc(0) == NULL && pool_alloc(POOL_MAX + 1) == NULL, "sizes out of range");
+	pool_free(NULL);
+	pool_free(&n);
+	p = pool_alloc(100);
+	pool_free((u8 *)p + 4);
+	pool_stats(2, &st);
+	check(st.in_use == 1, "foreign and interior pointers ignored");
+	pool_free(p);
+}
+
+static void stress(unsigned long ops) {
+	struct itimerval tv = { { 0, 50 }, { 0, 50 } };
+	void *live[LIVE] = { 0 };
+	u32 live_size[LIVE];
+	unsigned long i, fails = 0;
+	u32 slot;
+
+	signal(SIGALRM, irq);
+	setitimer(ITIMER_REAL, &tv, NULL);
+	for (i = 0; i < ops; i++) {
+		slot = next_rand() % LIVE;
+		if (live[slot] != NULL) {
+			if (!stamped(live[slot], live_size[slot], (u8)slot))
+				check(0, "block handed out twice");
+			pool_free(live[slot]);
+		}
+		live_size[slot] = sizes[next_rand() % NSIZES];
+		live[slot] = pool_alloc(live_size[slot]);
+		if (live[slot] == NULL)
+			fails++;
+		else
+			stamp(live[slot], live_size[slot], (u8)slot);
+	}
+	memset(&tv, 0, sizeof(tv));
+	setitimer(ITIMER_REAL, &tv, NULL);
+	irq_stop = 1;
+	irq(SIGALRM);
+	signal(SIGALRM, SIG_DFL);
+	for (slot = 0; slot < LIVE; slot++)
+		pool_free(live[slot]);
+	check(!irq_bad, "interrupt blocks untouched");
+	printf("stress: %lu ops, %lu interrupts taking %lu blocks, %lu main loop allocations refused\n",
+	       ops, irq_count, irq_allocs, fails);
+}
+
+typedef struct {
+	const char *name;
+	void *(*alloc)(u32 size);
+	void (*release)(void *p);
+} allocator_t;
+
+static void *host_alloc(u32 size) {
+	return malloc(size);
+}
+
+static void time_one(const allocator_t *a, unsigned long ops) {
+	unsigned long long *ta = malloc(ops * sizeof(*ta)), *tf = malloc(ops * sizeof(*tf));
+	void *live[LIVE] = { 0 };
+	unsigned long long t0, t1, t2;
+	unsigned long i;
+	u32 slot;
+
+	rng = 777;
+	for (i = 0; i < ops; i++) {
+		slot = next_rand() % LIVE;
+		t0 = now_ns();
+		a->release(live[slot]);
+		t1 = now_ns();
+		live[slot] = a->alloc(sizes[next_rand() % NSIZES]);
+		t2 = now_ns();
+		tf[i] = t1 - t0;
+		ta[i] = t2 - t1;
+	}
+	for (slot = 0; slot < LIVE; slot++)
+		a->release(live[slot]);
+	qsort(ta, ops, sizeof(*ta), cmp_ull);
+	qsort(tf, ops, sizeof(*tf), cmp_ull);
+	printf("  %-6s alloc median %3llu ns  p99.9 %5llu ns  max %7llu ns   "
+	       "free median %3llu ns  p99.9 %5llu ns  max %7llu ns\n", a->name,
+	       ta[ops / 2], ta[ops - ops / 1000 - 1], ta[ops - 1],
+	       tf[ops / 2], tf[ops - ops / 1000 - 1], tf[ops - 1]);
+	free(ta);
+	free(tf);
+}
+
+int main(int argc, char **argv) {
+	static const allocator_t allocators[] = {
+		{ "pool", pool_alloc, pool_free },
+		{ "malloc", host_alloc, free },
+	};
+	unsigned long ops = 2000000;
+	pool_stats_t st;
+	u32 class;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			ops = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n ops]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (ops < 1000) {
+		fprintf(stderr, "%s: at least 1000 ops\n", argv[0]);
+		return 2;
+	}
+
+	if (pool_init() != XST_SUCCESS) {
+		printf("FAIL: pool_init\n");
+		return 1;
+	}
+	check_layout();
+	stress(ops);
+
+	printf("timed, %lu allocations of 12 to 1500 bytes, %d live:\n", ops, LIVE);
+	time_one(&allocators[0], ops);
+	time_one(&allocators[1], ops);
+
+	printf("class   size blocks high water   allocs  fails\n");
+	for (class = 0; class < POOL_CLASSES; class++) {
+		pool_stats(class, &st);
+		printf("%5u %6u %6u %10u %8u %6u\n", class, st.size, st.blocks, st.high_water,
+		       st.allocs, st.fails);
+		check(st.in_use == 0, "everything returned");
+	}
+	if (failures) {
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,312 @@
+/*
+ * profsym.c -- symbolize a prof.c capture into folded stacks
+ *
+ * Reads the function symbols of the application ELF (32 or 64 bit,
+ * little endian, no libelf needed) and a profile written by prof_dump()
+ * over the UART or to SD: a "# prof" header line and one line of hex
+ * addresses per sample, the interrupted PC first and then the return
+ * addresses above it. Terminal noise around the capture is skipped.
+ *
+ * The default output is one line per distinct stack, outermost frame
+ * first, in the folded format flamegraph.pl and speedscope read:
+ *
+ *   main;run_fsm;update_display;fmt_out 42
+ *
+ * With -f it is a flat profile instead, samples by function, self and
+ * total. Addresses outside every function show up as their hex value.
+ *
+ * usage: profsym -e elf [-f] [capture]
+ *   -e  the application ELF the capture was taken from
+ *   -f  flat profile
+ *   capture defaults to standard input
+ */
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_DEPTH 32
+#define LINE_MAX_LEN 1024
+
+typedef struct {
+	uint64_t addr;
+	uint64_t size;
+	const char *name;
+} sym_t;
+
+typedef struct {
+	char *stack;
+	unsigned long count;
+} folded_t;
+
+typedef struct {
+	const char *name;
+	unsigned long self;
+	unsigned long total;
+} flat_t;
+
+static sym_t *syms;
+static size_t nsyms;
+
+static void die(const char *msg, const char *arg) {
+	fprintf(stderr, "profsym: %s%s%s\n", msg, arg ? " " : "", arg ? arg : "");
+	exit(1);
+}
+
+static uint64_t rd(const unsigned char *p, int bytes) {
+	uint64_t v = 0;
+	int i;
+
+	for (i = bytes - 1; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static int cmp_sym(const void *a, const void *b) {
+	const sym_t *x = a, *y = b;
+
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+/*
+ * load the STT_FUNC symbols of the ELF at path
+ */
+static void load_elf(const char *path) {
+	FILE *f = fopen(path, "rb");
+	unsigned char *img;
+	long len;
+	int is64;
+	uint64_t shoff;
+	unsigned shentsize, shnum, i, j;
+
+	if (f == NULL)
+		die("cannot open", path);
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	img = malloc((size_t)len);
+	if (img == NULL || fread(img, 1, (size_t)len, f) != (size_t)len)
+		die("cannot read", path);
+	fclose(f);
+	if (len < 52 || memcmp(img, "\177ELF", 4) != 0 || img[5] != 1)
+		die("not a little endian ELF:", path);
+	is64 = img[4] == 2;
+	shoff = is64 ? rd(img + 0x28, 8) : rd(img + 0x20, 4);
+	shentsize = (unsigned)rd(img + (is64 ? 0x3A : 0x2E), 2);
+	shnum = (unsigned)rd(img + (is64 ? 0x3C : 0x30), 2);
+	if (shoff + (uint64_t)shentsize * shnum > (uint64_t)len)
+		die("truncated section headers in", path);
+
+	for (i = 0; i < shnum; i++) {
+		const unsigned char *sh = img + shoff + (uint64_t)i * shentsize;
+		const unsigned char *str_sh;
+		uint64_t off, size, entsize, str_off;
+		unsigned link;
+
+		if (rd(sh + 4, 4) != 2)         /* SHT_SYMTAB */
+			continue;
+		off = rd(sh + (is64 ? 0x18 : 0x10), is64 ? 8 : 4);
+		size = rd(sh + (is64 ? 0x20 : 0x14), is64 ? 8 : 4);
+		link = (unsigned)rd(sh + (is64 ? 0x28 : 0x18), 4);
+		entsize = rd(sh + (is64 ? 0x38 : 0x24), is64 ? 8 : 4);
+		if (link >= shnum || entsize == 0 || off + size > (uint64_t)len)
+			die("bad symbol table in", path);
+		str_sh = img + shoff + (uint64_t)link * shentsize;
+		str_off = rd(str_sh + (is64 ? 0x18 : 0x10), is64 ? 8 : 4);
+
+		syms = realloc(syms, (nsyms + size / entsize) * sizeof(*syms));
+		for (j = 0; j < size / entsize; j++) {
+			const unsigned char *s = img + off + j * entsize;
+			unsigned info = is64 ? s[4] : s[12];
+			sym_t *out = &syms[nsyms];
+
+			if ((info & 0xF) != 2)      /* STT_FUNC */
+				continue;
+			out->name = (const char *)img + str_off + rd(s, 4);
+			out->addr = is64 ? rd(s + 8, 8) : rd(s + 4, 4);
+			out->size = is64 ? rd(s + 16, 8) : rd(s + 8, 4);
+			out->addr &= ~(uint64_t)1;  /* Thumb bit */
+			if (out->addr != 0)
+				nsyms++;
+		}
+	}
+	if (nsyms == 0)
+		die("no function symbols in", path);
+	qsort(syms, nsyms, sizeof(*syms), cmp_sym);
+}
+
+/*
+ * the name of the function holding addr, or its hex value in buf
+ */
+static const char *lookup(uint64_t addr, char *buf) {
+	size_t lo = 0, hi = nsyms;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+
+		if (syms[mid].addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo > 0) {
+		const sym_t *s = &syms[lo - 1];
+
+		if (addr < s->addr + s->size || (s->size == 0 && lo < nsyms))
+			return s->name;
+	}
+	sprintf(buf, "0x%llx", (unsigned long long)addr);
+	return buf;
+}
+
+/*
+ * the addresses of a sample line; 0 for anything else
+ */
+static int parse(const char *line, uint64_t *addr) {
+	int n = 0;
+	char *end;
+
+	while (*line != '\0') {
+		if (isspace((unsigned char)*line)) {
+			line++;
+			continue;
+		}
+		if (n == MAX_DEPTH || !isxdigit((unsigned char)*line))
+			return 0;
+		addr[n++] = strtoull(line, &end, 16);
+		if (end - line != 8 || (*end != '\0' && !isspace((unsigned char)*end)))
+			return 0;
+		line = end;
+	}
+	return n;
+}
+
+static int cmp_folded(const void *a, const void *b) {
+	return strcmp(((const folded_t *)a)->stack, ((const folded_t *)b)->stack);
+}
+
+static int cmp_flat(const void *a, const void *b) {
+	const flat_t *x = a, *y = b;
+
+	if (x->self != y->self)
+		return x->self < y->self ? 1 : -1;
+	return strcmp(x->name, y->name);
+}
+
+int main(int argc, char **argv) {
+	const char *elf = NULL;
+	int flat = 0, opt, depth, i;
+	FILE *in = stdin;
+	char line[LINE_MAX_LEN], stack[MAX_DEPTH * 80], buf[MAX_DEPTH][24];
+	const char *names[MAX_DEPTH];
+	uint64_t addr[MAX_DEPTH];
+	folded_t *folded = NULL;
+	size_t nfolded = 0, cap = 0, k, m;
+	unsigned long samples = 0, skipped = 0, headers = 0;
+
+	while ((opt = getopt(argc, argv, "e:f")) != -1) {
+		switch (opt) {
+		case 'e':
+			elf = optarg;
+			break;
+		case 'f':
+			flat = 1;
+			break;
+		default:
+			elf = NULL;
+			optind = argc + 1;
+			break;
+		}
+	}
+	if (elf == NULL || optind < argc - 1 || optind > argc) {
+		fprintf(stderr, "usage: %s -e elf [-f] [capture]\n", argv[0]);
+		return 2;
+	}
+	if (optind == argc - 1 && (in = fopen(argv[optind], "r")) == NULL)
+		die("cannot open", argv[optind]);
+	load_elf(elf);
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+		if (strncmp(line, "# prof", 6) == 0) {
+			headers++;
+			continue;
+		}
+		depth = parse(line, addr);
+		if (depth == 0) {
+			if (line[strspn(line, " \t\r\n")] != '\0')
+				skipped++;
+			continue;
+		}
+		/* return addresses point past the call, look up the call */
+		for (i = 0; i < depth; i++)
+			names[i] = lookup(i == 0 ? addr[i] : addr[i] - 1, buf[i]);
+		stack[0] = '\0';
+		for (i = depth - 1; i >= 0; i--) {
+			strcat(stack, names[i]);
+			if (i != 0)
+				strcat(stack, ";");
+		}
+		if (nfolded == cap) {
+			cap = cap ? cap * 2 : 1024;
+			folded = realloc(folded, cap * sizeof(*folded));
+		}
+		folded[nfolded].stack = strdup(stack);
+		folded[nfolded++].count = 1;
+		samples++;
+	}
+	if (headers == 0)
+		fprintf(stderr, "profsym: no \"# prof\" header, reading the lines anyway\n");
+
+	/* merge identical stacks */
+	qsort(folded, nfolded, sizeof(*folded), cmp_folded);
+	for (k = 0, m = 0; k < nfolded; k++) {
+		if (m > 0 && strcmp(folded[m - 1].stack, folded[k].stack) == 0) {
+			folded[m - 1].count++;
+			free(folded[k].stack);
+		} else {
+			folded[m++] = folded[k];
+		}
+	}
+	nfolded = m;
+
+	if (!flat) {
+		for (k = 0; k < nfolded; k++)
+			printf("%s %lu\n", folded[k].stack, folded[k].count);
+	} else {
+		flat_t *fl = calloc(nfolded * MAX_DEPTH + 1, sizeof(*fl));
+		size_t nfl = 0, f;
+
+		for (k = 0; k < nfolded; k++) {
+			char *save, *tok, *leaf = strrchr(folded[k].stack, ';');
+			char *seen[MAX_DEPTH];
+			int nseen = 0;
+
+			leaf = leaf ? leaf + 1 : folded[k].stack;
+			for (tok = strtok_r(strdup(folded[k].stack), ";", &save); tok != NULL;
+			     tok = strtok_r(NULL, ";", &save)) {
+				for (i = 0; i < nseen && strcmp(seen[i], tok) != 0; i++)
+					;
+				if (i < nseen)
+					continue;   /* recursion counts once */
+				seen[nseen++] = tok;
+				for (f = 0; f < nfl && strcmp(fl[f].name, tok) != 0; f++)
+					;
+				if (f == nfl)
+					fl[nfl++].name = tok;
+				fl[f].total += folded[k].count;
+				if (strcmp(tok, leaf) == 0)
+					fl[f].self += folded[k].count;
+			}
+		}
+		qsort(fl, nfl, sizeof(*fl), cmp_flat);
+		printf("%8s %6s %8s %6s  function\n", "self", "", "total", "");
+		for (f = 0; f < nfl; f++)
+			printf("%8lu %5.1f%% %8lu %5.1f%%  %s\n", fl[f].self, 100.0 * fl[f].self / samples,
+			       fl[f].total, 100.0 * fl[f].total / samples, fl[f].name);
+	}
+	fprintf(stderr, "profsym: %lu samples, %zu stacks, %lu lines skipped\n",
+		samples, nfolded, skipped);
+	return 0;
+}
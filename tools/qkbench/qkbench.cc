@@ -0,0 +1,360 @@
+/*
+ * qkbench.cc -- simulated instructions a second against the global quantum
+ *
+ * A CPU model stands in for QEMU behind remote-port: it runs instructions
+ * of CPU_PERIOD each, keeping its time with a tlm_quantumkeeper, and every
+ * MMIO_EVERY instructions makes an access as the firmware does, in turn:
+ *
+ *   LEDs       a write to axi_gpio_0 through the virtual board's bus
+ *   buttons    a read of axi_gpio_1, whose pins a board thread toggles
+ *              every BTN_PERIOD
+ *
+ * and in place of every BRAM_EVERY'th of those
+ *
+ *   bram       a read through b_transport_converter's nb_transport path
+ *              of an approximately timed memory, as M_AXI_GP0 goes to the
+ *              PL under xsim. It waits for the response in SystemC time,
+ *              so it syncs the CPU whatever the quantum.
+ *
+ * It runs the same instructions once for each quantum, from syncing on
+ * every instruction up to a millisecond, and prints how many it ran a
+ * second. The crossings between the CPU's local time and SystemC's are
+ * checked in every run:
+ *
+ *   - every LED value reaches the pins at the time of its write, not when
+ *     the quantum ends
+ *   - a button read sees the pins as they were at its time, or at most a
+ *     quantum, an instruction and the bus latency earlier
+ *   - every run takes the same simulated time, so no access's latency
+ *     is lost or counted twice
+ *
+ * Built against SystemC (SYSTEMC=) or the stand-in in scmini/ (SCMINI=1);
+ * the checks hold for either, the rates only compare quanta of one build.
+ *
+ * usage: qkbench [-n instructions]
+ *   -n  instructions a run (default 5000000)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <deque>
+
+#include "systemc.h"
+#include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/simple_target_socket.h"
+#include "tlm_utils/tlm_quantumkeeper.h"
+
+#include "bus.h"
+#include "axi_gpio.h"
+#include "b_transport_converter.h"
+
+#define CPU_PERIOD      sc_time(1500, SC_PS)    /* 667 MHz */
+#define MMIO_EVERY      50
+#define BRAM_EVERY      100
+#define BTN_PERIOD      sc_time(37, SC_US)
+#define BRAM_SIZE       0x2000
+#define BRAM_LATENCY    sc_time(60, SC_NS)
+
+#define LED_BASE        0x41200000
+#define BTN_BASE        0x41210000
+
+typedef b_transport_converter<32, 32> converter;
+
+static const double quanta_ns[] = { 0, 100, 1000, 10000, 100000, 1000000 };
+#define NQUANTA         (sizeof(quanta_ns) / sizeof(quanta_ns[0]))
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* a memory that answers nb_transport one BRAM_LATENCY after the request */
+class at_bram : public sc_module
+{
+public:
+	tlm_utils::simple_target_socket<at_bram> socket;
+
+	SC_HAS_PROCESS(at_bram);
+	at_bram(sc_module_name name) : sc_module(name), socket("socket"), req(NULL)
+	{
+		socket.register_nb_transport_fw(this, &at_bram::nb_transport_fw);
+		memset(mem, 0, sizeof(mem));
+
+		SC_METHOD(respond);
+		sensitive << resp_ev;
+		dont_initialize();
+	}
+
+private:
+	unsigned char mem[BRAM_SIZE];
+	tlm::tlm_generic_payload *req;
+	sc_event resp_ev;
+
+	tlm::tlm_sync_enum nb_transport_fw(tlm::tlm_generic_payload &gp, tlm::tlm_phase &phase,
+					   sc_time &delay)
+	{
+		if (!(phase == tlm::BEGIN_REQ))
+			return tlm::TLM_ACCEPTED;
+		req = &gp;
+		resp_ev.notify(delay + BRAM_LATENCY);
+		phase = tlm::END_REQ;
+		return tlm::TLM_UPDATED;
+	}
+
+	void respond()
+	{
+		tlm::tlm_phase phase = tlm::BEGIN_RESP;
+		sc_time delay = SC_ZERO_TIME;
+		sc_dt::uint64 addr = req->get_address() % BRAM_SIZE;
+
+		if (req->is_read())
+			memcpy(req->get_data_ptr(), mem + addr, req->get_data_length());
+		else
+			memcpy(mem + addr, req->get_data_ptr(), req->get_data_length());
+		req->set_response_status(tlm::TLM_OK_RESPONSE);
+		socket->nb_transport_bw(*req, phase, delay);
+	}
+};
+
+struct result {
+	double seconds;
+	sc_time simulated, max_stale;
+	unsigned long syncs, stale, led_errors;
+};
+
+class cpu : public sc_module
+{
+public:
+	tlm_utils::simple_initiator_socket<cpu> bus_sk, bram_sk;
+	sc_in<uint32_t> leds;
+	struct result res[NQUANTA];
+	bool failed;
+
+	SC_HAS_PROCESS(cpu);
+	cpu(sc_module_name name, unsigned long n)
+		: sc_module(name), bus_sk("bus_sk"), bram_sk("bram_sk"), leds("leds"),
+		  failed(false), n(n), done(false)
+	{
+		bus_sk.register_invalidate_direct_mem_ptr(this, &cpu::invalidate_direct_mem_ptr);
+		bram_sk.register_nb_transport_bw(this, &cpu::nb_transport_bw);
+		bram_sk.register_invalidate_direct_mem_ptr(this, &cpu::invalidate_direct_mem_ptr);
+
+		SC_THREAD(run);
+
+		SC_THREAD(press);
+
+		SC_METHOD(watch_leds);
+		sensitive << leds;
+		dont_initialize();
+	}
+
+private:
+	unsigned long n;
+	bool done;
+	struct result *r;
+	tlm_utils::tlm_quantumkeeper qk;
+	tlm::tlm_generic_payload gp;
+	std::deque<std::pair<sc_time, uint32_t> > led_writes;
+	sc_signal<uint32_t> btn_pins;
+
+public:
+	sc_signal<uint32_t> &buttons() { return btn_pins; }
+
+private:
+	void invalidate_direct_mem_ptr(sc_dt::uint64, sc_dt::uint64) {}
+
+	tlm::tlm_sync_enum nb_transport_bw(tlm::tlm_generic_payload &, tlm::tlm_phase &, sc_time &)
+	{
+		return tlm::TLM_ACCEPTED;
+	}
+
+	/* BTN0 toggles at every multiple of BTN_PERIOD */
+	void press()
+	{
+		while (!done) {
+			wait(BTN_PERIOD);
+			btn_pins.write(btn_pins.read() ^ 1);
+		}
+	}
+
+	static uint32_t btn_at(const sc_time &t)
+	{
+		return (t.value() / BTN_PERIOD.value()) & 1;
+	}
+
+	void watch_leds()
+	{
+		if (led_writes.empty() || led_writes.front().first != sc_time_stamp() ||
+		    led_writes.front().second != leds.read())
+			r->led_errors++;
+		if (!led_writes.empty())
+			led_writes.pop_front();
+	}
+
+	/* one access, returning the time it took effect at the target */
+	sc_time access(tlm_utils::simple_initiator_socket<cpu> &sk, tlm::tlm_command cmd,
+		       sc_dt::uint64 addr, uint32_t *data)
+	{
+		sc_time delay = qk.get_local_time();
+
+		gp.set_command(cmd);
+		gp.set_address(addr);
+		gp.set_data_ptr((unsigned char *)data);
+		gp.set_data_length(4);
+		gp.set_streaming_width(4);
+		gp.set_byte_enable_ptr(NULL);
+		gp.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+		sk->b_transport(gp, delay);
+		if (!gp.is_response_ok()) {
+			fprintf(stderr, "qkbench: access to 0x%08llx failed\n", (unsigned long long)addr);
+			failed = true;
+		}
+		qk.set(delay);
+		return sc_time_stamp() + delay;
+	}
+
+	void measure(int i)
+	{
+		sc_time quantum(quanta_ns[i], SC_NS), start, at;
+		unsigned long k, mmio = 0;
+		uint32_t v, led = 0, work = 1;
+		double t0;
+
+		r = &res[i];
+		*r = result();
+		tlm::tlm_global_quantum::instance().set(quantum);
+		qk.reset();
+		v = 0;
+		access(bus_sk, tlm::TLM_WRITE_COMMAND, LED_BASE + 4, &v);      /* all outputs */
+		qk.sync();
+		start = sc_time_stamp();
+		t0 = now_s();
+		for (k = 0; k < n; k++) {
+			work = work * 1103515245 + 12345;
+			qk.inc(CPU_PERIOD);
+			if (k % MMIO_EVERY != 0) {
+				/* no access */
+			} else if (++mmio % BRAM_EVERY == 0) {
+				v = work;
+				access(bram_sk, tlm::TLM_READ_COMMAND, (k * 4) % BRAM_SIZE, &v);
+			} else if (mmio & 1) {
+				/* never the value already on the pins */
+				led = (led + 1) & 0xF;
+				v = led;
+				at = access(bus_sk, tlm::TLM_WRITE_COMMAND, LED_BASE, &v);
+				led_writes.push_back(std::make_pair(at, led));
+			} else {
+				at = access(bus_sk, tlm::TLM_READ_COMMAND, BTN_BASE, &v);
+				if (v != btn_at(at)) {
+					sc_time edge = sc_time::from_value(at.value() / BTN_PERIOD.value() *
+									   BTN_PERIOD.value());
+
+					r->stale++;
+					if (at - edge > r->max_stale)
+						r->max_stale = at - edge;
+				}
+			}
+			if (qk.need_sync()) {
+				qk.sync();
+				r->syncs++;
+			}
+		}
+		qk.sync();
+		r->seconds = now_s() - t0;
+		r->simulated = sc_time_stamp() - start;
+		/* let the last LED write land */
+		wait(SC_ZERO_TIME);
+		wait(SC_ZERO_TIME);
+		if (!led_writes.empty()) {
+			r->led_errors += led_writes.size();
+			led_writes.clear();
+		}
+		if (r->max_stale > quantum + CPU_PERIOD + ACCESS_CYCLES * FCLK0_PERIOD) {
+			fprintf(stderr, "qkbench: quantum %g ns: a button read %s stale\n",
+				quanta_ns[i], r->max_stale.to_string().c_str());
+			failed = true;
+		}
+		if (r->led_errors != 0) {
+			fprintf(stderr, "qkbench: quantum %g ns: %lu LED writes out of time\n",
+				quanta_ns[i], r->led_errors);
+			failed = true;
+		}
+	}
+
+	void run()
+	{
+		size_t i;
+
+		for (i = 0; i < NQUANTA; i++)
+			measure(i);
+		done = true;
+		sc_stop();
+	}
+};
+
+int sc_main(int argc, char *argv[])
+{
+	unsigned long n = 5000000;
+	sc_signal<uint32_t> led_pins, unused_o;
+	sc_signal<uint32_t> zero;
+	sc_signal<bool> irq[2];
+	vboard_bus *bus;
+	axi_gpio *leds, *btns;
+	converter *conv;
+	at_bram *bram;
+	cpu *c;
+	size_t i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n': n = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: qkbench [-n instructions]\n");
+			return 2;
+		}
+	}
+
+	sc_set_time_resolution(1, SC_PS);
+	bus = new vboard_bus("bus");
+	leds = new axi_gpio("axi_gpio_0", 4);
+	btns = new axi_gpio("axi_gpio_1", 4);
+	conv = new converter("conv");
+	bram = new at_bram("bram");
+	c = new cpu("cpu", n);
+
+	bus->attach(LED_BASE, 0x10000).bind(leds->socket);
+	bus->attach(BTN_BASE, 0x10000).bind(btns->socket);
+	c->bus_sk.bind(bus->t_sk);
+	c->bram_sk.bind(conv->target_socket);
+	conv->initiator_socket.bind(bram->socket);
+	leds->gpio_i(zero);
+	leds->gpio_o(led_pins);
+	leds->irq(irq[0]);
+	btns->gpio_i(c->buttons());
+	btns->gpio_o(unused_o);
+	btns->irq(irq[1]);
+	c->leds(led_pins);
+	sc_start();
+
+	printf("%12s %12s %10s %8s %12s %12s\n", "quantum", "instr/s", "syncs", "stale",
+	       "max stale", "simulated");
+	for (i = 0; i < NQUANTA; i++) {
+		struct result *r = &c->res[i];
+
+		printf("%9g ns %10.2fM %10lu %8lu %9.0f ns %9.3f ms\n", quanta_ns[i],
+		       n / r->seconds / 1e6, r->syncs, r->stale, r->max_stale.to_seconds() * 1e9,
+		       r->simulated.to_seconds() * 1e3);
+		if (r->simulated != c->res[0].simulated) {
+			fprintf(stderr, "qkbench: quantum %g ns took a different simulated time\n",
+				quanta_ns[i]);
+			c->failed = true;
+		}
+	}
+	return c->failed ? 1 : 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * rsabench.c -- check and time the FSBL partition authentication
+ *
+ * Builds zynq_fsbl/rsa2048.c and sha256.c on the host, checks them against
+ * a fixed RSA-2048 / SHA-256 test vector and then times the per-partition
+ * authentication work the way rsa.c used to do it against the way it does
+ * it now:
+ *
+ *   before  SHA-256 of the SPK, PPK and SPK exponentiations with the
+ *           generic square-and-multiply, and a separate SHA-256 pass over
+ *           the partition after it was copied
+ *   after   SPK verified once and then recognised by comparison, fast path
+ *           for e = 2^k + 1, and the partition hashed chunk by chunk while
+ *           it is copied
+ *
+ * The partitions are run several times and the fastest round is printed,
+ * as single runs on a shared host vary by 20% or more.
+ *
+ * Only the rsa column is expected to improve. The SPK reuse does nearly all
+ * of it; the e = 2^k + 1 path saves a few percent of one exponentiation.
+ * Copy+hash is the SHA-256 of the partition either way and the copy is a
+ * small part of it, so hashing each chunk while it is still in the cache
+ * cannot show here, where the whole partition stays in the cache anyway;
+ * on the A9 it saves at most the second read of the partition from DDR.
+ *
+ * usage: rsabench [partition_kb [partitions [rounds]]]
+ *
+ * Host numbers only show the ratio; the A9 runs the same code.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rsa2048.h"
+#include "sha256.h"
+
+#define CHUNK 0x10000	/* RSA_HASH_CHUNK_SIZE in rsa.c */
+#define SPK_SIZE (256 + 256 + 64)
+
+/* key, R^2 mod N and a PKCS#1 v1.5 SHA-256 signature of TestMessage */
+static const char TestMessage[] = "traffic_fsm partition";
+static const u8 TestModulus[256] = {
+	0x9b, 0xd8, 0xc3, 0xb4, 0xdb, 0x8f, 0x28, 0xa6, 0x72, 0x98, 0x3c, 0x7c,
+	0xdb, 0xbe, 0xf8, 0xf4, 0xa7, 0x2d, 0x54, 0x9a, 0x82, 0x27, 0x5f, 0xc9,
+	0x54, 0x69, 0xed, 0x90, 0xae, 0x2d, 0x5b, 0xed, 0xe3, 0x98, 0xe0, 0x6a,
+	0xae, 0x87, 0x22, 0x31, 0xe9, 0xae, 0x0a, 0x13, 0x4e, 0xb2, 0x13, 0xe3,
+	0xae, 0xc2, 0x85, 0xeb, 0x68, 0x0a, 0x1e, 0x30, 0xf4, 0x7e, 0x63, 0x24,
+	0xd5, 0xf2, 0xb1, 0x7a, 0x3e, 0xbf, 0x0e, 0xb0, 0x91, 0x17, 0xdb, 0xf3,
+	0x70, 0x8d, 0xc6, 0xcd, 0x1b, 0xea, 0xbf, 0xbf, 0x46, 0xe5, 0x94, 0xe2,
+	0x69, 0x93, 0x3c, 0x19, 0x9a, 0xec, 0x10, 0x20, 0xf3, 0x3c, 0xa2, 0x98,
+	0x18, 0x2f, 0x2b, 0xa9, 0x29, 0x29, 0x50, 0x9c, 0x9f, 0xb4, 0x02, 0x0b,
+	0xdc, 0x6e, 0x63, 0x05, 0xff, 0xef, 0x46, 0xe5, 0x22, 0xfa, 0x15, 0x78,
+	0x61, 0x86, 0x5a, 0xa0, 0x4d, 0x19, 0x00, 0xe4, 0xb9, 0x10, 0xd6, 0xf4,
+	0x3f, 0xf1, 0x98, 0x34, 0xf8, 0xa4, 0xc6, 0x5a, 0x0e, 0xbe, 0x75, 0x1b,
+	0x17, 0x16, 0x76, 0xc4, 0xc3, 0x44, 0xe4, 0x73, 0xaa, 0x57, 0x41, 0xfe,
+	0xe1, 0x03, 0x2a, 0xc0, 0x78, 0x18, 0xd8, 0xf1, 0xc1, 0x0d, 0xb8, 0xe3,
+	0x29, 0x06, 0xe2, 0xe2, 0xef, 0x0e, 0x24, 0xa2, 0x69, 0xce, 0x6d, 0x10,
+	0xc7, 0x49, 0x2e, 0x2a, 0x80, 0x9e, 0xbd, 0xd8, 0x21, 0x21, 0xed, 0x93,
+	0xec, 0xf2, 0xb4, 0xb8, 0xe2, 0xe1, 0x49, 0x26, 0x1d, 0x38, 0xc0, 0xc6,
+	0x91, 0x05, 0x31, 0xef, 0xe8, 0x51, 0xae, 0xde, 0x98, 0x13, 0x4a, 0x52,
+	0x24, 0xb2, 0x1c, 0xc3, 0xa4, 0x06, 0xe3, 0xa9, 0x87, 0x15, 0x6f, 0xda,
+	0xc6, 0x0e, 0x12, 0x00, 0xbf, 0x16, 0xb6, 0xea, 0xd9, 0x56, 0xda, 0xc5,
+	0x16, 0x47, 0x3e, 0xd2, 0xe7, 0xba, 0x4d, 0x02, 0xa8, 0x6c, 0xa3, 0x80,
+	0x90, 0x4d, 0xf5, 0xb9,
+};
+static const u8 TestModulusExt[256] = {
+	0xaf, 0x09, 0x0e, 0x4a, 0x43, 0x49, 0xab, 0xc9, 0x90, 0x5f, 0xc9, 0x83,
+	0xd8, 0x49, 0xfe, 0x95, 0x6c, 0xdb, 0xb6, 0x0b, 0xd9, 0x5a, 0xf2, 0xec,
+	0xf2, 0x8a, 0x79, 0xa6, 0xce, 0x03, 0x12, 0xbc, 0xe3, 0x27, 0x5e, 0x79,
+	0x44, 0x84, 0x0c, 0x2b, 0xe0, 0xc1, 0x60, 0x8c, 0xc1, 0xfb, 0xdd, 0x09,
+	0x5f, 0x67, 0xbe, 0x45, 0x5a, 0x1d, 0x1d, 0x2d, 0xe9, 0xd1, 0x8a, 0x73,
+	0x4a, 0x5d, 0x82, 0xeb, 0x50, 0xb8, 0x63, 0xf9, 0xe1, 0xa5, 0xbc, 0xaa,
+	0x0d, 0x24, 0x76, 0x27, 0xb5, 0x09, 0xac, 0xd2, 0x42, 0x0a, 0x6e, 0x54,
+	0xad, 0xac, 0x89, 0xe6, 0x75, 0x82, 0xcf, 0x5f, 0x62, 0x41, 0x24, 0xc2,
+	0x59, 0x92, 0x7c, 0x48, 0xa4, 0x65, 0x47, 0x46, 0x96, 0x5b, 0xe8, 0x66,
+	0x56, 0xf5, 0xda, 0xa2, 0x3c, 0x8a, 0x02, 0xc3, 0xa4, 0x88, 0x87, 0x3f,
+	0x95, 0x2c, 0x7b, 0x36, 0x05, 0x4c, 0xd1, 0x45, 0x09, 0xfb, 0x7c, 0x85,
+	0x42, 0x30, 0x23, 0x66, 0xa8, 0x40, 0x03, 0x07, 0x89, 0xf4, 0x36, 0x85,
+	0xd9, 0x7a, 0xfd, 0xb6, 0x39, 0x8c, 0xd1, 0x88, 0xff, 0x90, 0x9d, 0x27,
+	0x54, 0xa1, 0x59, 0x86, 0x78, 0xf5, 0x6d, 0x30, 0x10, 0x03, 0xe5, 0x1a,
+	0x7e, 0x71, 0xea, 0x78, 0x85, 0x99, 0x45, 0x1e, 0x6b, 0x9f, 0x46, 0x57,
+	0xbc, 0x58, 0x3c, 0xd6, 0xa6, 0xb3, 0x8f, 0x9d, 0x9f, 0x94, 0xab, 0x1f,
+	0xaf, 0x4e, 0x26, 0x39, 0x44, 0x8a, 0xb7, 0x50, 0xd5, 0x12, 0xc5, 0x8c,
+	0x0c, 0x4c, 0x7c, 0xdd, 0x63, 0x85, 0xd9, 0x97, 0x2b, 0x83, 0x9e, 0x23,
+	0xde, 0x9e, 0x06, 0x56, 0x1e, 0xa3, 0xae, 0xda, 0xb2, 0x61, 0xf9, 0x22,
+	0x2c, 0xe1, 0xb3, 0xda, 0x8c, 0x29, 0x96, 0xb1, 0x08, 0x68, 0xf4, 0x6e,
+	0xbd, 0x77, 0xc2, 0xd2, 0xb3, 0x58, 0x36, 0x3c, 0xf2, 0x4b, 0x9e, 0x13,
+	0x72, 0x25, 0x49, 0x8f,
+};
+static const u8 TestSignature[256] = {
+	0x4d, 0x63, 0xd5, 0xcf, 0x0a, 0x38, 0x25, 0xbd, 0xa5, 0xb4, 0x7e, 0xe5,
+	0xa1, 0x71, 0x7e, 0x06, 0xba, 0xe8, 0x5f, 0x76, 0x10, 0x7f, 0x2b, 0xdd,
+	0xfb, 0x73, 0xe3, 0xed, 0x59, 0x0c, 0x3a, 0xe0, 0x25, 0xbb, 0x45, 0x44,
+	0x17, 0x3b, 0xcc, 0x32, 0xf7, 0x10, 0x13, 0x1f, 0x30, 0xe9, 0x0b, 0xfe,
+	0x81, 0xdf, 0x1c, 0x00, 0xec, 0x66, 0x51, 0xd1, 0xe8, 0xa5, 0x15, 0x51,
+	0x5e, 0x9e, 0x61, 0x43, 0xd6, 0x4b, 0xb8, 0x8b, 0xa1, 0xe6, 0x7e, 0xbf,
+	0xdd, 0x93, 0x7e, 0x3f, 0x4e, 0x68, 0x91, 0x6a, 0x77, 0x72, 0x0f, 0x5b,
+	0x28, 0x47, 0xf3, 0x57, 0xbf, 0x23, 0x4f, 0x49, 0x3b, 0x59, 0xab, 0x92,
+	0x79, 0x89, 0x07, 0xe9, 0xce, 0xbc, 0xac, 0xf6, 0x8e, 0xad, 0x6d, 0xf3,
+	0xf8, 0x2f, 0x4a, 0x66, 0x0c, 0x6c, 0x8d, 0x0c, 0x83, 0x32, 0xf8, 0x78,
+	0xbb, 0x3d, 0x5e, 0xa5, 0x3a, 0x70, 0x82, 0x60, 0x05, 0x2d, 0x22, 0x98,
+	0xf0, 0xb6, 0x9d, 0xe7, 0xea, 0x25, 0xa2, 0x92, 0x24, 0x71, 0x51, 0xf4,
+	0x4a, 0xde, 0x56, 0x23, 0x8a, 0xbb, 0x2d, 0x58, 0x15, 0x86, 0xef, 0xb3,
+	0xea, 0xde, 0x23, 0x8e, 0x6e, 0xd9, 0xc3, 0xbb, 0xaa, 0xf4, 0x0e, 0x19,
+	0xbf, 0xc8, 0xa5, 0xf7, 0x17, 0x08, 0x35, 0x21, 0xe7, 0x83, 0xbb, 0x9a,
+	0x48, 0xe1, 0x2d, 0xd0, 0xa6, 0x65, 0xbe, 0xfb, 0xc0, 0x5f, 0x64, 0x5d,
+	0x00, 0xd0, 0xb3, 0x30, 0x08, 0x37, 0x8a, 0xd2, 0x63, 0x62, 0x18, 0x08,
+	0xe8, 0x9b, 0xf5, 0x2b, 0x9f, 0x12, 0xb5, 0x8e, 0xac, 0xfc, 0xd7, 0x42,
+	0xa5, 0xd2, 0x32, 0x15, 0xb5, 0x74, 0xac, 0x9d, 0x9e, 0x50, 0x92, 0xb4,
+	0x8c, 0x97, 0x18, 0x8a, 0x7e, 0x01, 0xf6, 0x1e, 0x43, 0xf0, 0xf6, 0x5e,
+	0x2f, 0x8e, 0x0c, 0xd4, 0x7c, 0x0c, 0xa8, 0xd3, 0x9a, 0x53, 0xa5, 0x35,
+	0xa6, 0xd4, 0x9f, 0x26,
+};
+
+
+static const u8 T_padding[] = {0x30, 0x31, 0x30, 0x0D, 0x06, 0x09, 0x60, 0x86, 0x48,
+		0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20 };
+
+/* same walk as RecreatePaddingAndCheck() in rsa.c */
+static int padding_ok(const u8 *signature, const u8 *hash) {
+	const u8 *p = signature + 256;
+	unsigned i;
+
+	if (*--p != 0x00 || *--p != 0x01)
+		return 0;
+	for (i = 0; i < 256 - 3 - 19 - 32; i++)
+		if (*--p != 0xFF)
+			return 0;
+	if (*--p != 0x00)
+		return 0;
+	for (i = 0; i < sizeof(T_padding); i++)
+		if (*--p != T_padding[i])
+			return 0;
+	for (i = 0; i < 32; i++)
+		if (*--p != hash[i])
+			return 0;
+	return 1;
+}
+
+static double now_us(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int check(void) {
+	static const u8 abc_digest[32] = {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde,
+		0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+		0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad };
+	Rsa2048Key key;
+	Sha256Context ctx;
+	u8 digest[32], streamed[32], em[256], em2[256], bad[256], buf[1000];
+	int i, ok = 1;
+
+	Sha256((const u8 *)"abc", 3, digest);
+	if (memcmp(digest, abc_digest, 32) != 0) {
+		printf("FAIL sha256(\"abc\")\n");
+		ok = 0;
+	}
+
+	for (i = 0; i < (int)sizeof(buf); i++)
+		buf[i] = (u8)(i * 7);
+	Sha256(buf, sizeof(buf), digest);
+	Sha256Start(&ctx);
+	for (i = 0; i < (int)sizeof(buf); i += 37)
+		Sha256Update(&ctx, buf + i, (sizeof(buf) - i) < 37 ? sizeof(buf) - i : 37);
+	Sha256Finish(&ctx, streamed);
+	if (memcmp(digest, streamed, 32) != 0) {
+		printf("FAIL streamed sha256 differs from one-shot\n");
+		ok = 0;
+	}
+
+	Rsa2048KeyInit(&key, TestModulus, TestModulusExt);
+	Sha256((const u8 *)TestMessage, strlen(TestMessage), digest);
+
+	Rsa2048PubExp(&key, TestSignature, 65537, em);
+	Rsa2048ModExp(&key, TestSignature, 65537, em2);
+	if (!padding_ok(em, digest)) {
+		printf("FAIL signature does not verify (fast path)\n");
+		ok = 0;
+	}
+	if (memcmp(em, em2, sizeof(em)) != 0) {
+		printf("FAIL fast path and generic exponentiation differ\n");
+		ok = 0;
+	}
+
+	memcpy(bad, TestSignature, sizeof(bad));
+	bad[17] ^= 0x01;
+	Rsa2048PubExp(&key, bad, 65537, em);
+	if (padding_ok(em, digest)) {
+		printf("FAIL tampered signature verifies\n");
+		ok = 0;
+	}
+
+	/* e = 3 takes the fast path, e = 5 does not; both must agree */
+	Rsa2048PubExp(&key, TestSignature, 3, em);
+	Rsa2048ModExp(&key, TestSignature, 3, em2);
+	if (memcmp(em, em2, sizeof(em)) != 0) {
+		printf("FAIL e=3 fast path differs\n");
+		ok = 0;
+	}
+
+	printf("%s: sha256, streaming, rsa2048 verify/reject, fast path\n", ok ? "ok" : "FAILED");
+	return ok;
+}
+
+int main(int argc, char **argv) {
+	unsigned kb = argc > 1 ? (unsigned)atoi(argv[1]) : 1024;
+	unsigned parts = argc > 2 ? (unsigned)atoi(argv[2]) : 4;
+	unsigned rounds = argc > 3 ? (unsigned)atoi(argv[3]) : 5;
+	size_t size = (size_t)kb * 1024;
+	u8 *flash, *ddr, spk[SPK_SIZE + 256], cached[SPK_SIZE + 256];
+	u8 digest[32], em[256];
+	Rsa2048Key ppk, spk_key;
+	Sha256Context ctx;
+	double t0, t_gen, t_fast;
+	double b_rsa = 0, b_copy = 0, b_hash = 0, a_rsa = 0, a_hash = 0;
+	double before, after;
+	unsigned p, i, r, reps = 50;
+	size_t off;
+	int cached_valid;
+
+	if (!check())
+		return 1;
+	if (kb == 0 || parts == 0 || rounds == 0) {
+		fprintf(stderr, "usage: rsabench [partition_kb [partitions [rounds]]]\n");
+		return 1;
+	}
+
+	Rsa2048KeyInit(&ppk, TestModulus, TestModulusExt);
+
+	t0 = now_us();
+	for (i = 0; i < reps; i++)
+		Rsa2048ModExp(&ppk, TestSignature, 65537, em);
+	t_gen = (now_us() - t0) / reps;
+	t0 = now_us();
+	for (i = 0; i < reps; i++)
+		Rsa2048PubExp(&ppk, TestSignature, 65537, em);
+	t_fast = (now_us() - t0) / reps;
+	printf("rsa2048 e=65537: generic %.1f us, fast path %.1f us\n", t_gen, t_fast);
+
+	flash = malloc(size);
+	ddr = malloc(size);
+	if (flash == NULL || ddr == NULL)
+		return 1;
+	for (off = 0; off < size; off++)
+		flash[off] = (u8)(off * 13 + 1);
+	memcpy(spk, TestModulus, 256);
+	memcpy(spk + 256, TestModulusExt, 256);
+	memset(spk + 512, 0, 64 + 256);
+	spk[512] = 0x01; spk[514] = 0x01;	/* 65537 */
+	memcpy(spk + SPK_SIZE, TestSignature, 256);
+
+	for (r = 0; r < rounds; r++) {
+		double rsa0 = 0, copy0 = 0, hash0 = 0, rsa1 = 0, hash1 = 0;
+
+		cached_valid = 0;
+		for (p = 0; p < parts; p++) {
+			double t, t1, t2;
+
+			/* before: per partition SPK check, generic exponentiation, copy then hash */
+			t = now_us();
+			Sha256(spk, SPK_SIZE, digest);
+			Rsa2048KeyInit(&spk_key, spk, spk + 256);
+			Rsa2048ModExp(&ppk, spk + SPK_SIZE, 65537, em);
+			Rsa2048ModExp(&spk_key, TestSignature, 65537, em);
+			t1 = now_us();
+			memcpy(ddr, flash, size);
+			t2 = now_us();
+			Sha256(ddr, size - 256, digest);
+			rsa0 += t1 - t;
+			copy0 += t2 - t1;
+			hash0 += now_us() - t2;
+
+			/* after: SPK recognised, fast path, hash fused into the chunked copy */
+			t = now_us();
+			if (!cached_valid || memcmp(cached, spk, sizeof(cached)) != 0) {
+				Sha256(spk, SPK_SIZE, digest);
+				Rsa2048PubExp(&ppk, spk + SPK_SIZE, 65537, em);
+				Rsa2048KeyInit(&spk_key, spk, spk + 256);
+				memcpy(cached, spk, sizeof(cached));
+				cached_valid = 1;
+			}
+			Rsa2048PubExp(&spk_key, TestSignature, 65537, em);
+			t1 = now_us();
+			Sha256Start(&ctx);
+			for (off = 0; off < size; off += CHUNK) {
+				size_t n = size - off < CHUNK ? size - off : CHUNK;
+				size_t h = off + n > size - 256 ? (off < size - 256 ? size - 256 - off : 0) : n;
+
+				memcpy(ddr + off, flash + off, n);
+				Sha256Update(&ctx, ddr + off, h);
+			}
+			Sha256Finish(&ctx, digest);
+			rsa1 += t1 - t;
+			hash1 += now_us() - t1;
+		}
+		if (r == 0 || rsa0 + copy0 + hash0 < b_rsa + b_copy + b_hash) {
+			b_rsa = rsa0;
+			b_copy = copy0;
+			b_hash = hash0;
+		}
+		if (r == 0 || rsa1 + hash1 < a_rsa + a_hash) {
+			a_rsa = rsa1;
+			a_hash = hash1;
+		}
+	}
+	before = b_rsa + b_copy + b_hash;
+	after = a_rsa + a_hash;
+
+	printf("%u partitions of %u KB, per partition, best of %u rounds:\n", parts, kb, rounds);
+	printf("  before %9.1f us  (rsa %8.1f, copy %8.1f + hash %9.1f)\n",
+	       before / parts, b_rsa / parts, b_copy / parts, b_hash / parts);
+	printf("  after  %9.1f us  (rsa %8.1f, copy+hash %18.1f)\n",
+	       after / parts, a_rsa / parts, a_hash / parts);
+	printf("  rsa %.1f%%, copy+hash %.1f%%, total %.1f%% of before\n",
+	       a_rsa * 100.0 / b_rsa, a_hash * 100.0 / (b_copy + b_hash),
+	       after * 100.0 / before);
+
+	free(flash);
+	free(ddr);
+	return 0;
+}
@@ -0,0 +1,7 @@
+/*
+ * systemc.h -- the SystemC stand-in with sc_core and sc_dt in scope, see systemc
+ */
+#pragma once
+#include "systemc"
+using namespace sc_core;
+using namespace sc_dt;
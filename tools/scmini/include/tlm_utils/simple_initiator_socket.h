@@ -0,0 +1,23 @@
+/*
+ * simple_initiator_socket.h -- stand-in initiator socket, bound to one target
+ */
+#pragma once
+#include "systemc"
+namespace tlm_utils {
+template <class M, unsigned W = 32>
+class simple_initiator_socket : public tlm::tlm_bw_if {
+public:
+	M *m = 0; tlm::tlm_fw_if *fw = 0;
+	tlm::tlm_sync_enum (M::*nb)(tlm::tlm_generic_payload &, tlm::tlm_phase &, sc_core::sc_time &) = 0;
+	void (M::*inv)(sc_dt::uint64, sc_dt::uint64) = 0;
+	simple_initiator_socket() {}
+	simple_initiator_socket(const char *) {}
+	void register_nb_transport_bw(M *x, tlm::tlm_sync_enum (M::*f)(tlm::tlm_generic_payload &, tlm::tlm_phase &, sc_core::sc_time &)) { m = x; nb = f; }
+	void register_invalidate_direct_mem_ptr(M *x, void (M::*f)(sc_dt::uint64, sc_dt::uint64)) { m = x; inv = f; }
+	tlm::tlm_sync_enum nb_transport_bw(tlm::tlm_generic_payload &g, tlm::tlm_phase &p, sc_core::sc_time &t) { return (m->*nb)(g, p, t); }
+	void invalidate_direct_mem_ptr(sc_dt::uint64 a, sc_dt::uint64 b) { if (inv) (m->*inv)(a, b); }
+	template <class T> void bind(T &t) { fw = &t; t.bw = this; }
+	template <class T> void operator()(T &t) { bind(t); }
+	tlm::tlm_fw_if *operator->() { return fw; }
+};
+}
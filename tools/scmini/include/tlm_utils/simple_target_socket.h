@@ -0,0 +1,28 @@
+/*
+ * simple_target_socket.h -- stand-in target socket calling the registered
+ * member functions
+ */
+#pragma once
+#include "systemc"
+namespace tlm_utils {
+template <class M, unsigned W = 32>
+class simple_target_socket : public tlm::tlm_fw_if {
+public:
+	M *m = 0; tlm::tlm_bw_if *bw = 0;
+	void (M::*bt)(tlm::tlm_generic_payload &, sc_core::sc_time &) = 0;
+	tlm::tlm_sync_enum (M::*nb)(tlm::tlm_generic_payload &, tlm::tlm_phase &, sc_core::sc_time &) = 0;
+	unsigned int (M::*dbg)(tlm::tlm_generic_payload &) = 0;
+	bool (M::*dmi)(tlm::tlm_generic_payload &, tlm::tlm_dmi &) = 0;
+	simple_target_socket() {}
+	simple_target_socket(const char *) {}
+	void register_b_transport(M *x, void (M::*f)(tlm::tlm_generic_payload &, sc_core::sc_time &)) { m = x; bt = f; }
+	void register_nb_transport_fw(M *x, tlm::tlm_sync_enum (M::*f)(tlm::tlm_generic_payload &, tlm::tlm_phase &, sc_core::sc_time &)) { m = x; nb = f; }
+	void register_transport_dbg(M *x, unsigned int (M::*f)(tlm::tlm_generic_payload &)) { m = x; dbg = f; }
+	void register_get_direct_mem_ptr(M *x, bool (M::*f)(tlm::tlm_generic_payload &, tlm::tlm_dmi &)) { m = x; dmi = f; }
+	void b_transport(tlm::tlm_generic_payload &g, sc_core::sc_time &t) { (m->*bt)(g, t); }
+	tlm::tlm_sync_enum nb_transport_fw(tlm::tlm_generic_payload &g, tlm::tlm_phase &p, sc_core::sc_time &t) { return (m->*nb)(g, p, t); }
+	bool get_direct_mem_ptr(tlm::tlm_generic_payload &g, tlm::tlm_dmi &d) { if (!dmi) { d.set_start_address(0); d.set_end_address(~(sc_dt::uint64)0); return false; } return (m->*dmi)(g, d); }
+	unsigned int transport_dbg(tlm::tlm_generic_payload &g) { return dbg ? (m->*dbg)(g) : 0; }
+	tlm::tlm_bw_if *operator->() { return bw; }
+};
+}
@@ -0,0 +1,22 @@
+/*
+ * tlm_quantumkeeper.h -- stand-in quantum keeper over the global quantum
+ */
+#pragma once
+#include "systemc"
+namespace tlm_utils {
+class tlm_quantumkeeper {
+	sc_core::sc_time local, lq;
+public:
+	static void set_global_quantum(const sc_core::sc_time &t) { tlm::tlm_global_quantum::instance().set(t); }
+	static const sc_core::sc_time &get_global_quantum() { return tlm::tlm_global_quantum::instance().get(); }
+	void inc(const sc_core::sc_time &t) { local += t; }
+	void set(const sc_core::sc_time &t) { local = t; }
+	sc_core::sc_time get_current_time() const { return sc_core::sc_time_stamp() + local; }
+	sc_core::sc_time &get_local_time() { return local; }
+	bool need_sync() const { return local >= lq; }
+	void sync() { sc_core::wait(local); reset(); }
+	void reset() { local = sc_core::SC_ZERO_TIME; sc_core::sc_time q = get_global_quantum(), now = sc_core::sc_time_stamp();
+		lq = q.ps ? sc_core::sc_time::from_value((now.ps / q.ps + 1) * q.ps - now.ps) : sc_core::SC_ZERO_TIME; }
+	void set_and_sync(const sc_core::sc_time &t) { local = t; if (need_sync()) sync(); }
+};
+}
@@ -0,0 +1,12 @@
+/*
+ * remote-port-tlm-memory-master.h -- declaration only, see remote-port-tlm.h
+ */
+#pragma once
+#include "remote-port-tlm.h"
+#include "tlm_utils/simple_initiator_socket.h"
+
+class remoteport_tlm_memory_master : public remoteport_tlm_dev {
+public:
+	tlm_utils::simple_initiator_socket<remoteport_tlm_memory_master> sk;
+	remoteport_tlm_memory_master(sc_module_name name) {}
+};
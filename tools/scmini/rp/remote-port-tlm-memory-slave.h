@@ -0,0 +1,12 @@
+/*
+ * remote-port-tlm-memory-slave.h -- declaration only, see remote-port-tlm.h
+ */
+#pragma once
+#include "remote-port-tlm.h"
+#include "tlm_utils/simple_target_socket.h"
+
+class remoteport_tlm_memory_slave : public remoteport_tlm_dev {
+public:
+	tlm_utils::simple_target_socket<remoteport_tlm_memory_slave> sk;
+	remoteport_tlm_memory_slave(sc_module_name name) {}
+};
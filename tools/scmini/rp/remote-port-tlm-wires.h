@@ -0,0 +1,13 @@
+/*
+ * remote-port-tlm-wires.h -- declaration only, see remote-port-tlm.h
+ */
+#pragma once
+#include "remote-port-tlm.h"
+
+class remoteport_tlm_wires : public remoteport_tlm_dev {
+public:
+	sc_vector<sc_in<bool> > wires_in;
+	sc_vector<sc_out<bool> > wires_out;
+	remoteport_tlm_wires(sc_module_name name, unsigned int nr_in, unsigned int nr_out)
+		: wires_in("wires_in", nr_in), wires_out("wires_out", nr_out) {}
+};
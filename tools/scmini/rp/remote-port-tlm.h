@@ -0,0 +1,21 @@
+/*
+ * remote-port-tlm.h -- declarations of the libsystemctlm-soc remote-port
+ * classes that xilinx-zynq.h uses, enough to compile the vboard sources
+ * against the SystemC stand-in. Nothing here is implemented: linking
+ * vboard needs libremote-port from libsystemctlm-soc.
+ */
+#pragma once
+#include "systemc.h"
+
+class remoteport_tlm_dev {
+public:
+	virtual ~remoteport_tlm_dev() {}
+};
+
+class remoteport_tlm : public sc_module {
+public:
+	sc_in<bool> rst;
+	remoteport_tlm(sc_module_name name, int fd, const char *sk_descr) : sc_module(name) {}
+	void register_dev(unsigned int dev_id, remoteport_tlm_dev *dev);
+	void tie_off(void);
+};
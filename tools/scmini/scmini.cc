@@ -0,0 +1,18 @@
+/*
+ * scmini.cc -- the parts of the SystemC stand-in that are not inline
+ *
+ * main() hands over to sc_main() as the SystemC library does, and
+ * scm_switch saves the callee-saved registers of one thread on its stack
+ * and restores those of the next (x86-64 SysV).
+ */
+#include "systemc.h"
+
+asm(".text\n.globl scm_switch\nscm_switch:\n"
+    "push %rbp\npush %rbx\npush %r12\npush %r13\npush %r14\npush %r15\n"
+    "mov %rsp,(%rdi)\nmov %rsi,%rsp\n"
+    "pop %r15\npop %r14\npop %r13\npop %r12\npop %rbx\npop %rbp\nret\n");
+
+int main(int argc, char **argv)
+{
+	return sc_main(argc, argv);
+}
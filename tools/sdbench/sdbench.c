@@ -0,0 +1,282 @@
+/*
+ * sdbench.c -- time the FSBL SD boot path against a FAT image
+ *
+ * Builds zynq_fsbl/sd.c twice, as is (cluster map, multi-block reads) and
+ * with SD_FAST_PATH_EXCLUDE (f_lseek + f_read per request), on top of the
+ * BSP's xilffs ff.c. The card is a RAM disk: it is formatted with f_mkfs,
+ * BOOT.BIN is copied on, optionally interleaved with a filler file so its
+ * clusters are fragmented, and then both loaders replay the reads
+ * LoadBootImage() makes: the header words, the partition header table and
+ * every partition in one request.
+ *
+ * Every disk_read() is one CMD17/CMD18 on the board, so it is charged a
+ * command latency plus the transfer time. The data read is compared with
+ * the file.
+ *
+ * usage: sdbench [-s MB] [-a bytes] [-f KB] [-l us] [-b MB/s] BOOT.BIN
+ *   -s MB      card size (default 64)
+ *   -a bytes   cluster size (default 4096)
+ *   -f KB      fragment BOOT.BIN every KB kilobytes (default 0, contiguous)
+ *   -l us      latency per command (default 250, as bootsim)
+ *   -b MB/s    card bandwidth (default 20, as bootsim)
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "sd.h"
+#include "image_mover.h"
+
+#define SECTOR		512
+#define MAX_PARTS	32
+#define MAX_READS	(4 + 2 * MAX_PARTS)
+
+u32 InitSD_base(const char *filename);
+u32 SDAccess_base(u32 SourceAddress, u32 DestinationAddress, u32 LengthBytes);
+void ReleaseSD_base(void);
+
+u32 FlashReadBaseAddress;
+
+static u8 *disk;
+static u32 disk_sectors;
+static double latency_us = 250.0;
+static double mbps = 20.0;
+static unsigned long cmds, sectors;
+static double model_ns;
+
+typedef struct {
+	u32 src, len;
+} req_t;
+
+static req_t reqs[MAX_READS];
+static int nreqs;
+
+/*
+ * RAM disk behind xilffs, charged like the card
+ */
+DSTATUS disk_initialize(BYTE pdrv) {
+	(void)pdrv;
+	return 0;
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+	(void)pdrv;
+	return 0;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count) {
+	(void)pdrv;
+	if (sector + count > disk_sectors)
+		return RES_PARERR;
+	memcpy(buff, disk + (size_t)sector * SECTOR, (size_t)count * SECTOR);
+	cmds++;
+	sectors += count;
+	model_ns += latency_us * 1e3 + count * SECTOR * 1e3 / mbps;
+	return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count) {
+	(void)pdrv;
+	if (sector + count > disk_sectors)
+		return RES_PARERR;
+	memcpy(disk + (size_t)sector * SECTOR, buff, (size_t)count * SECTOR);
+	return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff) {
+	(void)pdrv;
+	switch (cmd) {
+	case CTRL_SYNC: return RES_OK;
+	case GET_SECTOR_COUNT: *(DWORD *)buff = disk_sectors; return RES_OK;
+	case GET_SECTOR_SIZE: *(WORD *)buff = SECTOR; return RES_OK;
+	case GET_BLOCK_SIZE: *(DWORD *)buff = 1; return RES_OK;
+	}
+	return RES_PARERR;
+}
+
+DWORD get_fattime(void) {
+	return ((DWORD)(2020 - 1980) << 25) | (1 << 21) | (1 << 16);
+}
+
+char *strcpy_rom(char *Dest, const char *Src) {
+	return strcpy(Dest, Src);
+}
+
+static u32 rd32(const u8 *p) {
+	return (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+}
+
+static void die(const char *what, int rc) {
+	fprintf(stderr, "sdbench: %s failed (%d)\n", what, rc);
+	exit(1);
+}
+
+/*
+ * format the card and copy BOOT.BIN on, frag_kb > 0 interleaves it with a
+ * filler file
+ */
+static void make_card(const u8 *img, size_t size, u32 au, u32 frag_kb) {
+	static BYTE work[FF_MAX_SS * 4];
+	FATFS fs;
+	FIL boot, fill;
+	UINT bw;
+	size_t off = 0, step = frag_kb ? (size_t)frag_kb * 1024 : size;
+	int rc;
+
+	rc = f_mkfs("0:", FM_FAT | FM_FAT32 | FM_SFD, au, work, sizeof(work));
+	if (rc != FR_OK)
+		die("f_mkfs", rc);
+	rc = f_mount(&fs, "0:", 1);
+	if (rc != FR_OK)
+		die("f_mount", rc);
+	if ((rc = f_open(&boot, "0:/BOOT.BIN", FA_WRITE | FA_CREATE_ALWAYS)) != FR_OK)
+		die("f_open BOOT.BIN", rc);
+	if (frag_kb && (rc = f_open(&fill, "0:/FILL.BIN", FA_WRITE | FA_CREATE_ALWAYS)) != FR_OK)
+		die("f_open FILL.BIN", rc);
+	while (off < size) {
+		size_t n = size - off < step ? size - off : step;
+
+		if ((rc = f_write(&boot, img + off, (UINT)n, &bw)) != FR_OK || bw != n)
+			die("f_write BOOT.BIN", rc);
+		if ((rc = f_sync(&boot)) != FR_OK)
+			die("f_sync", rc);
+		if (frag_kb && ((rc = f_write(&fill, img, au, &bw)) != FR_OK || bw != au))
+			die("f_write FILL.BIN", rc);
+		if (frag_kb && (rc = f_sync(&fill)) != FR_OK)
+			die("f_sync", rc);
+		off += n;
+	}
+	f_close(&boot);
+	if (frag_kb)
+		f_close(&fill);
+	f_mount(NULL, "0:", 0);
+}
+
+/*
+ * the requests LoadBootImage() makes through MoveImage
+ */
+static void plan(const u8 *img, size_t size) {
+	u32 phdr = rd32(img + IMAGE_PHDR_OFFSET);
+	int i;
+
+	reqs[nreqs++] = (req_t){ IMAGE_PHDR_OFFSET, 4 };
+	reqs[nreqs++] = (req_t){ IMAGE_HDR_OFFSET, 4 };
+	for (i = 0; i < MAX_PARTS; i++) {
+		const u8 *h = img + phdr + i * PARTITION_HDR_TOTAL_LEN;
+
+		if ((size_t)(h - img) + PARTITION_HDR_TOTAL_LEN > size)
+			break;
+		reqs[nreqs++] = (req_t){ phdr + i * PARTITION_HDR_TOTAL_LEN, PARTITION_HDR_TOTAL_LEN };
+		if (rd32(h + PARTITION_HDR_CHECKSUM_OFFSET) == 0xFFFFFFFF || rd32(h) == 0)
+			break;
+	}
+	for (i = 1; i < MAX_PARTS && nreqs < MAX_READS; i++) {
+		const u8 *h = img + phdr + i * PARTITION_HDR_TOTAL_LEN;
+
+		if ((size_t)(h - img) + PARTITION_HDR_TOTAL_LEN > size ||
+		    rd32(h + PARTITION_HDR_CHECKSUM_OFFSET) == 0xFFFFFFFF || rd32(h) == 0)
+			break;
+		reqs[nreqs++] = (req_t){ rd32(h + PARTITION_ADDR_OFFSET) * 4,
+					 rd32(h + PARTITION_WORD_LEN_OFFSET) * 4 };
+	}
+}
+
+static void run(const char *name, u32 (*init)(const char *),
+		u32 (*access)(u32, u32, u32), void (*release)(void),
+		const u8 *img, u8 *dst) {
+	struct timespec t0, t1;
+	int i;
+
+	cmds = sectors = 0;
+	model_ns = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if (init("BOOT.BIN") != XST_SUCCESS)
+		die(name, 0);
+	for (i = 0; i < nreqs; i++) {
+		if (access(reqs[i].src, (u32)(uintptr_t)dst, reqs[i].len) != XST_SUCCESS)
+			die(name, i);
+		if (memcmp(dst, img + reqs[i].src, reqs[i].len) != 0) {
+			fprintf(stderr, "sdbench: %s read %d (0x%x+%u) differs\n",
+				name, i, reqs[i].src, reqs[i].len);
+			exit(1);
+		}
+	}
+	release();
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	printf("%-9s %6lu cmds %8lu sectors  card %9.3f ms  host %7.3f ms\n",
+	       name, cmds, sectors, model_ns / 1e6,
+	       (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: sdbench [-s MB] [-a bytes] [-f KB] [-l us] [-b MB/s] BOOT.BIN\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	u32 card_mb = 64, au = 4096, frag_kb = 0, max_len = 0;
+	u8 *img, *dst;
+	long size;
+	FILE *f;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "s:a:f:l:b:")) != -1) {
+		switch (opt) {
+		case 's': card_mb = atoi(optarg); break;
+		case 'a': au = atoi(optarg); break;
+		case 'f': frag_kb = atoi(optarg); break;
+		case 'l': latency_us = atof(optarg); break;
+		case 'b': mbps = atof(optarg); break;
+		default: usage();
+		}
+	}
+	if (argc - optind != 1)
+		usage();
+
+	f = fopen(argv[optind], "rb");
+	if (f == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	rewind(f);
+	img = malloc(size);
+	if (img == NULL || fread(img, 1, size, f) != (size_t)size)
+		die("read BOOT.BIN", 0);
+	fclose(f);
+	if (size < IMAGE_PHDR_OFFSET + 4)
+		die("BOOT.BIN header", 0);
+
+	disk_sectors = card_mb * (1024 * 1024 / SECTOR);
+	disk = calloc(disk_sectors, SECTOR);
+	if (disk == NULL)
+		die("calloc", 0);
+	make_card(img, size, au, frag_kb);
+	plan(img, size);
+
+	/* the loader takes u32 destinations, like DDR on the board */
+	for (i = 0; i < nreqs; i++) {
+		if (reqs[i].src + (size_t)reqs[i].len > (size_t)size)
+			die("partition table", i);
+		if (reqs[i].len > max_len)
+			max_len = reqs[i].len;
+	}
+	dst = mmap(NULL, max_len + SECTOR, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+	if (dst == MAP_FAILED)
+		die("mmap", 0);
+
+	printf("%ld byte image, %d reads, %u byte clusters%s\n", size, nreqs, au,
+	       frag_kb ? ", fragmented" : "");
+	run("f_read", InitSD_base, SDAccess_base, ReleaseSD_base, img, dst);
+	run("fastpath", InitSD, SDAccess, ReleaseSD, img, dst);
+	return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * sdlog.c -- time small-append logging through the xilffs sector cache
+ *
+ * Builds the application BSP's xilffs ff.c and diskcache.c on the host
+ * over a FAT image file, which stands in for the card:
+ * disk_cache_dev_read() and disk_cache_dev_write() are pread()/pwrite()
+ * on the image. The same log
+ * is written twice on a freshly formatted image, once with every
+ * disk_read()/disk_write() going to the image as diskio.c did before the
+ * cache, and once through the cache as diskio.c does now. A logger
+ * appends fixed size records and calls f_sync() every few of them.
+ *
+ * Every command is charged a latency plus the transfer time, writes with
+ * a latency of their own since a card busies itself after each write
+ * command. After each run the cache is dropped, the log read back from
+ * the image and compared with what was written.
+ *
+ * With -i the image is kept; it has no partition table, so on Linux
+ * "mount -o loop image /mnt" shows the log of the cached run.
+ *
+ * usage: sdlog [-s MB] [-a bytes] [-r bytes] [-n records] [-y records]
+ *              [-l us] [-w us] [-b MB/s] [-i image]
+ *   -s MB      card size (default 64)
+ *   -a bytes   cluster size (default 4096)
+ *   -r bytes   record size (default 48)
+ *   -n records records to log (default 20000)
+ *   -y records records per f_sync (default 16, 0 only at f_close)
+ *   -l us      latency per read command (default 250, as sdbench)
+ *   -w us      latency per write command (default 1000)
+ *   -b MB/s    card bandwidth (default 20, as sdbench)
+ *   -i image   image file (default a temporary file)
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "diskcache.h"
+
+#define SECTOR		512
+#define MAX_RECORD	512
+
+static int fd = -1;
+static u32 disk_sectors;
+static int cached;
+static double read_us = 250.0, write_us = 1000.0, mbps = 20.0;
+static unsigned long reads, writes, sectors_read, sectors_written;
+static double model_ns;
+
+/*
+ * the image file below the cache, charged like the card
+ */
+DRESULT disk_cache_dev_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count) {
+	(void)pdrv;
+	if (sector + count > disk_sectors)
+		return RES_PARERR;
+	if (pread(fd, buff, (size_t)count * SECTOR, (off_t)sector * SECTOR) !=
+	    (ssize_t)count * SECTOR)
+		return RES_ERROR;
+	reads++;
+	sectors_read += count;
+	model_ns += read_us * 1e3 + count * SECTOR * 1e3 / mbps;
+	return RES_OK;
+}
+
+DRESULT disk_cache_dev_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count) {
+	(void)pdrv;
+	if (sector + count > disk_sectors)
+		return RES_PARERR;
+	if (pwrite(fd, buff, (size_t)count * SECTOR, (off_t)sector * SECTOR) !=
+	    (ssize_t)count * SECTOR)
+		return RES_ERROR;
+	writes++;
+	sectors_written += count;
+	model_ns += write_us * 1e3 + count * SECTOR * 1e3 / mbps;
+	return RES_OK;
+}
+
+/*
+ * the glue ff.c calls, as diskio.c with the cache or without it
+ */
+DSTATUS disk_initialize(BYTE pdrv) {
+	(void)pdrv;
+	return 0;
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+	(void)pdrv;
+	return 0;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count) {
+	return cached ? disk_cache_read(pdrv, buff, sector, count) :
+		disk_cache_dev_read(pdrv, buff, sector, count);
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count) {
+	return cached ? disk_cache_write(pdrv, buff, sector, count) :
+		disk_cache_dev_write(pdrv, buff, sector, count);
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff) {
+	switch (cmd) {
+	case CTRL_SYNC: return cached ? disk_cache_sync(pdrv) : RES_OK;
+	case GET_SECTOR_COUNT: *(DWORD *)buff = disk_sectors; return RES_OK;
+	case GET_SECTOR_SIZE: *(WORD *)buff = SECTOR; return RES_OK;
+	case GET_BLOCK_SIZE: *(DWORD *)buff = 1; return RES_OK;
+	}
+	return RES_PARERR;
+}
+
+DWORD get_fattime(void) {
+	return ((DWORD)(2020 - 1980) << 25) | (1 << 21) | (1 << 16);
+}
+
+static void die(const char *what, int rc) {
+	fprintf(stderr, "sdlog: %s failed (%d)\n", what, rc);
+	exit(1);
+}
+
+/*
+ * record i, a line of printable text padded to len bytes
+ */
+static void record(char *buf, unsigned long i, u32 len) {
+	u32 n = (u32)snprintf(buf, len, "%08lu,%lu,%lu", i, (i * 7919) % 4096, i % 3);
+
+	if (n > len - 1)
+		n = len - 1;
+	memset(buf + n, ' ', len - 1 - n);
+	buf[len - 1] = '\n';
+}
+
+static void format(u32 au) {
+	static BYTE work[FF_MAX_SS * 4];
+	int rc;
+
+	if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)disk_sectors * SECTOR) != 0)
+		die("ftruncate", 0);
+	rc = f_mkfs("0:", FM_FAT | FM_FAT32 | FM_SFD, au, work, sizeof(work));
+	if (rc != FR_OK)
+		die("f_mkfs", rc);
+}
+
+/*
+ * read the log back from the image and compare it with the records
+ */
+static void verify(const char *name, unsigned long n, u32 len) {
+	char want[MAX_RECORD], got[MAX_RECORD];
+	FATFS fs;
+	FIL log;
+	UINT br;
+	unsigned long i;
+	int rc;
+
+	disk_cache_invalidate(0);
+	if ((rc = f_mount(&fs, "0:", 1)) != FR_OK)
+		die("f_mount", rc);
+	if ((rc = f_open(&log, "0:/LOG.TXT", FA_READ)) != FR_OK)
+		die("f_open LOG.TXT", rc);
+	if (f_size(&log) != (FSIZE_t)n * len) {
+		fprintf(stderr, "sdlog: %s log is %lu bytes, not %lu\n", name,
+			(unsigned long)f_size(&log), n * len);
+		exit(1);
+	}
+	for (i = 0; i < n; i++) {
+		record(want, i, len);
+		if ((rc = f_read(&log, got, len, &br)) != FR_OK || br != len)
+			die("f_read", rc);
+		if (memcmp(want, got, len) != 0) {
+			fprintf(stderr, "sdlog: %s record %lu differs\n", name, i);
+			exit(1);
+		}
+	}
+	f_close(&log);
+	f_mount(NULL, "0:", 0);
+}
+
+static double run(const char *name, int use_cache, u32 au, unsigned long n, u32 len, u32 sync,
+		  DiskCacheStats *st) {
+	char buf[MAX_RECORD];
+	DiskCacheStats before;
+	struct timespec t0, t1;
+	FATFS fs;
+	FIL log;
+	UINT bw;
+	unsigned long i;
+	int rc;
+
+	cached = use_cache;
+	format(au);
+	disk_cache_invalidate(0);
+	disk_cache_stats(&before);
+	reads = writes = sectors_read = sectors_written = 0;
+	model_ns = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if ((rc = f_mount(&fs, "0:", 1)) != FR_OK)
+		die("f_mount", rc);
+	if ((rc = f_open(&log, "0:/LOG.TXT", FA_WRITE | FA_CREATE_ALWAYS)) != FR_OK)
+		die("f_open LOG.TXT", rc);
+	for (i = 0; i < n; i++) {
+		record(buf, i, len);
+		if ((rc = f_write(&log, buf, len, &bw)) != FR_OK || bw != len)
+			die("f_write", rc);
+		if (sync != 0 && (i + 1) % sync == 0 && (rc = f_sync(&log)) != FR_OK)
+			die("f_sync", rc);
+	}
+	if ((rc = f_close(&log)) != FR_OK)
+		die("f_close", rc);
+	f_mount(NULL, "0:", 0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	disk_cache_stats(st);
+	st->ReadHits -= before.ReadHits;
+	st->ReadMisses -= before.ReadMisses;
+	st->ReadAhead -= before.ReadAhead;
+	st->Writes -= before.Writes;
+	st->WriteBacks -= before.WriteBacks;
+	st->Evictions -= before.Evictions;
+	st->Bypassed -= before.Bypassed;
+	st->Commands -= before.Commands;
+
+	printf("%-9s %7lu reads %7lu writes %8lu sectors  card %9.1f ms %8.1f KB/s  host %7.1f ms\n",
+	       name, reads, writes, sectors_read + sectors_written, model_ns / 1e6,
+	       n * len / 1024.0 / (model_ns / 1e9),
+	       (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+	verify(name, n, len);
+	return model_ns;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: sdlog [-s MB] [-a bytes] [-r bytes] [-n records] [-y records]\n"
+		"             [-l us] [-w us] [-b MB/s] [-i image]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	u32 card_mb = 64, au = 4096, len = 48, sync = 16;
+	unsigned long n = 20000;
+	const char *image = NULL;
+	char tmp[] = "/tmp/sdlogXXXXXX";
+	DiskCacheStats st;
+	double plain, cache;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:a:r:n:y:l:w:b:i:")) != -1) {
+		switch (opt) {
+		case 's': card_mb = atoi(optarg); break;
+		case 'a': au = atoi(optarg); break;
+		case 'r': len = atoi(optarg); break;
+		case 'n': n = strtoul(optarg, NULL, 0); break;
+		case 'y': sync = atoi(optarg); break;
+		case 'l': read_us = atof(optarg); break;
+		case 'w': write_us = atof(optarg); break;
+		case 'b': mbps = atof(optarg); break;
+		case 'i': image = optarg; break;
+		default: usage();
+		}
+	}
+	if (optind != argc || len < 2 || len > MAX_RECORD || card_mb == 0)
+		usage();
+
+	if (image != NULL) {
+		fd = open(image, O_RDWR | O_CREAT, 0644);
+	} else {
+		fd = mkstemp(tmp);
+		unlink(tmp);
+	}
+	if (fd < 0) {
+		perror(image != NULL ? image : tmp);
+		return 1;
+	}
+	disk_sectors = card_mb * (1024 * 1024 / SECTOR);
+
+	printf("%lu records of %u bytes, f_sync every %u, %u byte clusters, %u sector cache\n",
+	       n, len, sync, au, (u32)DISK_CACHE_SECTORS);
+	plain = run("direct", 0, au, n, len, sync, &st);
+	cache = run("cached", 1, au, n, len, sync, &st);
+	printf("cached is %.2fx the direct throughput\n", plain / cache);
+	printf("cached run: %u read hits, %u misses, %u read ahead, %u sectors written, "
+	       "%u written back (%u evicted), %u bypassed, %u commands\n",
+	       st.ReadHits, st.ReadMisses, st.ReadAhead, st.Writes, st.WriteBacks,
+	       st.Evictions, st.Bypassed, st.Commands);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,308 @@
+/*
+ * tsread.c -- scan and filter the UPDATE history written by tslog.c
+ *
+ * Maps a HISTORY.TSL file copied off the card and walks its blocks with
+ * the firmware's own codec (module6_sw/src/tsblock.c). A block is skipped
+ * on its header when its unit, boot or time range cannot match, or when
+ * the min/max index of the -w column rules it out; only the blocks left
+ * are decoded, and only the columns the query needs.
+ *
+ * Matching rows are printed as CSV with -p, otherwise count, min, max and
+ * mean of the -a column are printed. The scan rate is reported against
+ * the file size, so skipped blocks count as scanned, as they would be on
+ * a query over the whole history.
+ *
+ * Every block's header is checked for sane offsets before decoding; -k
+ * verifies the CRC of each decoded block as well. Bad blocks are counted
+ * and skipped.
+ *
+ * With -g the tool writes a synthetic history of that many rows instead,
+ * ten updates a second with jitter, values wandering like sensor readings
+ * and a reboot every million rows, to time the scan on.
+ *
+ * usage: tsread [-u unit] [-B boot] [-t from:to] [-w col:lo:hi] [-a col]
+ *               [-p] [-k] file
+ *        tsread -g rows file
+ *   -u unit        rows of this unit only
+ *   -B boot        rows of this boot only
+ *   -t from:to     rows from..to ms after boot, inclusive
+ *   -w col:lo:hi   rows with column col between lo and hi, inclusive
+ *   -a col         column to aggregate (default avg)
+ *   -p             print the matching rows as CSV
+ *   -k             verify the CRC of every decoded block
+ *   col is avg or 0..29, the index into values[]
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tsblock.h"
+
+typedef struct {
+	int unit_set, boot_set, time_set, where_set, print, verify;
+	u32 unit, boot, where_col, agg_col;
+	u64 from, to;
+	s32 lo, hi;
+} query_t;
+
+typedef struct {
+	unsigned long blocks, skipped, decoded, bad, rows;
+	long long sum;
+	s32 min, max;
+} result_t;
+
+static void usage(void) {
+	fprintf(stderr, "usage: tsread [-u unit] [-B boot] [-t from:to] [-w col:lo:hi] [-a col]\n"
+		"              [-p] [-k] file\n"
+		"       tsread -g rows file\n");
+	exit(2);
+}
+
+static double now_s(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* avg is column 0, values[i] column 1 + i */
+static u32 column(const char *s, char **end) {
+	long v;
+
+	if (strncmp(s, "avg", 3) == 0) {
+		*end = (char *)s + 3;
+		return 0;
+	}
+	v = strtol(s, end, 10);
+	if (*end == s || v < 0 || v >= TS_COLUMNS - 1)
+		usage();
+	return (u32)v + 1;
+}
+
+/*
+ * offsets inside the payload and in order, so decoding stays in the block
+ * even when the CRC is not checked
+ */
+static int sane(const ts_header_t *h) {
+	u32 c;
+
+	if (h->magic != TS_MAGIC || h->columns != TS_COLUMNS || h->rows == 0 ||
+	    h->rows > TS_ROWS_MAX || h->length > TS_PAYLOAD || h->offset[0] != 0 ||
+	    h->offset[1 + TS_COLUMNS] != h->length)
+		return 0;
+	for (c = 0; c <= TS_COLUMNS; c++)
+		if (h->offset[c] > h->offset[c + 1])
+			return 0;
+	return 1;
+}
+
+static void scan_block(const u8 *blk, const query_t *q, result_t *res) {
+	const ts_header_t *h = (const ts_header_t *)blk;
+	static u64 t[TS_ROWS_MAX];
+	static s32 v[TS_COLUMNS][TS_ROWS_MAX];
+	static u8 have[TS_COLUMNS];
+	u32 r, c, n;
+
+	res->blocks++;
+	if (!sane(h)) {
+		res->bad++;
+		return;
+	}
+	if ((q->unit_set && h->unit != q->unit) || (q->boot_set && h->boot != q->boot) ||
+	    (q->time_set && (h->t_last < q->from || h->t_first > q->to)) ||
+	    (q->where_set && (h->max[q->where_col] < q->lo || h->min[q->where_col] > q->hi))) {
+		res->skipped++;
+		return;
+	}
+	if (q->verify && !ts_block_check(blk)) {
+		res->bad++;
+		return;
+	}
+	res->decoded++;
+
+	n = h->rows;
+	memset(have, 0, sizeof(have));
+	if (q->time_set || q->print)
+		ts_block_times(blk, t);
+	if (q->where_set) {
+		ts_block_column(blk, q->where_col, v[q->where_col]);
+		have[q->where_col] = 1;
+	}
+	if (q->print) {
+		for (c = 0; c < TS_COLUMNS; c++)
+			if (!have[c])
+				ts_block_column(blk, c, v[c]);
+	} else if (!have[q->agg_col]) {
+		ts_block_column(blk, q->agg_col, v[q->agg_col]);
+	}
+
+	for (r = 0; r < n; r++) {
+		if (q->time_set && (t[r] < q->from || t[r] > q->to))
+			continue;
+		if (q->where_set && (v[q->where_col][r] < q->lo || v[q->where_col][r] > q->hi))
+			continue;
+		res->rows++;
+		if (q->print) {
+			printf("%u,%llu,%u", h->boot, (unsigned long long)t[r], h->unit);
+			for (c = 0; c < TS_COLUMNS; c++)
+				printf(",%d", v[c][r]);
+			putchar('\n');
+		} else {
+			s32 x = v[q->agg_col][r];
+
+			if (res->rows == 1 || x < res->min)
+				res->min = x;
+			if (res->rows == 1 || x > res->max)
+				res->max = x;
+			res->sum += x;
+		}
+	}
+}
+
+/*
+ * a synthetic history of rows updates
+ */
+static int generate(const char *path, unsigned long rows) {
+	static ts_builder_t b;
+	static u8 blk[TS_BLOCK_SIZE];
+	s32 values[TS_COLUMNS], sum;
+	FILE *f = fopen(path, "wb");
+	unsigned long i, blocks = 0;
+	u32 boot = 0, c, seed = 1;
+	u64 t = 0;
+
+	if (f == NULL) {
+		perror(path);
+		return 1;
+	}
+	for (c = 0; c < TS_COLUMNS; c++)
+		values[c] = 500;
+	ts_builder_reset(&b, 7, boot);
+	for (i = 0; i < rows; i++) {
+		if (i != 0 && i % 1000000 == 0) {
+			/* a reboot: the block ends and time starts over */
+			if (b.hdr.rows != 0) {
+				ts_builder_seal(&b, blk);
+				fwrite(blk, 1, sizeof(blk), f);
+				blocks++;
+			}
+			ts_builder_reset(&b, 7, ++boot);
+			t = 0;
+		}
+		seed = seed * 1103515245 + 12345;
+		t += 100 + (seed >> 16) % 7 - 3;
+		for (c = 1, sum = 0; c < TS_COLUMNS; c++) {
+			seed = seed * 1103515245 + 12345;
+			/* most readings hold still, some drift a step */
+			if ((seed >> 16) % 4 == 0)
+				values[c] += (int)((seed >> 20) % 5) - 2;
+			sum += values[c];
+		}
+		values[0] = sum / (TS_COLUMNS - 1);
+		if (!ts_builder_add(&b, t, values)) {
+			ts_builder_seal(&b, blk);
+			fwrite(blk, 1, sizeof(blk), f);
+			blocks++;
+			ts_builder_reset(&b, 7, boot);
+			ts_builder_add(&b, t, values);
+		}
+	}
+	if (b.hdr.rows != 0) {
+		ts_builder_seal(&b, blk);
+		fwrite(blk, 1, sizeof(blk), f);
+		blocks++;
+	}
+	if (fclose(f) != 0) {
+		perror(path);
+		return 1;
+	}
+	printf("%lu rows in %lu blocks, %.1f bytes a row (%zu raw)\n", rows, blocks,
+	       (double)blocks * TS_BLOCK_SIZE / rows, sizeof(u64) + TS_COLUMNS * sizeof(s32));
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	query_t q = { 0 };
+	result_t res = { 0 };
+	unsigned long gen = 0;
+	unsigned long long a, b2;
+	struct stat st;
+	const u8 *map;
+	double t0, t1;
+	char *end;
+	size_t off;
+	int opt, fd;
+
+	while ((opt = getopt(argc, argv, "u:B:t:w:a:pkg:")) != -1) {
+		switch (opt) {
+		case 'u': q.unit_set = 1; q.unit = strtoul(optarg, NULL, 0); break;
+		case 'B': q.boot_set = 1; q.boot = strtoul(optarg, NULL, 0); break;
+		case 't':
+			if (sscanf(optarg, "%llu:%llu", &a, &b2) != 2)
+				usage();
+			q.time_set = 1;
+			q.from = a;
+			q.to = b2;
+			break;
+		case 'w':
+			q.where_col = column(optarg, &end);
+			if (*end != ':')
+				usage();
+			q.lo = strtol(end + 1, &end, 10);
+			if (*end != ':')
+				usage();
+			q.hi = strtol(end + 1, &end, 10);
+			q.where_set = 1;
+			break;
+		case 'a':
+			q.agg_col = column(optarg, &end);
+			break;
+		case 'p': q.print = 1; break;
+		case 'k': q.verify = 1; break;
+		case 'g': gen = strtoul(optarg, NULL, 0); break;
+		default: usage();
+		}
+	}
+	if (argc - optind != 1)
+		usage();
+	if (gen != 0)
+		return generate(argv[optind], gen);
+
+	fd = open(argv[optind], O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if (st.st_size < TS_BLOCK_SIZE) {
+		fprintf(stderr, "tsread: %s holds no block\n", argv[optind]);
+		return 1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	t0 = now_s();
+	for (off = 0; off + TS_BLOCK_SIZE <= (size_t)st.st_size; off += TS_BLOCK_SIZE)
+		scan_block(map + off, &q, &res);
+	t1 = now_s();
+
+	if (!q.print) {
+		if (res.rows != 0)
+			printf("%lu rows, %s min %d max %d mean %.2f\n", res.rows,
+			       q.agg_col == 0 ? "avg" : "column", res.min, res.max,
+			       (double)res.sum / res.rows);
+		else
+			printf("no rows\n");
+	}
+	fprintf(stderr, "tsread: %lu blocks, %lu skipped, %lu decoded, %lu bad, "
+		"%.1f MB in %.3f s, %.2f GB/s\n", res.blocks, res.skipped, res.decoded, res.bad,
+		st.st_size / 1e6, t1 - t0, st.st_size / 1e9 / (t1 - t0));
+	return 0;
+}
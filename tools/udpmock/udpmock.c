@@ -0,0 +1,740 @@
+/*
+ * udpmock.c -- run module6_sw/src/udp.c against a model of the GEM
+ *
+ * udp.c is built with the emacps driver from the application BSP. Their
+ * register accesses go through the bootsim xil_io.h shim to a model of
+ * GEM0, its PHY and the SLCR clock control; the buffer descriptor rings
+ * and the buffers are plain memory, and the binary is linked below 4 GB
+ * so their addresses fit the 32 bit descriptor fields. Between calls into
+ * the firmware the model plays the GEM DMA: it walks the transmit ring
+ * after STARTTX and fills the receive ring, setting the used and new bits
+ * as the hardware does, and does the checksum offload. Transmitted frames
+ * go to a model of the substation server, which answers ARP and UPDATE.
+ *
+ * The run checks speed and clock setup, ARP resolution with a datagram
+ * waiting on it, that payloads are handed over in place in the ring
+ * buffers, ring wrap and buffer recycling, transmit pool exhaustion,
+ * receive ring overflow and checksum drops. It then times UPDATE round
+ * trips: host time in the firmware (udp_alloc() to udp_send(), and the
+ * udp_poll() that runs the response handler) plus the time on the wire
+ * at the negotiated speed. The host is faster than the 667 MHz A9 and
+ * the cache maintenance is free here, so the stack time is a lower bound.
+ * The cache maintenance calls are counted instead: with the buffers from
+ * dma_mem.h a transmitted frame needs none.
+ *
+ * usage: udpmock [-n round trips] [-s 10|100|1000] [-l peer us]
+ *   -n  round trips to time (default 100000)
+ *   -s  speed the PHY negotiates (default 1000)
+ *   -l  substation turnaround in microseconds (default 0)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "xil_io.h"
+#include "xil_cache.h"
+#include "xil_mmu.h"
+#include "xil_exception.h"
+#include "xtime_l.h"
+#include "xemacps.h"
+#include "dma_mem.h"
+#include "udp.h"
+
+#define GEM_BASE    XPAR_XEMACPS_0_BASEADDR
+#define GEM_MODID   0x00020118   /* Zynq-7000 GEM, revision 2 */
+#define SLCR_LOCK          0xF8000004
+#define SLCR_UNLOCK        0xF8000008
+#define SLCR_GEM0_CLK_CTRL 0xF8000140
+#define PHY_ADDR    1
+
+#define BOARD_IP    UDP_IP(192, 168, 1, 10)
+#define PEER_IP     UDP_IP(192, 168, 1, 100)
+#define PORT        12345
+#define UPDATE      2
+#define MARK        0x55AA       /* unsolicited datagrams from the peer */
+
+#define FRAME_MAX   1536
+#define WIRE_SLOTS  64
+#define PAYLOAD_OFF 44           /* payload offset in a ring buffer */
+
+/* the substation wire format, as in fsm.c */
+typedef struct {
+	int type;
+	int id;
+	int value;
+} update_request_t;
+
+typedef struct {
+	int type;
+	int id;
+	int average;
+	int values[30];
+} update_response_t;
+
+typedef struct {
+	u8 data[FRAME_MAX];
+	u32 len;
+} wire_frame_t;
+
+static u32 gem[0x1000 / 4];
+static u32 isr, imr;
+static int tx_go;
+static u32 tx_ptr, rx_ptr;
+static u16 phy[32];
+static u32 slcr_clk, slcr_locked = 1;
+static struct { INTPTR addr; u32 attr; } tlb[8];    /* sections remapped */
+static u32 tlb_used;
+static u32 cache_cleans, cache_invalidates;
+static Xil_InterruptHandler irq_handler;
+static void *irq_ref;
+
+/* frames from the substation to the board, not yet in the ring */
+static wire_frame_t wire[WIRE_SLOTS];
+static u32 wire_head, wire_tail;
+
+static u32 speed = 1000;
+static double peer_us;
+static const u8 peer_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static u8 board_mac[6];
+static int failures;
+
+/* model counters */
+static unsigned long tx_frames, rx_delivered, rx_overruns, rx_csum_drops;
+static unsigned long peer_arp_requests, peer_arp_replies, peer_updates;
+static unsigned long bad_frames;
+static u32 last_tx_buf;
+
+/* firmware side */
+static int responses;
+static update_response_t last_resp;
+static const void *last_data;
+static int marks;
+
+static void check(int ok, const char *what) {
+	if (!ok) {
+		printf("FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+static unsigned long long host_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+/* a frame on the wire: preamble, FCS and gap included */
+static double wire_ns(u32 len) {
+	if (len < 60)
+		len = 60;
+	return (len + 24) * 8 * 1000.0 / speed;
+}
+
+static void put16(u8 *p, u32 v) {
+	p[0] = (u8)(v >> 8);
+	p[1] = (u8)v;
+}
+
+static void put32(u8 *p, u32 v) {
+	put16(p, v >> 16);
+	put16(p + 2, v);
+}
+
+static u32 get16(const u8 *p) {
+	return ((u32)p[0] << 8) | p[1];
+}
+
+static u32 get32(const u8 *p) {
+	return (get16(p) << 16) | get16(p + 2);
+}
+
+static u32 csum_add(u32 sum, const u8 *p, u32 len) {
+	u32 i;
+
+	for (i = 0; i + 1 < len; i += 2)
+		sum += get16(p + i);
+	if (len & 1)
+		sum += (u32)p[len - 1] << 8;
+	return sum;
+}
+
+static u16 csum_fold(u32 sum) {
+	while (sum >> 16)
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	return (u16)~sum;
+}
+
+static u16 udp_csum(const u8 *ip) {
+	u32 ulen = get16(ip + 2) - 20;
+	u32 sum = csum_add(0, ip + 12, 8);
+	u16 c;
+
+	sum += 17 + ulen;
+	c = csum_fold(csum_add(sum, ip + 20, ulen));
+	return c == 0 ? 0xFFFF : c;
+}
+
+/*
+ * the checksum offload: fill in the IP and UDP checksums of an IPv4 UDP
+ * frame, or check them
+ */
+static void csum_fill(u8 *frame) {
+	u8 *ip = frame + 14;
+
+	if (get16(frame + 12) != 0x0800 || ip[9] != 17)
+		return;
+	put16(ip + 10, 0);
+	put16(ip + 10, csum_fold(csum_add(0, ip, 20)));
+	put16(ip + 26, 0);
+	put16(ip + 26, udp_csum(ip));
+}
+
+static int csum_ok(const u8 *frame) {
+	const u8 *ip = frame + 14;
+	u8 copy[FRAME_MAX];
+
+	if (get16(frame + 12) != 0x0800 || ip[9] != 17)
+		return 1;
+	memcpy(copy, frame, 14 + get16(ip + 2));
+	csum_fill(copy);
+	return memcmp(copy, frame, 14 + get16(ip + 2)) == 0;
+}
+
+static void wire_push(const u8 *frame, u32 len) {
+	wire_frame_t *w;
+
+	if (wire_head - wire_tail == WIRE_SLOTS)
+		return;
+	w = &wire[wire_head++ % WIRE_SLOTS];
+	memcpy(w->data, frame, len);
+	w->len = len;
+}
+
+/*
+ * the substation: build a datagram from PEER_IP:PORT to the board
+ */
+static void peer_send(const void *payload, u32 len, int corrupt) {
+	u8 f[FRAME_MAX];
+	u8 *ip = f + 14;
+
+	memcpy(f, board_mac, 6);
+	memcpy(f + 6, peer_mac, 6);
+	put16(f + 12, 0x0800);
+	memset(ip, 0, 28);
+	ip[0] = 0x45;
+	put16(ip + 2, 28 + len);
+	put16(ip + 6, 0x4000);
+	ip[8] = 64;
+	ip[9] = 17;
+	put32(ip + 12, PEER_IP);
+	put32(ip + 16, BOARD_IP);
+	put16(ip + 20, PORT);
+	put16(ip + 22, PORT);
+	put16(ip + 24, 8 + len);
+	memcpy(ip + 28, payload, len);
+	csum_fill(f);
+	if (corrupt)
+		ip[28] ^= 0xFF;
+	wire_push(f, 42 + len);
+}
+
+static void peer_arp(u32 op, const u8 *mac, u32 ip) {
+	u8 f[42];
+	u8 *a = f + 14;
+
+	memcpy(f, op == 1 ? (const u8 *)"\xff\xff\xff\xff\xff\xff" : mac, 6);
+	memcpy(f + 6, peer_mac, 6);
+	put16(f + 12, 0x0806);
+	put16(a, 1);
+	put16(a + 2, 0x0800);
+	a[4] = 6;
+	a[5] = 4;
+	put16(a + 6, op);
+	memcpy(a + 8, peer_mac, 6);
+	put32(a + 14, PEER_IP);
+	memset(a + 18, 0, 6);
+	if (op == 2)
+		memcpy(a + 18, mac, 6);
+	put32(a + 24, ip);
+	wire_push(f, sizeof(f));
+}
+
+static void peer_input(const u8 *f, u32 len) {
+	const u8 *ip = f + 14;
+	update_request_t req;
+	update_response_t resp;
+	int i;
+
+	if (len < 60) {
+		bad_frames++;
+		return;
+	}
+	if (get16(f + 12) == 0x0806) {
+		const u8 *a = f + 14;
+
+		if (get16(a + 6) == 1 && get32(a + 24) == PEER_IP) {
+			peer_arp_requests++;
+			memcpy(board_mac, a + 8, 6);
+			peer_arp(2, a + 8, get32(a + 14));
+		} else if (get16(a + 6) == 2 && get32(a + 24) == PEER_IP) {
+			peer_arp_replies++;
+		}
+		return;
+	}
+	if (memcmp(f, peer_mac, 6) != 0 || get16(f + 12) != 0x0800 || ip[0] != 0x45 ||
+	    ip[9] != 17 || get32(ip + 12) != BOARD_IP || get32(ip + 16) != PEER_IP ||
+	    get16(ip + 2) + 14 > len || get16(ip + 24) != get16(ip + 2) - 20 ||
+	    get16(ip + 22) != PORT || !csum_ok(f)) {
+		bad_frames++;
+		return;
+	}
+	if (get16(ip + 24) - 8 != sizeof(req)) {
+		bad_frames++;
+		return;
+	}
+	memcpy(&req, ip + 28, sizeof(req));
+	if (req.type != UPDATE) {
+		bad_frames++;
+		return;
+	}
+	peer_updates++;
+	resp.type = UPDATE;
+	resp.id = req.id;
+	resp.average = 50;
+	for (i = 0; i < 30; i++)
+		resp.values[i] = i;
+	resp.values[29] = req.value;    /* lets the board match the reply */
+	peer_send(&resp, sizeof(resp), 0);
+}
+
+/*
+ * GEM DMA: send what the transmit ring holds, then move frames from the
+ * wire into the receive ring
+ */
+static void gem_step(void) {
+	static u8 frame[FRAME_MAX];
+	static u32 flen;
+
+	while (tx_go) {
+		u32 *bd = (u32 *)(UINTPTR)tx_ptr;
+		u32 status = bd[1];
+		u32 len = status & XEMACPS_TXBUF_LEN_MASK;
+
+		if (status & XEMACPS_TXBUF_USED_MASK) {
+			tx_go = 0;
+			isr |= XEMACPS_IXR_TXUSED_MASK;
+			break;
+		}
+		if (flen + len <= FRAME_MAX)
+			memcpy(frame + flen, (u8 *)(UINTPTR)bd[0], len);
+		flen += len;
+		last_tx_buf = bd[0];
+		bd[1] = status | XEMACPS_TXBUF_USED_MASK;
+		tx_ptr = (status & XEMACPS_TXBUF_WRAP_MASK) ? gem[XEMACPS_TXQBASE_OFFSET / 4] : tx_ptr + 8;
+		if (status & XEMACPS_TXBUF_LAST_MASK) {
+			if (gem[XEMACPS_DMACR_OFFSET / 4] & XEMACPS_DMACR_TCPCKSUM_MASK)
+				csum_fill(frame);
+			tx_frames++;
+			gem[XEMACPS_TXSR_OFFSET / 4] |= XEMACPS_TXSR_TXCOMPL_MASK;
+			isr |= XEMACPS_IXR_TXCOMPL_MASK;
+			peer_input(frame, flen);
+			flen = 0;
+		}
+	}
+
+	while (wire_tail != wire_head) {
+		wire_frame_t *w = &wire[wire_tail++ % WIRE_SLOTS];
+		u32 *bd = (u32 *)(UINTPTR)rx_ptr;
+		u32 off = (gem[XEMACPS_NWCFG_OFFSET / 4] & XEMACPS_NWCFG_RXOFFS_MASK) >> 14;
+
+		if ((gem[XEMACPS_NWCTRL_OFFSET / 4] & XEMACPS_NWCTRL_RXEN_MASK) == 0)
+			continue;
+		if ((gem[XEMACPS_NWCFG_OFFSET / 4] & XEMACPS_NWCFG_RXCHKSUMEN_MASK) &&
+		    !csum_ok(w->data)) {
+			rx_csum_drops++;
+			continue;
+		}
+		if (bd[0] & XEMACPS_RXBUF_NEW_MASK) {
+			rx_overruns++;
+			gem[XEMACPS_RXSR_OFFSET / 4] |= XEMACPS_RXSR_BUFFNA_MASK;
+			isr |= XEMACPS_IXR_RXUSED_MASK;
+			continue;
+		}
+		memcpy((u8 *)(UINTPTR)(bd[0] & XEMACPS_RXBUF_ADD_MASK) + off, w->data, w->len);
+		bd[1] = w->len | XEMACPS_RXBUF_SOF_MASK | XEMACPS_RXBUF_EOF_MASK;
+		bd[0] |= XEMACPS_RXBUF_NEW_MASK;
+		rx_ptr = (bd[0] & XEMACPS_RXBUF_WRAP_MASK) ? gem[XEMACPS_RXQBASE_OFFSET / 4] : rx_ptr + 8;
+		rx_delivered++;
+		gem[XEMACPS_RXSR_OFFSET / 4] |= XEMACPS_RXSR_FRAMERX_MASK;
+		isr |= XEMACPS_IXR_FRAMERX_MASK;
+	}
+}
+
+/* take the GEM interrupt if one is pending and enabled */
+static void gem_irq(void) {
+	if ((isr & imr) != 0 && irq_handler != NULL)
+		irq_handler(irq_ref);
+}
+
+static void mdio(u32 value) {
+	u32 addr = (value & XEMACPS_PHYMNTNC_ADDR_MASK) >> XEMACPS_PHYMNTNC_PHAD_SHFT_MSK;
+	u32 reg = (value & XEMACPS_PHYMNTNC_REG_MASK) >> XEMACPS_PHYMNTNC_PREG_SHFT_MSK;
+	u32 data = 0xFFFF;
+
+	if (value & XEMACPS_PHYMNTNC_OP_R_MASK) {
+		if (addr == PHY_ADDR)
+			data = phy[reg];
+	} else if (addr == PHY_ADDR) {
+		phy[reg] = (u16)value;
+		data = (u16)value;
+	}
+	gem[XEMACPS_PHYMNTNC_OFFSET / 4] = (value & 0xFFFF0000u) | data;
+}
+
+u32 bootsim_reg_read(UINTPTR Addr) {
+	if (Addr >= GEM_BASE && Addr < GEM_BASE + 0x1000) {
+		switch (Addr - GEM_BASE) {
+		case XEMACPS_NWSR_OFFSET:
+			return XEMACPS_NWSR_MDIOIDLE_MASK;
+		case XEMACPS_ISR_OFFSET:
+			return isr;
+		case XEMACPS_IMR_OFFSET:
+			return ~imr & XEMACPS_IXR_ALL_MASK;
+		case 0xFC:
+			return GEM_MODID;
+		default:
+			return gem[(Addr - GEM_BASE) / 4];
+		}
+	}
+	if (Addr == SLCR_GEM0_CLK_CTRL)
+		return slcr_clk;
+	return 0;
+}
+
+void bootsim_reg_write(UINTPTR Addr, u32 Value) {
+	if (Addr >= GEM_BASE && Addr < GEM_BASE + 0x1000) {
+		u32 off = Addr - GEM_BASE;
+
+		switch (off) {
+		case XEMACPS_NWCTRL_OFFSET:
+			if (Value & XEMACPS_NWCTRL_STARTTX_MASK)
+				tx_go = 1;
+			gem[off / 4] = Value & ~XEMACPS_NWCTRL_STARTTX_MASK;
+			break;
+		case XEMACPS_ISR_OFFSET:
+			isr &= ~Value;
+			break;
+		case XEMACPS_IER_OFFSET:
+			imr |= Value;
+			break;
+		case XEMACPS_IDR_OFFSET:
+			imr &= ~Value;
+			break;
+		case XEMACPS_TXSR_OFFSET:
+		case XEMACPS_RXSR_OFFSET:
+			gem[off / 4] &= ~Value;
+			break;
+		case XEMACPS_PHYMNTNC_OFFSET:
+			mdio(Value);
+			break;
+		case XEMACPS_TXQBASE_OFFSET:
+			tx_ptr = Value;
+			gem[off / 4] = Value;
+			break;
+		case XEMACPS_RXQBASE_OFFSET:
+			rx_ptr = Value;
+			gem[off / 4] = Value;
+			break;
+		default:
+			gem[off / 4] = Value;
+		}
+		return;
+	}
+	if (Addr == SLCR_UNLOCK && Value == 0xDF0D)
+		slcr_locked = 0;
+	else if (Addr == SLCR_LOCK && Value == 0x767B)
+		slcr_locked = 1;
+	else if (Addr == SLCR_GEM0_CLK_CTRL && !slcr_locked)
+		slcr_clk = Value;
+}
+
+void Xil_DCacheFlushRange(INTPTR adr, u32 len) {
+	(void)adr;
+	(void)len;
+	cache_cleans++;
+}
+
+void Xil_DCacheInvalidateRange(INTPTR adr, u32 len) {
+	(void)adr;
+	(void)len;
+	cache_invalidates++;
+}
+
+void Xil_SetTlbAttributes(INTPTR Addr, u32 attrib) {
+	if ((Addr & (DMA_MEM_SECTION - 1)) == 0 && tlb_used < 8) {
+		tlb[tlb_used].addr = Addr;
+		tlb[tlb_used++].attr = attrib;
+	}
+}
+
+/* the mapping of the section addr is in, write-back DDR if untouched */
+static u32 tlb_attr(UINTPTR addr) {
+	u32 i;
+
+	for (i = 0; i < tlb_used; i++)
+		if (addr - (UINTPTR)tlb[i].addr < DMA_MEM_SECTION)
+			return tlb[i].attr;
+	return NORM_WB_CACHE;
+}
+
+void XTime_GetTime(XTime *Xtime_Global) {
+	*Xtime_Global = host_ns() * (COUNTS_PER_SECOND / 1000000) / 1000;
+}
+
+s32 gic_connect(u32 id, Xil_InterruptHandler handler, void *devp) {
+	if (id != XPAR_XEMACPS_0_INTR)
+		return XST_FAILURE;
+	irq_handler = handler;
+	irq_ref = devp;
+	return XST_SUCCESS;
+}
+
+static void recv(void *ref, const udp_addr_t *from, void *data, u32 len) {
+	(void)ref;
+	last_data = data;
+	if (from->ip != PEER_IP || from->port != PORT || len != sizeof(update_response_t)) {
+		bad_frames++;
+		return;
+	}
+	memcpy(&last_resp, data, sizeof(last_resp));
+	if (last_resp.average == MARK)
+		marks++;
+	else
+		responses++;
+}
+
+/* is p the payload of one of the buffers on the receive ring? */
+static int in_rx_ring(const void *p) {
+	u32 *bd = (u32 *)(UINTPTR)gem[XEMACPS_RXQBASE_OFFSET / 4];
+	int i;
+
+	for (i = 0; i < UDP_RX_BUFS; i++)
+		if ((const u8 *)(UINTPTR)(bd[2 * i] & XEMACPS_RXBUF_ADD_MASK) + PAYLOAD_OFF == p)
+			return 1;
+	return 0;
+}
+
+static void run(void) {
+	gem_step();
+	gem_irq();
+	udp_poll();
+}
+
+static int cmp_ull(const void *a, const void *b) {
+	unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void phy_setup(void) {
+	phy[0] = 0x1140;                /* autonegotiation on, full duplex */
+	phy[1] = 0x796D;                /* link up, autonegotiation complete */
+	phy[2] = 0x001C;                /* Realtek */
+	phy[3] = 0xC915;
+	phy[4] = 0x01E1;                /* 10/100 half and full */
+	phy[9] = 0x0200;                /* 1000 full */
+	if (speed == 1000) {
+		phy[5] = 0xC5E1;
+		phy[10] = 0x3800;
+	} else if (speed == 100) {
+		phy[5] = 0xC1E1;
+	} else {
+		phy[5] = 0xC061;
+	}
+}
+
+int main(int argc, char **argv) {
+	static const udp_config_t cfg = { UDP_MAC_DEFAULT, BOARD_IP, PORT };
+	static const u8 mac[6] = UDP_MAC_DEFAULT;
+	const udp_addr_t peer = { PEER_IP, PORT };
+	unsigned long n = 100000, i;
+	unsigned long long t0, t1, t2, t3, *rtt, sum = 0;
+	update_request_t *req;
+	void *bufs[UDP_TX_BUFS + 1];
+	udp_stats_t st;
+	dma_mem_stats_t wt, wb;
+	u32 div0, div1, cnt;
+	double wire_rtt;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:s:l:")) != -1) {
+		switch (opt) {
+		case 'n':
+			n = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			speed = (u32)strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			peer_us = strtod(optarg, NULL);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n round trips] [-s 10|100|1000] [-l peer us]\n", argv[0]);
+			return 2;
+		}
+	}
+	if ((speed != 10 && speed != 100 && speed != 1000) || n == 0) {
+		fprintf(stderr, "%s: bad speed or count\n", argv[0]);
+		return 2;
+	}
+	rtt = malloc(n * sizeof(*rtt));
+	if (rtt == NULL)
+		return 1;
+	phy_setup();
+
+	/* bring up */
+	dma_mem_init();
+	check(udp_init(&cfg, recv, NULL) == XST_SUCCESS, "udp_init");
+	udp_stats(&st);
+	check(st.link_mbps == speed, "negotiated speed");
+	div0 = 8;
+	div1 = speed == 1000 ? 1 : speed == 100 ? 5 : 50;
+	check(((slcr_clk >> 8) & 0x3F) == div0 && ((slcr_clk >> 20) & 0x3F) == div1 && slcr_locked,
+	      "SLCR GEM0 clock divisors");
+	check(((gem[XEMACPS_NWCFG_OFFSET / 4] & XEMACPS_NWCFG_1000_MASK) != 0) == (speed == 1000),
+	      "NWCFG speed");
+	check((gem[XEMACPS_NWCFG_OFFSET / 4] & XEMACPS_NWCFG_RXOFFS_MASK) == (2 << 14),
+	      "receive buffer offset");
+	check(tlb_attr(gem[XEMACPS_RXQBASE_OFFSET / 4]) == NORM_NONCACHE &&
+	      tlb_attr(gem[XEMACPS_TXQBASE_OFFSET / 4]) == NORM_NONCACHE,
+	      "descriptors in an uncached section");
+	check(memcmp(&gem[XEMACPS_LADDR1L_OFFSET / 4], mac, 4) == 0, "MAC address");
+
+	/* the first datagram waits for ARP */
+	req = udp_alloc();
+	check(req != NULL && ((UINTPTR)req & 3) == 0, "udp_alloc aligned");
+	req->type = UPDATE;
+	req->id = 0;
+	req->value = -1;
+	check(udp_send(req, sizeof(*req), &peer) == XST_SUCCESS, "udp_send unresolved");
+	for (i = 0; i < 10 && responses == 0; i++)
+		run();
+	udp_stats(&st);
+	check(peer_arp_requests == 1 && st.arp_requests == 1, "ARP request");
+	check(responses == 1 && last_resp.values[29] == -1, "datagram sent after ARP reply");
+	check((UINTPTR)req - 42 == last_tx_buf, "transmit in place");
+	check(in_rx_ring(last_data), "receive in place");
+	check(tlb_attr((UINTPTR)req) == NORM_WT_CACHE, "transmit buffers write-through");
+	check(tlb_attr((UINTPTR)last_data) == NORM_WB_CACHE, "receive buffers write-back");
+
+	/* the board answers ARP for its address */
+	peer_arp(1, NULL, BOARD_IP);
+	run();
+	run();
+	check(peer_arp_replies == 1, "ARP reply");
+
+	/* a bad UDP checksum is dropped by the GEM */
+	cnt = responses;
+	peer_send(&last_resp, sizeof(last_resp), 1);
+	run();
+	check(rx_csum_drops == 1 && responses == (int)cnt, "checksum drop");
+
+	/* timed round trips */
+	for (i = 0; i < n; i++) {
+		t0 = host_ns();
+		req = udp_alloc();
+		req->type = UPDATE;
+		req->id = 0;
+		req->value = (int)i;
+		udp_send(req, sizeof(*req), &peer);
+		t1 = host_ns();
+		gem_step();
+		t2 = host_ns();
+		gem_irq();
+		udp_poll();
+		t3 = host_ns();
+		rtt[i] = (t1 - t0) + (t3 - t2);
+		sum += rtt[i];
+		if (last_resp.values[29] != (int)i) {
+			check(0, "round trip response");
+			break;
+		}
+	}
+	n = i;
+
+	/* every transmit buffer in flight at once */
+	cnt = responses;
+	for (i = 0; i < UDP_TX_BUFS + 1; i++) {
+		bufs[i] = udp_alloc();
+		if (bufs[i] == NULL)
+			break;
+	}
+	check(i == UDP_TX_BUFS, "transmit pool size");
+	while (i-- > 0) {
+		req = bufs[i];
+		req->type = UPDATE;
+		req->id = 0;
+		req->value = (int)i;
+		udp_send(req, sizeof(*req), &peer);
+	}
+	check(udp_alloc() == NULL, "transmit pool exhausted");
+	run();
+	run();
+	udp_stats(&st);
+	check(responses == (int)cnt + UDP_TX_BUFS && st.tx_free_min == 0, "burst");
+
+	/* more frames than receive buffers while the board is busy */
+	last_resp.average = MARK;
+	for (i = 0; i < UDP_RX_BUFS + 8; i++)
+		peer_send(&last_resp, sizeof(last_resp), 0);
+	gem_step();
+	check(rx_overruns == 8, "receive ring overflow");
+	run();
+	check(marks == UDP_RX_BUFS, "receive ring drained");
+	req = udp_alloc();
+	req->type = UPDATE;
+	req->id = 0;
+	req->value = 7;
+	udp_send(req, sizeof(*req), &peer);
+	run();
+	check(last_resp.values[29] == 7, "round trip after overflow");
+
+	udp_stats(&st);
+	check(bad_frames == 0, "malformed frames");
+	check(st.rx_dropped == 0, "receive drops");
+	dma_mem_stats(DMA_MEM_WRITE_THROUGH, &wt);
+	dma_mem_stats(DMA_MEM_CACHED, &wb);
+	check(cache_cleans == 0 && wt.skipped == st.tx_frames, "no clean on transmit");
+	check(cache_invalidates == wb.maint, "invalidate on receive only");
+
+	qsort(rtt, n, sizeof(*rtt), cmp_ull);
+	wire_rtt = wire_ns(42 + sizeof(update_request_t)) + peer_us * 1000.0 +
+		   wire_ns(42 + sizeof(update_response_t));
+	printf("link %u Mbps, %lu round trips, substation turnaround %.1f us\n", speed, n, peer_us);
+	if (n > 0) {
+		printf("  stack (host)   min %.2f us  median %.2f us  p99 %.2f us  mean %.2f us\n",
+		       rtt[0] / 1000.0, rtt[n / 2] / 1000.0, rtt[n * 99 / 100] / 1000.0,
+		       (double)sum / n / 1000.0);
+		printf("  wire           %.2f us\n", wire_rtt / 1000.0);
+		printf("  round trip     %.2f us median\n", (rtt[n / 2] + wire_rtt) / 1000.0);
+	}
+	printf("  UART at 9600   %.1f ms on the wire alone\n",
+	       (sizeof(update_request_t) + sizeof(update_response_t)) * 10 * 1000.0 / 9600);
+	printf("gem: tx %lu rx %lu overruns %lu checksum drops %lu irqs %u\n",
+	       tx_frames, rx_delivered, rx_overruns, rx_csum_drops, st.irqs);
+	printf("udp: rx %u datagrams %u dropped %u errors %u tx %u free min %u arp req %u rep %u\n",
+	       st.rx_frames, st.rx_datagrams, st.rx_dropped, st.rx_errors, st.tx_frames, st.tx_free_min,
+	       st.arp_requests, st.arp_replies);
+	printf("dma_mem: cleans skipped %u, invalidates %u (%.1f per frame received)\n",
+	       wt.skipped, wb.maint, (double)wb.maint / st.rx_frames);
+	free(rtt);
+	if (failures) {
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
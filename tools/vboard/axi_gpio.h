@@ -0,0 +1,139 @@
+/*
+ * axi_gpio.h -- loosely timed model of the AXI GPIO v2.0, one channel
+ *
+ * The block design has four, all single channel (XPAR_AXI_GPIO_n_IS_DUAL
+ * 0): the LEDs, the buttons, the switches and the RGB LED. The pins are
+ * two ports: gpio_i, what the board drives, and gpio_o, what the model
+ * drives, the data register on the bits set to output in the tristate
+ * register.
+ *
+ * Registers as in xgpio_l.h:
+ *
+ *   0x000  DATA    reads gpio_i on input bits, the register on outputs
+ *   0x004  TRI     1 = input, all inputs out of reset
+ *   0x11C  GIE     bit 31 global interrupt enable
+ *   0x120  ISR     bit 0 channel 1 changed; a write toggles, as in the IP
+ *   0x128  IER
+ *
+ * Any change of gpio_i on an input bit sets ISR bit 0, and irq is
+ * GIE && (ISR & IER). The IP's two clock input synchronizer is left out.
+ *
+ * A write reaches the pins at the time annotated on the transaction, not
+ * when the initiator's quantum ends, so an initiator running ahead of
+ * SystemC time moves them when it would have. Each value of gpio_o is
+ * queued for its own time, as several writes can fall in one quantum.
+ */
+#ifndef VBOARD_AXI_GPIO_H
+#define VBOARD_AXI_GPIO_H
+
+#include <deque>
+
+#include "bus.h"
+
+class axi_gpio : public sc_module
+{
+public:
+	tlm_utils::simple_target_socket<axi_gpio> socket;
+	sc_in<uint32_t> gpio_i;
+	sc_out<uint32_t> gpio_o;
+	sc_out<bool> irq;
+
+	SC_HAS_PROCESS(axi_gpio);
+	axi_gpio(sc_module_name name, unsigned int width)
+		: sc_module(name), socket("socket"), gpio_i("gpio_i"), gpio_o("gpio_o"),
+		  irq("irq"), mask(width >= 32 ? 0xFFFFFFFF : (1u << width) - 1),
+		  data(0), tri(mask), gie(0), isr(0), ier(0), last_i(0)
+	{
+		socket.register_b_transport(this, &axi_gpio::b_transport);
+		socket.register_transport_dbg(this, &axi_gpio::transport_dbg);
+
+		SC_METHOD(input_changed);
+		sensitive << gpio_i;
+		dont_initialize();
+
+		SC_METHOD(update);
+		sensitive << update_ev;
+
+		SC_METHOD(drive);
+		sensitive << out_evq;
+		dont_initialize();
+	}
+
+private:
+	const uint32_t mask;
+	uint32_t data, tri, gie, isr, ier;
+	uint32_t last_i;
+	sc_event update_ev;
+	sc_event_queue out_evq;
+	std::deque<uint32_t> out_q;     /* gpio_o values, in time order */
+
+	void input_changed()
+	{
+		uint32_t in = gpio_i.read() & mask;
+
+		if ((in ^ last_i) & tri) {
+			isr |= 1;
+			update_ev.notify(SC_ZERO_TIME);
+		}
+		last_i = in;
+	}
+
+	/* drive the interrupt from the registers */
+	void update()
+	{
+		irq.write((gie & 0x80000000) && (isr & ier & 1));
+	}
+
+	void drive()
+	{
+		gpio_o.write(out_q.front());
+		out_q.pop_front();
+	}
+
+	bool access(tlm::tlm_generic_payload &gp, const sc_time &delay)
+	{
+		uint32_t *p, v;
+
+		if (!reg_access(gp, &p))
+			return false;
+		if (gp.is_read()) {
+			switch (gp.get_address()) {
+			case 0x000: v = ((gpio_i.read() & tri) | (data & ~tri)) & mask; break;
+			case 0x004: v = tri; break;
+			case 0x11C: v = gie; break;
+			case 0x120: v = isr; break;
+			case 0x128: v = ier; break;
+			default: v = 0; break;
+			}
+			*p = v;
+			return true;
+		}
+		v = *p;
+		switch (gp.get_address()) {
+		case 0x000: data = v & mask; break;
+		case 0x004: tri = v & mask; break;
+		case 0x11C: gie = v & 0x80000000; break;
+		case 0x120: isr ^= v & 1; break;
+		case 0x128: ier = v & 1; break;
+		default: break;
+		}
+		if (gp.get_address() <= 0x004) {
+			out_q.push_back(data & ~tri & mask);
+			out_evq.notify(delay);
+		}
+		update_ev.notify(delay);
+		return true;
+	}
+
+	void b_transport(tlm::tlm_generic_payload &gp, sc_time &delay)
+	{
+		access(gp, delay);
+	}
+
+	unsigned int transport_dbg(tlm::tlm_generic_payload &gp)
+	{
+		return gp.is_read() && access(gp, SC_ZERO_TIME) ? 4 : 0;
+	}
+};
+
+#endif
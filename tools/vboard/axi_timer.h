@@ -0,0 +1,276 @@
+/*
+ * axi_timer.h -- loosely timed model of the AXI Timer v2.0
+ *
+ * Two 32 bit counters on the 50 MHz s_axi_aclk, registers as in
+ * xtmrctr_l.h, counter 1 at 0x10:
+ *
+ *   0x00  TCSR   MDT UDT GENT CAPT ARHT LOAD ENIT ENT T0INT PWMA ENALL
+ *   0x04  TLR    load value
+ *   0x08  TCR    counter, read only
+ *
+ * Nothing ticks. A counter holds its value at the time it was last
+ * settled, and a read or a TCSR write first works out the value now from
+ * the clocks gone by. A down counter runs from TLR to 0 and reloads a
+ * clock later, a period of TLR + 2 clocks, an up counter from TLR to
+ * 0xFFFFFFFF, as the IP does. Each rollover sets T0INT; without ARHT the
+ * counter stops there. The rollover is only scheduled as an event while
+ * ENIT is set, so a free running counter costs nothing.
+ *
+ * With PWMA and GENT set in both counters and both running, pwm0 is high
+ * for the period of counter 1 out of each period of counter 0, the mode
+ * servo.c sets up. The period starts over on every register write, which
+ * is how the IP behaves across servo_set()'s stop and restart.
+ *
+ * Register writes take effect at the time annotated on the transaction:
+ * the counters are settled to it, and the interrupt and the rollover are
+ * scheduled from it, so an initiator running ahead in its quantum sees the
+ * timer as it would without temporal decoupling.
+ *
+ * Capture mode counts but takes no capture (capturetrig is not connected
+ * in the block design) and cascade mode is not modelled.
+ */
+#ifndef VBOARD_AXI_TIMER_H
+#define VBOARD_AXI_TIMER_H
+
+#include "bus.h"
+
+#define TCSR_MDT        0x001
+#define TCSR_UDT        0x002
+#define TCSR_GENT       0x004
+#define TCSR_ARHT       0x010
+#define TCSR_LOAD       0x020
+#define TCSR_ENIT       0x040
+#define TCSR_ENT        0x080
+#define TCSR_TINT       0x100
+#define TCSR_PWMA       0x200
+#define TCSR_ENALL      0x400
+
+class axi_timer : public sc_module
+{
+public:
+	tlm_utils::simple_target_socket<axi_timer> socket;
+	sc_out<bool> irq;
+	sc_out<bool> pwm0;
+
+	SC_HAS_PROCESS(axi_timer);
+	axi_timer(sc_module_name name)
+		: sc_module(name), socket("socket"), irq("irq"), pwm0("pwm0"),
+		  tick(FCLK0_PERIOD), irq_level(false), pwm_high(false), pwm_restart(false)
+	{
+		int i;
+
+		socket.register_b_transport(this, &axi_timer::b_transport);
+		socket.register_transport_dbg(this, &axi_timer::transport_dbg);
+		for (i = 0; i < 2; i++) {
+			t[i].tcsr = 0;
+			t[i].tlr = 0;
+			t[i].count = 0;
+		}
+
+		SC_METHOD(expire);
+		sensitive << expire_ev;
+		dont_initialize();
+
+		SC_METHOD(pwm);
+
+		SC_METHOD(drive);
+		sensitive << irq_ev;
+	}
+
+private:
+	struct counter {
+		uint32_t tcsr, tlr, count;
+		sc_time since;          /* when count was last settled */
+	} t[2];
+	const sc_time tick;
+	sc_event expire_ev, pwm_ev, irq_ev;
+	bool irq_level, pwm_high, pwm_restart;
+
+	static bool running(const struct counter *c)
+	{
+		return (c->tcsr & (TCSR_ENT | TCSR_LOAD)) == TCSR_ENT;
+	}
+
+	/* clocks in a period after the reload */
+	static uint64_t period(const struct counter *c)
+	{
+		return (c->tcsr & TCSR_UDT) ? (uint64_t)c->tlr + 2 :
+			(uint64_t)(0xFFFFFFFF - c->tlr) + 2;
+	}
+
+	/* clocks from the count to the next rollover */
+	static uint64_t to_rollover(const struct counter *c)
+	{
+		return (c->tcsr & TCSR_UDT) ? (uint64_t)c->count + 2 :
+			(uint64_t)(0xFFFFFFFF - c->count) + 2;
+	}
+
+	/* the value count reaches k clocks after a reload to TLR */
+	static uint32_t after(const struct counter *c, uint32_t from, uint64_t k)
+	{
+		if (c->tcsr & TCSR_UDT)
+			return k >= from ? 0 : from - (uint32_t)k;
+		return k >= 0xFFFFFFFFull - from ? 0xFFFFFFFF : from + (uint32_t)k;
+	}
+
+	/* bring c up to now */
+	void settle(struct counter *c, const sc_time &now)
+	{
+		uint64_t k, first;
+
+		if (!running(c) || now <= c->since) {
+			c->since = now > c->since ? now : c->since;
+			return;
+		}
+		k = (now - c->since).value() / tick.value();
+		c->since += (double)k * tick;
+		first = to_rollover(c);
+		if (k < first) {
+			c->count = after(c, c->count, k);
+			return;
+		}
+		if (!(c->tcsr & TCSR_MDT))
+			c->tcsr |= TCSR_TINT;
+		if (!(c->tcsr & TCSR_ARHT)) {
+			c->count = (c->tcsr & TCSR_UDT) ? 0 : 0xFFFFFFFF;
+			c->tcsr &= ~TCSR_ENT;
+			return;
+		}
+		c->count = after(c, c->tlr, (k - first) % period(c));
+	}
+
+	/* raise irq and arm the next rollover of the counters that interrupt */
+	void update(const sc_time &now)
+	{
+		sc_time next = SC_ZERO_TIME, global = sc_time_stamp();
+		bool level = false, armed = false;
+		int i;
+
+		for (i = 0; i < 2; i++) {
+			struct counter *c = &t[i];
+
+			if ((c->tcsr & (TCSR_TINT | TCSR_ENIT)) == (TCSR_TINT | TCSR_ENIT))
+				level = true;
+			if ((c->tcsr & TCSR_ENIT) && running(c) && !(c->tcsr & TCSR_MDT)) {
+				sc_time at = c->since + (double)to_rollover(c) * tick;
+
+				if (!armed || at < next)
+					next = at;
+				armed = true;
+			}
+		}
+		irq_level = level;
+		irq_ev.notify(now - global);
+		expire_ev.cancel();
+		if (armed)
+			expire_ev.notify(next > global ? next - global : SC_ZERO_TIME);
+	}
+
+	void drive()
+	{
+		irq.write(irq_level);
+	}
+
+	void expire()
+	{
+		sc_time now = sc_time_stamp();
+
+		settle(&t[0], now);
+		settle(&t[1], now);
+		update(now);
+	}
+
+	bool pwm_on() const
+	{
+		const uint32_t need = TCSR_PWMA | TCSR_GENT;
+
+		return (t[0].tcsr & need) == need && (t[1].tcsr & need) == need &&
+			running(&t[0]) && running(&t[1]);
+	}
+
+	void pwm()
+	{
+		sc_time high, low;
+
+		if (!pwm_on()) {
+			pwm_high = false;
+			pwm0.write(false);
+			next_trigger(pwm_ev);
+			return;
+		}
+		high = (double)period(&t[1]) * tick;
+		low = (double)period(&t[0]) * tick;
+		low = high < low ? low - high : SC_ZERO_TIME;
+		if (pwm_restart || !pwm_high || low == SC_ZERO_TIME) {
+			pwm_restart = false;
+			pwm_high = true;
+			pwm0.write(true);
+			next_trigger(high, pwm_ev);
+		} else {
+			pwm_high = false;
+			pwm0.write(false);
+			next_trigger(low, pwm_ev);
+		}
+	}
+
+	void write_tcsr(struct counter *c, uint32_t v)
+	{
+		uint32_t clear = v & TCSR_TINT;
+
+		c->tcsr = (v & ~(TCSR_TINT | TCSR_ENALL)) | (c->tcsr & TCSR_TINT & ~clear);
+		if (v & TCSR_ENALL) {
+			t[0].tcsr |= TCSR_ENT;
+			t[1].tcsr |= TCSR_ENT;
+		}
+		if (c->tcsr & TCSR_LOAD)
+			c->count = c->tlr;
+	}
+
+	bool access(tlm::tlm_generic_payload &gp, const sc_time &now)
+	{
+		uint64_t addr = gp.get_address();
+		struct counter *c;
+		uint32_t *p;
+
+		if (!reg_access(gp, &p))
+			return false;
+		if (addr >= 0x20) {
+			if (gp.is_read())
+				*p = 0;
+			return true;
+		}
+		c = &t[addr >> 4];
+		settle(&t[0], now);
+		settle(&t[1], now);
+		if (gp.is_read()) {
+			switch (addr & 0xF) {
+			case 0x0: *p = c->tcsr; break;
+			case 0x4: *p = c->tlr; break;
+			case 0x8: *p = c->count; break;
+			default: *p = 0; break;
+			}
+			return true;
+		}
+		switch (addr & 0xF) {
+		case 0x0: write_tcsr(c, *p); break;
+		case 0x4: c->tlr = *p; break;
+		default: return true;
+		}
+		update(now);
+		pwm_restart = true;
+		pwm_ev.notify(now - sc_time_stamp());
+		return true;
+	}
+
+	void b_transport(tlm::tlm_generic_payload &gp, sc_time &delay)
+	{
+		access(gp, sc_time_stamp() + delay);
+	}
+
+	unsigned int transport_dbg(tlm::tlm_generic_payload &gp)
+	{
+		return gp.is_read() && access(gp, sc_time_stamp()) ? 4 : 0;
+	}
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * bus.h -- the AXI interconnect on M_AXI_GP0 of the virtual board
+ *
+ * ps7_0_axi_periph decodes the GP0 window into one 64 KB slot per
+ * peripheral. The model forwards a transaction to the target whose range
+ * holds its address, with the address made relative to the base, so the
+ * peripheral models see register offsets as in the drivers' _l.h headers.
+ * An access outside every range gets TLM_ADDRESS_ERROR_RESPONSE, which
+ * the PS turns into a data abort, as a DECERR from the interconnect is.
+ *
+ * Every routed access costs ACCESS_CYCLES of the 50 MHz interconnect
+ * clock, added to the transaction's delay as loosely timed models do.
+ *
+ * reg_access() is the common front of the register models: 32 bit,
+ * aligned, no byte enables, as the AXI-Lite slaves take.
+ */
+#ifndef VBOARD_BUS_H
+#define VBOARD_BUS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "systemc.h"
+#include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/simple_target_socket.h"
+
+#define ACCESS_CYCLES   5
+#define FCLK0_PERIOD    sc_time(20, SC_NS)
+
+/*
+ * reg_access -- check gp is a register access and point data at its word
+ *
+ * returns false, with the response status set, when it is not
+ */
+static inline bool reg_access(tlm::tlm_generic_payload &gp, uint32_t **data)
+{
+	if (gp.get_data_length() != 4 || (gp.get_address() & 3) != 0 ||
+	    gp.get_streaming_width() < 4) {
+		gp.set_response_status(tlm::TLM_BURST_ERROR_RESPONSE);
+		return false;
+	}
+	if (gp.get_byte_enable_ptr() != NULL) {
+		gp.set_response_status(tlm::TLM_BYTE_ENABLE_ERROR_RESPONSE);
+		return false;
+	}
+	*data = (uint32_t *)gp.get_data_ptr();
+	gp.set_response_status(tlm::TLM_OK_RESPONSE);
+	return true;
+}
+
+class vboard_bus : public sc_module
+{
+public:
+	tlm_utils::simple_target_socket<vboard_bus> t_sk;
+
+	SC_HAS_PROCESS(vboard_bus);
+	vboard_bus(sc_module_name name)
+		: sc_module(name), t_sk("t_sk")
+	{
+		t_sk.register_b_transport(this, &vboard_bus::b_transport);
+		t_sk.register_transport_dbg(this, &vboard_bus::transport_dbg);
+	}
+
+	~vboard_bus()
+	{
+		for (size_t i = 0; i < map.size(); i++)
+			delete map[i].sk;
+	}
+
+	/*
+	 * attach -- map size bytes at base to a new initiator socket, to be
+	 * bound to the peripheral's target socket
+	 */
+	tlm_utils::simple_initiator_socket<vboard_bus> &attach(uint64_t base, uint64_t size)
+	{
+		struct range r;
+		char name[32];
+
+		snprintf(name, sizeof(name), "i_sk%zu", map.size());
+		r.base = base;
+		r.size = size;
+		r.sk = new tlm_utils::simple_initiator_socket<vboard_bus>(name);
+		map.push_back(r);
+		return *r.sk;
+	}
+
+private:
+	struct range {
+		uint64_t base;
+		uint64_t size;
+		tlm_utils::simple_initiator_socket<vboard_bus> *sk;
+	};
+	std::vector<struct range> map;
+
+	struct range *decode(uint64_t addr)
+	{
+		for (size_t i = 0; i < map.size(); i++)
+			if (addr - map[i].base < map[i].size)
+				return &map[i];
+		return NULL;
+	}
+
+	void b_transport(tlm::tlm_generic_payload &gp, sc_time &delay)
+	{
+		uint64_t addr = gp.get_address();
+		struct range *r = decode(addr);
+
+		if (r == NULL) {
+			gp.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+			return;
+		}
+		delay += ACCESS_CYCLES * FCLK0_PERIOD;
+		gp.set_address(addr - r->base);
+		(*r->sk)->b_transport(gp, delay);
+		gp.set_address(addr);
+	}
+
+	unsigned int transport_dbg(tlm::tlm_generic_payload &gp)
+	{
+		uint64_t addr = gp.get_address();
+		struct range *r = decode(addr);
+		unsigned int n;
+
+		if (r == NULL)
+			return 0;
+		gp.set_address(addr - r->base);
+		n = (*r->sk)->transport_dbg(gp);
+		gp.set_address(addr);
+		return n;
+	}
+};
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * vboard.cc -- the module6 board around the PS7 in Xilinx QEMU
+ *
+ * The PS runs in QEMU with the firmware ELF; this is the PL side of the
+ * block design, joined to QEMU by remote-port through the xilinx_zynq
+ * wrapper in the PS7 IP's sim_tlm directory. M_AXI_GP0 goes through the
+ * interconnect model to the peripherals at their xparameters.h addresses:
+ *
+ *   0x41200000  axi_gpio_0   LD0-3
+ *   0x41210000  axi_gpio_1   BTN0-3, interrupt on IRQ_F2P[0] (GIC 61)
+ *   0x41220000  axi_gpio_2   SW0-3, interrupt on IRQ_F2P[1] (GIC 62)
+ *   0x41230000  axi_gpio_3   LD6, the RGB LED
+ *   0x42800000  axi_timer_0  pwm0 to the servo
+ *   0x43C00000  xadc_wiz_0   the pot on VAUX14
+ *
+ * The timer's and the XADC's interrupts are not on xlconcat_0 in the block
+ * design and are left unconnected here too.
+ *
+ * A script drives the buttons, the switches and the XADC inputs at set
+ * times, one event a line, # to the end of a line a comment:
+ *
+ *   2s       btn 0x1      buttons, BTN0 bit 0
+ *   2.05s    btn 0
+ *   3s       sw 0x3       switches
+ *   4s       pot 0.42     volts at VAUX14, 0 to 1
+ *   5s       temp 90      die temperature, degrees C
+ *   5s       vccint 0.93  volts, vccaux as well
+ *   60s      quit
+ *
+ * Times are of the simulation, in s, ms, us or ns, and in order. The LEDs,
+ * the RGB LED and the servo duty cycle measured on pwm0 are printed as
+ * they change, with the time.
+ *
+ * The firmware's adc.c reads the XADC through XAdcPs, the PS side DEVCFG
+ * interface that QEMU models, and not through xadc_wiz_0, so pot, temp
+ * and vccint reach code that uses the XSysMon driver only.
+ *
+ * QEMU is started first, with a Zynq co-simulation device tree, whose
+ * remote-port node is named cosim, and -machine-path DIR, where QEMU
+ * makes the socket that vboard then connects to:
+ *
+ *   qemu-system-aarch64 -M arm-generic-fdt-7series -serial /dev/null \
+ *       -serial mon:stdio -display none -kernel fsm.elf \
+ *       -dtb zynq-cosim.dtb -machine-path DIR -sync-quantum 10000
+ *   vboard -s board.script unix:DIR/qemu-rport-_cosim@0
+ *
+ * QEMU waits at reset until vboard has connected.
+ *
+ * SystemC runs ahead of QEMU by up to the global quantum before the two
+ * sync over remote-port, the peripherals taking each access at the time
+ * annotated on it. A longer quantum runs faster; the cost is that an input
+ * change reaches the firmware up to a quantum late. It should be about
+ * QEMU's -sync-quantum, which is in ns.
+ *
+ * usage: vboard [-s script] [-q quantum] unix:DIR/qemu-rport-_cosim@0
+ *   -s  script of input events (default none, run until QEMU exits)
+ *   -q  global quantum, in s, ms, us or ns (default 10us)
+ */
+#define SC_INCLUDE_DYNAMIC_PROCESSES
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "systemc.h"
+#include "tlm_utils/simple_initiator_socket.h"
+#include "tlm_utils/simple_target_socket.h"
+
+#include "xilinx-zynq.h"
+#include "bus.h"
+#include "axi_gpio.h"
+#include "axi_timer.h"
+#include "xadc_wiz.h"
+
+#define POT_VAUX        14
+
+struct script_event {
+	sc_time at;
+	char what[16];
+	double value;
+};
+
+class vboard : public sc_module
+{
+public:
+	SC_HAS_PROCESS(vboard);
+	vboard(sc_module_name name, const char *sk_descr, std::vector<struct script_event> &script)
+		: sc_module(name), zynq("zynq", sk_descr), bus("bus"),
+		  leds("axi_gpio_0", 4), btns("axi_gpio_1", 4), sws("axi_gpio_2", 4),
+		  rgb("axi_gpio_3", 3), timer("axi_timer_0"), xadc("xadc_wiz_0"),
+		  script(script), duty(-1)
+	{
+		bus.attach(0x41200000, 0x10000).bind(leds.socket);
+		bus.attach(0x41210000, 0x10000).bind(btns.socket);
+		bus.attach(0x41220000, 0x10000).bind(sws.socket);
+		bus.attach(0x41230000, 0x10000).bind(rgb.socket);
+		bus.attach(0x42800000, 0x10000).bind(timer.socket);
+		bus.attach(0x43C00000, 0x10000).bind(xadc.socket);
+		zynq.m_axi_gp[0]->bind(bus.t_sk);
+
+		leds.gpio_i(zero);
+		leds.gpio_o(led_pins);
+		leds.irq(unused[0]);
+		btns.gpio_i(btn_pins);
+		btns.gpio_o(unused_o[0]);
+		btns.irq(zynq.pl2ps_irq[0]);
+		sws.gpio_i(sw_pins);
+		sws.gpio_o(unused_o[1]);
+		sws.irq(zynq.pl2ps_irq[1]);
+		rgb.gpio_i(zero);
+		rgb.gpio_o(rgb_pins);
+		rgb.irq(unused[1]);
+		timer.irq(unused[2]);
+		timer.pwm0(pwm0);
+		xadc.irq(unused[3]);
+
+		zynq.rst(rst);
+		zynq.tie_off();
+
+		SC_THREAD(pull_reset);
+		SC_THREAD(play);
+
+		SC_METHOD(show_leds);
+		sensitive << led_pins << rgb_pins;
+		dont_initialize();
+
+		SC_METHOD(measure_pwm);
+		sensitive << pwm0;
+		dont_initialize();
+	}
+
+private:
+	xilinx_zynq zynq;
+	vboard_bus bus;
+	axi_gpio leds, btns, sws, rgb;
+	axi_timer timer;
+	xadc_wiz xadc;
+
+	sc_signal<bool> rst;
+	sc_signal<uint32_t> zero, led_pins, btn_pins, sw_pins, rgb_pins;
+	sc_signal<uint32_t> unused_o[2];
+	sc_signal<bool> unused[4];
+	sc_signal<bool> pwm0;
+
+	std::vector<struct script_event> &script;
+	sc_time rise, high;
+	double duty;
+
+	void pull_reset()
+	{
+		rst.write(true);
+		wait(1, SC_US);
+		rst.write(false);
+	}
+
+	void play()
+	{
+		size_t i;
+
+		for (i = 0; i < script.size(); i++) {
+			struct script_event *e = &script[i];
+
+			if (e->at > sc_time_stamp())
+				wait(e->at - sc_time_stamp());
+			if (strcmp(e->what, "btn") == 0)
+				btn_pins.write((uint32_t)e->value);
+			else if (strcmp(e->what, "sw") == 0)
+				sw_pins.write((uint32_t)e->value);
+			else if (strcmp(e->what, "pot") == 0)
+				xadc.set_aux(POT_VAUX, e->value);
+			else if (strcmp(e->what, "temp") == 0)
+				xadc.set_temp(e->value);
+			else if (strcmp(e->what, "vccint") == 0)
+				xadc.set_vccint(e->value);
+			else if (strcmp(e->what, "vccaux") == 0)
+				xadc.set_vccaux(e->value);
+			else if (strcmp(e->what, "quit") == 0)
+				sc_stop();
+		}
+	}
+
+	void show_leds()
+	{
+		uint32_t l = led_pins.read(), c = rgb_pins.read();
+
+		printf("%12.6f leds %c%c%c%c rgb %c%c%c\n", sc_time_stamp().to_seconds(),
+		       l & 8 ? '*' : '.', l & 4 ? '*' : '.', l & 2 ? '*' : '.', l & 1 ? '*' : '.',
+		       c & 4 ? 'r' : '.', c & 2 ? 'g' : '.', c & 1 ? 'b' : '.');
+	}
+
+	/* the duty cycle of each whole period, printed when it moves */
+	void measure_pwm()
+	{
+		sc_time now = sc_time_stamp();
+		double d;
+
+		if (!pwm0.read()) {
+			high = now - rise;
+			return;
+		}
+		if (rise != SC_ZERO_TIME && now > rise) {
+			d = 100.0 * (high / (now - rise));
+			if (d < duty - 0.005 || d > duty + 0.005) {
+				printf("%12.6f servo %.2f%% of %.3f ms\n", now.to_seconds(), d,
+				       (now - rise).to_seconds() * 1e3);
+				duty = d;
+			}
+		}
+		rise = now;
+	}
+};
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: vboard [-s script] [-q quantum] unix:DIR/qemu-rport-_cosim@0\n");
+	exit(2);
+}
+
+/* seconds in a unit of time, 0 if it is not one */
+static double unit_scale(const char *unit)
+{
+	if (strcmp(unit, "s") == 0)
+		return 1;
+	if (strcmp(unit, "ms") == 0)
+		return 1e-3;
+	if (strcmp(unit, "us") == 0)
+		return 1e-6;
+	if (strcmp(unit, "ns") == 0)
+		return 1e-9;
+	return 0;
+}
+
+static void load(const char *path, std::vector<struct script_event> &script)
+{
+	FILE *f = fopen(path, "r");
+	char line[256], unit[8], *hash;
+	struct script_event e;
+	double t, scale;
+	int n = 0, fields;
+
+	if (f == NULL) {
+		perror(path);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		n++;
+		if ((hash = strchr(line, '#')) != NULL)
+			*hash = '\0';
+		e.value = 0;
+		unit[0] = '\0';
+		fields = sscanf(line, "%lf%7[a-z] %15s %lf", &t, unit, e.what, &e.value);
+		if (fields <= 0)
+			continue;
+		scale = unit_scale(unit);
+		if (fields < 3 || scale == 0 ||
+		    (fields < 4 && strcmp(e.what, "quit") != 0) ||
+		    (strcmp(e.what, "btn") != 0 && strcmp(e.what, "sw") != 0 &&
+		     strcmp(e.what, "pot") != 0 && strcmp(e.what, "temp") != 0 &&
+		     strcmp(e.what, "vccint") != 0 && strcmp(e.what, "vccaux") != 0 &&
+		     strcmp(e.what, "quit") != 0)) {
+			fprintf(stderr, "%s:%d: bad event\n", path, n);
+			exit(1);
+		}
+		e.at = sc_time(t * scale, SC_SEC);
+		if (!script.empty() && e.at < script.back().at) {
+			fprintf(stderr, "%s:%d: out of order\n", path, n);
+			exit(1);
+		}
+		script.push_back(e);
+	}
+	fclose(f);
+}
+
+int sc_main(int argc, char *argv[])
+{
+	std::vector<struct script_event> script;
+	vboard *board;
+	char unit[8], end;
+	double q = 10e-6;
+	int opt;
+
+	sc_set_time_resolution(1, SC_PS);
+	while ((opt = getopt(argc, argv, "s:q:")) != -1) {
+		switch (opt) {
+		case 's': load(optarg, script); break;
+		case 'q':
+			if (sscanf(optarg, "%lf%7[a-z]%c", &q, unit, &end) != 2 ||
+			    q < 0 || unit_scale(unit) == 0)
+				usage();
+			q *= unit_scale(unit);
+			break;
+		default: usage();
+		}
+	}
+	if (argc - optind != 1)
+		usage();
+
+	/* remote-port syncs with QEMU at most this far apart */
+	tlm::tlm_global_quantum::instance().set(sc_time(q, SC_SEC));
+	board = new vboard("vboard", argv[optind], script);
+	sc_start();
+	delete board;
+	return 0;
+}
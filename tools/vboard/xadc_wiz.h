@@ -0,0 +1,303 @@
+/*
+ * xadc_wiz.h -- loosely timed model of the XADC Wizard v3.3 AXI interface
+ *
+ * Registers as in xsysmon_hw.h (XADC, so XSM_IP_OFFSET is 0):
+ *
+ *   0x000  SRR     0xA resets the IP
+ *   0x004  SR      EOS and EOC always set, never BUSY
+ *   0x008  AOR     alarm outputs: OT, ALM0 temp, ALM1 VCCINT, ALM2 VCCAUX
+ *   0x010  ARR     resets the ADC: min/max start over
+ *   0x05C  GIER
+ *   0x060  IPISR   a write toggles, as in the IP
+ *   0x068  IPIER
+ *   0x200  the XADC's DRP registers, 4 bytes apart: measurements at
+ *          0x200 (0x00), min/max at 0x280 (0x20), configuration at 0x300
+ *          (0x40) and alarm thresholds at 0x340 (0x50)
+ *
+ * The inputs are set by the board in volts and degrees with set_temp(),
+ * set_vccint(), set_vccaux() and set_aux(); the model holds the codes the
+ * ADC would return, 12 bits left aligned. There is no conversion clock:
+ * a new input is taken as converted at once, min/max and the alarms are
+ * worked out then and the alarm interrupts raised. The end of conversion
+ * and end of sequence interrupts are scheduled, one conversion per
+ * channel every CONV_TIME, only while they are enabled in IPIER, so the
+ * sequencer costs nothing unless the firmware asks for them.
+ *
+ * Register writes take effect at the time annotated on the transaction,
+ * for the interrupt and the next conversion alike.
+ *
+ * The temperature alarm and OT have hysteresis (set above the upper
+ * threshold, cleared below the lower one), the supply alarms are outside
+ * [lower, upper]. Configuration register 1 disables them bit by bit.
+ */
+#ifndef VBOARD_XADC_WIZ_H
+#define VBOARD_XADC_WIZ_H
+
+#include "bus.h"
+
+#define CONV_TIME       sc_time(1, SC_US)       /* 1 MSPS */
+
+#define XADC_TEMP       0x00
+#define XADC_VCCINT     0x01
+#define XADC_VCCAUX     0x02
+#define XADC_VBRAM      0x06
+#define XADC_AUX0       0x10
+#define XADC_MAX        0x20    /* temp, vccint, vccaux, vbram */
+#define XADC_MIN        0x24
+#define XADC_CFR1       0x41
+#define XADC_SEQ00      0x48
+#define XADC_SEQ01      0x49
+#define XADC_ATR        0x50    /* temp, vccint, vccaux, OT upper, then lower */
+
+#define ALM_OT          0x01
+#define ALM_TEMP        0x02
+#define ALM_VCCINT      0x04
+#define ALM_VCCAUX      0x08
+#define ISR_EOS         0x10
+#define ISR_EOC         0x20
+#define ISR_OT_OFF      0x100
+#define ISR_TEMP_OFF    0x200
+
+class xadc_wiz : public sc_module
+{
+public:
+	tlm_utils::simple_target_socket<xadc_wiz> socket;
+	sc_out<bool> irq;
+
+	SC_HAS_PROCESS(xadc_wiz);
+	xadc_wiz(sc_module_name name)
+		: sc_module(name), socket("socket"), irq("irq")
+	{
+		socket.register_b_transport(this, &xadc_wiz::b_transport);
+		socket.register_transport_dbg(this, &xadc_wiz::transport_dbg);
+		memset(drp, 0, sizeof(drp));
+		drp[XADC_TEMP] = temp_code(40.0);
+		drp[XADC_VCCINT] = supply_code(1.0);
+		drp[XADC_VCCAUX] = supply_code(1.8);
+		drp[XADC_VBRAM] = supply_code(1.0);
+		reset(SC_ZERO_TIME);
+
+		SC_METHOD(sequence);
+		sensitive << seq_ev;
+		dont_initialize();
+
+		SC_METHOD(drive);
+		sensitive << irq_ev;
+	}
+
+	void set_temp(double c) { convert(XADC_TEMP, temp_code(c)); }
+	void set_vccint(double v) { convert(XADC_VCCINT, supply_code(v)); }
+	void set_vccaux(double v) { convert(XADC_VCCAUX, supply_code(v)); }
+
+	/* unipolar, 0 to 1 V at VAUXP[n] - VAUXN[n] */
+	void set_aux(int n, double v) { convert(XADC_AUX0 + n, code(v)); }
+
+private:
+	uint16_t drp[0x80];
+	uint32_t gier, isr, ier, alarms;
+	sc_event seq_ev, irq_ev;
+
+	static uint16_t code(double full_scale)
+	{
+		if (full_scale <= 0)
+			return 0;
+		if (full_scale >= 1)
+			return 0xFFF0;
+		return (uint16_t)(full_scale * 4096) << 4;
+	}
+
+	/* UG480: T = code * 503.975 / 4096 - 273.15 */
+	static uint16_t temp_code(double c)
+	{
+		return code((c + 273.15) / 503.975);
+	}
+
+	/* UG480: V = code / 4096 * 3 */
+	static uint16_t supply_code(double v)
+	{
+		return code(v / 3);
+	}
+
+	/* defaults as UG480 table 3-7 and the IP after SRR */
+	void reset(const sc_time &delay)
+	{
+		static const uint16_t atr[16] = {
+			0xB5ED, 0x5999, 0xA147, 0xCA33, 0xA93A, 0x5111, 0x91EB, 0xAE4E,
+		};
+		int i;
+
+		memset(drp + 0x40, 0, sizeof(drp) - 0x40 * sizeof(drp[0]));
+		for (i = 0; i < 16; i++)
+			drp[XADC_ATR + i] = atr[i];
+		reset_adc();
+		gier = 0;
+		isr = 0;
+		ier = 0;
+		alarms = 0;
+		update(delay);
+	}
+
+	void reset_adc()
+	{
+		int i;
+
+		for (i = 0; i < 4; i++) {
+			drp[XADC_MAX + i] = 0x0000;
+			drp[XADC_MIN + i] = 0xFFFF;
+		}
+		minmax(XADC_TEMP, 0);
+		minmax(XADC_VCCINT, 1);
+		minmax(XADC_VCCAUX, 2);
+		minmax(XADC_VBRAM, 3);
+	}
+
+	void minmax(int ch, int i)
+	{
+		if (drp[ch] > drp[XADC_MAX + i])
+			drp[XADC_MAX + i] = drp[ch];
+		if (drp[ch] < drp[XADC_MIN + i])
+			drp[XADC_MIN + i] = drp[ch];
+	}
+
+	void convert(int ch, uint16_t v)
+	{
+		drp[ch] = v;
+		if (ch == XADC_TEMP)
+			minmax(ch, 0);
+		else if (ch == XADC_VCCINT)
+			minmax(ch, 1);
+		else if (ch == XADC_VCCAUX)
+			minmax(ch, 2);
+		check_alarms(SC_ZERO_TIME);
+	}
+
+	/* set above upper, cleared below lower */
+	static bool hysteresis(bool on, uint16_t v, uint16_t upper, uint16_t lower)
+	{
+		return on ? v >= lower : v > upper;
+	}
+
+	/* the OT upper threshold only counts with its low nibble 0x3, else 125 C */
+	void check_alarms(const sc_time &delay)
+	{
+		uint16_t cfr1 = drp[XADC_CFR1], ot_upper = drp[XADC_ATR + 3];
+		uint32_t active = 0, rise, fall;
+
+		if ((ot_upper & 0xF) != 0x3)
+			ot_upper = temp_code(125.0);
+		if (!(cfr1 & 0x0001) &&
+		    hysteresis(alarms & ALM_OT, drp[XADC_TEMP], ot_upper, drp[XADC_ATR + 7]))
+			active |= ALM_OT;
+		if (!(cfr1 & 0x0002) &&
+		    hysteresis(alarms & ALM_TEMP, drp[XADC_TEMP], drp[XADC_ATR + 0], drp[XADC_ATR + 4]))
+			active |= ALM_TEMP;
+		if (!(cfr1 & 0x0004) &&
+		    (drp[XADC_VCCINT] > drp[XADC_ATR + 1] || drp[XADC_VCCINT] < drp[XADC_ATR + 5]))
+			active |= ALM_VCCINT;
+		if (!(cfr1 & 0x0008) &&
+		    (drp[XADC_VCCAUX] > drp[XADC_ATR + 2] || drp[XADC_VCCAUX] < drp[XADC_ATR + 6]))
+			active |= ALM_VCCAUX;
+		rise = active & ~alarms;
+		fall = alarms & ~active;
+		isr |= rise;
+		if (fall & ALM_OT)
+			isr |= ISR_OT_OFF;
+		if (fall & ALM_TEMP)
+			isr |= ISR_TEMP_OFF;
+		alarms = active;
+		update(delay);
+	}
+
+	/* channels the sequencer converts, at least the one it sits on */
+	int channels() const
+	{
+		uint32_t sel = drp[XADC_SEQ00] | (uint32_t)drp[XADC_SEQ01] << 16;
+		int n = 0;
+
+		while (sel != 0) {
+			n += sel & 1;
+			sel >>= 1;
+		}
+		return n != 0 ? n : 1;
+	}
+
+	void drive()
+	{
+		irq.write((gier & 0x80000000) && (isr & ier));
+	}
+
+	void update(const sc_time &delay)
+	{
+		irq_ev.notify(delay);
+		seq_ev.cancel();
+		if (ier & (ISR_EOC | ISR_EOS))
+			seq_ev.notify(delay + CONV_TIME);
+	}
+
+	/* a whole sequence at once: one EOC a channel would only be merged */
+	void sequence()
+	{
+		isr |= ISR_EOC | ISR_EOS;
+		drive();
+		if (ier & (ISR_EOC | ISR_EOS))
+			seq_ev.notify((double)channels() * CONV_TIME);
+	}
+
+	bool access(tlm::tlm_generic_payload &gp, const sc_time &delay)
+	{
+		uint64_t addr = gp.get_address();
+		uint32_t *p, v;
+
+		if (!reg_access(gp, &p))
+			return false;
+		if (gp.is_read()) {
+			if (addr >= 0x200 && addr < 0x400)
+				v = drp[(addr - 0x200) >> 2];
+			else if (addr == 0x004)
+				v = 0x60;
+			else if (addr == 0x008)
+				v = alarms & 0xF;
+			else if (addr == 0x05C)
+				v = gier;
+			else if (addr == 0x060)
+				v = isr;
+			else if (addr == 0x068)
+				v = ier;
+			else
+				v = 0;
+			*p = v;
+			return true;
+		}
+		v = *p;
+		if (addr >= 0x300 && addr < 0x400) {
+			drp[(addr - 0x200) >> 2] = (uint16_t)v;
+			check_alarms(delay);
+		} else if (addr == 0x000 && v == 0xA) {
+			reset(delay);
+		} else if (addr == 0x010) {
+			reset_adc();
+		} else if (addr == 0x05C) {
+			gier = v & 0x80000000;
+			update(delay);
+		} else if (addr == 0x060) {
+			isr ^= v & 0x3C7FF;
+			update(delay);
+		} else if (addr == 0x068) {
+			ier = v & 0x3C7FF;
+			update(delay);
+		}
+		return true;
+	}
+
+	void b_transport(tlm::tlm_generic_payload &gp, sc_time &delay)
+	{
+		access(gp, delay);
+	}
+
+	unsigned int transport_dbg(tlm::tlm_generic_payload &gp)
+	{
+		return gp.is_read() && access(gp, SC_ZERO_TIME) ? 4 : 0;
+	}
+};
+
+#endif